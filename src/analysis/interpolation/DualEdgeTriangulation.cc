@@ -35,12 +35,9 @@ DualEdgeTriangulation::~DualEdgeTriangulation()
   }
 
   //remove all the HalfEdge
-  if ( mHalfEdge.count() > 0 )
+  for ( int i = 0; i < mHalfEdgeBlocks.count(); i++ )
   {
-    for ( int i = 0; i < mHalfEdge.count(); i++ )
-    {
-      delete mHalfEdge[i];
-    }
+    delete[] mHalfEdgeBlocks[i];
   }
 }
 
@@ -1189,7 +1186,14 @@ bool DualEdgeTriangulation::getTriangle( double x, double y, Point3D* p1, Point3
 
 unsigned int DualEdgeTriangulation::insertEdge( int dual, int next, int point, bool mbreak, bool forced )
 {
-  HalfEdge* edge = new HalfEdge( dual, next, point, mbreak, forced );
+  if ( mHalfEdgeBlockUsed == mHalfEdgeBlockSize )
+  {
+    mHalfEdgeBlocks.append( new HalfEdge[mHalfEdgeBlockSize] );
+    mHalfEdgeBlockUsed = 0;
+  }
+  HalfEdge* edge = mHalfEdgeBlocks.last() + mHalfEdgeBlockUsed;
+  ++mHalfEdgeBlockUsed;
+  *edge = HalfEdge( dual, next, point, mbreak, forced );
   mHalfEdge.append( edge );
   return mHalfEdge.count() - 1;
 
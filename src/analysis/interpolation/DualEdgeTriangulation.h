@@ -125,6 +125,12 @@ class ANALYSIS_EXPORT DualEdgeTriangulation: public Triangulation
     const static unsigned int mDefaultStorageForHalfEdges = 300006;
     /**Stores pointers to the HalfEdges*/
     QVector<HalfEdge*> mHalfEdge;
+    /**Number of HalfEdges allocated at once*/
+    const static int mHalfEdgeBlockSize = 65536;
+    /**The HalfEdges are allocated in blocks of mHalfEdgeBlockSize instead of one by one. Their addresses stay valid while the triangulation exists*/
+    QList<HalfEdge*> mHalfEdgeBlocks;
+    /**Number of used HalfEdges in the last block*/
+    int mHalfEdgeBlockUsed;
     /**Association to an interpolator object*/
     TriangleInterpolator* mTriangleInterpolator;
     /**Member to store the behaviour in case of crossing forced segments*/
@@ -181,16 +187,16 @@ class ANALYSIS_EXPORT DualEdgeTriangulation: public Triangulation
     void evaluateInfluenceRegion( Point3D* point, int edge, std::set<int>* set );
 };
 
-inline DualEdgeTriangulation::DualEdgeTriangulation() : xMax( 0 ), xMin( 0 ), yMax( 0 ), yMin( 0 ), mTriangleInterpolator( 0 ), mForcedCrossBehaviour( Triangulation::DELETE_FIRST ), mEdgeColor( 0, 255, 0 ), mForcedEdgeColor( 0, 0, 255 ), mBreakEdgeColor( 100, 100, 0 ), mDecorator( this )
+inline DualEdgeTriangulation::DualEdgeTriangulation() : xMax( 0 ), xMin( 0 ), yMax( 0 ), yMin( 0 ), mHalfEdgeBlockUsed( mHalfEdgeBlockSize ), mTriangleInterpolator( 0 ), mForcedCrossBehaviour( Triangulation::DELETE_FIRST ), mEdgeColor( 0, 255, 0 ), mForcedEdgeColor( 0, 0, 255 ), mBreakEdgeColor( 100, 100, 0 ), mDecorator( this )
 {
   mPointVector.reserve( mDefaultStorageForPoints );
   mHalfEdge.reserve( mDefaultStorageForHalfEdges );
 }
 
-inline DualEdgeTriangulation::DualEdgeTriangulation( int nop, Triangulation* decorator ): xMax( 0 ), xMin( 0 ), yMax( 0 ), yMin( 0 ), mTriangleInterpolator( 0 ), mForcedCrossBehaviour( Triangulation::DELETE_FIRST ), mEdgeColor( 0, 255, 0 ), mForcedEdgeColor( 0, 0, 255 ), mBreakEdgeColor( 100, 100, 0 ), mDecorator( decorator )
+inline DualEdgeTriangulation::DualEdgeTriangulation( int nop, Triangulation* decorator ): xMax( 0 ), xMin( 0 ), yMax( 0 ), yMin( 0 ), mHalfEdgeBlockUsed( mHalfEdgeBlockSize ), mTriangleInterpolator( 0 ), mForcedCrossBehaviour( Triangulation::DELETE_FIRST ), mEdgeColor( 0, 255, 0 ), mForcedEdgeColor( 0, 0, 255 ), mBreakEdgeColor( 100, 100, 0 ), mDecorator( decorator )
 {
   mPointVector.reserve( nop );
-  mHalfEdge.reserve( nop );
+  mHalfEdge.reserve( 3 * nop );
   if ( !mDecorator )
   {
     mDecorator = this;
@@ -1,3 +1,93 @@
 #include "Triangulation.h"
+#include <QtAlgorithms>
 
-//empty file (abstract class)
+/**Minimal number of points of an insertion round. Smaller sets are inserted in a single (the first) round*/
+static const int sMinRoundSize = 64;
+/**Resolution of the grid the hilbert curve is built on (2^16 x 2^16 cells)*/
+static const unsigned int sHilbertGridSize = 65536;
+
+/**Point with its position on the hilbert curve*/
+struct HilbertItem
+{
+  unsigned int key;
+  Point3D* point;
+  bool operator<( const HilbertItem& other ) const { return key < other.key; }
+};
+
+/**Returns the distance of the grid cell x/y along the hilbert curve*/
+static unsigned int hilbertKey( unsigned int x, unsigned int y )
+{
+  unsigned int d = 0;
+  for ( unsigned int s = sHilbertGridSize / 2; s > 0; s /= 2 )
+  {
+    unsigned int rx = ( x & s ) > 0;
+    unsigned int ry = ( y & s ) > 0;
+    d += s * s * (( 3 * rx ) ^ ry );
+    //rotate the quadrant
+    if ( ry == 0 )
+    {
+      if ( rx == 1 )
+      {
+        x = sHilbertGridSize - 1 - x;
+        y = sHilbertGridSize - 1 - y;
+      }
+      unsigned int t = x;
+      x = y;
+      y = t;
+    }
+  }
+  return d;
+}
+
+void Triangulation::addPoints( QVector<Point3D*>& points )
+{
+  int n = points.size();
+  if ( n == 0 )
+  {
+    return;
+  }
+
+  //bounding box of the input
+  double xmin = points[0]->getX(), xmax = xmin;
+  double ymin = points[0]->getY(), ymax = ymin;
+  for ( int i = 1; i < n; ++i )
+  {
+    xmin = qMin( xmin, points[i]->getX() );
+    xmax = qMax( xmax, points[i]->getX() );
+    ymin = qMin( ymin, points[i]->getY() );
+    ymax = qMax( ymax, points[i]->getY() );
+  }
+  double extent = qMax( xmax - xmin, ymax - ymin );
+  double scale = extent > 0 ? ( sHilbertGridSize - 1 ) / extent : 0;
+
+  //shuffle with a fixed seed, so that the triangulation does not depend on the input order, but is reproducible
+  QVector<HilbertItem> items( n );
+  unsigned int random = 12345;
+  for ( int i = 0; i < n; ++i )
+  {
+    items[i].point = points[i];
+    items[i].key = hilbertKey(( unsigned int )(( points[i]->getX() - xmin ) * scale ), ( unsigned int )(( points[i]->getY() - ymin ) * scale ) );
+  }
+  for ( int i = n - 1; i > 0; --i )
+  {
+    random = random * 1103515245 + 12345;
+    int j = ( random >> 8 ) % ( i + 1 );
+    qSwap( items[i], items[j] );
+  }
+
+  //biased randomized insertion order: the last round contains half of the points, the one before a quarter, etc.
+  //Within a round, the points follow the hilbert curve
+  int end = n;
+  while ( end > 0 )
+  {
+    int begin = end > sMinRoundSize ? end / 2 : 0;
+    qSort( items.begin() + begin, items.begin() + end );
+    end = begin;
+  }
+
+  for ( int i = 0; i < n; ++i )
+  {
+    points[i] = items[i].point;
+    addPoint( points[i] );
+  }
+}
@@ -18,6 +18,7 @@
 #define TRIANGULATION_H
 
 #include <QList>
+#include <QVector>
 #include "Line3D.h"
 #include "Vector3D.h"
 #include <qpainter.h>
@@ -35,6 +36,8 @@ class ANALYSIS_EXPORT Triangulation
     virtual void addLine( Line3D* line, bool breakline ) = 0;
     /**Adds a point to the triangulation*/
     virtual int addPoint( Point3D* p ) = 0;
+    /**Adds many points at once. The points are sorted along a space filling curve first (in randomized rounds of increasing size), so that each point is located close to the previously inserted one. The class takes ownership of the points, the order of the vector is changed*/
+    virtual void addPoints( QVector<Point3D*>& points );
     /**Calculates the normal at a point on the surface and assigns it to 'result'. Returns true in case of success and flase in case of failure*/
     virtual bool calcNormal( double x, double y, Vector3D* result ) = 0;
     /**Performs a consistency check, remove this later*/
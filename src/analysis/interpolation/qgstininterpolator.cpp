@@ -132,6 +132,10 @@ void QgsTINInterpolator::initialize()
 
   delete theProgressDialog;
 
+  //the points are inserted at once in spatially sorted order, which is much faster than the order of the features
+  mTriangulation->addPoints( mPoints );
+  mPoints.clear();
+
   if ( mInterpolation == CloughTocher )
   {
     CloughTocherInterpolator* ctInterpolator = new CloughTocherInterpolator();
@@ -224,11 +228,7 @@ int QgsTINInterpolator::insertData( QgsFeature* f, bool zCoord, int attr, InputT
       {
         z = attributeValue;
       }
-      Point3D* thePoint = new Point3D( x, y, z );
-      if ( mTriangulation->addPoint( thePoint ) == -100 )
-      {
-        return -1;
-      }
+      mPoints.append( new Point3D( x, y, z ) );
       break;
     }
     case QGis::WKBMultiPoint25D:
@@ -254,6 +254,7 @@ int QgsTINInterpolator::insertData( QgsFeature* f, bool zCoord, int attr, InputT
         {
           z = attributeValue;
         }
+        mPoints.append( new Point3D( x, y, z ) );
       }
       break;
     }
@@ -289,8 +290,7 @@ int QgsTINInterpolator::insertData( QgsFeature* f, bool zCoord, int attr, InputT
 
         if ( type == POINTS )
         {
-          //todo: handle error code -100
-          mTriangulation->addPoint( new Point3D( x, y, z ) );
+          mPoints.append( new Point3D( x, y, z ) );
         }
         else
         {
@@ -340,8 +340,7 @@ int QgsTINInterpolator::insertData( QgsFeature* f, bool zCoord, int attr, InputT
 
           if ( type == POINTS )
           {
-            //todo: handle error code -100
-            mTriangulation->addPoint( new Point3D( x, y, z ) );
+            mPoints.append( new Point3D( x, y, z ) );
           }
           else
           {
@@ -389,8 +388,7 @@ int QgsTINInterpolator::insertData( QgsFeature* f, bool zCoord, int attr, InputT
           }
           if ( type == POINTS )
           {
-            //todo: handle error code -100
-            mTriangulation->addPoint( new Point3D( x, y, z ) );
+            mPoints.append( new Point3D( x, y, z ) );
           }
           else
           {
@@ -445,8 +443,7 @@ int QgsTINInterpolator::insertData( QgsFeature* f, bool zCoord, int attr, InputT
             }
             if ( type == POINTS )
             {
-              //todo: handle error code -100
-              mTriangulation->addPoint( new Point3D( x, y, z ) );
+              mPoints.append( new Point3D( x, y, z ) );
             }
             else
             {
@@ -20,7 +20,9 @@
 
 #include "qgsinterpolator.h"
 #include <QString>
+#include <QVector>
 
+class Point3D;
 class Triangulation;
 class TriangleInterpolator;
 class QgsFeature;
@@ -59,6 +61,8 @@ class ANALYSIS_EXPORT QgsTINInterpolator: public QgsInterpolator
     QString mTriangulationFilePath;
     /**Type of interpolation*/
     TIN_INTERPOLATION mInterpolation;
+    /**Vertices collected by insertData, they are added to the triangulation in one go*/
+    QVector<Point3D*> mPoints;
 
     /**Create dual edge triangulation*/
     void initialize();
@@ -67,7 +71,7 @@ class ANALYSIS_EXPORT QgsTINInterpolator: public QgsInterpolator
       @param zCoord true if the z coordinate is the interpolation attribute
       @param attr interpolation attribute index (if zCoord is false)
       @param type point/structure line, break line
-      @return 0 in case of success, -1 if the feature could not be inserted because of numerical problems*/
+      @return 0 in case of success*/
     int insertData( QgsFeature* f, bool zCoord, int attr, InputType type );
 };
 
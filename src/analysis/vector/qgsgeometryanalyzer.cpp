@@ -27,233 +27,402 @@
 #include "qgsvectordataprovider.h"
 #include "qgsdistancearea.h"
 #include <QProgressDialog>
+#include <QtAlgorithms>
+#include <QtConcurrentRun>
 
-bool QgsGeometryAnalyzer::simplify( QgsVectorLayer* layer, const QString& shapefileName,
-                                    double tolerance, bool onlySelectedFeatures, QProgressDialog* p )
-{
-  if ( !layer )
-  {
-    return false;
-  }
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
-  QgsVectorDataProvider* dp = layer->dataProvider();
-  if ( !dp )
-  {
-    return false;
-  }
+//number of features which are read, processed and written together
+static const int sFeatureBlockSize = 1000;
 
-  QGis::WkbType outputType = dp->geometryType();
-  const QgsCoordinateReferenceSystem crs = layer->srs();
+/**Reads the selected or all features of a layer*/
+class QgsAnalyzerFeatureReader
+{
+  public:
+    QgsAnalyzerFeatureReader( QgsVectorLayer* layer, bool onlySelectedFeatures )
+        : mLayer( layer )
+        , mOnlySelectedFeatures( onlySelectedFeatures )
+    {
+      if ( mOnlySelectedFeatures )
+      {
+        mSelection = layer->selectedFeaturesIds();
+        mSelectionIt = mSelection.constBegin();
+      }
+      else
+      {
+        layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
+      }
+    }
 
-  QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), dp->fields(), outputType, &crs );
-  QgsFeature currentFeature;
+    int featureCount() const
+    {
+      return mOnlySelectedFeatures ? mSelection.size() : mLayer->featureCount();
+    }
 
-  //take only selection
-  if ( onlySelectedFeatures )
-  {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    if ( p )
+    bool nextFeature( QgsFeature& f )
     {
-      p->setMaximum( selection.size() );
+      if ( !mOnlySelectedFeatures )
+      {
+        return mLayer->nextFeature( f );
+      }
+
+      while ( mSelectionIt != mSelection.constEnd() )
+      {
+        int id = *mSelectionIt;
+        ++mSelectionIt;
+        if ( mLayer->featureAtId( id, f, true, true ) )
+        {
+          return true;
+        }
+      }
+      return false;
     }
 
-    int processedFeatures = 0;
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
+  private:
+    QgsVectorLayer* mLayer;
+    bool mOnlySelectedFeatures;
+    QgsFeatureIds mSelection;
+    QgsFeatureIds::const_iterator mSelectionIt;
+};
+
+/**Geometry operation of the per feature tools. It is applied in a worker thread,
+  so it must only touch the feature passed in*/
+class QgsFeatureOperation
+{
+  public:
+    enum Type
+    {
+      None,
+      Simplify,
+      Centroid,
+      Buffer,
+      ConvexHull
+    };
+
+    QgsFeatureOperation( Type type, double parameter = 0.0, int parameterField = -1 )
+        : mType( type )
+        , mParameter( parameter )
+        , mParameterField( parameterField )
+    {}
+
+    void operator()( QgsFeature& f ) const
     {
-      if ( p )
+      QgsGeometry* featureGeometry = f.geometry();
+      if ( !featureGeometry || mType == None )
       {
-        p->setValue( processedFeatures );
+        return;
       }
 
-      if ( p && p->wasCanceled() )
+      QgsGeometry* result = 0;
+      switch ( mType )
       {
-        break;
+        case Simplify:
+          result = featureGeometry->simplify( mParameter );
+          break;
+        case Centroid:
+          result = featureGeometry->centroid();
+          break;
+        case Buffer:
+          result = featureGeometry->buffer( mParameterField == -1 ? mParameter : f.attributeMap()[mParameterField].toDouble(), 5 );
+          break;
+        case ConvexHull:
+          result = featureGeometry->convexHull();
+          break;
+        case None:
+          break;
       }
-      if ( !layer->featureAtId( *it, currentFeature, true, true ) )
+
+      //hand over a geometry without GEOS representation: copying or deleting it in
+      //the reading thread would then call GEOS concurrently with the next block
+      if ( result )
       {
-        continue;
+        QgsGeometry* wkbGeometry = 0;
+        unsigned char* wkb = result->asWkb();
+        if ( wkb )
+        {
+          size_t wkbSize = result->wkbSize();
+          unsigned char* wkbCopy = new unsigned char[wkbSize];
+          memcpy( wkbCopy, wkb, wkbSize );
+          wkbGeometry = new QgsGeometry();
+          wkbGeometry->fromWkb( wkbCopy, wkbSize );
+        }
+        delete result;
+        result = wkbGeometry;
       }
-      simplifyFeature( currentFeature, &vWriter, tolerance );
-      ++processedFeatures;
+      f.setGeometry( result );
     }
 
-    if ( p )
-    {
-      p->setValue( selection.size() );
-    }
+  private:
+    Type mType;
+    double mParameter;
+    int mParameterField;
+};
+
+/**Processed geometries grouped by the value of an attribute, together
+  with the attributes of the first feature of each group*/
+struct QgsGeometryGroups
+{
+  QgsGeometryGroups( int field = -1 )
+      : groupField( field )
+  {}
+  /**index of the attribute, -1 puts all geometries in one group*/
+  int groupField;
+  QMap<QString, QList<QgsGeometry*> > geometries;
+  QMap<QString, QgsAttributeMap> attributes;
+};
+
+/**Applies op to the features of a block, one after the other*/
+static void processBlock( QList<QgsFeature>* block, QgsFeatureOperation op )
+{
+  for ( QList<QgsFeature>::iterator it = block->begin(); it != block->end(); ++it )
+  {
+    op( *it );
   }
-  //take all features
-  else
+}
+
+/**Reads the features in blocks and applies op to the geometries of a block in a worker
+  thread while the next block is read. GEOS uses a global context which is not reentrant,
+  so only one block is processed at a time. The results are written to vfw in input order
+  or, if groups is not 0, collected in groups. Features without geometry are skipped.
+  Returns false if canceled*/
+static bool processFeatures( QgsVectorLayer* layer, bool onlySelectedFeatures, const QgsFeatureOperation& op,
+                             QgsVectorFileWriter* vfw, QgsGeometryGroups* groups, QProgressDialog* p )
+{
+  QgsAnalyzerFeatureReader reader( layer, onlySelectedFeatures );
+  int featureCount = reader.featureCount();
+  if ( p )
+  {
+    p->setMaximum( featureCount );
+  }
+  if ( vfw )
   {
-    layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
+    //the output is written on the writer's own thread
+    vfw->setBackgroundWriting( true );
+  }
 
+  QList<QgsFeature> blocks[2];
+  QFuture<void> futures[2];
+  int current = 0;
+  int processedFeatures = 0;
+  bool canceled = false;
+  QgsFeature f;
 
-    int featureCount = layer->featureCount();
-    if ( p )
+  while ( blocks[current].size() < sFeatureBlockSize && reader.nextFeature( f ) )
+  {
+    blocks[current] << f;
+  }
+  futures[current] = QtConcurrent::run( processBlock, &blocks[current], op );
+
+  while ( !blocks[current].isEmpty() )
+  {
+    int next = 1 - current;
+    blocks[next].clear();
+    if ( !canceled )
+    {
+      while ( blocks[next].size() < sFeatureBlockSize && reader.nextFeature( f ) )
+      {
+        blocks[next] << f;
+      }
+    }
+
+    futures[current].waitForFinished();
+    if ( !blocks[next].isEmpty() )
     {
-      p->setMaximum( featureCount );
+      futures[next] = QtConcurrent::run( processBlock, &blocks[next], op );
     }
-    int processedFeatures = 0;
 
-    while ( layer->nextFeature( currentFeature ) )
+    for ( QList<QgsFeature>::iterator it = blocks[current].begin(); it != blocks[current].end(); ++it )
     {
-      if ( p )
+      if ( !it->geometry() )
       {
-        p->setValue( processedFeatures );
+        continue;
+      }
+
+      if ( groups )
+      {
+        QString key = groups->groupField == -1 ? QString() : it->attributeMap()[groups->groupField].toString();
+        if ( !groups->attributes.contains( key ) )
+        {
+          groups->attributes.insert( key, it->attributeMap() );
+        }
+        groups->geometries[key] << it->geometryAndOwnership();
       }
-      if ( p && p->wasCanceled() )
+      else if ( vfw )
       {
-        break;
+        vfw->addFeature( *it );
       }
-      simplifyFeature( currentFeature, &vWriter, tolerance );
-      ++processedFeatures;
     }
+
+    processedFeatures += blocks[current].size();
     if ( p )
     {
-      p->setValue( featureCount );
+      p->setValue( processedFeatures );
+      if ( p->wasCanceled() )
+      {
+        canceled = true;
+      }
     }
+    current = next;
   }
 
-  return true;
+  if ( p )
+  {
+    p->setValue( featureCount );
+  }
+  return !canceled;
 }
 
-void QgsGeometryAnalyzer::simplifyFeature( QgsFeature& f, QgsVectorFileWriter* vfw, double tolerance )
+/**Geometry with the center of its bounding box, for sorting*/
+struct QgsUnionItem
 {
-  QgsGeometry* featureGeometry = f.geometry();
-  QgsGeometry* tmpGeometry = 0;
+  double x;
+  double y;
+  QgsGeometry* geometry;
+};
 
-  if ( !featureGeometry )
-  {
-    return;
-  }
-  // simplify feature
-  tmpGeometry = featureGeometry->simplify( tolerance );
+static bool unionItemLessX( const QgsUnionItem& a, const QgsUnionItem& b )
+{
+  return a.x < b.x;
+}
+
+static bool unionItemLessY( const QgsUnionItem& a, const QgsUnionItem& b )
+{
+  return a.y < b.y;
+}
 
-  QgsFeature newFeature;
-  newFeature.setGeometry( tmpGeometry );
-  newFeature.setAttributeMap( f.attributeMap() );
+struct QgsGeometryPair
+{
+  QgsGeometry* first;
+  QgsGeometry* second;
+  QgsGeometry* result;
+};
 
-  //add it to vector file writer
-  if ( vfw )
+static void combineGeometryPair( QgsGeometryPair& pair )
+{
+  if ( !pair.second )
   {
-    vfw->addFeature( newFeature );
+    pair.result = pair.first;
+    return;
   }
+  pair.result = pair.first->combine( pair.second );
+  delete pair.first;
+  delete pair.second;
 }
 
-bool QgsGeometryAnalyzer::centroids( QgsVectorLayer* layer, const QString& shapefileName,
-                                     bool onlySelectedFeatures, QProgressDialog* p )
+/**Merges the geometries with a cascaded union: the geometries are sorted into
+  tiles (sort tile recursive) and merged pairwise, level by level, so that every
+  union combines two neighbouring geometries of similar size. Takes ownership of
+  the geometries, returns 0 for an empty list*/
+static QgsGeometry* unionGeometries( const QList<QgsGeometry*>& geometries )
 {
-  if ( !layer )
+  if ( geometries.isEmpty() )
   {
-    return false;
+    return 0;
   }
 
-  QgsVectorDataProvider* dp = layer->dataProvider();
-  if ( !dp )
+  QVector<QgsUnionItem> items( geometries.size() );
+  for ( int i = 0; i < geometries.size(); ++i )
   {
-    return false;
+    QgsRectangle bbox = geometries[i]->boundingBox();
+    items[i].x = ( bbox.xMinimum() + bbox.xMaximum() ) / 2.0;
+    items[i].y = ( bbox.yMinimum() + bbox.yMaximum() ) / 2.0;
+    items[i].geometry = geometries[i];
   }
 
-  QGis::WkbType outputType = QGis::WKBPoint;
-  const QgsCoordinateReferenceSystem crs = layer->srs();
-
-  QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), dp->fields(), outputType, &crs );
-  QgsFeature currentFeature;
-
-  //take only selection
-  if ( onlySelectedFeatures )
+  //vertical strips of sqrt(n) items, sorted by y in alternating direction
+  int n = items.size();
+  int stripSize = qMax( 1, ( int ) ceil( sqrt(( double ) n ) ) );
+  qSort( items.begin(), items.end(), unionItemLessX );
+  for ( int start = 0, strip = 0; start < n; start += stripSize, ++strip )
   {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    if ( p )
+    QVector<QgsUnionItem>::iterator begin = items.begin() + start;
+    QVector<QgsUnionItem>::iterator end = items.begin() + qMin( start + stripSize, n );
+    qSort( begin, end, unionItemLessY );
+    if ( strip % 2 == 1 )
     {
-      p->setMaximum( selection.size() );
+      std::reverse( begin, end );
     }
+  }
 
-    int processedFeatures = 0;
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      if ( !layer->featureAtId( *it, currentFeature, true, true ) )
-      {
-        continue;
-      }
-      centroidFeature( currentFeature, &vWriter );
-      ++processedFeatures;
-    }
+  QList<QgsGeometry*> level;
+  for ( int i = 0; i < n; ++i )
+  {
+    level << items[i].geometry;
+  }
 
-    if ( p )
+  while ( level.size() > 1 )
+  {
+    QList<QgsGeometryPair> pairs;
+    for ( int i = 0; i < level.size(); i += 2 )
     {
-      p->setValue( selection.size() );
+      QgsGeometryPair pair;
+      pair.first = level[i];
+      pair.second = i + 1 < level.size() ? level[i + 1] : 0;
+      pair.result = 0;
+      pairs << pair;
     }
-  }
-  //take all features
-  else
-  {
-    layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
 
-    int featureCount = layer->featureCount();
-    if ( p )
+    for ( int i = 0; i < pairs.size(); ++i )
     {
-      p->setMaximum( featureCount );
+      combineGeometryPair( pairs[i] );
     }
-    int processedFeatures = 0;
 
-    while ( layer->nextFeature( currentFeature ) )
+    level.clear();
+    for ( int i = 0; i < pairs.size(); ++i )
     {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
+      if ( pairs[i].result )
       {
-        break;
+        level << pairs[i].result;
       }
-      centroidFeature( currentFeature, &vWriter );
-      ++processedFeatures;
-    }
-    if ( p )
-    {
-      p->setValue( featureCount );
     }
   }
 
-  return true;
+  return level.isEmpty() ? 0 : level.first();
 }
 
 
-void QgsGeometryAnalyzer::centroidFeature( QgsFeature& f, QgsVectorFileWriter* vfw )
+bool QgsGeometryAnalyzer::simplify( QgsVectorLayer* layer, const QString& shapefileName,
+                                    double tolerance, bool onlySelectedFeatures, QProgressDialog* p )
 {
-  QgsGeometry* featureGeometry = f.geometry();
-  QgsGeometry* tmpGeometry = 0;
+  if ( !layer )
+  {
+    return false;
+  }
 
-  if ( !featureGeometry )
+  QgsVectorDataProvider* dp = layer->dataProvider();
+  if ( !dp )
   {
-    return;
+    return false;
   }
 
-  tmpGeometry = featureGeometry->centroid();
+  QGis::WkbType outputType = dp->geometryType();
+  const QgsCoordinateReferenceSystem crs = layer->srs();
 
-  QgsFeature newFeature;
-  newFeature.setGeometry( tmpGeometry );
-  newFeature.setAttributeMap( f.attributeMap() );
+  QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), dp->fields(), outputType, &crs );
+  return processFeatures( layer, onlySelectedFeatures, QgsFeatureOperation( QgsFeatureOperation::Simplify, tolerance ), &vWriter, 0, p );
+}
 
-  //add it to vector file writer
-  if ( vfw )
+bool QgsGeometryAnalyzer::centroids( QgsVectorLayer* layer, const QString& shapefileName,
+                                     bool onlySelectedFeatures, QProgressDialog* p )
+{
+  if ( !layer )
+  {
+    return false;
+  }
+
+  QgsVectorDataProvider* dp = layer->dataProvider();
+  if ( !dp )
   {
-    vfw->addFeature( newFeature );
+    return false;
   }
+
+  QGis::WkbType outputType = QGis::WKBPoint;
+  const QgsCoordinateReferenceSystem crs = layer->srs();
+
+  QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), dp->fields(), outputType, &crs );
+  return processFeatures( layer, onlySelectedFeatures, QgsFeatureOperation( QgsFeatureOperation::Centroid ), &vWriter, 0, p );
 }
 
 bool QgsGeometryAnalyzer::extent( QgsVectorLayer* layer, const QString& shapefileName,
@@ -389,15 +558,6 @@ bool QgsGeometryAnalyzer::convexHull( QgsVectorLayer* layer, const QString& shap
   {
     return false;
   }
-  bool useField = false;
-  if ( uniqueIdField == -1 )
-  {
-    uniqueIdField = 0;
-  }
-  else
-  {
-    useField = true;
-  }
   QgsFieldMap fields;
   fields.insert( 0 , QgsField( QString( "UID" ), QVariant::String ) );
   fields.insert( 1 , QgsField( QString( "AREA" ), QVariant::Double ) );
@@ -407,186 +567,49 @@ bool QgsGeometryAnalyzer::convexHull( QgsVectorLayer* layer, const QString& shap
   const QgsCoordinateReferenceSystem crs = layer->srs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), fields, outputType, &crs );
-  QgsFeature currentFeature;
-  QgsGeometry* dissolveGeometry = 0; //dissolve geometry
-  QMultiMap<QString, int> map;
 
-  if ( onlySelectedFeatures )
+  //the hull of a group is the hull of the union of the feature hulls
+  QgsGeometryGroups groups( uniqueIdField );
+  bool complete = processFeatures( layer, onlySelectedFeatures, QgsFeatureOperation( QgsFeatureOperation::ConvexHull ), 0, &groups, p );
+
+  QMap<QString, QList<QgsGeometry*> >::const_iterator it = groups.geometries.constBegin();
+  if ( !complete )
   {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
+    for ( ; it != groups.geometries.constEnd(); ++it )
     {
-#if 0
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        // break; // it may be better to do something else here?
-        return false;
-      }
-#endif
-      if ( !layer->featureAtId( *it, currentFeature, true, true ) )
-      {
-        continue;
-      }
-      map.insert( currentFeature.attributeMap()[ uniqueIdField ].toString(), currentFeature.id() );
+      qDeleteAll( it.value() );
     }
+    return false;
   }
-  else
+
+  for ( ; it != groups.geometries.constEnd(); ++it )
   {
-    layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
-    while ( layer->nextFeature( currentFeature ) )
+    QgsGeometry* dissolveGeometry = unionGeometries( it.value() );
+    if ( !dissolveGeometry )
     {
-#if 0
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        // break; // it may be better to do something else here?
-        return false;
-      }
-#endif
-      map.insert( currentFeature.attributeMap()[ uniqueIdField ].toString(), currentFeature.id() );
+      continue;
     }
-  }
 
-  QMultiMap<QString, int>::const_iterator jt = map.constBegin();
-  while ( jt != map.constEnd() )
-  {
-    QString currentKey = jt.key();
-    int processedFeatures = 0;
-    //take only selection
-    if ( onlySelectedFeatures )
+    QgsGeometry* hullGeometry = dissolveGeometry->convexHull();
+    delete dissolveGeometry;
+    if ( !hullGeometry )
     {
-      //use QgsVectorLayer::featureAtId
-      const QgsFeatureIds selection = layer->selectedFeaturesIds();
-      if ( p )
-      {
-        p->setMaximum( selection.size() );
-      }
-      processedFeatures = 0;
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( selection.contains( jt.value() ) )
-        {
-          if ( p )
-          {
-            p->setValue( processedFeatures );
-          }
-          if ( !layer->featureAtId( jt.value(), currentFeature, true, true ) )
-          {
-            continue;
-          }
-          convexFeature( currentFeature, processedFeatures, &dissolveGeometry );
-          ++processedFeatures;
-        }
-        ++jt;
-      }
-      QList<double> values;
-      if ( !dissolveGeometry )
-      {
-        QgsDebugMsg( "no dissolved geometry - should not happen" );
-        return false;
-      }
-      dissolveGeometry = dissolveGeometry->convexHull();
-      values = simpleMeasure( dissolveGeometry );
-      QgsAttributeMap attributeMap;
-      attributeMap.insert( 0 , QVariant( currentKey ) );
-      attributeMap.insert( 1 , values[ 0 ] );
-      attributeMap.insert( 2 , values[ 1 ] );
-      QgsFeature dissolveFeature;
-      dissolveFeature.setAttributeMap( attributeMap );
-      dissolveFeature.setGeometry( dissolveGeometry );
-      vWriter.addFeature( dissolveFeature );
+      continue;
     }
-    //take all features
-    else
-    {
-      int featureCount = layer->featureCount();
-      if ( p )
-      {
-        p->setMaximum( featureCount );
-      }
-      processedFeatures = 0;
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p )
-        {
-          p->setValue( processedFeatures );
-        }
 
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( !layer->featureAtId( jt.value(), currentFeature, true, true ) )
-        {
-          continue;
-        }
-        convexFeature( currentFeature, processedFeatures, &dissolveGeometry );
-        ++processedFeatures;
-        ++jt;
-      }
-      QList<double> values;
-      // QgsGeometry* tmpGeometry = 0;
-      if ( !dissolveGeometry )
-      {
-        QgsDebugMsg( "no dissolved geometry - should not happen" );
-        return false;
-      }
-      dissolveGeometry = dissolveGeometry->convexHull();
-      // values = simpleMeasure( tmpGeometry );
-      values = simpleMeasure( dissolveGeometry );
-      QgsAttributeMap attributeMap;
-      attributeMap.insert( 0 , QVariant( currentKey ) );
-      attributeMap.insert( 1 , QVariant( values[ 0 ] ) );
-      attributeMap.insert( 2 , QVariant( values[ 1 ] ) );
-      QgsFeature dissolveFeature;
-      dissolveFeature.setAttributeMap( attributeMap );
-      dissolveFeature.setGeometry( dissolveGeometry );
-      vWriter.addFeature( dissolveFeature );
-    }
+    QList<double> values = simpleMeasure( hullGeometry );
+    QgsAttributeMap attributeMap;
+    attributeMap.insert( 0 , QVariant( it.key() ) );
+    attributeMap.insert( 1 , QVariant( values.value( 0 ) ) );
+    attributeMap.insert( 2 , QVariant( values.value( 1 ) ) );
+    QgsFeature dissolveFeature;
+    dissolveFeature.setAttributeMap( attributeMap );
+    dissolveFeature.setGeometry( hullGeometry );
+    vWriter.addFeature( dissolveFeature );
   }
   return true;
 }
 
-
-void QgsGeometryAnalyzer::convexFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry )
-{
-  QgsGeometry* featureGeometry = f.geometry();
-  QgsGeometry* tmpGeometry = 0;
-  QgsGeometry* convexGeometry = 0;
-
-  if ( !featureGeometry )
-  {
-    return;
-  }
-
-  convexGeometry = featureGeometry->convexHull();
-
-  if ( nProcessedFeatures == 0 )
-  {
-    *dissolveGeometry = convexGeometry;
-  }
-  else
-  {
-    tmpGeometry = *dissolveGeometry;
-    *dissolveGeometry = ( *dissolveGeometry )->combine( convexGeometry );
-    delete tmpGeometry;
-    delete convexGeometry;
-  }
-}
-
 bool QgsGeometryAnalyzer::dissolve( QgsVectorLayer* layer, const QString& shapefileName,
                                     bool onlySelectedFeatures, int uniqueIdField, QProgressDialog* p )
 {
@@ -599,151 +622,42 @@ bool QgsGeometryAnalyzer::dissolve( QgsVectorLayer* layer, const QString& shapef
   {
     return false;
   }
-  bool useField = false;
-  if ( uniqueIdField == -1 )
-  {
-    uniqueIdField = 0;
-  }
-  else
-  {
-    useField = true;
-  }
 
   QGis::WkbType outputType = dp->geometryType();
   const QgsCoordinateReferenceSystem crs = layer->srs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), dp->fields(), outputType, &crs );
-  QgsFeature currentFeature;
-  QMultiMap<QString, int> map;
 
-  if ( onlySelectedFeatures )
-  {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
-    {
-      if ( !layer->featureAtId( *it, currentFeature, true, true ) )
-      {
-        continue;
-      }
-      map.insert( currentFeature.attributeMap()[ uniqueIdField ].toString(), currentFeature.id() );
-    }
-  }
-  else
+  //read all geometries once, grouped by the dissolve attribute
+  QgsGeometryGroups groups( uniqueIdField );
+  bool complete = processFeatures( layer, onlySelectedFeatures, QgsFeatureOperation( QgsFeatureOperation::None ), 0, &groups, p );
+
+  QMap<QString, QList<QgsGeometry*> >::const_iterator it = groups.geometries.constBegin();
+  if ( !complete )
   {
-    layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
-    while ( layer->nextFeature( currentFeature ) )
+    for ( ; it != groups.geometries.constEnd(); ++it )
     {
-      map.insert( currentFeature.attributeMap()[ uniqueIdField ].toString(), currentFeature.id() );
+      qDeleteAll( it.value() );
     }
+    return false;
   }
 
-  QgsGeometry *dissolveGeometry = 0; //dissolve geometry
-  QMultiMap<QString, int>::const_iterator jt = map.constBegin();
-  QgsFeature outputFeature;
-  while ( jt != map.constEnd() )
+  for ( ; it != groups.geometries.constEnd(); ++it )
   {
-    QString currentKey = jt.key();
-    int processedFeatures = 0;
-    bool first = true;
-    //take only selection
-    if ( onlySelectedFeatures )
+    QgsGeometry* dissolveGeometry = unionGeometries( it.value() );
+    if ( !dissolveGeometry )
     {
-      //use QgsVectorLayer::featureAtId
-      const QgsFeatureIds selection = layer->selectedFeaturesIds();
-      if ( p )
-      {
-        p->setMaximum( selection.size() );
-      }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( selection.contains( jt.value() ) )
-        {
-          if ( p )
-          {
-            p->setValue( processedFeatures );
-          }
-          if ( !layer->featureAtId( jt.value(), currentFeature, true, true ) )
-          {
-            continue;
-          }
-          if ( first )
-          {
-            outputFeature.setAttributeMap( currentFeature.attributeMap() );
-            first = false;
-          }
-          dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-          ++processedFeatures;
-        }
-        ++jt;
-      }
+      continue;
     }
-    //take all features
-    else
-    {
-      int featureCount = layer->featureCount();
-      if ( p )
-      {
-        p->setMaximum( featureCount );
-      }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p )
-        {
-          p->setValue( processedFeatures );
-        }
 
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( !layer->featureAtId( jt.value(), currentFeature, true, true ) )
-        {
-          continue;
-        }
-        {
-          outputFeature.setAttributeMap( currentFeature.attributeMap() );
-          first = false;
-        }
-        dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-        ++processedFeatures;
-        ++jt;
-      }
-    }
+    QgsFeature outputFeature;
+    outputFeature.setAttributeMap( groups.attributes.value( it.key() ) );
     outputFeature.setGeometry( dissolveGeometry );
     vWriter.addFeature( outputFeature );
   }
   return true;
 }
 
-void QgsGeometryAnalyzer::dissolveFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry )
-{
-  QgsGeometry* featureGeometry = f.geometry();
-
-  if ( !featureGeometry )
-  {
-    return;
-  }
-
-  if ( nProcessedFeatures == 0 )
-  {
-    int geomSize = featureGeometry->wkbSize();
-    *dissolveGeometry = new QgsGeometry();
-    unsigned char* wkb = new unsigned char[geomSize];
-    memcpy( wkb, featureGeometry->asWkb(), geomSize );
-    ( *dissolveGeometry )->fromWkb( wkb, geomSize );
-  }
-  else
-  {
-    *dissolveGeometry = ( *dissolveGeometry )->combine( featureGeometry );
-  }
-}
-
 bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefileName, double bufferDistance,
                                   bool onlySelectedFeatures, bool dissolve, int bufferDistanceField, QProgressDialog* p )
 {
@@ -766,139 +680,29 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
   const QgsCoordinateReferenceSystem crs = layer->srs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), dp->fields(), outputType, &crs );
-  QgsFeature currentFeature;
-  QgsGeometry *dissolveGeometry = 0; //dissolve geometry (if dissolve enabled)
-
-  //take only selection
-  if ( onlySelectedFeatures )
-  {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    if ( p )
-    {
-      p->setMaximum( selection.size() );
-    }
-
-    int processedFeatures = 0;
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      if ( !layer->featureAtId( *it, currentFeature, true, true ) )
-      {
-        continue;
-      }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
-      ++processedFeatures;
-    }
-
-    if ( p )
-    {
-      p->setValue( selection.size() );
-    }
-  }
-  //take all features
-  else
-  {
-    layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
-
-
-    int featureCount = layer->featureCount();
-    if ( p )
-    {
-      p->setMaximum( featureCount );
-    }
-    int processedFeatures = 0;
-
-    while ( layer->nextFeature( currentFeature ) )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
-      ++processedFeatures;
-    }
-    if ( p )
-    {
-      p->setValue( featureCount );
-    }
-  }
-
-  if ( dissolve )
-  {
-    QgsFeature dissolveFeature;
-    if ( !dissolveGeometry )
-    {
-      QgsDebugMsg( "no dissolved geometry - should not happen" );
-      return false;
-    }
-    dissolveFeature.setGeometry( dissolveGeometry );
-    vWriter.addFeature( dissolveFeature );
-  }
-  return true;
-}
-
-void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures, QgsVectorFileWriter* vfw, bool dissolve,
-    QgsGeometry** dissolveGeometry, double bufferDistance, int bufferDistanceField )
-{
-  double currentBufferDistance;
-  QgsGeometry* featureGeometry = f.geometry();
-  QgsGeometry* tmpGeometry = 0;
-  QgsGeometry* bufferGeometry = 0;
+  QgsFeatureOperation op( QgsFeatureOperation::Buffer, bufferDistance, bufferDistanceField );
 
-  if ( !featureGeometry )
+  if ( !dissolve )
   {
-    return;
+    return processFeatures( layer, onlySelectedFeatures, op, &vWriter, 0, p );
   }
 
-  //create buffer
-  if ( bufferDistanceField == -1 )
+  QgsGeometryGroups groups;
+  if ( !processFeatures( layer, onlySelectedFeatures, op, 0, &groups, p ) )
   {
-    currentBufferDistance = bufferDistance;
-  }
-  else
-  {
-    currentBufferDistance = f.attributeMap()[bufferDistanceField].toDouble();
+    qDeleteAll( groups.geometries.value( QString() ) );
+    return false;
   }
-  bufferGeometry = featureGeometry->buffer( currentBufferDistance, 5 );
 
-  if ( dissolve )
+  QgsGeometry* dissolveGeometry = unionGeometries( groups.geometries.value( QString() ) );
+  if ( !dissolveGeometry )
   {
-    if ( nProcessedFeatures == 0 )
-    {
-      *dissolveGeometry = bufferGeometry;
-    }
-    else
-    {
-      tmpGeometry = *dissolveGeometry;
-      *dissolveGeometry = ( *dissolveGeometry )->combine( bufferGeometry );
-      delete tmpGeometry;
-      delete bufferGeometry;
-    }
+    QgsDebugMsg( "no dissolved geometry - should not happen" );
+    return false;
   }
-  else //dissolve
-  {
-    QgsFeature newFeature;
-    newFeature.setGeometry( bufferGeometry );
-    newFeature.setAttributeMap( f.attributeMap() );
 
-    //add it to vector file writer
-    if ( vfw )
-    {
-      vfw->addFeature( newFeature );
-    }
-  }
+  QgsFeature dissolveFeature;
+  dissolveFeature.setGeometry( dissolveGeometry );
+  vWriter.addFeature( dissolveFeature );
+  return true;
 }
@@ -105,17 +105,6 @@ class ANALYSIS_EXPORT QgsGeometryAnalyzer
 
     QList<double> simpleMeasure( QgsGeometry* geometry );
     double perimeterMeasure( QgsGeometry* geometry, QgsDistanceArea& measure );
-    /**Helper function to simplify an individual feature*/
-    void simplifyFeature( QgsFeature& f, QgsVectorFileWriter* vfw, double tolerance );
-    /**Helper function to get the cetroid of an individual feature*/
-    void centroidFeature( QgsFeature& f, QgsVectorFileWriter* vfw );
-    /**Helper function to buffer an individual feature*/
-    void bufferFeature( QgsFeature& f, int nProcessedFeatures, QgsVectorFileWriter* vfw, bool dissolve, QgsGeometry** dissolveGeometry,
-                        double bufferDistance, int bufferDistanceField );
-    /**Helper function to get the convex hull of feature(s)*/
-    void convexFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry );
-    /**Helper function to dissolve feature(s)*/
-    void dissolveFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry );
 
 };
 #endif //QGSVECTORANALYZER
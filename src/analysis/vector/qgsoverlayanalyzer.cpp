@@ -51,6 +51,7 @@ bool QgsOverlayAnalyzer::intersection( QgsVectorLayer* layerA, QgsVectorLayer* l
   combineFieldLists( fieldsA, fieldsB );
 
   QgsVectorFileWriter vWriter( shapefileName, dpA->encoding(), fieldsA, outputType, &crs );
+  vWriter.setBackgroundWriting( true );
   QgsFeature currentFeature;
   QgsSpatialIndex index;
 
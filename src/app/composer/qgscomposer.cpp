@@ -49,6 +49,7 @@
 #include <QCloseEvent>
 #include <QCheckBox>
 #include <QDesktopWidget>
+#include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QIcon>
@@ -66,6 +67,35 @@
 #include <QToolBar>
 #include <QToolButton>
 #include <QUndoView>
+#include <QVector>
+
+#include "gdal.h"
+
+//! Maximum memory for one band of a raster export or print (in bytes)
+static const int sMaxBandBytes = 64 * 1024 * 1024;
+
+//! Returns the short name of the GDAL driver able to write the image format or an empty string
+static QString gdalDriverForImageFormat( const QString& format )
+{
+  QString f = format.toLower();
+  if ( f == "tif" || f == "tiff" )
+  {
+    return "GTiff";
+  }
+  else if ( f == "png" )
+  {
+    return "PNG";
+  }
+  else if ( f == "jpg" || f == "jpeg" )
+  {
+    return "JPEG";
+  }
+  else if ( f == "bmp" )
+  {
+    return "BMP";
+  }
+  return QString();
+}
 
 
 
@@ -557,22 +587,23 @@ void QgsComposer::print( QPrinter &printer )
 
   if ( printAsRaster )
   {
-    //print out via QImage, code copied from on_mActionExportAsImage_activated
+    //print out via QImage. The page is rendered in horizontal bands, so that large formats fit into memory
     int width = ( int )( mComposition->printResolution() * mComposition->paperWidth() / 25.4 );
     int height = ( int )( mComposition-> printResolution() * mComposition->paperHeight() / 25.4 );
-    QImage image( QSize( width, height ), QImage::Format_ARGB32 );
+    int rows = bandRows( width );
+    QImage image( QSize( width, qMin( rows, height ) ), QImage::Format_ARGB32 );
     if ( !image.isNull() )
     {
       image.setDotsPerMeterX( mComposition->printResolution() / 25.4 * 1000 );
       image.setDotsPerMeterY( mComposition->printResolution() / 25.4 * 1000 );
-      image.fill( 0 );
-      QPainter imagePainter( &image );
-      QRectF sourceArea( 0, 0, mComposition->paperWidth(), mComposition->paperHeight() );
-      QRectF targetArea( 0, 0, width, height );
       mView->setPaintingEnabled( false );
-      mComposition->render( &imagePainter, targetArea, sourceArea );
+      for ( int row = 0; row < height; row += rows )
+      {
+        int currentRows = qMin( rows, height - row );
+        renderBand( image, row, height );
+        p.drawImage( QRectF( 0, row, width, currentRows ), image, QRectF( 0, 0, width, currentRows ) );
+      }
       mView->setPaintingEnabled( true );
-      p.drawImage( targetArea, image, targetArea );
     }
     else
     {
@@ -624,18 +655,6 @@ void QgsComposer::on_mActionExportAsImage_triggered()
   QgsDebugMsg( QString( "Image %1x%2" ).arg( width ).arg( height ) );
   QgsDebugMsg( QString( "memuse = %1" ).arg( memuse ) );
 
-  if ( memuse > 200 )   // about 4500x4500
-  {
-    int answer = QMessageBox::warning( 0, tr( "Big image" ),
-                                       tr( "To create image %1x%2 requires about %3 MB of memory. Proceed?" )
-                                       .arg( width ).arg( height ).arg( memuse ),
-                                       QMessageBox::Ok | QMessageBox::Cancel,  QMessageBox::Ok );
-
-    raise();
-    if ( answer == QMessageBox::Cancel )
-      return;
-  }
-
   // Get file and format (stolen from qgisapp.cpp but modified significantely)
 
   //create a map to hold the QImageIO names and the filter names
@@ -723,6 +742,36 @@ void QgsComposer::on_mActionExportAsImage_triggered()
   if ( myOutputFileNameQString == "" )
     return;
 
+  //big images are rendered in bands and written with GDAL, if the format is supported
+  QString gdalDriverName = gdalDriverForImageFormat( myFilterMap[myFilterString] );
+  if ( memuse > 200 && !gdalDriverName.isEmpty() )
+  {
+    QApplication::setOverrideCursor( Qt::BusyCursor );
+    mComposition->setPlotStyle( QgsComposition::Print );
+    mView->setPaintingEnabled( false );
+    bool success = exportImageInBands( myOutputFileNameQString, gdalDriverName, width, height );
+    mComposition->setPlotStyle( QgsComposition::Preview );
+    mView->setPaintingEnabled( true );
+    QApplication::restoreOverrideCursor();
+    if ( !success )
+    {
+      QMessageBox::warning( 0, tr( "Export failed" ), tr( "Writing the image %1 failed." ).arg( myOutputFileNameQString ), QMessageBox::Ok );
+    }
+    return;
+  }
+
+  if ( memuse > 200 )   // about 4500x4500
+  {
+    int answer = QMessageBox::warning( 0, tr( "Big image" ),
+                                       tr( "To create image %1x%2 requires about %3 MB of memory. Proceed?" )
+                                       .arg( width ).arg( height ).arg( memuse ),
+                                       QMessageBox::Ok | QMessageBox::Cancel,  QMessageBox::Ok );
+
+    raise();
+    if ( answer == QMessageBox::Cancel )
+      return;
+  }
+
   QImage image( QSize( width, height ), QImage::Format_ARGB32 );
   if ( image.isNull() )
   {
@@ -749,6 +798,108 @@ void QgsComposer::on_mActionExportAsImage_triggered()
   image.save( myOutputFileNameQString, myFilterMap[myFilterString].toLocal8Bit().data() );
 }
 
+int QgsComposer::bandRows( int width ) const
+{
+  return qMax( 1, sMaxBandBytes / ( 4 * qMax( width, 1 ) ) );
+}
+
+void QgsComposer::renderBand( QImage& band, int firstRow, int imageHeight )
+{
+  band.fill( 0 );
+  QPainter p( &band );
+  double mmPerRow = mComposition->paperHeight() / imageHeight;
+  QRectF sourceArea( 0, firstRow * mmPerRow, mComposition->paperWidth(), band.height() * mmPerRow );
+  QRectF targetArea( 0, 0, band.width(), band.height() );
+  //the composer maps only render the part of their extent inside the clip
+  p.setClipRect( targetArea );
+  mComposition->render( &p, targetArea, sourceArea, Qt::IgnoreAspectRatio );
+}
+
+bool QgsComposer::exportImageInBands( const QString& fileName, const QString& gdalDriverName, int width, int height )
+{
+  GDALAllRegister();
+  GDALDriverH tiffDriver = GDALGetDriverByName( "GTiff" );
+  GDALDriverH outputDriver = GDALGetDriverByName( gdalDriverName.toLocal8Bit().data() );
+  if ( !tiffDriver || !outputDriver )
+  {
+    return false;
+  }
+
+  //GTiff is written directly. The other drivers only support CreateCopy, they get a temporary tiff as source
+  bool directWrite = ( gdalDriverName == "GTiff" );
+  QString tiffName = directWrite ? fileName : fileName + ".tmp.tif";
+  //jpeg and bmp have no alpha channel
+  int nBands = ( gdalDriverName == "JPEG" || gdalDriverName == "BMP" ) ? 3 : 4;
+
+  GDALDatasetH dataset = GDALCreate( tiffDriver, QFile::encodeName( tiffName ).data(), width, height, nBands, GDT_Byte, 0 );
+  if ( !dataset )
+  {
+    return false;
+  }
+  if ( nBands == 4 )
+  {
+    GDALSetRasterColorInterpretation( GDALGetRasterBand( dataset, 4 ), GCI_AlphaBand );
+  }
+  if ( directWrite )
+  {
+    GDALSetMetadataItem( dataset, "TIFFTAG_XRESOLUTION", QString::number( mComposition->printResolution() ).toLocal8Bit().data(), 0 );
+    GDALSetMetadataItem( dataset, "TIFFTAG_YRESOLUTION", QString::number( mComposition->printResolution() ).toLocal8Bit().data(), 0 );
+    GDALSetMetadataItem( dataset, "TIFFTAG_RESOLUTIONUNIT", "2", 0 ); //inch
+  }
+
+  int rows = bandRows( width );
+  QImage band( QSize( width, qMin( rows, height ) ), QImage::Format_ARGB32 );
+  if ( band.isNull() )
+  {
+    GDALClose( dataset );
+    return false;
+  }
+  QVector<unsigned char> buffer( width * band.height() * nBands );
+
+  bool success = true;
+  for ( int row = 0; row < height && success; row += rows )
+  {
+    int currentRows = qMin( rows, height - row );
+    renderBand( band, row, height );
+
+    //pixel interleaved bytes in band order (red, green, blue, alpha)
+    unsigned char* pixel = buffer.data();
+    for ( int i = 0; i < currentRows; ++i )
+    {
+      const QRgb* line = ( const QRgb* ) band.scanLine( i );
+      for ( int j = 0; j < width; ++j )
+      {
+        *pixel++ = qRed( line[j] );
+        *pixel++ = qGreen( line[j] );
+        *pixel++ = qBlue( line[j] );
+        if ( nBands == 4 )
+        {
+          *pixel++ = qAlpha( line[j] );
+        }
+      }
+    }
+    success = GDALDatasetRasterIO( dataset, GF_Write, 0, row, width, currentRows, buffer.data(), width, currentRows, GDT_Byte,
+                                   nBands, 0, nBands, nBands * width, 1 ) == CE_None;
+  }
+
+  if ( success && !directWrite )
+  {
+    //the copy reads the temporary file line by line, so the memory use stays small
+    GDALDatasetH outputDataset = GDALCreateCopy( outputDriver, QFile::encodeName( fileName ).data(), dataset, FALSE, 0, 0, 0 );
+    success = outputDataset != 0;
+    if ( outputDataset )
+    {
+      GDALClose( outputDataset );
+    }
+  }
+
+  GDALClose( dataset );
+  if ( !directWrite )
+  {
+    GDALDeleteDataset( tiffDriver, QFile::encodeName( tiffName ).data() );
+  }
+  return success;
+}
 
 void QgsComposer::on_mActionExportAsSVG_triggered()
 {
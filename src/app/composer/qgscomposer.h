@@ -41,6 +41,7 @@ class QDomDocument;
 class QMoveEvent;
 class QResizeEvent;
 class QFile;
+class QImage;
 class QSizeGrip;
 class QUndoView;
 
@@ -279,6 +280,18 @@ class QgsComposer: public QMainWindow, private Ui::QgsComposerBase
     //! Print to a printer object
     void print( QPrinter &printer );
 
+    //! Number of image rows rendered at once for raster output of the given width
+    int bandRows( int width ) const;
+
+    //! Renders the rows from firstRow into band. The full image is as wide as band and imageHeight pixels high
+    void renderBand( QImage& band, int firstRow, int imageHeight );
+
+    /**Renders the composition band by band and writes the rows with GDAL, so that only one band is in memory
+      @param fileName output file
+      @param gdalDriverName short name of the GDAL driver for the output format
+      @return false if the file could not be created*/
+    bool exportImageInBands( const QString& fileName, const QString& gdalDriverName, int width, int height );
+
     //! Writes state under DOM element
     void writeXML( QDomNode& parentNode, QDomDocument& doc );
 
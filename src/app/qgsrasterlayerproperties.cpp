@@ -48,6 +48,7 @@
 #include <QList>
 #include <QSettings>
 #include <QMouseEvent>
+#include <QtConcurrentRun>
 #include "qgslogger.h"
 
 // QWT Charting widget
@@ -74,6 +75,7 @@ QgsRasterLayerProperties::QgsRasterLayerProperties( QgsMapLayer* lyr, QgsMapCanv
   mRasterLayerIsInternal = mRasterLayer->dataProvider() == 0;
 
   setupUi( this );
+  connect( &mPyramidWatcher, SIGNAL( finished() ), this, SLOT( pyramidsBuilt() ) );
   connect( buttonBox, SIGNAL( accepted() ), this, SLOT( accept() ) );
   connect( this, SIGNAL( accepted() ), this, SLOT( apply() ) );
   connect( buttonBox->button( QDialogButtonBox::Apply ), SIGNAL( clicked() ), this, SLOT( apply() ) );
@@ -285,6 +287,12 @@ QgsRasterLayerProperties::QgsRasterLayerProperties( QgsMapLayer* lyr, QgsMapCanv
 
 QgsRasterLayerProperties::~QgsRasterLayerProperties()
 {
+  if ( mPyramidWatcher.isRunning() )
+  {
+    mRasterLayer->cancelPyramidBuild();
+    mPyramidWatcher.waitForFinished();
+  }
+
   QSettings settings;
   settings.setValue( "/Windows/RasterLayerProperties/geometry", saveGeometry() );
   settings.setValue( "/Windows/RasterLayerProperties/row", tabBar->currentIndex() );
@@ -1475,6 +1483,11 @@ void QgsRasterLayerProperties::apply()
 
 void QgsRasterLayerProperties::on_buttonBuildPyramids_clicked()
 {
+  if ( mPyramidWatcher.isRunning() )
+  {
+    mRasterLayer->cancelPyramidBuild();
+    return;
+  }
 
   connect( mRasterLayer, SIGNAL( progressUpdate( int ) ), mPyramidProgress, SLOT( setValue( int ) ) );
   //
@@ -1489,18 +1502,28 @@ void QgsRasterLayerProperties::on_buttonBuildPyramids_clicked()
     myPyramidList[myCounterInt].build = myItem->isSelected() || myPyramidList[myCounterInt].exists;
   }
   //
-  // Ask raster layer to build the pyramids
+  // Ask raster layer to build the pyramids in a worker thread, the
+  // button cancels the build until pyramidsBuilt() is called
   //
-
-  // let the user know we're going to possibly be taking a while
-  QApplication::setOverrideCursor( Qt::WaitCursor );
   bool myBuildInternalFlag = cbxInternalPyramids->isChecked();
-  QString res = mRasterLayer->buildPyramids(
-                  myPyramidList,
-                  cboResamplingMethod->currentText(),
-                  myBuildInternalFlag );
-  QApplication::restoreOverrideCursor();
+  mPyramidWatcher.setFuture( QtConcurrent::run( mRasterLayer, &QgsRasterLayer::buildPyramids,
+                             myPyramidList,
+                             cboResamplingMethod->currentText(),
+                             myBuildInternalFlag ) );
+  buttonBuildPyramids->setText( tr( "Cancel" ) );
+  lbxPyramidResolutions->setEnabled( false );
+}
+
+void QgsRasterLayerProperties::pyramidsBuilt()
+{
+  QString res = mPyramidWatcher.result();
   disconnect( mRasterLayer, SIGNAL( progressUpdate( int ) ), mPyramidProgress, SLOT( setValue( int ) ) );
+  // the overviews were written through a dataset handle of the worker thread
+  mRasterLayer->reloadDataset();
+  buttonBuildPyramids->setText( tr( "Build pyramids" ) );
+  lbxPyramidResolutions->setEnabled( true );
+  mPyramidProgress->setValue( 0 );
+
   if ( !res.isNull() )
   {
     if ( res == "ERROR_WRITE_ACCESS" )
@@ -1538,7 +1561,7 @@ void QgsRasterLayerProperties::on_buttonBuildPyramids_clicked()
   //
   lbxPyramidResolutions->clear();
   // Need to rebuild list as some or all pyramids may have failed to build
-  myPyramidList = mRasterLayer->buildPyramidList();
+  QgsRasterLayer::RasterPyramidList myPyramidList = mRasterLayer->buildPyramidList();
   QIcon myPyramidPixmap( QgisApp::getThemeIcon( "/mIconPyramid.png" ) );
   QIcon myNoPyramidPixmap( QgisApp::getThemeIcon( "/mIconNoPyramid.png" ) );
 
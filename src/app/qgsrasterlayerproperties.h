@@ -26,6 +26,8 @@
 #include "qgscolorrampshader.h"
 #include "qgscontexthelp.h"
 
+#include <QFutureWatcher>
+
 class QgsMapLayer;
 class QgsMapCanvas;
 class QgsRasterLayer;
@@ -54,7 +56,8 @@ class QgsRasterLayerProperties : public QDialog, private Ui::QgsRasterLayerPrope
     //TODO: Verify that these all need to be public
     /** \brief Applies the settings made in the dialog without closing the box */
     void apply();
-    /** \brief this slot asks the rasterlayer to construct pyramids */
+    /** \brief this slot asks the rasterlayer to construct pyramids in the background,
+        or cancels the running build */
     void on_buttonBuildPyramids_clicked();
     /** \brief slot executed when user presses "Add Values From Display" button on the transparency page */
     void on_pbnAddValuesFromDisplay_clicked();
@@ -146,6 +149,8 @@ class QgsRasterLayerProperties : public QDialog, private Ui::QgsRasterLayerPrope
     void on_buttonBox_helpRequested() { QgsContextHelp::run( metaObject()->className() ); }
     /** This slot lets you save the histogram as an image to disk */
     void on_mSaveAsImageButton_clicked();
+    /** Reports the result of the background pyramid build and refreshes the pyramid list */
+    void pyramidsBuilt();
 
   signals:
 
@@ -214,6 +219,9 @@ class QgsRasterLayerProperties : public QDialog, private Ui::QgsRasterLayerPrope
 
     QgsMapCanvas* mMapCanvas;
     QgsPixelSelectorTool* mPixelSelectorTool;
+
+    /** Watches the pyramid build running in a worker thread */
+    QFutureWatcher<QString> mPyramidWatcher;
 };
 
 /**
@@ -27,7 +27,11 @@
 #include "qgsmaprenderer.h"
 #include "qgsrasterlayer.h"
 #include "qgsrendercontext.h"
+#include "qgsrenderer.h"
+#include "qgsrendererv2.h"
 #include "qgsscalecalculator.h"
+#include "qgssymbol.h"
+#include "qgssymbolv2.h"
 #include "qgsvectorlayer.h"
 
 #include "qgslabel.h"
@@ -40,6 +44,9 @@
 #include <iostream>
 #include <cmath>
 
+//room (in mm) for labels of features outside the part of the map which is printed at once
+static const double sLabelMarginMM = 20.0;
+
 QgsComposerMap::QgsComposerMap( QgsComposition *composition, int x, int y, int width, int height )
     : QgsComposerItem( x, y, width, height, composition ), mKeepLayerSet( false ), mGridEnabled( false ), mGridStyle( Solid ), \
     mGridIntervalX( 0.0 ), mGridIntervalY( 0.0 ), mGridOffsetX( 0.0 ), mGridOffsetY( 0.0 ), mGridAnnotationPrecision( 3 ), mShowGridAnnotation( false ), \
@@ -228,6 +235,14 @@ void QgsComposerMap::paint( QPainter* painter, const QStyleOptionGraphicsItem* i
   }
 
   QRectF thisPaintRect = QRectF( 0, 0, QGraphicsRectItem::rect().width(), QGraphicsRectItem::rect().height() );
+
+  //part of the item that ends up on the paint device (e.g. one band of a banded raster print)
+  QRectF visibleRect = thisPaintRect;
+  if ( painter->hasClipping() )
+  {
+    visibleRect &= painter->clipRegion().boundingRect();
+  }
+
   painter->save();
   painter->setClipRect( thisPaintRect );
 
@@ -297,28 +312,53 @@ void QgsComposerMap::paint( QPainter* painter, const QStyleOptionGraphicsItem* i
       return;
     }
 
-    QgsRectangle requestRectangle;
-    requestedExtent( requestRectangle );
-
-    QSizeF theSize( requestRectangle.width() * mapUnitsToMM(), requestRectangle.height() * mapUnitsToMM() );
-    QgsPoint rotationPoint = QgsPoint(( mExtent.xMaximum() + mExtent.xMinimum() ) / 2.0, ( mExtent.yMaximum() + mExtent.yMinimum() ) / 2.0 );
-
-    //shift such that rotation point is at 0/0 point in the coordinate system
-    double yShiftMM = ( requestRectangle.yMaximum() - rotationPoint.y() ) * mapUnitsToMM();
-    double xShiftMM = ( requestRectangle.xMinimum() - rotationPoint.x() ) * mapUnitsToMM();
-
-    //shift such that top left point of the extent at point 0/0 in item coordinate system
-    double xTopLeftShift = ( rotationPoint.x() - mExtent.xMinimum() ) * mapUnitsToMM();
-    double yTopLeftShift = ( mExtent.yMaximum() - rotationPoint.y() ) * mapUnitsToMM();
-    painter->save();
-    painter->translate( mXOffset, mYOffset );
-    painter->translate( xTopLeftShift, yTopLeftShift );
-    painter->rotate( mRotation );
-    painter->translate( xShiftMM, -yShiftMM );
-    draw( painter, requestRectangle, theSize, 25.4 ); //scene coordinates seem to be in mm
-
-    //restore rotation
-    painter->restore();
+    if ( mRotation == 0 )
+    {
+      //only render the visible part of the map extent, at its position in the item
+      QRectF mapRect( mXOffset, mYOffset, mExtent.width() * mapUnitsToMM(), mExtent.height() * mapUnitsToMM() );
+      QRectF drawRect = mapRect & visibleRect;
+      if ( !drawRect.isEmpty() )
+      {
+        //features just outside of a band reach into it with their symbols and labels, so the query extent
+        //gets a margin and only the painter is clipped to the visible part
+        double margin = maxSymbolSizeMM() + sLabelMarginMM;
+        drawRect = drawRect.adjusted( -margin, -margin, margin, margin ) & mapRect;
+        double xMin = mExtent.xMinimum() + ( drawRect.left() - mXOffset ) / mapUnitsToMM();
+        double yMax = mExtent.yMaximum() - ( drawRect.top() - mYOffset ) / mapUnitsToMM();
+        QgsRectangle drawExtent( xMin, yMax - drawRect.height() / mapUnitsToMM(), xMin + drawRect.width() / mapUnitsToMM(), yMax );
+
+        painter->save();
+        painter->setClipRect( visibleRect, Qt::IntersectClip );
+        painter->translate( drawRect.topLeft() );
+        draw( painter, drawExtent, drawRect.size(), 25.4 ); //scene coordinates seem to be in mm
+        painter->restore();
+      }
+    }
+    else
+    {
+      QgsRectangle requestRectangle;
+      requestedExtent( requestRectangle );
+
+      QSizeF theSize( requestRectangle.width() * mapUnitsToMM(), requestRectangle.height() * mapUnitsToMM() );
+      QgsPoint rotationPoint = QgsPoint(( mExtent.xMaximum() + mExtent.xMinimum() ) / 2.0, ( mExtent.yMaximum() + mExtent.yMinimum() ) / 2.0 );
+
+      //shift such that rotation point is at 0/0 point in the coordinate system
+      double yShiftMM = ( requestRectangle.yMaximum() - rotationPoint.y() ) * mapUnitsToMM();
+      double xShiftMM = ( requestRectangle.xMinimum() - rotationPoint.x() ) * mapUnitsToMM();
+
+      //shift such that top left point of the extent at point 0/0 in item coordinate system
+      double xTopLeftShift = ( rotationPoint.x() - mExtent.xMinimum() ) * mapUnitsToMM();
+      double yTopLeftShift = ( mExtent.yMaximum() - rotationPoint.y() ) * mapUnitsToMM();
+      painter->save();
+      painter->translate( mXOffset, mYOffset );
+      painter->translate( xTopLeftShift, yTopLeftShift );
+      painter->rotate( mRotation );
+      painter->translate( xShiftMM, -yShiftMM );
+      draw( painter, requestRectangle, theSize, 25.4 ); //scene coordinates seem to be in mm
+
+      //restore rotation
+      painter->restore();
+    }
 
     //draw canvas items
     drawCanvasItems( painter, itemStyle );
@@ -1381,6 +1421,64 @@ double QgsComposerMap::mapUnitsToMM() const
   return rect().width() / extentWidth;
 }
 
+double QgsComposerMap::maxSymbolSizeMM() const
+{
+  if ( !mMapRenderer )
+  {
+    return 0;
+  }
+
+  double maxSize = 0;
+  QStringList layers = mKeepLayerSet ? mLayerSet : mMapRenderer->layerSet();
+  QStringList::const_iterator layerIt = layers.constBegin();
+  for ( ; layerIt != layers.constEnd(); ++layerIt )
+  {
+    QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( *layerIt ) );
+    if ( !vl )
+    {
+      continue;
+    }
+
+    if ( vl->isUsingRendererV2() && vl->rendererV2() )
+    {
+      QgsSymbolV2List symbols = vl->rendererV2()->symbols();
+      QgsSymbolV2List::const_iterator symbolIt = symbols.constBegin();
+      for ( ; symbolIt != symbols.constEnd(); ++symbolIt )
+      {
+        double size = 0;
+        if (( *symbolIt )->type() == QgsSymbolV2::Marker )
+        {
+          size = static_cast<QgsMarkerSymbolV2*>( *symbolIt )->size();
+        }
+        else if (( *symbolIt )->type() == QgsSymbolV2::Line )
+        {
+          size = static_cast<QgsLineSymbolV2*>( *symbolIt )->width();
+        }
+        if (( *symbolIt )->outputUnit() == QgsSymbolV2::MapUnit )
+        {
+          size *= mapUnitsToMM();
+        }
+        maxSize = qMax( maxSize, size );
+      }
+    }
+    else if ( vl->renderer() )
+    {
+      QList<QgsSymbol*> symbols = vl->renderer()->symbols();
+      QList<QgsSymbol*>::const_iterator symbolIt = symbols.constBegin();
+      for ( ; symbolIt != symbols.constEnd(); ++symbolIt )
+      {
+        double pointSize = ( *symbolIt )->pointSize();
+        if (( *symbolIt )->pointSizeUnits() )
+        {
+          pointSize *= mapUnitsToMM();
+        }
+        maxSize = qMax( maxSize, qMax( pointSize, ( *symbolIt )->lineWidth() ) );
+      }
+    }
+  }
+  return maxSize;
+}
+
 void QgsComposerMap::transformShift( double& xShift, double& yShift ) const
 {
   double mmToMapUnits = 1.0 / mapUnitsToMM();
@@ -404,6 +404,8 @@ class CORE_EXPORT QgsComposerMap : public QgsComposerItem
     void drawCanvasItems( QPainter* painter, const QStyleOptionGraphicsItem* itemStyle );
     void drawCanvasItem( QGraphicsItem* item, QPainter* painter, const QStyleOptionGraphicsItem* itemStyle );
     QPointF composerMapPosForItem( const QGraphicsItem* item ) const;
+    /**Returns the largest marker size / line width (in mm) of the symbols of the rendered vector layers*/
+    double maxSymbolSizeMM() const;
 };
 
 #endif
@@ -27,6 +27,7 @@
 #include <QTextStream>
 
 #include "qgsapplication.h"
+#include "qgscrscache.h"
 #include "qgslogger.h"
 #include "qgsmessageoutput.h"
 #include "qgis.h" //const vals declared here
@@ -174,6 +175,15 @@ bool QgsCoordinateReferenceSystem::createFromSrsId( long id )
 bool QgsCoordinateReferenceSystem::loadFromDb( QString db, QString expression, QString value )
 {
   QgsDebugMsgLevel( "load CRS from " + db + " where " + expression + " is " + value, 3 );
+
+  //srs.db is read only, so its definitions can be shared. The user database may change at any time
+  bool systemDb = ( db == QgsApplication::srsDbFilePath() );
+  QString cacheKey = expression + "=" + value;
+  if ( systemDb && QgsCRSCache::instance()->searchCRS( cacheKey, *this ) )
+  {
+    return mIsValidFlag;
+  }
+
   mIsValidFlag = false;
 
   QFileInfo myInfo( db );
@@ -230,6 +240,11 @@ bool QgsCoordinateReferenceSystem::loadFromDb( QString db, QString expression, Q
   }
   sqlite3_finalize( myPreparedStatement );
   sqlite3_close( myDatabase );
+
+  if ( systemDb && mIsValidFlag )
+  {
+    QgsCRSCache::instance()->insertCRS( cacheKey, *this );
+  }
   return mIsValidFlag;
 }
 
@@ -0,0 +1,96 @@
+/***************************************************************************
+                              qgscrscache.cpp
+                              ---------------
+  begin                : October 2010
+  copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgscrscache.h"
+#include "qgscoordinatetransform.h"
+#include <QMutexLocker>
+
+QgsCRSCache* QgsCRSCache::mInstance = 0;
+
+//guards the creation of the instance, the first calls may come from several render threads
+static QMutex sInstanceMutex;
+
+QgsCRSCache* QgsCRSCache::instance()
+{
+  QMutexLocker locker( &sInstanceMutex );
+  if ( !mInstance )
+  {
+    mInstance = new QgsCRSCache();
+  }
+  return mInstance;
+}
+
+//number of CRS definitions kept (srs.db contains a few thousand)
+static const int sMaxCRS = 1000;
+
+QgsCRSCache::QgsCRSCache(): mCRS( sMaxCRS )
+{
+}
+
+QgsCRSCache::~QgsCRSCache()
+{
+}
+
+bool QgsCRSCache::searchCRS( const QString& key, QgsCoordinateReferenceSystem& crs )
+{
+  QMutexLocker locker( &mMutex );
+  QgsCoordinateReferenceSystem* cachedCRS = mCRS.object( key );
+  if ( !cachedCRS )
+  {
+    return false;
+  }
+  crs = *cachedCRS;
+  return true;
+}
+
+void QgsCRSCache::insertCRS( const QString& key, const QgsCoordinateReferenceSystem& crs )
+{
+  if ( !crs.isValid() )
+  {
+    return;
+  }
+  QMutexLocker locker( &mMutex );
+  mCRS.insert( key, new QgsCoordinateReferenceSystem( crs ) );
+}
+
+const QgsCoordinateTransform* QgsCRSCache::transform( const QgsCoordinateReferenceSystem& source, const QgsCoordinateReferenceSystem& destination )
+{
+  //no lock needed, the transforms are per thread
+  if ( !mTransforms.hasLocalData() )
+  {
+    mTransforms.setLocalData( new TransformCache( maxTransforms() ) );
+  }
+  TransformCache* transforms = mTransforms.localData();
+
+  QPair< QString, QString > key = qMakePair( source.toProj4(), destination.toProj4() );
+  QgsCoordinateTransform* ct = transforms->object( key );
+  if ( !ct )
+  {
+    ct = new QgsCoordinateTransform( source, destination );
+    transforms->insert( key, ct );
+  }
+  return ct;
+}
+
+void QgsCRSCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mCRS.clear();
+  if ( mTransforms.hasLocalData() )
+  {
+    mTransforms.localData()->clear();
+  }
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+                              qgscrscache.h
+                              -------------
+  begin                : October 2010
+  copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCRSCACHE_H
+#define QGSCRSCACHE_H
+
+#include "qgscoordinatereferencesystem.h"
+#include <QCache>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QThreadStorage>
+
+class QgsCoordinateTransform;
+
+/** \ingroup core
+ * Process wide cache for coordinate reference system definitions read from srs.db
+ * and for initialised coordinate transforms. Repeated renders (and map server requests)
+ * can reuse them without running sqlite queries and pj_init again.
+ * The CRS definitions are shared by all threads (access is serialized with a mutex).
+ * Transforms carry mutable proj state, so every thread gets its own set of them.
+ * Both caches are bounded, the least recently used entries are dropped first.
+ * @note added in 1.6
+ */
+class CORE_EXPORT QgsCRSCache
+{
+  public:
+    static QgsCRSCache* instance();
+    ~QgsCRSCache();
+
+    /**Looks up a CRS definition by its srs.db query key (e.g. "srid=4326")
+      @return true if the CRS was found in the cache and copied to crs*/
+    bool searchCRS( const QString& key, QgsCoordinateReferenceSystem& crs );
+    /**Inserts a valid CRS definition which has been loaded with the query key*/
+    void insertCRS( const QString& key, const QgsCoordinateReferenceSystem& crs );
+
+    /**Returns an initialised transform from source to destination, owned by the calling thread's cache.
+      Callers must not delete the transform or change its source/destination CRS. The transform stays
+      valid until the thread has asked for maxTransforms() other transforms or calls clear()*/
+    const QgsCoordinateTransform* transform( const QgsCoordinateReferenceSystem& source, const QgsCoordinateReferenceSystem& destination );
+
+    /**Maximum number of transforms cached per thread*/
+    static int maxTransforms() { return 64; }
+
+    /**Removes all cached CRS definitions and the transforms of the calling thread*/
+    void clear();
+
+  protected:
+    QgsCRSCache();
+
+  private:
+    typedef QCache< QPair< QString, QString >, QgsCoordinateTransform > TransformCache;
+
+    static QgsCRSCache* mInstance;
+    QCache< QString, QgsCoordinateReferenceSystem > mCRS;
+    /**Transforms of each thread, the key is the pair of source and destination proj4 strings*/
+    QThreadStorage< TransformCache* > mTransforms;
+    QMutex mMutex;
+};
+
+#endif // QGSCRSCACHE_H
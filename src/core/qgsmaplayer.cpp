@@ -154,39 +154,7 @@ bool QgsMapLayer::readXML( QDomNode & layer_node )
   QDomNode mnl;
   QDomElement mne;
 
-  // read provider
-  QString provider;
-  mnl = layer_node.namedItem( "provider" );
-  mne = mnl.toElement();
-  provider = mne.text();
-
-  // set data source
-  mnl = layer_node.namedItem( "datasource" );
-  mne = mnl.toElement();
-  mDataSource = mne.text();
-
-  if ( provider == "spatialite" )
-  {
-    QgsDataSourceURI uri( mDataSource );
-    uri.setDatabase( QgsProject::instance()->readPath( uri.database() ) );
-    mDataSource = uri.uri();
-  }
-  else if ( provider == "ogr" )
-  {
-    QStringList theURIParts = mDataSource.split( "|" );
-    theURIParts[0] = QgsProject::instance()->readPath( theURIParts[0] );
-    mDataSource = theURIParts.join( "|" );
-  }
-  else if ( provider == "delimitedtext" )
-  {
-    QStringList theURIParts = mDataSource.split( "?" );
-    theURIParts[0] = QgsProject::instance()->readPath( theURIParts[0] );
-    mDataSource = theURIParts.join( "?" );
-  }
-  else
-  {
-    mDataSource = QgsProject::instance()->readPath( mDataSource );
-  }
+  mDataSource = readDataSource( layer_node );
 
   // Set the CRS from project file, asking the user if necessary.
   // Make it the saved CRS to have WMS layer projected correctly.
@@ -271,6 +239,48 @@ bool QgsMapLayer::readXml( QDomNode & layer_node )
 
 
 
+QString QgsMapLayer::readDataSource( const QDomNode & layer_node )
+{
+  QDomNode mnl;
+  QDomElement mne;
+
+  // read provider
+  QString provider;
+  mnl = layer_node.namedItem( "provider" );
+  mne = mnl.toElement();
+  provider = mne.text();
+
+  // set data source
+  mnl = layer_node.namedItem( "datasource" );
+  mne = mnl.toElement();
+  QString dataSource = mne.text();
+
+  if ( provider == "spatialite" )
+  {
+    QgsDataSourceURI uri( dataSource );
+    uri.setDatabase( QgsProject::instance()->readPath( uri.database() ) );
+    dataSource = uri.uri();
+  }
+  else if ( provider == "ogr" )
+  {
+    QStringList theURIParts = dataSource.split( "|" );
+    theURIParts[0] = QgsProject::instance()->readPath( theURIParts[0] );
+    dataSource = theURIParts.join( "|" );
+  }
+  else if ( provider == "delimitedtext" )
+  {
+    QStringList theURIParts = dataSource.split( "?" );
+    theURIParts[0] = QgsProject::instance()->readPath( theURIParts[0] );
+    dataSource = theURIParts.join( "?" );
+  }
+  else
+  {
+    dataSource = QgsProject::instance()->readPath( dataSource );
+  }
+
+  return dataSource;
+}
+
 bool QgsMapLayer::writeXML( QDomNode & layer_node, QDomDocument & document )
 {
   // general layer metadata
@@ -323,6 +333,14 @@ bool QgsMapLayer::writeXML( QDomNode & layer_node, QDomDocument & document )
 
   maplayer.appendChild( dataSource );
 
+  // extent, lets layers skip scanning the data source when loading the project
+  QDomElement extentElement = document.createElement( "extent" );
+  extentElement.setAttribute( "xmin", QString::number( mLayerExtent.xMinimum(), 'f' ) );
+  extentElement.setAttribute( "ymin", QString::number( mLayerExtent.yMinimum(), 'f' ) );
+  extentElement.setAttribute( "xmax", QString::number( mLayerExtent.xMaximum(), 'f' ) );
+  extentElement.setAttribute( "ymax", QString::number( mLayerExtent.yMaximum(), 'f' ) );
+  maplayer.appendChild( extentElement );
+
 
   // layer name
   QDomElement layerName = document.createElement( "layername" );
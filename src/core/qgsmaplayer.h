@@ -150,6 +150,13 @@ class CORE_EXPORT QgsMapLayer : public QObject
      */
     bool readXML( QDomNode & layer_node );
 
+    /** Return the data source of the layer stored in the Dom node, with relative
+        paths resolved like readXML() does. Used to start opening the data source
+        before the layer itself is created.
+        @note added in 1.6
+     */
+    static QString readDataSource( const QDomNode & layer_node );
+
 
     /** stores state in Dom node
        @param layer_node is Dom node corresponding to ``projectlayers'' tag
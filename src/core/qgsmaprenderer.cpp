@@ -18,6 +18,7 @@
 #include <cfloat>
 
 #include "qgscoordinatetransform.h"
+#include "qgscrscache.h"
 #include "qgslogger.h"
 #include "qgsmaprenderer.h"
 #include "qgsscalecalculator.h"
@@ -242,7 +243,7 @@ void QgsMapRenderer::render( QPainter* painter )
 
   mDrawing = true;
 
-  QgsCoordinateTransform* ct;
+  const QgsCoordinateTransform* ct;
 
 #ifdef QGISDEBUG
   QgsDebugMsg( "Starting to render layer stack." );
@@ -252,7 +253,7 @@ void QgsMapRenderer::render( QPainter* painter )
 
   mRenderContext.setDrawEditingInformation( !mOverview );
   mRenderContext.setPainter( painter );
-  mRenderContext.setCoordinateTransform( 0 );
+  mRenderContext.setSharedCoordinateTransform( 0 );
   //this flag is only for stopping during the current rendering progress,
   //so must be false at every new render operation
   mRenderContext.setRenderingStopped( false );
@@ -372,7 +373,7 @@ void QgsMapRenderer::render( QPainter* painter )
       {
         r1 = mExtent;
         split = splitLayersExtent( ml, r1, r2 );
-        ct = new QgsCoordinateTransform( ml->srs(), *mDestCRS );
+        ct = QgsCRSCache::instance()->transform( ml->srs(), *mDestCRS );
         mRenderContext.setExtent( r1 );
       }
       else
@@ -380,7 +381,7 @@ void QgsMapRenderer::render( QPainter* painter )
         ct = NULL;
       }
 
-      mRenderContext.setCoordinateTransform( ct );
+      mRenderContext.setSharedCoordinateTransform( ct );
 
       //decide if we have to scale the raster
       //this is necessary in case QGraphicsScene is used
@@ -421,8 +422,9 @@ void QgsMapRenderer::render( QPainter* painter )
       // or if there's a labeling engine that needs the layer to register features
       if ( ml->type() == QgsMapLayer::VectorLayer )
       {
+        // also if the layer draws a selection inline, as selection changes do not invalidate the cache
         QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( ml );
-        if ( vl->isEditable() ||
+        if ( vl->isEditable() || ( mRenderContext.drawSelection() && vl->selectedFeatureCount() > 0 ) ||
              ( mRenderContext.labelingEngine() && mRenderContext.labelingEngine()->willUseLayer( vl ) ) )
         {
           ml->setCacheImage( 0 );
@@ -548,7 +550,7 @@ void QgsMapRenderer::render( QPainter* painter )
           {
             QgsRectangle r1 = mExtent;
             split = splitLayersExtent( ml, r1, r2 );
-            ct = new QgsCoordinateTransform( ml->srs(), *mDestCRS );
+            ct = QgsCRSCache::instance()->transform( ml->srs(), *mDestCRS );
             mRenderContext.setExtent( r1 );
           }
           else
@@ -556,7 +558,7 @@ void QgsMapRenderer::render( QPainter* painter )
             ct = NULL;
           }
 
-          mRenderContext.setCoordinateTransform( ct );
+          mRenderContext.setSharedCoordinateTransform( ct );
 
           ml->drawLabels( mRenderContext );
           if ( split )
@@ -590,7 +592,7 @@ void QgsMapRenderer::render( QPainter* painter )
   {
     // set correct extent
     mRenderContext.setExtent( mExtent );
-    mRenderContext.setCoordinateTransform( NULL );
+    mRenderContext.setSharedCoordinateTransform( NULL );
 
     mLabelingEngine->drawLabeling( mRenderContext );
     mLabelingEngine->exit();
@@ -602,6 +604,64 @@ void QgsMapRenderer::render( QPainter* painter )
 
 }
 
+void QgsMapRenderer::renderSelection( QPainter* painter )
+{
+  if ( mExtent.isEmpty() || mDrawing || !painter->device() )
+  {
+    return;
+  }
+
+  mDrawing = true;
+
+  //scale factors, scale and map to pixel are kept from the last render
+  mRenderContext.setPainter( painter );
+  mRenderContext.setRenderingStopped( false );
+
+  QgsRectangle r1, r2;
+  const QgsCoordinateTransform* ct;
+
+  // draw the selections in the layer order, starting at the base
+  QListIterator<QString> li( mLayerSet );
+  li.toBack();
+  while ( li.hasPrevious() )
+  {
+    QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( QgsMapLayerRegistry::instance()->mapLayer( li.previous() ) );
+    if ( !vl || vl->selectedFeatureCount() == 0 )
+    {
+      continue;
+    }
+
+    if ( vl->hasScaleBasedVisibility() && ( vl->minimumScale() >= mScale || mScale >= vl->maximumScale() ) && !mOverview )
+    {
+      continue;
+    }
+
+    bool split = false;
+    if ( hasCrsTransformEnabled() )
+    {
+      r1 = mExtent;
+      split = splitLayersExtent( vl, r1, r2 );
+      ct = QgsCRSCache::instance()->transform( vl->srs(), *mDestCRS );
+      mRenderContext.setExtent( r1 );
+    }
+    else
+    {
+      ct = NULL;
+      mRenderContext.setExtent( mExtent );
+    }
+    mRenderContext.setSharedCoordinateTransform( ct );
+
+    vl->drawSelectedFeatures( mRenderContext );
+    if ( split )
+    {
+      mRenderContext.setExtent( r2 );
+      vl->drawSelectedFeatures( mRenderContext );
+    }
+  }
+
+  mDrawing = false;
+}
+
 void QgsMapRenderer::setMapUnits( QGis::UnitType u )
 {
   mScaleCalculator->setMapUnits( u );
@@ -674,7 +734,7 @@ bool QgsMapRenderer::splitLayersExtent( QgsMapLayer* layer, QgsRectangle& extent
   {
     try
     {
-      QgsCoordinateTransform tr( layer->srs(), *mDestCRS );
+      const QgsCoordinateTransform& tr = *QgsCRSCache::instance()->transform( layer->srs(), *mDestCRS );
 
 #ifdef QGISDEBUG
       // QgsLogger::debug<QgsRectangle>("Getting extent of canvas in layers CS. Canvas is ", extent, __FILE__, __FUNCTION__, __LINE__);
@@ -686,7 +746,7 @@ bool QgsMapRenderer::splitLayersExtent( QgsMapLayer* layer, QgsRectangle& extent
       // extent separately.
       static const double splitCoord = 180.0;
 
-      if ( tr.sourceCrs().geographicFlag() )
+      if ( layer->srs().geographicFlag() )
       {
         // Note: ll = lower left point
         //   and ur = upper right point
@@ -730,8 +790,8 @@ QgsRectangle QgsMapRenderer::layerExtentToOutputExtent( QgsMapLayer* theLayer, Q
   {
     try
     {
-      QgsCoordinateTransform tr( theLayer->srs(), *mDestCRS );
-      extent = tr.transformBoundingBox( extent );
+      const QgsCoordinateTransform* tr = QgsCRSCache::instance()->transform( theLayer->srs(), *mDestCRS );
+      extent = tr->transformBoundingBox( extent );
     }
     catch ( QgsCsException &cse )
     {
@@ -753,8 +813,8 @@ QgsPoint QgsMapRenderer::layerToMapCoordinates( QgsMapLayer* theLayer, QgsPoint
   {
     try
     {
-      QgsCoordinateTransform tr( theLayer->srs(), *mDestCRS );
-      point = tr.transform( point, QgsCoordinateTransform::ForwardTransform );
+      const QgsCoordinateTransform* tr = QgsCRSCache::instance()->transform( theLayer->srs(), *mDestCRS );
+      point = tr->transform( point, QgsCoordinateTransform::ForwardTransform );
     }
     catch ( QgsCsException &cse )
     {
@@ -775,8 +835,8 @@ QgsPoint QgsMapRenderer::mapToLayerCoordinates( QgsMapLayer* theLayer, QgsPoint
   {
     try
     {
-      QgsCoordinateTransform tr( theLayer->srs(), *mDestCRS );
-      point = tr.transform( point, QgsCoordinateTransform::ReverseTransform );
+      const QgsCoordinateTransform* tr = QgsCRSCache::instance()->transform( theLayer->srs(), *mDestCRS );
+      point = tr->transform( point, QgsCoordinateTransform::ReverseTransform );
     }
     catch ( QgsCsException &cse )
     {
@@ -797,8 +857,8 @@ QgsRectangle QgsMapRenderer::mapToLayerCoordinates( QgsMapLayer* theLayer, QgsRe
   {
     try
     {
-      QgsCoordinateTransform tr( theLayer->srs(), *mDestCRS );
-      rect = tr.transform( rect, QgsCoordinateTransform::ReverseTransform );
+      const QgsCoordinateTransform* tr = QgsCRSCache::instance()->transform( theLayer->srs(), *mDestCRS );
+      rect = tr->transform( rect, QgsCoordinateTransform::ReverseTransform );
     }
     catch ( QgsCsException &cse )
     {
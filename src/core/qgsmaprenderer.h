@@ -113,6 +113,13 @@ class CORE_EXPORT QgsMapRenderer : public QObject
     //! starts rendering
     void render( QPainter* painter );
 
+    /** Draws the selected features of the vector layers with the settings of the last render().
+      Used together with QgsRenderContext::setDrawSelection( false ) to update the selection
+      without rendering the layers again. The selection is drawn on top of all layers and labels.
+      Does nothing while render() is running.
+      @note added in 1.6 */
+    void renderSelection( QPainter* painter );
+
     //! sets extent and checks whether suitable (returns false if not)
     bool setExtent( const QgsRectangle& extent );
 
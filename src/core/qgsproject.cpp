@@ -32,11 +32,13 @@
 #include "qgsprojectversion.h"
 #include "qgspluginlayer.h"
 #include "qgspluginlayerregistry.h"
+#include "qgsproviderregistry.h"
 
 #include <QApplication>
 #include <QFileInfo>
 #include <QDomNode>
 #include <QObject>
+#include <QSettings>
 #include <QTextStream>
 
 
@@ -676,6 +678,27 @@ QPair< bool, QList<QDomNode> > QgsProject::_getMapLayers( QDomDocument const &do
 
   emit layerLoaded( 0, nl.count() );
 
+  // Start reading the files of the vector data sources concurrently. The
+  // layers and their providers are still created one by one below, so that
+  // the order is kept; each of them only waits for its own files.
+  QSettings settings;
+  bool parallelLoading = settings.value( "/qgis/parallelLayerLoading", true ).toBool();
+  if ( parallelLoading )
+  {
+    for ( int i = 0; i < nl.count(); i++ )
+    {
+      QDomNode node = nl.item( i );
+      if ( node.toElement().attribute( "type" ) != "vector" )
+        continue;
+
+      QString provider = node.namedItem( "provider" ).toElement().text();
+      if ( provider.isEmpty() )
+        continue;
+
+      QgsProviderRegistry::instance()->preloadProvider( provider, QgsMapLayer::readDataSource( node ) );
+    }
+  }
+
   for ( int i = 0; i < nl.count(); i++ )
   {
     QDomNode node = nl.item( i );
@@ -707,6 +730,7 @@ QPair< bool, QList<QDomNode> > QgsProject::_getMapLayers( QDomDocument const &do
     {
       QgsDebugMsg( "Unable to create layer" );
 
+      QgsProviderRegistry::instance()->clearPreloadedProviders();
       return qMakePair( false, brokenNodes );
     }
 
@@ -729,6 +753,12 @@ QPair< bool, QList<QDomNode> > QgsProject::_getMapLayers( QDomDocument const &do
     emit layerLoaded( i + 1, nl.count() );
   }
 
+  if ( parallelLoading )
+  {
+    // providers of layers that failed before requesting them
+    QgsProviderRegistry::instance()->clearPreloadedProviders();
+  }
+
   return qMakePair( returnStatus, brokenNodes );
 
 } // _getMapLayers
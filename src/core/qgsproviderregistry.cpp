@@ -23,7 +23,11 @@
 
 #include <QString>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QLibrary>
+#include <QUrl>
+#include <QtConcurrentRun>
 
 
 #include "qgis.h"
@@ -224,6 +228,7 @@ QgsProviderRegistry::QgsProviderRegistry( QString pluginPath )
 
 QgsProviderRegistry::~QgsProviderRegistry()
 {
+  clearPreloadedProviders();
 }
 
 
@@ -321,6 +326,64 @@ QDir const & QgsProviderRegistry::libraryDirectory() const
 typedef QgsDataProvider * classFactoryFunction_t( const QString * );
 
 
+// bytes read ahead from a data file, enough for its header (and the field descriptors of a dbf)
+static const qint64 sPreloadHeaderSize = 64 * 1024;
+// index files are read completely up to this size
+static const qint64 sPreloadIndexSize = 4 * 1024 * 1024;
+// maximum number of bytes read ahead for one data source
+static const qint64 sPreloadMaxSize = 16 * 1024 * 1024;
+
+void QgsProviderRegistry::readDataSourceFiles( QString providerKey, QString dataSource )
+{
+  // only plain file I/O here, provider constructors use Qt and OGR functions which are not thread safe
+  QString filePath;
+  if ( providerKey == "ogr" )
+  {
+    filePath = dataSource.section( '|', 0, 0 );
+  }
+  else if ( providerKey == "delimitedtext" )
+  {
+    filePath = QUrl::fromPercentEncoding( dataSource.left( dataSource.indexOf( "?" ) ).toUtf8() );
+    if ( filePath.startsWith( "file://" ) )
+    {
+      filePath = filePath.mid( 7 );
+    }
+  }
+
+  QFileInfo fileInfo( filePath );
+  if ( !fileInfo.isFile() )
+  {
+    return;
+  }
+
+  // the headers of the data file and its companions (e.g. .shp/.dbf) and the index files (e.g. .shx/.qix),
+  // not the records: those are read by the provider when needed and could be several gigabytes
+  QStringList indexSuffixes;
+  indexSuffixes << "shx" << "qix" << "sbn" << "sbx" << "idx" << "ind" << "prj" << "qpj" << "cpg";
+
+  qint64 bytesLeft = sPreloadMaxSize;
+  QFileInfoList files = fileInfo.dir().entryInfoList( QStringList() << fileInfo.completeBaseName() + ".*", QDir::Files );
+  QFileInfoList::const_iterator fileIt = files.constBegin();
+  for ( ; fileIt != files.constEnd() && bytesLeft > 0; ++fileIt )
+  {
+    QFile file( fileIt->absoluteFilePath() );
+    if ( !file.open( QIODevice::ReadOnly ) )
+    {
+      continue;
+    }
+    qint64 readSize = indexSuffixes.contains( fileIt->suffix().toLower() ) ? sPreloadIndexSize : sPreloadHeaderSize;
+    readSize = qMin( readSize, bytesLeft );
+    char buffer[65536];
+    qint64 bytesRead;
+    while ( readSize > 0 && ( bytesRead = file.read( buffer, qMin( readSize, ( qint64 ) sizeof( buffer ) ) ) ) > 0 )
+    {
+      readSize -= bytesRead;
+      bytesLeft -= bytesRead;
+    }
+  }
+}
+
+
 
 /** Copied from QgsVectorLayer::setDataProvider
  *  TODO: Make it work in the generic environment
@@ -331,6 +394,54 @@ typedef QgsDataProvider * classFactoryFunction_t( const QString * );
  */
 QgsDataProvider* QgsProviderRegistry::getProvider( QString const & providerKey,
     QString const & dataSource )
+{
+  QString preloadKey = providerKey + "\n" + dataSource;
+  QHash< QString, QList< QFuture<void> > >::iterator preloadIt = mPreloadedProviders.find( preloadKey );
+  if ( preloadIt != mPreloadedProviders.end() )
+  {
+    // no need to wait: the read ahead only warms the file system cache and is limited to headers and indexes
+    preloadIt.value().removeFirst();
+    if ( preloadIt.value().isEmpty() )
+    {
+      mPreloadedProviders.erase( preloadIt );
+    }
+  }
+
+  return createProvider( providerKey, dataSource );
+}
+
+
+void QgsProviderRegistry::preloadProvider( QString const & providerKey,
+    QString const & dataSource )
+{
+  // Only file based providers benefit from reading ahead
+  if ( providerKey != "ogr" && providerKey != "delimitedtext" )
+  {
+    return;
+  }
+
+  QFuture<void> future = QtConcurrent::run( readDataSourceFiles, providerKey, dataSource );
+  mPreloadedProviders[ providerKey + "\n" + dataSource ].append( future );
+}
+
+
+void QgsProviderRegistry::clearPreloadedProviders()
+{
+  QHash< QString, QList< QFuture<void> > >::iterator it = mPreloadedProviders.begin();
+  for ( ; it != mPreloadedProviders.end(); ++it )
+  {
+    QList< QFuture<void> >::iterator futureIt = it.value().begin();
+    for ( ; futureIt != it.value().end(); ++futureIt )
+    {
+      futureIt->waitForFinished();
+    }
+  }
+  mPreloadedProviders.clear();
+}
+
+
+QgsDataProvider* QgsProviderRegistry::createProvider( QString const & providerKey,
+    QString const & dataSource )
 {
   // XXX should I check for and possibly delete any pre-existing providers?
   // XXX How often will that scenario occur?
@@ -423,7 +534,7 @@ QgsDataProvider* QgsProviderRegistry::getProvider( QString const & providerKey,
 
   return 0;  // factory didn't exist
 
-} // QgsProviderRegistry::setDataProvider
+} // QgsProviderRegistry::createProvider
 
 QString QgsProviderRegistry::fileVectorFilters() const
 {
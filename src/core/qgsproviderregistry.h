@@ -23,6 +23,9 @@
 #include <map>
 
 #include <QDir>
+#include <QFuture>
+#include <QHash>
+#include <QList>
 #include <QString>
 
 
@@ -67,6 +70,23 @@ class CORE_EXPORT QgsProviderRegistry
     QgsDataProvider * getProvider( const QString & providerKey,
                                    const QString & dataSource );
 
+    /** Start reading the headers and index files of a data source in a worker
+        thread, so that they are in the file system cache when the provider is
+        created. At most a few megabytes are read per data source. A later
+        getProvider call with the same arguments does not wait for the read ahead
+        and creates the provider in the calling thread as usual. Provider
+        constructors are not thread safe, so only the file I/O of several layers
+        overlaps. Only ogr and delimitedtext data sources are read ahead.
+        @note added in 1.6
+     */
+    void preloadProvider( const QString & providerKey,
+                          const QString & dataSource );
+
+    /** Wait for and forget the read aheads that were not taken by getProvider
+        @note added in 1.6
+     */
+    void clearPreloadedProviders();
+
     /** Return list of available providers by their keys */
     QStringList providerList() const;
 
@@ -134,6 +154,16 @@ class CORE_EXPORT QgsProviderRegistry
     /** pointer to canonical Singleton object */
     static QgsProviderRegistry* _instance;
 
+    /** load the provider library and create an instance of the provider */
+    QgsDataProvider * createProvider( const QString & providerKey,
+                                      const QString & dataSource );
+
+    /** run by preloadProvider in a worker thread, reads the headers of the data source file and its companions and their index files */
+    static void readDataSourceFiles( QString providerKey, QString dataSource );
+
+    /** read aheads started by preloadProvider, key is provider key and data source */
+    QHash< QString, QList< QFuture<void> > > mPreloadedProviders;
+
     /** associative container of provider metadata handles */
     Providers mProviders;
 
@@ -21,7 +21,9 @@
 QgsRenderContext::QgsRenderContext()
     : mPainter( 0 ),
     mCoordTransform( 0 ),
+    mOwnsCoordTransform( false ),
     mDrawEditingInformation( false ),
+    mDrawSelection( true ),
     mForceVectorOutput( false ),
     mRenderingStopped( false ),
     mScaleFactor( 1.0 ),
@@ -33,12 +35,29 @@ QgsRenderContext::QgsRenderContext()
 
 QgsRenderContext::~QgsRenderContext()
 {
-  delete mCoordTransform;
+  if ( mOwnsCoordTransform )
+  {
+    delete mCoordTransform;
+  }
 }
 
 void QgsRenderContext::setCoordinateTransform( QgsCoordinateTransform* t )
 {
-  delete mCoordTransform;
+  if ( mOwnsCoordTransform )
+  {
+    delete mCoordTransform;
+  }
   mCoordTransform = t;
+  mOwnsCoordTransform = true;
+}
+
+void QgsRenderContext::setSharedCoordinateTransform( const QgsCoordinateTransform* t )
+{
+  if ( mOwnsCoordTransform )
+  {
+    delete mCoordTransform;
+  }
+  mCoordTransform = t;
+  mOwnsCoordTransform = false;
 }
 
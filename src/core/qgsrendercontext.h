@@ -58,6 +58,10 @@ class CORE_EXPORT QgsRenderContext
 
     bool drawEditingInformation() const {return mDrawEditingInformation;}
 
+    /**True if vector layers highlight their selected features while drawing.
+      @note added in 1.6*/
+    bool drawSelection() const {return mDrawSelection;}
+
     double rendererScale() const {return mRendererScale;}
 
     //! Added in QGIS v1.4
@@ -67,9 +71,15 @@ class CORE_EXPORT QgsRenderContext
 
     /**Sets coordinate transformation. QgsRenderContext takes ownership and deletes if necessary*/
     void setCoordinateTransform( QgsCoordinateTransform* t );
+    /**Sets a coordinate transformation which is owned elsewhere (e.g. by QgsCRSCache).
+      @note added in 1.6*/
+    void setSharedCoordinateTransform( const QgsCoordinateTransform* t );
     void setMapToPixel( const QgsMapToPixel& mtp ) {mMapToPixel = mtp;}
     void setExtent( const QgsRectangle& extent ) {mExtent = extent;}
     void setDrawEditingInformation( bool b ) {mDrawEditingInformation = b;}
+    /**Set to false if the selection is drawn separately (see QgsMapRenderer::renderSelection).
+      @note added in 1.6*/
+    void setDrawSelection( bool b ) {mDrawSelection = b;}
     void setRenderingStopped( bool stopped ) {mRenderingStopped = stopped;}
     void setScaleFactor( double factor ) {mScaleFactor = factor;}
     void setRasterScaleFactor( double factor ) {mRasterScaleFactor = factor;}
@@ -86,11 +96,17 @@ class CORE_EXPORT QgsRenderContext
     QPainter* mPainter;
 
     /**For transformation between coordinate systems. Can be 0 if on-the-fly reprojection is not used*/
-    QgsCoordinateTransform* mCoordTransform;
+    const QgsCoordinateTransform* mCoordTransform;
+
+    /**True if mCoordTransform has been passed with setCoordinateTransform and needs to be deleted*/
+    bool mOwnsCoordTransform;
 
     /**True if vertex markers for editing should be drawn*/
     bool mDrawEditingInformation;
 
+    /**True if selected features are drawn with the selection color by the layers*/
+    bool mDrawSelection;
+
     QgsRectangle mExtent;
 
     /**If true then no rendered vector elements should be cached as image*/
@@ -15,11 +15,10 @@
 /* $Id$ */
 
 #include <QSettings>
+#include <QSet>
+#include <QtAlgorithms>
 #include <QTextCodec>
 
-#include <cfloat> // for DBL_MAX
-#include <climits>
-
 #include "qgsvectordataprovider.h"
 #include "qgsfeature.h"
 #include "qgsfield.h"
@@ -27,7 +26,6 @@
 
 QgsVectorDataProvider::QgsVectorDataProvider( QString uri )
     : QgsDataProvider( uri )
-    , mCacheMinMaxDirty( true )
     , mFetchFeaturesWithoutGeom( true )
 {
   QSettings settings;
@@ -305,32 +303,93 @@ QVariant QgsVectorDataProvider::minimumValue( int index )
     return QVariant();
   }
 
-  fillMinMaxCache();
+  return fieldStatistics( index ).minimum;
+}
 
-  if ( !mCacheMinValues.contains( index ) )
+QVariant QgsVectorDataProvider::maximumValue( int index )
+{
+  if ( !fields().contains( index ) )
+  {
+    QgsDebugMsg( "Warning: access requested to invalid field index: " + QString::number( index ) );
     return QVariant();
+  }
 
-  return mCacheMinValues[index];
+  return fieldStatistics( index ).maximum;
 }
 
-QVariant QgsVectorDataProvider::maximumValue( int index )
+QVariant QgsVectorDataProvider::aggregateValue( int index, Aggregate aggregate )
 {
+  if ( aggregate == Minimum )
+    return minimumValue( index );
+  if ( aggregate == Maximum )
+    return maximumValue( index );
+
   if ( !fields().contains( index ) )
   {
     QgsDebugMsg( "Warning: access requested to invalid field index: " + QString::number( index ) );
     return QVariant();
   }
 
-  fillMinMaxCache();
+  const FieldStatistics& stats = fieldStatistics( index );
+  if ( aggregate == Count )
+    return stats.count;
 
-  if ( !mCacheMaxValues.contains( index ) )
-    return QVariant();
+  return stats.sum;
+}
+
+QList<double> QgsVectorDataProvider::quantiles( int index, int classes )
+{
+  QList<double> breaks;
+  if ( !fields().contains( index ) )
+  {
+    QgsDebugMsg( "Warning: access requested to invalid field index: " + QString::number( index ) );
+    return breaks;
+  }
+
+  if ( !mCacheSortedValues.contains( index ) )
+  {
+    QList<double> values;
+    QgsFeature f;
+    select( QgsAttributeList() << index, QgsRectangle(), false );
+    while ( nextFeature( f ) )
+    {
+      const QVariant& value = f.attributeMap()[index];
+      if ( !value.isNull() )
+        values.append( value.toDouble() );
+    }
+    qSort( values );
+    mCacheSortedValues.insert( index, values );
+  }
+
+  const QList<double>& values = mCacheSortedValues[index];
+  int n = values.size();
+  if ( n == 0 )
+    return breaks;
+
+  // q-th quantile: Xq = (1 - r) * X[a] + r * X[a+1] with a = q * (n-1) (indices 0...n-1)
+  for ( int i = 1; i < classes; i++ )
+  {
+    double q = i / ( double ) classes;
+    double a = q * ( n - 1 );
+    int aa = ( int )( a );
+    double r = a - aa;
+    breaks.append( aa + 1 < n ? ( 1 - r ) * values[aa] + r * values[aa+1] : values[aa] );
+  }
+  breaks.append( values[n-1] );
 
-  return mCacheMaxValues[index];
+  return breaks;
 }
 
 void QgsVectorDataProvider::uniqueValues( int index, QList<QVariant> &values, int limit )
 {
+  if ( mCacheUniqueValues.contains( index ) )
+  {
+    values = mCacheUniqueValues[index];
+    if ( limit >= 0 && values.size() > limit )
+      values = values.mid( 0, limit );
+    return;
+  }
+
   QgsFeature f;
   QgsAttributeList keys;
   keys.append( index );
@@ -339,92 +398,80 @@ void QgsVectorDataProvider::uniqueValues( int index, QList<QVariant> &values, in
   QSet<QString> set;
   values.clear();
 
+  bool complete = true;
   while ( nextFeature( f ) )
   {
-    if ( !set.contains( f.attributeMap()[index].toString() ) )
+    if ( limit >= 0 && values.size() >= limit )
     {
-      values.append( f.attributeMap()[index] );
-      set.insert( f.attributeMap()[index].toString() );
+      complete = false;
+      break;
     }
 
-    if ( limit >= 0 && values.size() >= limit )
-      break;
+    const QVariant& value = f.attributeMap()[index];
+    if ( !set.contains( value.toString() ) )
+    {
+      values.append( value );
+      set.insert( value.toString() );
+    }
   }
+
+  // a list cut off by the limit cannot answer later requests
+  if ( complete )
+    mCacheUniqueValues.insert( index, values );
 }
 
 void QgsVectorDataProvider::clearMinMaxCache()
 {
-  mCacheMinMaxDirty = true;
+  mCacheStatistics.clear();
+  mCacheUniqueValues.clear();
+  mCacheSortedValues.clear();
 }
 
-void QgsVectorDataProvider::fillMinMaxCache()
+const QgsVectorDataProvider::FieldStatistics& QgsVectorDataProvider::fieldStatistics( int index )
 {
-  if ( !mCacheMinMaxDirty )
-    return;
+  QMap<int, FieldStatistics>::const_iterator cached = mCacheStatistics.find( index );
+  if ( cached != mCacheStatistics.end() )
+    return cached.value();
+
+  QVariant::Type type = fields()[index].type();
+  bool numeric = type == QVariant::Int || type == QVariant::Double || type == QVariant::LongLong;
+
+  FieldStatistics stats;
+  stats.count = 0;
+  double sum = 0.0;
 
-  const QgsFieldMap& flds = fields();
-  for ( QgsFieldMap::const_iterator it = flds.begin(); it != flds.end(); ++it )
+  QgsFeature f;
+  select( QgsAttributeList() << index, QgsRectangle(), false );
+  while ( nextFeature( f ) )
   {
-    if ( it->type() == QVariant::Int )
-    {
-      mCacheMinValues[it.key()] = QVariant( INT_MAX );
-      mCacheMaxValues[it.key()] = QVariant( INT_MIN );
-    }
-    else if ( it->type() == QVariant::Double )
+    const QVariant& value = f.attributeMap()[index];
+    if ( value.isNull() )
+      continue;
+
+    if ( numeric )
     {
-      mCacheMinValues[it.key()] = QVariant( DBL_MAX );
-      mCacheMaxValues[it.key()] = QVariant( -DBL_MAX );
+      double v = value.toDouble();
+      sum += v;
+      if ( stats.count == 0 || v < stats.minimum.toDouble() )
+        stats.minimum = value;
+      if ( stats.count == 0 || v > stats.maximum.toDouble() )
+        stats.maximum = value;
     }
     else
     {
-      mCacheMinValues[it.key()] = QVariant();
-      mCacheMaxValues[it.key()] = QVariant();
+      QString v = value.toString();
+      if ( stats.count == 0 || v < stats.minimum.toString() )
+        stats.minimum = v;
+      if ( stats.count == 0 || v > stats.maximum.toString() )
+        stats.maximum = v;
     }
+    stats.count++;
   }
 
-  QgsFeature f;
-  QgsAttributeList keys = mCacheMinValues.keys();
-  select( keys, QgsRectangle(), false );
-
-  while ( nextFeature( f ) )
-  {
-    QgsAttributeMap attrMap = f.attributeMap();
-    for ( QgsAttributeList::const_iterator it = keys.begin(); it != keys.end(); ++it )
-    {
-      const QVariant& varValue = attrMap[*it];
-
-      if ( flds[*it].type() == QVariant::Int )
-      {
-        int value = varValue.toInt();
-        if ( value < mCacheMinValues[*it].toInt() )
-          mCacheMinValues[*it] = value;
-        if ( value > mCacheMaxValues[*it].toInt() )
-          mCacheMaxValues[*it] = value;
-      }
-      else if ( flds[*it].type() == QVariant::Double )
-      {
-        double value = varValue.toDouble();
-        if ( value < mCacheMinValues[*it].toDouble() )
-          mCacheMinValues[*it] = value;
-        if ( value > mCacheMaxValues[*it].toDouble() )
-          mCacheMaxValues[*it] = value;
-      }
-      else
-      {
-        QString value = varValue.toString();
-        if ( mCacheMinValues[*it].isNull() || value < mCacheMinValues[*it].toString() )
-        {
-          mCacheMinValues[*it] = value;
-        }
-        if ( mCacheMaxValues[*it].isNull() || value > mCacheMaxValues[*it].toString() )
-        {
-          mCacheMaxValues[*it] = value;
-        }
-      }
-    }
-  }
+  if ( numeric && stats.count > 0 )
+    stats.sum = sum;
 
-  mCacheMinMaxDirty = false;
+  return mCacheStatistics.insert( index, stats ).value();
 }
 
 QVariant QgsVectorDataProvider::convertValue( QVariant::Type type, QString value )
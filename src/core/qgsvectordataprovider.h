@@ -76,6 +76,22 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider
       SequentialSelectGeometryAtId = 1 << 11,
     };
 
+    /**
+     * aggregates of attribute values, see aggregateValue()
+     * @note added in 1.6
+     */
+    enum Aggregate
+    {
+      /** number of non null values */
+      Count,
+      /** sum of the values */
+      Sum,
+      /** minimal value */
+      Minimum,
+      /** maximal value */
+      Maximum
+    };
+
     /** bitmask of all provider's editing capabilities */
     const static int EditingCapabilities = AddFeatures | DeleteFeatures |
                                            ChangeAttributeValues | ChangeGeometries | AddAttributes | DeleteAttributes;
@@ -176,9 +192,9 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider
      * Returns the minimum value of an attribute
      * @param index the index of the attribute
      *
-     * Default implementation walks all numeric attributes and caches minimal
-     * and maximal values. If provider has facilities to retrieve minimal
-     * value directly, override this function.
+     * Default implementation fetches the attribute once and caches its
+     * statistics until the data changes. If provider has facilities to retrieve
+     * minimal value directly, override this function.
      */
     virtual QVariant minimumValue( int index );
 
@@ -186,19 +202,50 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider
      * Returns the maximum value of an attribute
      * @param index the index of the attribute
      *
-     * Default implementation walks all numeric attributes and caches minimal
-     * and maximal values. If provider has facilities to retrieve maximal
-     * value directly, override this function.
+     * Default implementation fetches the attribute once and caches its
+     * statistics until the data changes. If provider has facilities to retrieve
+     * maximal value directly, override this function.
      */
     virtual QVariant maximumValue( int index );
 
+    /**
+     * Returns an aggregate of the non null values of an attribute
+     * @param index the index of the attribute
+     * @param aggregate the aggregate to calculate
+     * @return the number of values as int, the sum as double (null for
+     * non numeric attributes), minimum and maximum as for minimumValue()
+     * and maximumValue(). Null if there are no values.
+     *
+     * Default implementation uses minimumValue() / maximumValue() and the
+     * cached attribute statistics. Providers which can calculate aggregates
+     * in the data source should override this function.
+     * @note added in 1.6
+     */
+    virtual QVariant aggregateValue( int index, Aggregate aggregate );
+
+    /**
+     * Returns the class breaks which divide the non null values of a numeric
+     * attribute into classes of equal size. The i-th break is the
+     * i/classes quantile, interpolated linearly between the two closest
+     * values, the last break is the maximum.
+     * @param index the index of the attribute
+     * @param classes number of classes
+     * @return list of classes breaks, empty if there are no values
+     *
+     * Default implementation fetches the attribute once and caches the
+     * sorted values until the data changes.
+     * @note added in 1.6
+     */
+    virtual QList<double> quantiles( int index, int classes );
+
     /**
      * Return unique values of an attribute
      * @param index the index of the attribute
      * @param uniqueValues values reference to the list to fill
      * @param limit maxmum number of the values to return (added in 1.4)
      *
-     * Default implementation simply iterates the features
+     * Default implementation iterates the features and caches the complete
+     * list of values until the data changes
      */
     virtual void uniqueValues( int index, QList<QVariant> &uniqueValues, int limit = -1 );
 
@@ -372,11 +419,29 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider
   protected:
     QVariant convertValue( QVariant::Type type, QString value );
 
+    /** Statistics of the non null values of an attribute
+     * @note added in 1.6 */
+    struct FieldStatistics
+    {
+      int count;
+      /** null for non numeric attributes */
+      QVariant sum;
+      QVariant minimum;
+      QVariant maximum;
+    };
+
+    /** Forgets the cached attribute statistics, call it when the data changed */
     void clearMinMaxCache();
-    void fillMinMaxCache();
 
-    bool mCacheMinMaxDirty;
-    QMap<int, QVariant> mCacheMinValues, mCacheMaxValues;
+    /** Returns the statistics of an attribute, calculated in a single pass
+     * over the attribute if they are not yet cached
+     * @note added in 1.6 */
+    const FieldStatistics& fieldStatistics( int index );
+
+    /** Cached statistics, unique values and sorted numeric values by attribute index */
+    QMap<int, FieldStatistics> mCacheStatistics;
+    QMap<int, QList<QVariant> > mCacheUniqueValues;
+    QMap<int, QList<double> > mCacheSortedValues;
 
     /** Encoding */
     QTextCodec* mEncoding;
@@ -33,15 +33,123 @@
 #include <QTextStream>
 #include <QSet>
 #include <QMetaType>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
 
 #include <cassert>
 #include <cstdlib> // size_t
+#include <cstring>
 
 #include <ogr_api.h>
 #include <ogr_srs_api.h>
 #include <cpl_error.h>
 #include <cpl_conv.h>
 
+//features committed together, if the driver supports transactions
+static const int sTransactionSize = 10000;
+
+/** Converts and writes the features queued by QgsVectorFileWriter::addFeature()
+  in background writing mode. */
+class QgsVectorFileWriterThread : public QThread
+{
+  public:
+    QgsVectorFileWriterThread( QgsVectorFileWriter* writer, int maxQueuedFeatures )
+        : mWriter( writer )
+        , mMaxQueuedFeatures( maxQueuedFeatures )
+        , mPending( 0 )
+        , mStop( false )
+    {}
+
+    /** queues a copy of the feature, waits while the queue is full. Takes the error
+      messages of the features that failed since the last call */
+    QStringList enqueue( const QgsFeature& feature )
+    {
+      QMutexLocker locker( &mMutex );
+      while ( mQueue.size() >= mMaxQueuedFeatures )
+        mNotFull.wait( &mMutex );
+      mQueue.enqueue( feature );
+      mPending++;
+      mNotEmpty.wakeOne();
+      QStringList errors = mErrors;
+      mErrors.clear();
+      return errors;
+    }
+
+    /** waits until all queued features are written and takes the error messages of failed features */
+    QStringList waitForQueue()
+    {
+      QMutexLocker locker( &mMutex );
+      while ( mPending > 0 )
+        mDone.wait( &mMutex );
+      QStringList errors = mErrors;
+      mErrors.clear();
+      return errors;
+    }
+
+    /** writes the remaining features and ends the thread */
+    void stop()
+    {
+      mMutex.lock();
+      mStop = true;
+      mNotEmpty.wakeOne();
+      mMutex.unlock();
+      wait();
+    }
+
+  protected:
+    void run()
+    {
+      for ( ;; )
+      {
+        QList<QgsFeature> batch;
+
+        mMutex.lock();
+        while ( mQueue.isEmpty() && !mStop )
+          mNotEmpty.wait( &mMutex );
+        if ( mQueue.isEmpty() )
+        {
+          mMutex.unlock();
+          return;
+        }
+        batch = mQueue;
+        mQueue.clear();
+        mNotFull.wakeAll();
+        mMutex.unlock();
+
+        QStringList errors;
+        for ( int i = 0; i < batch.size(); ++i )
+        {
+          QString errorMessage;
+          if ( !mWriter->writeFeature( batch[i], errorMessage ) )
+            errors << errorMessage;
+        }
+
+        mMutex.lock();
+        mErrors += errors;
+        mPending -= batch.size();
+        mDone.wakeAll();
+        mMutex.unlock();
+      }
+    }
+
+  private:
+    QgsVectorFileWriter* mWriter;
+    int mMaxQueuedFeatures;
+
+    QMutex mMutex;
+    QWaitCondition mNotEmpty;
+    QWaitCondition mNotFull;
+    QWaitCondition mDone;
+
+    QQueue<QgsFeature> mQueue;
+    /** queued features and features being written */
+    int mPending;
+    bool mStop;
+    QStringList mErrors;
+};
+
 
 QgsVectorFileWriter::QgsVectorFileWriter(
   const QString &theVectorFileName,
@@ -57,6 +165,10 @@ QgsVectorFileWriter::QgsVectorFileWriter(
     , mLayer( NULL )
     , mGeom( NULL )
     , mError( NoError )
+    , mUseTransactions( false )
+    , mTransactionFeatures( 0 )
+    , mFailedFeatures( 0 )
+    , mThread( 0 )
 {
   QString vectorFileName = theVectorFileName;
   QString fileEncoding = theFileEncoding;
@@ -233,6 +345,8 @@ QgsVectorFileWriter::QgsVectorFileWriter(
 
   QgsDebugMsg( "created layer" );
 
+  mUseTransactions = OGR_L_TestCapability( mLayer, OLCTransactions );
+
   // create the fields
   QgsDebugMsg( "creating " + QString::number( fields.size() ) + " fields" );
 
@@ -361,7 +475,7 @@ QString QgsVectorFileWriter::errorMessage()
   return mErrorMessage;
 }
 
-bool QgsVectorFileWriter::addFeature( QgsFeature& feature )
+bool QgsVectorFileWriter::writeFeature( QgsFeature& feature, QString& errorMessage )
 {
   QgsAttributeMap::const_iterator it;
 
@@ -400,13 +514,12 @@ bool QgsVectorFileWriter::addFeature( QgsFeature& feature )
         OGR_F_SetFieldString( poFeature, ogrField, mCodec->fromUnicode( attrValue.toString() ).data() );
         break;
       default:
-        mErrorMessage = QObject::tr( "Invalid variant type for field %1[%2]: received %3 with type %4" )
-                        .arg( fldIt.value().name() )
-                        .arg( ogrField )
-                        .arg( QMetaType::typeName( attrValue.type() ) )
-                        .arg( attrValue.toString() );
-        QgsDebugMsg( mErrorMessage );
-        mError = ErrFeatureWriteFailed;
+        errorMessage = QObject::tr( "Invalid variant type for field %1[%2]: received %3 with type %4" )
+                       .arg( fldIt.value().name() )
+                       .arg( ogrField )
+                       .arg( QMetaType::typeName( attrValue.type() ) )
+                       .arg( attrValue.toString() );
+        QgsDebugMsg( errorMessage );
         return false;
     }
   }
@@ -429,9 +542,8 @@ bool QgsVectorFileWriter::addFeature( QgsFeature& feature )
     if ( !mGeom2 )
     {
       QgsDebugMsg( QString( "Failed to create empty geometry for type %1 (OGR error: %2)" ).arg( geom->wkbType() ).arg( CPLGetLastErrorMsg() ) );
-      mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
-                      .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-      mError = ErrFeatureWriteFailed;
+      errorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
+                     .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
       OGR_F_Destroy( poFeature );
       return false;
     }
@@ -440,9 +552,8 @@ bool QgsVectorFileWriter::addFeature( QgsFeature& feature )
     if ( err != OGRERR_NONE )
     {
       QgsDebugMsg( QString( "Failed to import geometry from WKB: %1 (OGR error: %2)" ).arg( err ).arg( CPLGetLastErrorMsg() ) );
-      mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
-                      .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-      mError = ErrFeatureWriteFailed;
+      errorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
+                     .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
       OGR_F_Destroy( poFeature );
       return false;
     }
@@ -456,9 +567,8 @@ bool QgsVectorFileWriter::addFeature( QgsFeature& feature )
     if ( err != OGRERR_NONE )
     {
       QgsDebugMsg( QString( "Failed to import geometry from WKB: %1 (OGR error: %2)" ).arg( err ).arg( CPLGetLastErrorMsg() ) );
-      mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
-                      .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-      mError = ErrFeatureWriteFailed;
+      errorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
+                     .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
       OGR_F_Destroy( poFeature );
       return false;
     }
@@ -467,24 +577,139 @@ bool QgsVectorFileWriter::addFeature( QgsFeature& feature )
     OGR_F_SetGeometry( poFeature, mGeom );
   }
 
+  if ( mUseTransactions )
+  {
+    if ( mTransactionFeatures == 0 )
+      OGR_L_StartTransaction( mLayer );
+    mTransactionFeatures++;
+  }
+
   // put the created feature to layer
-  if ( OGR_L_CreateFeature( mLayer, poFeature ) != OGRERR_NONE )
+  bool written = OGR_L_CreateFeature( mLayer, poFeature ) == OGRERR_NONE;
+  if ( !written )
   {
-    mErrorMessage = QObject::tr( "Feature creation error (OGR error: %1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-    mError = ErrFeatureWriteFailed;
+    errorMessage = QObject::tr( "Feature creation error (OGR error: %1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
 
-    QgsDebugMsg( mErrorMessage );
-    OGR_F_Destroy( poFeature );
-    return false;
+    QgsDebugMsg( errorMessage );
   }
 
   OGR_F_Destroy( poFeature );
 
+  if ( mTransactionFeatures >= sTransactionSize )
+  {
+    commitTransaction();
+  }
+
+  return written;
+}
+
+bool QgsVectorFileWriter::addFeature( QgsFeature& feature )
+{
+  if ( mThread )
+  {
+    //queue a copy with the geometry as wkb only. GEOS is not reentrant, the writer thread
+    //must neither clone nor export a GEOS geometry while the caller keeps using GEOS
+    QgsFeature queuedFeature( feature.id(), feature.typeName() );
+    queuedFeature.setAttributeMap( feature.attributeMap() );
+    QgsGeometry* geometry = feature.geometry();
+    unsigned char* wkb = geometry ? geometry->asWkb() : 0;
+    if ( wkb )
+    {
+      size_t wkbSize = geometry->wkbSize();
+      unsigned char* wkbCopy = new unsigned char[wkbSize];
+      memcpy( wkbCopy, wkb, wkbSize );
+      queuedFeature.setGeometryAndOwnership( wkbCopy, wkbSize );
+    }
+
+    //failures of features queued before are recorded, but the return value keeps its meaning
+    //of "this feature was accepted"
+    QStringList errors = mThread->enqueue( queuedFeature );
+    if ( !errors.isEmpty() )
+    {
+      mErrorMessage = errors.join( "\n" );
+      mError = ErrFeatureWriteFailed;
+      mFailedFeatures += errors.size();
+    }
+    return true;
+  }
+
+  if ( !writeFeature( feature, mErrorMessage ) )
+  {
+    mError = ErrFeatureWriteFailed;
+    mFailedFeatures++;
+    return false;
+  }
+
   return true;
 }
 
+int QgsVectorFileWriter::failedFeatures() const
+{
+  return mFailedFeatures;
+}
+
+void QgsVectorFileWriter::commitTransaction()
+{
+  if ( mTransactionFeatures > 0 )
+  {
+    OGR_L_CommitTransaction( mLayer );
+    mTransactionFeatures = 0;
+  }
+}
+
+void QgsVectorFileWriter::setBackgroundWriting( bool enabled, int maxQueuedFeatures )
+{
+  if ( enabled && !mThread && mLayer )
+  {
+    mThread = new QgsVectorFileWriterThread( this, qMax( 1, maxQueuedFeatures ) );
+    mThread->start();
+  }
+  else if ( !enabled && mThread )
+  {
+    flush();
+    mThread->stop();
+    delete mThread;
+    mThread = 0;
+  }
+}
+
+bool QgsVectorFileWriter::flush()
+{
+  bool ok = true;
+
+  if ( mThread )
+  {
+    QStringList errors = mThread->waitForQueue();
+    if ( !errors.isEmpty() )
+    {
+      mErrorMessage = errors.join( "\n" );
+      mError = ErrFeatureWriteFailed;
+      mFailedFeatures += errors.size();
+      ok = false;
+    }
+  }
+
+  if ( mLayer )
+  {
+    commitTransaction();
+  }
+
+  return ok;
+}
+
 QgsVectorFileWriter::~QgsVectorFileWriter()
 {
+  if ( mThread )
+  {
+    mThread->stop();
+    delete mThread;
+  }
+
+  if ( mLayer )
+  {
+    commitTransaction();
+  }
+
   if ( mGeom )
   {
     OGR_G_DestroyGeometry( mGeom );
@@ -557,6 +782,9 @@ QgsVectorFileWriter::writeAsVectorFormat( QgsVectorLayer* layer,
     errorMessage->clear();
   }
 
+  // read and transform the features while the previous ones are written
+  writer->setBackgroundWriting( true );
+
   QgsAttributeList allAttr = skipAttributeCreation ? QgsAttributeList() : layer->pendingAllAttributesList();
   QgsFeature fet;
 
@@ -576,7 +804,7 @@ QgsVectorFileWriter::writeAsVectorFormat( QgsVectorLayer* layer,
     shallTransform = false;
   }
 
-  int n = 0, errors = 0;
+  int n = 0;
 
   // write all features
   while ( layer->nextFeature( fet ) )
@@ -611,33 +839,40 @@ QgsVectorFileWriter::writeAsVectorFormat( QgsVectorLayer* layer,
     {
       fet.clearAttributeMap();
     }
-    if ( !writer->addFeature( fet ) )
+    // in background mode a failure can also belong to a feature added before
+    if ( !writer->addFeature( fet ) && errorMessage )
     {
-      WriterError err = writer->hasError();
-      if ( err != NoError && errorMessage )
+      if ( errorMessage->isEmpty() )
       {
-        if ( errorMessage->isEmpty() )
-        {
-          *errorMessage = QObject::tr( "Feature write errors:" );
-        }
-        *errorMessage += "\n" + writer->errorMessage();
+        *errorMessage = QObject::tr( "Feature write errors:" );
       }
-      errors++;
+      *errorMessage += "\n" + writer->errorMessage();
+    }
+    n++;
 
-      if ( errors > 1000 )
+    if ( writer->failedFeatures() > 1000 )
+    {
+      if ( errorMessage )
       {
-        if ( errorMessage )
-        {
-          *errorMessage += QObject::tr( "Stopping after %1 errors" ).arg( errors );
-        }
-
-        n = -1;
-        break;
+        *errorMessage += QObject::tr( "Stopping after %1 errors" ).arg( writer->failedFeatures() );
       }
+
+      n = -1;
+      break;
     }
-    n++;
   }
 
+  // wait for the queued features
+  if ( n >= 0 && !writer->flush() && errorMessage )
+  {
+    if ( errorMessage->isEmpty() )
+    {
+      *errorMessage = QObject::tr( "Feature write errors:" );
+    }
+    *errorMessage += "\n" + writer->errorMessage();
+  }
+  int errors = writer->failedFeatures();
+
   delete writer;
 
   if ( shallTransform )
@@ -30,6 +30,7 @@ typedef void *OGRLayerH;
 typedef void *OGRGeometryH;
 
 class QTextCodec;
+class QgsVectorFileWriterThread;
 
 /** \ingroup core
   * A convenience class for writing vector files to disk.
@@ -113,9 +114,33 @@ class CORE_EXPORT QgsVectorFileWriter
      */
     QString errorMessage();
 
-    /** add feature to the currently opened shapefile */
+    /** add feature to the currently opened shapefile. In background writing
+     * mode the feature is queued and true is returned. Failures of features
+     * queued before are counted by failedFeatures() and described by
+     * hasError() and errorMessage(), flush() reports the remaining ones */
     bool addFeature( QgsFeature& feature );
 
+    /** Number of features that could not be written so far. Failures of queued
+     * features are counted by the next addFeature() or flush()
+     * @note added in 1.6
+     */
+    int failedFeatures() const;
+
+    /** Queues the features passed to addFeature() and converts and writes them
+     * on a separate thread, so that the caller is not blocked by the output.
+     * addFeature() only waits while maxQueuedFeatures are pending. Errors of
+     * queued features are reported by the next addFeature() or by flush().
+     * @note added in 1.6
+     */
+    void setBackgroundWriting( bool enabled, int maxQueuedFeatures = 1000 );
+
+    /** Waits until all added features are written and commits the pending
+     * transaction. Returns false if queued features could not be written,
+     * hasError() and errorMessage() then describe the failures.
+     * @note added in 1.6
+     */
+    bool flush();
+
     /** close opened shapefile for writing */
     ~QgsVectorFileWriter();
 
@@ -129,6 +154,12 @@ class CORE_EXPORT QgsVectorFileWriter
 
     OGRGeometryH createEmptyGeometry( QGis::WkbType wkbType );
 
+    /** converts the feature to OGR and writes it, sets errorMessage on failure */
+    bool writeFeature( QgsFeature& feature, QString& errorMessage );
+
+    /** commits the features written since the last commit */
+    void commitTransaction();
+
     OGRDataSourceH mDS;
     OGRLayerH mLayer;
     OGRGeometryH mGeom;
@@ -147,7 +178,20 @@ class CORE_EXPORT QgsVectorFileWriter
     /** map attribute indizes to OGR field indexes */
     QMap<int, int> mAttrIdxToOgrIdx;
 
+    /** whether the layer supports transactions, features are then committed in batches */
+    bool mUseTransactions;
+    /** features written in the current transaction */
+    int mTransactionFeatures;
+
+    /** features that could not be written */
+    int mFailedFeatures;
+
   private:
+    /** writes the queued features if background writing is enabled */
+    QgsVectorFileWriterThread *mThread;
+
+    friend class QgsVectorFileWriterThread;
+
     static QPair<QString, QString> nameAndGlob( QString driverName );
 };
 
@@ -65,6 +65,7 @@
 #include "qgsproviderregistry.h"
 #include "qgsrectangle.h"
 #include "qgsrendercontext.h"
+#include "spatialindex/qgsrtree.h"
 #include "qgssinglesymbolrenderer.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsvectordataprovider.h"
@@ -102,6 +103,7 @@ QgsVectorLayer::QgsVectorLayer( QString vectorLayerPath,
     mEditable( false ),
     mReadOnly( false ),
     mModified( false ),
+    mEditIndex( 0 ),
     mMaxUpdatedIndex( -1 ),
     mActiveCommand( NULL ),
     mRenderer( 0 ),
@@ -110,7 +112,8 @@ QgsVectorLayer::QgsVectorLayer( QString vectorLayerPath,
     mLabel( 0 ),
     mLabelOn( false ),
     mVertexMarkerOnlyForSelection( false ),
-    mFetching( false )
+    mFetching( false ),
+    mExtentDeferred( false )
 {
   mActions = new QgsAttributeAction( this );
 
@@ -187,6 +190,8 @@ QgsVectorLayer::~QgsVectorLayer()
   // Destroy any cached geometries and clear the references to them
   deleteCachedGeometries();
 
+  delete mEditIndex;
+
   delete mActions;
 
   //delete remaining overlays
@@ -713,6 +718,7 @@ void QgsVectorLayer::drawRendererV2( QgsRenderContext& rendererContext, bool lab
 
   QSettings settings;
   bool vertexMarkerOnlyForSelection = settings.value( "/qgis/digitizing/marker_only_for_selected", false ).toBool();
+  bool drawSelection = rendererContext.drawSelection();
 
   mRendererV2->startRender( rendererContext, this );
 
@@ -744,7 +750,7 @@ void QgsVectorLayer::drawRendererV2( QgsRenderContext& rendererContext, bool lab
       }
 #endif //Q_WS_MAC
 
-      bool sel = mSelectedFeatureIds.contains( fet.id() );
+      bool sel = drawSelection && mSelectedFeatureIds.contains( fet.id() );
       bool drawMarker = ( mEditable && ( !vertexMarkerOnlyForSelection || sel ) );
 
       // render feature
@@ -780,12 +786,13 @@ void QgsVectorLayer::drawRendererV2Levels( QgsRenderContext& rendererContext, bo
 
   QSettings settings;
   bool vertexMarkerOnlyForSelection = settings.value( "/qgis/digitizing/marker_only_for_selected", false ).toBool();
+  bool drawSelection = rendererContext.drawSelection();
 
   // startRender must be called before symbolForFeature() calls to make sure renderer is ready
   mRendererV2->startRender( rendererContext, this );
 
   QgsSingleSymbolRendererV2* selRenderer = NULL;
-  if ( !mSelectedFeatureIds.isEmpty() )
+  if ( drawSelection && !mSelectedFeatureIds.isEmpty() )
   {
     selRenderer = new QgsSingleSymbolRendererV2( QgsSymbolV2::defaultSymbol( geometryType() ) );
     selRenderer->symbol()->setColor( QgsRenderer::selectionColor() );
@@ -880,7 +887,7 @@ void QgsVectorLayer::drawRendererV2Levels( QgsRenderContext& rendererContext, bo
           qApp->processEvents();
         }
 #endif //Q_WS_MAC
-        bool sel = mSelectedFeatureIds.contains( fit->id() );
+        bool sel = drawSelection && mSelectedFeatureIds.contains( fit->id() );
         // maybe vertex markers should be drawn only during the last pass...
         bool drawMarker = ( mEditable && ( !vertexMarkerOnlyForSelection || sel ) );
 
@@ -916,6 +923,9 @@ bool QgsVectorLayer::draw( QgsRenderContext& rendererContext )
   if ( geometryType() == QGis::NoGeometry )
     return true;
 
+  if ( mExtentDeferred )
+    updateExtents();
+
   //set update threshold before each draw to make sure the current setting is picked up
   QSettings settings;
   mUpdateThreshold = settings.value( "Map/updateThreshold", 0 ).toInt();
@@ -1056,7 +1066,7 @@ bool QgsVectorLayer::draw( QgsRenderContext& rendererContext )
         // check if feature is selected
         // only show selections of the current layer
         // TODO: create a mechanism to let layer know whether it's current layer or not [MD]
-        bool sel = mSelectedFeatureIds.contains( fet.id() );
+        bool sel = rendererContext.drawSelection() && mSelectedFeatureIds.contains( fet.id() );
 
         mCurrentVertexMarkerType = QgsVectorLayer::NoMarker;
         mCurrentVertexMarkerSize = 7;
@@ -1117,6 +1127,78 @@ bool QgsVectorLayer::draw( QgsRenderContext& rendererContext )
   return true; // Assume success always
 }
 
+void QgsVectorLayer::drawSelectedFeatures( QgsRenderContext& rendererContext )
+{
+  if ( geometryType() == QGis::NoGeometry || mSelectedFeatureIds.isEmpty() )
+    return;
+
+  if ( mUsingRendererV2 ? mRendererV2 == NULL : mRenderer == NULL )
+    return;
+
+  if ( mExtentDeferred )
+    updateExtents();
+
+  QImage marker;
+  double opacity = 1.0;
+  if ( mUsingRendererV2 )
+  {
+    if ( mEditable )
+      mRendererV2->setVertexMarkerAppearance( currentVertexMarkerType(), currentVertexMarkerSize() );
+    mRendererV2->startRender( rendererContext, this );
+  }
+  else
+  {
+    if ( !mRenderer->usesTransparency() )
+    {
+      opacity = ( mTransparencyLevel * 1.0 ) / 255.0;
+    }
+    mCurrentVertexMarkerType = mEditable ? currentVertexMarkerType() : QgsVectorLayer::NoMarker;
+    mCurrentVertexMarkerSize = mEditable ? currentVertexMarkerSize() : 7;
+  }
+
+  const QgsRectangle& extent = rendererContext.extent();
+  QgsFeature fet;
+
+  // fetched by id: a select() would reset an iteration running on this layer
+  for ( QgsFeatureIds::const_iterator it = mSelectedFeatureIds.constBegin(); it != mSelectedFeatureIds.constEnd(); ++it )
+  {
+    if ( rendererContext.renderingStopped() )
+      break;
+
+    if ( !featureAtId( *it, fet, true, true ) || !fet.geometry() )
+      continue;
+
+    if ( !extent.isEmpty() && !fet.geometry()->boundingBox().intersects( extent ) )
+      continue;
+
+    drawSelectedFeature( rendererContext, fet, &marker, opacity );
+  }
+
+  if ( mUsingRendererV2 )
+    stopRendererV2( rendererContext, NULL );
+}
+
+void QgsVectorLayer::drawSelectedFeature( QgsRenderContext& rendererContext, QgsFeature& fet, QImage* marker, double opacity )
+{
+  try
+  {
+    if ( mUsingRendererV2 )
+    {
+      mRendererV2->renderFeature( fet, rendererContext, -1, true, mEditable );
+    }
+    else
+    {
+      mRenderer->renderFeature( rendererContext, fet, marker, true, opacity );
+      drawFeature( rendererContext, fet, marker );
+    }
+  }
+  catch ( const QgsCsException &cse )
+  {
+    QgsDebugMsg( QString( "Failed to transform a point while drawing a selected feature of type '%1'. Ignoring this feature. %2" )
+                 .arg( fet.typeName() ).arg( cse.what() ) );
+  }
+}
+
 void QgsVectorLayer::deleteCachedGeometries()
 {
   // Destroy any cached geometries
@@ -1146,9 +1228,6 @@ void QgsVectorLayer::select( int number, bool emitSignal )
 
   if ( emitSignal )
   {
-    // invalidate cache
-    setCacheImage( 0 );
-
     emit selectionChanged();
   }
 }
@@ -1159,9 +1238,6 @@ void QgsVectorLayer::deselect( int number, bool emitSignal )
 
   if ( emitSignal )
   {
-    // invalidate cache
-    setCacheImage( 0 );
-
     emit selectionChanged();
   }
 }
@@ -1185,9 +1261,6 @@ void QgsVectorLayer::select( QgsRectangle & rect, bool lock )
     select( f.id(), false ); // don't emit signal (not to redraw it everytime)
   }
 
-  // invalidate cache
-  setCacheImage( 0 );
-
   emit selectionChanged(); // now emit signal to redraw layer
 }
 
@@ -1211,9 +1284,6 @@ void QgsVectorLayer::invertSelection()
     mSelectedFeatureIds.remove( *iter );
   }
 
-  // invalidate cache
-  setCacheImage( 0 );
-
   emit selectionChanged();
 }
 
@@ -1237,9 +1307,6 @@ void QgsVectorLayer::invertSelectionInRectangle( QgsRectangle & rect )
     }
   }
 
-  // invalidate cache
-  setCacheImage( 0 );
-
   emit selectionChanged();
 }
 
@@ -1252,9 +1319,6 @@ void QgsVectorLayer::removeSelection( bool emitSignal )
 
   if ( emitSignal )
   {
-    // invalidate cache
-    setCacheImage( 0 );
-
     emit selectionChanged();
   }
 }
@@ -1419,6 +1483,8 @@ long QgsVectorLayer::updateFeatureCount() const
 
 void QgsVectorLayer::updateExtents()
 {
+  mExtentDeferred = false;
+
   if ( geometryType() == QGis::NoGeometry )
     return;
 
@@ -1535,6 +1601,9 @@ void QgsVectorLayer::select( QgsAttributeList attributes, QgsRectangle rect, boo
   if ( !mDataProvider )
     return;
 
+  if ( mExtentDeferred )
+    updateExtents();
+
   mFetching        = true;
   mFetchRect       = rect;
   mFetchAttributes = attributes;
@@ -1545,7 +1614,15 @@ void QgsVectorLayer::select( QgsAttributeList attributes, QgsRectangle rect, boo
   if ( mEditable )
   {
     mFetchAddedFeaturesIt = mAddedFeatures.begin();
-    mFetchChangedGeomIt = mChangedGeometries.begin();
+
+    // edited features which might be in the rectangle
+    mFetchEditIds.clear();
+    if ( !rect.isEmpty() && mEditIndex )
+    {
+      QgsRTree::Box box = { rect.xMinimum(), rect.yMinimum(), rect.xMaximum(), rect.yMaximum() };
+      mEditIndex->intersects( box, mFetchEditIds );
+    }
+    mFetchEditIdsIt = mFetchEditIds.constBegin();
   }
 
   //look in the normal features of the provider
@@ -1583,45 +1660,40 @@ bool QgsVectorLayer::nextFeature( QgsFeature &f )
   {
     if ( !mFetchRect.isEmpty() )
     {
-      // check if changed geometries are in rectangle
-      for ( ; mFetchChangedGeomIt != mChangedGeometries.end(); mFetchChangedGeomIt++ )
+      // check if edited geometries with a bounding box in the rectangle intersect it
+      for ( ; mFetchEditIdsIt != mFetchEditIds.constEnd(); mFetchEditIdsIt++ )
       {
-        int fid = mFetchChangedGeomIt.key();
+        int fid = *mFetchEditIdsIt;
 
         if ( mFetchConsidered.contains( fid ) )
           // skip deleted features
           continue;
 
-        mFetchConsidered << fid;
+        int addedIndex = fid < 0 ? addedFeatureIndex( fid ) : -1;
+        QgsGeometry* geom = 0;
+        QgsGeometryMap::iterator changedIt = mChangedGeometries.find( fid );
+        if ( changedIt != mChangedGeometries.end() )
+          geom = &changedIt.value();
+        else if ( addedIndex >= 0 )
+          geom = mAddedFeatures[addedIndex].geometry();
 
-        if ( !mFetchChangedGeomIt->intersects( mFetchRect ) )
-          // skip changed geometries not in rectangle and don't check again
+        if ( !geom || !geom->intersects( mFetchRect ) )
           continue;
 
         f.setFeatureId( fid );
         f.setValid( true );
 
         if ( mFetchGeometry )
-          f.setGeometry( mFetchChangedGeomIt.value() );
+          f.setGeometry( *geom );
 
         if ( mFetchAttributes.size() > 0 )
         {
           if ( fid < 0 )
           {
             // fid<0 => in mAddedFeatures
-            bool found = false;
-
-            for ( QgsFeatureList::iterator it = mAddedFeatures.begin(); it != mAddedFeatures.end(); it++ )
-            {
-              if ( fid == it->id() )
-              {
-                found = true;
-                f.setAttributeMap( it->attributeMap() );
-                break;
-              }
-            }
-
-            if ( !found )
+            if ( addedIndex >= 0 )
+              f.setAttributeMap( mAddedFeatures[addedIndex].attributeMap() );
+            else
               QgsDebugMsg( QString( "No attributes for the added feature %1 found" ).arg( f.id() ) );
           }
           else
@@ -1629,17 +1701,17 @@ bool QgsVectorLayer::nextFeature( QgsFeature &f )
             // retrieve attributes from provider
             QgsFeature tmp;
             mDataProvider->featureAtId( fid, tmp, false, mFetchProvAttributes );
-            updateFeatureAttributes( tmp );
             f.setAttributeMap( tmp.attributeMap() );
           }
+          updateFeatureAttributes( f );
         }
 
         // return complete feature
-        mFetchChangedGeomIt++;
+        mFetchEditIdsIt++;
         return true;
       }
 
-      // no more changed geometries
+      // no more edited features in rectangle
     }
 
     for ( ; mFetchAddedFeaturesIt != mAddedFeatures.end(); mFetchAddedFeaturesIt++ )
@@ -1647,19 +1719,18 @@ bool QgsVectorLayer::nextFeature( QgsFeature &f )
       int fid = mFetchAddedFeaturesIt->id();
 
       if ( mFetchConsidered.contains( fid ) )
-        // must have changed geometry outside rectangle
+        // skip deleted features
         continue;
 
       if ( !mFetchRect.isEmpty() &&
-           mFetchAddedFeaturesIt->geometry() &&
-           !mFetchAddedFeaturesIt->geometry()->intersects( mFetchRect ) )
-        // skip added features not in rectangle
+           ( mFetchAddedFeaturesIt->geometry() || mChangedGeometries.contains( fid ) ) )
+        // added features with a geometry are in the edit index, only the others are returned here
         continue;
 
       f.setFeatureId( fid );
       f.setValid( true );
 
-      if ( mFetchGeometry )
+      if ( mFetchGeometry && mFetchAddedFeaturesIt->geometry() )
         f.setGeometry( *mFetchAddedFeaturesIt->geometry() );
 
       if ( mFetchAttributes.size() > 0 )
@@ -1672,7 +1743,7 @@ bool QgsVectorLayer::nextFeature( QgsFeature &f )
       return true;
     }
 
-    // no more added features
+    // no more edited features
   }
 
   while ( dataProvider()->nextFeature( f ) )
@@ -1680,6 +1751,10 @@ bool QgsVectorLayer::nextFeature( QgsFeature &f )
     if ( mFetchConsidered.contains( f.id() ) )
       continue;
 
+    if ( mEditable && !mFetchRect.isEmpty() && mChangedGeometries.contains( f.id() ) )
+      // changed geometries in the rectangle have been returned from the edit buffer
+      continue;
+
     if ( mEditable )
       updateFeatureAttributes( f );
 
@@ -1710,19 +1785,10 @@ bool QgsVectorLayer::featureAtId( int featureId, QgsFeature& f, bool fetchGeomet
       if ( featureId < 0 )
       {
         // featureId<0 => in mAddedFeatures
-        bool found = false;
-
-        for ( QgsFeatureList::iterator it = mAddedFeatures.begin(); it != mAddedFeatures.end(); it++ )
-        {
-          if ( featureId != it->id() )
-          {
-            found = true;
-            f.setAttributeMap( it->attributeMap() );
-            break;
-          }
-        }
-
-        if ( !found )
+        int addedIndex = addedFeatureIndex( featureId );
+        if ( addedIndex >= 0 )
+          f.setAttributeMap( mAddedFeatures[addedIndex].attributeMap() );
+        else
           QgsDebugMsg( QString( "No attributes for the added feature %1 found" ).arg( f.id() ) );
       }
       else
@@ -1738,20 +1804,19 @@ bool QgsVectorLayer::featureAtId( int featureId, QgsFeature& f, bool fetchGeomet
   }
 
   //added features
-  for ( QgsFeatureList::iterator iter = mAddedFeatures.begin(); iter != mAddedFeatures.end(); ++iter )
+  int addedIndex = addedFeatureIndex( featureId );
+  if ( addedIndex >= 0 )
   {
-    if ( iter->id() == featureId )
-    {
-      f.setFeatureId( iter->id() );
-      f.setValid( true );
-      if ( fetchGeometries )
-        f.setGeometry( *iter->geometry() );
+    QgsFeature& added = mAddedFeatures[addedIndex];
+    f.setFeatureId( added.id() );
+    f.setValid( true );
+    if ( fetchGeometries )
+      f.setGeometry( *added.geometry() );
 
-      if ( fetchAttributes )
-        f.setAttributeMap( iter->attributeMap() );
+    if ( fetchAttributes )
+      f.setAttributeMap( added.attributeMap() );
 
-      return true;
-    }
+    return true;
   }
 
   // regular features
@@ -2546,6 +2611,19 @@ bool QgsVectorLayer::readXml( QDomNode & layer_node )
     mProviderKey = "ogr";
   }
 
+  // optionally keep the extent stored in the project until the layer
+  // is drawn or queried, instead of letting the provider compute it now
+  QSettings settings;
+  QDomElement extentElem = layer_node.namedItem( "extent" ).toElement();
+  if ( !extentElem.isNull() && settings.value( "/qgis/deferLayerExtent", false ).toBool() )
+  {
+    mLayerExtent = QgsRectangle( extentElem.attribute( "xmin" ).toDouble(),
+                                 extentElem.attribute( "ymin" ).toDouble(),
+                                 extentElem.attribute( "xmax" ).toDouble(),
+                                 extentElem.attribute( "ymax" ).toDouble() );
+    mExtentDeferred = true;
+  }
+
   if ( ! setDataProvider( mProviderKey ) )
   {
     return false;
@@ -2597,17 +2675,20 @@ bool QgsVectorLayer::setDataProvider( QString const & provider )
       // TODO: Check if the provider has the capability to send fullExtentCalculated
       connect( mDataProvider, SIGNAL( fullExtentCalculated() ), this, SLOT( updateExtents() ) );
 
-      // get the extent
-      QgsRectangle mbr = mDataProvider->extent();
-
-      // show the extent
-      QString s = mbr.toString();
-      QgsDebugMsg( "Extent of layer: " +  s );
-      // store the extent
-      mLayerExtent.setXMaximum( mbr.xMaximum() );
-      mLayerExtent.setXMinimum( mbr.xMinimum() );
-      mLayerExtent.setYMaximum( mbr.yMaximum() );
-      mLayerExtent.setYMinimum( mbr.yMinimum() );
+      if ( !mExtentDeferred )
+      {
+        // get the extent
+        QgsRectangle mbr = mDataProvider->extent();
+
+        // show the extent
+        QString s = mbr.toString();
+        QgsDebugMsg( "Extent of layer: " +  s );
+        // store the extent
+        mLayerExtent.setXMaximum( mbr.xMaximum() );
+        mLayerExtent.setXMinimum( mbr.xMinimum() );
+        mLayerExtent.setYMaximum( mbr.yMaximum() );
+        mLayerExtent.setYMinimum( mbr.yMinimum() );
+      }
 
       // get and store the feature type
       mWkbType = mDataProvider->geometryType();
@@ -3464,6 +3545,8 @@ bool QgsVectorLayer::commitChanges()
           f.setGeometry( mChangedGeometries.take( f.id() ) );
         }
       }
+      // slots of the signals below may look up added features through the index
+      rebuildAddedFeaturesIndex();
 
       if (( cap & QgsVectorDataProvider::AddFeatures ) && mDataProvider->addFeatures( mAddedFeatures ) )
       {
@@ -3472,6 +3555,7 @@ bool QgsVectorLayer::commitChanges()
         emit committedFeaturesAdded( getLayerID(), mAddedFeatures );
 
         mAddedFeatures.clear();
+        mAddedFeaturesIndex.clear();
       }
       else
       {
@@ -3527,6 +3611,7 @@ bool QgsVectorLayer::commitChanges()
   }
 
   deleteCachedGeometries();
+  rebuildEditIndex();
 
   if ( success )
   {
@@ -3596,6 +3681,7 @@ bool QgsVectorLayer::rollBack()
   }
 
   deleteCachedGeometries();
+  rebuildEditIndex();
 
   undoStack()->clear();
 
@@ -3616,9 +3702,6 @@ void QgsVectorLayer::setSelectedFeatures( const QgsFeatureIds& ids )
   // TODO: check whether features with these ID exist
   mSelectedFeatureIds = ids;
 
-  // invalidate cache
-  setCacheImage( 0 );
-
   emit selectionChanged();
 }
 
@@ -3648,22 +3731,15 @@ QgsFeatureList QgsVectorLayer::selectedFeatures()
   {
     QgsFeature feat;
 
-    bool selectionIsAddedFeature = false;
-
     // Check this selected item against the uncommitted added features
-    for ( QgsFeatureList::iterator iter = mAddedFeatures.begin(); iter != mAddedFeatures.end(); ++iter )
+    int addedIndex = addedFeatureIndex( *it );
+    if ( addedIndex >= 0 )
     {
-      if ( *it == iter->id() )
-      {
-        feat = QgsFeature( *iter );
-        selectionIsAddedFeature = true;
-        break;
-      }
+      feat = QgsFeature( mAddedFeatures[addedIndex] );
     }
-
-    // if the geometry is not newly added, get it from provider
-    if ( !selectionIsAddedFeature )
+    else
     {
+      // if the geometry is not newly added, get it from provider
       mDataProvider->featureAtId( *it, feat, true, allAttrs );
     }
 
@@ -4375,6 +4451,7 @@ void QgsVectorLayer::editGeometryChange( int featureId, QgsGeometry& geometry )
     mActiveCommand->storeGeometryChange( featureId, mChangedGeometries[ featureId ], geometry );
   }
   mChangedGeometries[ featureId ] = geometry;
+  updateEditIndex( featureId );
 }
 
 
@@ -4384,7 +4461,9 @@ void QgsVectorLayer::editFeatureAdd( QgsFeature& feature )
   {
     mActiveCommand->storeFeatureAdd( feature );
   }
+  mAddedFeaturesIndex.insert( feature.id(), mAddedFeatures.size() );
   mAddedFeatures.append( feature );
+  updateEditIndex( feature.id() );
 }
 
 void QgsVectorLayer::editFeatureDelete( int featureId )
@@ -4396,6 +4475,69 @@ void QgsVectorLayer::editFeatureDelete( int featureId )
   mDeletedFeatureIds.insert( featureId );
 }
 
+void QgsVectorLayer::rebuildAddedFeaturesIndex()
+{
+  mAddedFeaturesIndex.clear();
+  for ( int i = 0; i < mAddedFeatures.size(); i++ )
+  {
+    mAddedFeaturesIndex.insert( mAddedFeatures[i].id(), i );
+  }
+}
+
+void QgsVectorLayer::updateEditIndex( int fid )
+{
+  QgsGeometry* geometry = 0;
+  QgsGeometryMap::iterator changedIt = mChangedGeometries.find( fid );
+  if ( changedIt != mChangedGeometries.end() )
+  {
+    geometry = &changedIt.value();
+  }
+  else
+  {
+    int addedIndex = addedFeatureIndex( fid );
+    if ( addedIndex >= 0 )
+      geometry = mAddedFeatures[addedIndex].geometry();
+  }
+
+  QHash<int, QgsRectangle>::iterator boxIt = mEditIndexBoxes.find( fid );
+  if ( boxIt != mEditIndexBoxes.end() )
+  {
+    QgsRTree::Box box = { boxIt->xMinimum(), boxIt->yMinimum(), boxIt->xMaximum(), boxIt->yMaximum() };
+    mEditIndex->remove( fid, box );
+    mEditIndexBoxes.erase( boxIt );
+  }
+
+  if ( !geometry )
+    return;
+
+  if ( !mEditIndex )
+    mEditIndex = new QgsRTree();
+
+  QgsRectangle rect = geometry->boundingBox();
+  QgsRTree::Box box = { rect.xMinimum(), rect.yMinimum(), rect.xMaximum(), rect.yMaximum() };
+  mEditIndex->insert( fid, box );
+  mEditIndexBoxes.insert( fid, rect );
+}
+
+void QgsVectorLayer::rebuildEditIndex()
+{
+  rebuildAddedFeaturesIndex();
+
+  delete mEditIndex;
+  mEditIndex = 0;
+  mEditIndexBoxes.clear();
+
+  for ( QgsGeometryMap::const_iterator it = mChangedGeometries.constBegin(); it != mChangedGeometries.constEnd(); ++it )
+  {
+    updateEditIndex( it.key() );
+  }
+  for ( int i = 0; i < mAddedFeatures.size(); i++ )
+  {
+    if ( !mEditIndexBoxes.contains( mAddedFeatures[i].id() ) )
+      updateEditIndex( mAddedFeatures[i].id() );
+  }
+}
+
 void QgsVectorLayer::editAttributeChange( int featureId, int field, QVariant value )
 {
   if ( mActiveCommand != NULL )
@@ -4405,14 +4547,11 @@ void QgsVectorLayer::editAttributeChange( int featureId, int field, QVariant val
     if ( featureId < 0 )
     {
       // work with added feature
-      for ( int i = 0; i < mAddedFeatures.size(); i++ )
+      int addedIndex = addedFeatureIndex( featureId );
+      if ( addedIndex >= 0 && mAddedFeatures[addedIndex].attributeMap().contains( field ) )
       {
-        if ( mAddedFeatures[i].id() == featureId && mAddedFeatures[i].attributeMap().contains( field ) )
-        {
-          original = mAddedFeatures[i].attributeMap()[field];
-          isFirstChange = false;
-          break;
-        }
+        original = mAddedFeatures[addedIndex].attributeMap()[field];
+        isFirstChange = false;
       }
     }
     else
@@ -4439,13 +4578,10 @@ void QgsVectorLayer::editAttributeChange( int featureId, int field, QVariant val
   else
   {
     // updated added feature
-    for ( int i = 0; i < mAddedFeatures.size(); i++ )
+    int addedIndex = addedFeatureIndex( featureId );
+    if ( addedIndex >= 0 )
     {
-      if ( mAddedFeatures[i].id() == featureId )
-      {
-        mAddedFeatures[i].changeAttribute( field, value );
-        break;
-      }
+      mAddedFeatures[addedIndex].changeAttribute( field, value );
     }
   }
 }
@@ -4501,6 +4637,7 @@ void QgsVectorLayer::redoEditCommand( QgsUndoCommand* cmd )
     {
       mChangedGeometries[it.key()] = *( it.value().target );
     }
+    updateEditIndex( it.key() );
   }
 
   // deleted features
@@ -4515,7 +4652,9 @@ void QgsVectorLayer::redoEditCommand( QgsUndoCommand* cmd )
   QgsFeatureList::iterator addIt = addedFeatures.begin();
   for ( ; addIt != addedFeatures.end(); ++addIt )
   {
+    mAddedFeaturesIndex.insert( addIt->id(), mAddedFeatures.size() );
     mAddedFeatures.append( *addIt );
+    updateEditIndex( addIt->id() );
     emit featureAdded( addIt->id() );
   }
 
@@ -4546,13 +4685,10 @@ void QgsVectorLayer::redoEditCommand( QgsUndoCommand* cmd )
       else
       {
         // added feature
-        for ( int i = 0; i < mAddedFeatures.size(); i++ )
+        int addedIndex = addedFeatureIndex( fid );
+        if ( addedIndex >= 0 )
         {
-          if ( mAddedFeatures[i].id() == fid )
-          {
-            mAddedFeatures[i].changeAttribute( attrChIt.key(), attrChIt.value().target );
-            break;
-          }
+          mAddedFeatures[addedIndex].changeAttribute( attrChIt.key(), attrChIt.value().target );
         }
       }
       emit attributeValueChanged( fid, attrChIt.key(), attrChIt.value().target );
@@ -4625,6 +4761,7 @@ void QgsVectorLayer::undoEditCommand( QgsUndoCommand* cmd )
     {
       mChangedGeometries[it.key()] = *( it.value().original );
     }
+    updateEditIndex( it.key() );
   }
 
   // deleted features
@@ -4636,17 +4773,32 @@ void QgsVectorLayer::undoEditCommand( QgsUndoCommand* cmd )
   }
 
   // added features
+  // remove them in a single pass and reindex once, the list can be long
+  QSet<int> undoneFeatureIds;
   QgsFeatureList::iterator addIt = addedFeatures.begin();
   for ( ; addIt != addedFeatures.end(); ++addIt )
   {
-    QgsFeatureList::iterator addedIt = mAddedFeatures.begin();
-    for ( ; addedIt != mAddedFeatures.end(); ++addedIt )
+    if ( mAddedFeaturesIndex.contains( addIt->id() ) )
+      undoneFeatureIds.insert( addIt->id() );
+  }
+
+  if ( !undoneFeatureIds.isEmpty() )
+  {
+    QgsFeatureList remainingFeatures;
+    for ( QgsFeatureList::const_iterator addedIt = mAddedFeatures.constBegin(); addedIt != mAddedFeatures.constEnd(); ++addedIt )
     {
-      if ( addedIt->id() == addIt->id() )
+      if ( !undoneFeatureIds.contains( addedIt->id() ) )
+        remainingFeatures << *addedIt;
+    }
+    mAddedFeatures = remainingFeatures;
+    rebuildAddedFeaturesIndex();
+
+    for ( addIt = addedFeatures.begin(); addIt != addedFeatures.end(); ++addIt )
+    {
+      if ( undoneFeatureIds.contains( addIt->id() ) )
       {
-        mAddedFeatures.erase( addedIt );
+        updateEditIndex( addIt->id() );
         emit featureDeleted( addIt->id() );
-        break; // feature was found so move to next one
       }
     }
   }
@@ -4673,13 +4825,10 @@ void QgsVectorLayer::undoEditCommand( QgsUndoCommand* cmd )
       else
       {
         // added feature TODO:
-        for ( int i = 0; i < mAddedFeatures.size(); i++ )
+        int addedIndex = addedFeatureIndex( fid );
+        if ( addedIndex >= 0 )
         {
-          if ( mAddedFeatures[i].id() == fid )
-          {
-            mAddedFeatures[i].changeAttribute( attrChIt.key(), attrChIt.value().original );
-            break;
-          }
+          mAddedFeatures[addedIndex].changeAttribute( attrChIt.key(), attrChIt.value().original );
         }
       }
       QVariant original = attrChIt.value().original;
@@ -19,6 +19,7 @@
 #ifndef QGSVECTORLAYER_H
 #define QGSVECTORLAYER_H
 
+#include <QHash>
 #include <QMap>
 #include <QSet>
 #include <QList>
@@ -41,6 +42,7 @@ class QgsMapToPixel;
 class QgsLabel;
 class QgsRectangle;
 class QgsRenderer;
+class QgsRTree;
 class QgsUndoCommand;
 class QgsVectorDataProvider;
 class QgsVectorOverlay;
@@ -418,6 +420,16 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
      */
     bool draw( QgsRenderContext& rendererContext );
 
+    /** Draws only the selected features (with the selection color) within the extent of
+     *  the context. The features are fetched by id, so the cost depends on the size of the
+     *  selection and not on the size of the layer, and an iteration started with select()
+     *  is not disturbed.
+     *  Used to draw the selection on top of a map rendered without it
+     *  (see QgsRenderContext::setDrawSelection)
+     *  @note added in 1.6
+     */
+    void drawSelectedFeatures( QgsRenderContext& rendererContext );
+
     /** Draws the layer labels using coordinate transformation */
     void drawLabels( QgsRenderContext& rendererContext );
 
@@ -719,6 +731,23 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     /** Record changed attribute, store in active command (if any) */
     void editAttributeChange( int featureId, int field, QVariant value );
 
+    /** position of the added feature in mAddedFeatures or -1 if fid is not an added feature */
+    int addedFeatureIndex( int fid ) const { return mAddedFeaturesIndex.value( fid, -1 ); }
+
+    /** recreates mAddedFeaturesIndex after features have been removed from mAddedFeatures */
+    void rebuildAddedFeaturesIndex();
+
+    /** updates the entry of a feature in the edit index with its current edited geometry
+      (changed geometry or geometry of the added feature). Has to be called after every
+      change of mChangedGeometries or mAddedFeatures */
+    void updateEditIndex( int fid );
+
+    /** recreates both indexes of the edit buffer (after commit and rollback) */
+    void rebuildEditIndex();
+
+    /** Draws a feature of the selection with the renderer of the layer (V1 or V2) */
+    void drawSelectedFeature( QgsRenderContext& rendererContext, QgsFeature& fet, QImage* marker, double opacity );
+
     /** Stop version 2 renderer and selected renderer (if required) */
     void stopRendererV2( QgsRenderContext& rendererContext, QgsSingleSymbolRendererV2* selRenderer );
 
@@ -773,6 +802,16 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
      */
     QgsFeatureList mAddedFeatures;
 
+    /** Position of the added features in mAddedFeatures by feature id */
+    QHash<int, int> mAddedFeaturesIndex;
+
+    /** R-tree with the bounding boxes of the changed geometries and of the added features,
+        used to find the edited features within the rectangle of a select() */
+    QgsRTree* mEditIndex;
+
+    /** bounding boxes of the entries of mEditIndex (needed to remove them again) */
+    QHash<int, QgsRectangle> mEditIndexBoxes;
+
     /** Changed attributes values which are not commited */
     QgsChangedAttributesMap mChangedAttributeValues;
 
@@ -844,8 +883,14 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     bool mFetchGeometry;
 
     QSet<int> mFetchConsidered;
-    QgsGeometryMap::iterator mFetchChangedGeomIt;
+    /** edited features with bounding box in mFetchRect */
+    QList<int> mFetchEditIds;
+    QList<int>::const_iterator mFetchEditIdsIt;
     QgsFeatureList::iterator mFetchAddedFeaturesIt;
+
+    /** true while mLayerExtent is the extent stored in the project file
+        and the provider has not been asked for the real one yet */
+    bool mExtentDeferred;
 };
 
 #endif
@@ -23,10 +23,13 @@ email                : tim at linfiniti.com
 #include "qgsproviderregistry.h"
 #include "qgsrasterbandstats.h"
 #include "qgsrasterlayer.h"
+#include "qgsrasterprojector.h"
 #include "qgsrasterpyramid.h"
 #include "qgsrectangle.h"
 #include "qgsrendercontext.h"
 #include "qgscoordinatereferencesystem.h"
+#include "qgscoordinatetransform.h"
+#include "qgscsexception.h"
 
 #include "gdalwarper.h"
 #include "cpl_conv.h"
@@ -59,6 +62,7 @@ email                : tim at linfiniti.com
 #include <QRegExp>
 #include <QSlider>
 #include <QSettings>
+#include <QThread>
 #include "qgslogger.h"
 // workaround for MSVC compiler which already has defined macro max
 // that interferes with calling std::numeric_limits<int>::max
@@ -111,6 +115,7 @@ QgsRasterLayer::QgsRasterLayer(
 
   mBandCount = 0;
   mHasPyramids = false;
+  mPyramidBuildCanceled = false;
   mNoDataValue = -9999.0;
   mValidNoDataValue = false;
 
@@ -193,6 +198,7 @@ QgsRasterLayer::QgsRasterLayer( int dummy,
                format +  " and CRS of " + crs );
 
   mBandCount = 0;
+  mPyramidBuildCanceled = false;
   mRasterShader = new QgsRasterShader();
 
   // Initialise the affine transform matrix
@@ -576,6 +582,11 @@ int CPL_STDCALL progressCallback( double dfComplete,
 
   QgsRasterLayer * mypLayer = ( QgsRasterLayer * ) pProgressArg;
 
+  if ( mypLayer->isPyramidBuildCanceled() )
+  {
+    return false;
+  }
+
   if ( dfLastComplete > dfComplete )
   {
     if ( dfLastComplete >= 1.0 )
@@ -962,10 +973,11 @@ QString QgsRasterLayer::buildPyramids( RasterPyramidList const & theRasterPyrami
   //without requiring the user to rebuild the pyramid list to get the updated infomation
 
   //
-  // Note: Make sure the raster is not opened in write mode
-  // in order to force overviews to be written to a separate file.
-  // Otherwise reoopen it in read/write mode to stick overviews
-  // into the same file (if supported)
+  // The overviews are built on a dataset handle of their own, so that the
+  // layer's dataset stays valid for drawing, identify and statistics while
+  // this runs in a worker thread. Open it in read only mode to force the
+  // overviews into a separate file. Otherwise open it in read/write mode to
+  // stick overviews into the same file (if supported).
   //
 
 
@@ -978,8 +990,20 @@ QString QgsRasterLayer::buildPyramids( RasterPyramidList const & theRasterPyrami
     return "ERROR_WRITE_ACCESS";
   }
 
-  if ( mGdalDataset != mGdalBaseDataset )
+  GDALDatasetH myDataset = GDALOpen( QFile::encodeName( mDataSource ).constData(), theTryInternalFlag ? GA_Update : GA_ReadOnly );
+  if ( !myDataset )
+  {
+    // if the dataset couldn't be opened in read / write mode, tell the user
+    return "ERROR_WRITE_FORMAT";
+  }
+
+  // the layer draws rotated or gcp based rasters through a warped virtual dataset (see readFile)
+  double myGeoTransform[6];
+  if (( GDALGetGeoTransform( myDataset, myGeoTransform ) == CE_None
+        && ( myGeoTransform[1] < 0.0 || myGeoTransform[2] != 0.0 || myGeoTransform[4] != 0.0 || myGeoTransform[5] > 0.0 ) )
+      || GDALGetGCPCount( myDataset ) > 0 )
   {
+    GDALClose( myDataset );
     QgsLogger::warning( "Pyramid building not currently supported for 'warped virtual dataset'." );
     return "ERROR_VIRTUAL";
   }
@@ -993,34 +1017,22 @@ QString QgsRasterLayer::buildPyramids( RasterPyramidList const & theRasterPyrami
       GDALGetMetadataItem( GDALGetDriverByName( "GTiff" ), GDAL_DMD_CREATIONOPTIONLIST, "" );
     if ( strstr( pszGTiffCreationOptions, "BIGTIFF" ) == NULL )
     {
-      QString myCompressionType = QString( GDALGetMetadataItem( mGdalDataset, "COMPRESSION", "IMAGE_STRUCTURE" ) );
+      QString myCompressionType = QString( GDALGetMetadataItem( myDataset, "COMPRESSION", "IMAGE_STRUCTURE" ) );
       if ( "JPEG" == myCompressionType )
       {
+        GDALClose( myDataset );
         return "ERROR_JPEG_COMPRESSION";
       }
     }
-
-    //close the gdal dataset and reopen it in read / write mode
-    GDALClose( mGdalDataset );
-    mGdalBaseDataset = GDALOpen( QFile::encodeName( mDataSource ).constData(), GA_Update );
-
-    // if the dataset couldn't be opened in read / write mode, tell the user
-    if ( !mGdalBaseDataset )
-    {
-      mGdalBaseDataset = GDALOpen( QFile::encodeName( mDataSource ).constData(), GA_ReadOnly );
-      //Since we are not a virtual warped dataset, mGdalDataSet and mGdalBaseDataset are supposed to be the same
-      mGdalDataset = mGdalBaseDataset;
-      return "ERROR_WRITE_FORMAT";
-    }
   }
 
   //
-  // Iterate through the Raster Layer Pyramid Vector, building any pyramid
-  // marked as exists in eaxh RasterPyramid struct.
+  // Collect the levels of the Raster Layer Pyramid Vector marked to be built.
+  // They are passed to GDAL in a single call, so that each overview level is
+  // computed from the previous one instead of reading the full resolution
+  // data again for every level.
   //
-  CPLErr myError; //in case anything fails
-  int myCount = 1;
-  int myTotal = theRasterPyramidList.count();
+  QVector<int> myOverviewLevels;
   RasterPyramidList::const_iterator myRasterPyramidIterator;
   for ( myRasterPyramidIterator = theRasterPyramidList.begin();
         myRasterPyramidIterator != theRasterPyramidList.end();
@@ -1034,85 +1046,95 @@ QString QgsRasterLayer::buildPyramids( RasterPyramidList const & theRasterPyrami
 #endif
     if (( *myRasterPyramidIterator ).build )
     {
-      QgsDebugMsg( "Building....." );
-      emit drawingProgress( myCount, myTotal );
-      int myOverviewLevelsArray[1] = {( *myRasterPyramidIterator ).level };
-      /* From : http://remotesensing.org/gdal/classGDALDataset.html#a23
-       * pszResampling : one of "NEAREST", "AVERAGE" or "MODE" controlling the downsampling method applied.
-       * nOverviews : number of overviews to build.
-       * panOverviewList : the list of overview decimation factors to build.
-       * nBand : number of bands to build overviews for in panBandList. Build for all bands if this is 0.
-       * panBandList : list of band numbers.
-       * pfnProgress : a function to call to report progress, or NULL.
-       * pProgressData : application data to pass to the progress function.
-       */
-      //build the pyramid and show progress to console
-      try
-      {
+      myOverviewLevels << ( *myRasterPyramidIterator ).level;
+    }
+  }
 
-        //build the pyramid and show progress to console
-        //NOTE this (magphase) is disabled in the gui since it tends
-        //to create corrupted images. The images can be repaired
-        //by running one of the other resampling strategies below.
-        //see ticket #284
-        if ( theResamplingMethod == tr( "Average Magphase" ) )
-        {
-          myError = GDALBuildOverviews( mGdalBaseDataset, "MODE", 1, myOverviewLevelsArray, 0, NULL,
-                                        progressCallback, this ); //this is the arg for the gdal progress callback
-        }
-        else if ( theResamplingMethod == tr( "Average" ) )
+  if ( !myOverviewLevels.isEmpty() )
+  {
+    QgsDebugMsg( "Building....." );
+    mPyramidBuildCanceled = false;
 
-        {
-          myError = GDALBuildOverviews( mGdalBaseDataset, "AVERAGE", 1, myOverviewLevelsArray, 0, NULL,
-                                        progressCallback, this ); //this is the arg for the gdal progress callback
-        }
-        else // fall back to nearest neighbor
-        {
-          myError = GDALBuildOverviews( mGdalBaseDataset, "NEAREST", 1, myOverviewLevelsArray, 0, NULL,
-                                        progressCallback, this ); //this is the arg for the gdal progress callback
-        }
+    /* From : http://remotesensing.org/gdal/classGDALDataset.html#a23
+     * pszResampling : one of "NEAREST", "AVERAGE" or "MODE" controlling the downsampling method applied.
+     * nOverviews : number of overviews to build.
+     * panOverviewList : the list of overview decimation factors to build.
+     * nBand : number of bands to build overviews for in panBandList. Build for all bands if this is 0.
+     * panBandList : list of band numbers.
+     * pfnProgress : a function to call to report progress, or NULL.
+     * pProgressData : application data to pass to the progress function.
+     */
+    //NOTE this (magphase) is disabled in the gui since it tends
+    //to create corrupted images. The images can be repaired
+    //by running one of the other resampling strategies below.
+    //see ticket #284
+    const char* myResampling = "NEAREST"; // fall back to nearest neighbor
+    if ( theResamplingMethod == tr( "Average Magphase" ) )
+    {
+      myResampling = "MODE";
+    }
+    else if ( theResamplingMethod == tr( "Average" ) )
+    {
+      myResampling = "AVERAGE";
+    }
 
-        if ( myError == CE_Failure || CPLGetLastErrorNo() == CPLE_NotSupported )
-        {
-          //something bad happenend
-          //QString myString = QString (CPLGetLastError());
-          GDALClose( mGdalBaseDataset );
-          mGdalBaseDataset = GDALOpen( QFile::encodeName( mDataSource ).constData(), GA_ReadOnly );
-          //Since we are not a virtual warped dataset, mGdalDataSet and mGdalBaseDataset are supposed to be the same
-          mGdalDataset = mGdalBaseDataset;
-
-          emit drawingProgress( 0, 0 );
-          return "FAILED_NOT_SUPPORTED";
-        }
-        else
-        {
-          //make sure the raster knows it has pyramids
-          mHasPyramids = true;
-        }
-        myCount++;
+    CPLErrorReset();
+    CPLErr myError = GDALBuildOverviews( myDataset, myResampling,
+                                         myOverviewLevels.size(), myOverviewLevels.data(), 0, NULL,
+                                         progressCallback, this ); //this is the arg for the gdal progress callback
+    bool myCanceled = mPyramidBuildCanceled;
+    mPyramidBuildCanceled = false;
 
-      }
-      catch ( CPLErr )
-      {
-        QgsLogger::warning( "Pyramid overview building failed!" );
-      }
+    if ( myError == CE_Failure || CPLGetLastErrorNo() == CPLE_NotSupported )
+    {
+      //something bad happenend
+      //QString myString = QString (CPLGetLastError());
+      GDALClose( myDataset );
+
+      emit drawingProgress( 0, 0 );
+      return myCanceled ? "CANCELED" : "FAILED_NOT_SUPPORTED";
     }
   }
 
   QgsDebugMsg( "Pyramid overviews built" );
-  if ( theTryInternalFlag )
+  GDALClose( myDataset );
+
+  // a worker thread leaves this to the layer's thread
+  if ( QThread::currentThread() == thread() )
   {
-    //close the gdal dataset and reopen it in read only mode
-    GDALClose( mGdalBaseDataset );
-    mGdalBaseDataset = GDALOpen( QFile::encodeName( mDataSource ).constData(), GA_ReadOnly );
-    //Since we are not a virtual warped dataset, mGdalDataSet and mGdalBaseDataset are supposed to be the same
-    mGdalDataset = mGdalBaseDataset;
+    reloadDataset();
   }
 
   emit drawingProgress( 0, 0 );
   return NULL; // returning null on success
 }
 
+void QgsRasterLayer::reloadDataset()
+{
+  // a warped virtual dataset would have to be recreated, buildPyramids does not support those anyway
+  if ( usesProvider() || !mGdalBaseDataset || mGdalDataset != mGdalBaseDataset )
+  {
+    return;
+  }
+
+  GDALDatasetH myDataset = GDALOpen( QFile::encodeName( mDataSource ).constData(), GA_ReadOnly );
+  if ( !myDataset )
+  {
+    return;
+  }
+
+  GDALDereferenceDataset( mGdalBaseDataset );
+  GDALClose( mGdalDataset );
+  mGdalBaseDataset = myDataset;
+  //Since we are not a virtual warped dataset, mGdalDataSet and mGdalBaseDataset are supposed to be the same
+  mGdalDataset = mGdalBaseDataset;
+  GDALReferenceDataset( mGdalDataset );
+
+  mLastModified = lastModified( mDataSource );
+  mHasPyramids = GDALGetOverviewCount( GDALGetRasterBand( mGdalDataset, 1 ) ) > 0;
+  buildPyramidList();
+}
+
 
 QgsRasterLayer::RasterPyramidList  QgsRasterLayer::buildPyramidList()
 {
@@ -1409,6 +1431,14 @@ bool QgsRasterLayer::draw( QgsRenderContext& rendererContext )
     return false;
   }
 
+  // pixels of local rasters are warped to the destination CRS,
+  // providers (WMS) are asked for images in the destination CRS
+  const QgsCoordinateTransform* ct = rendererContext.coordinateTransform();
+  if ( ct && !ct->isShortCircuited() && mProviderKey.isEmpty() )
+  {
+    return drawReprojected( rendererContext );
+  }
+
   const QgsMapToPixel& theQgsMapToPixel = rendererContext.mapToPixel();
   const QgsRectangle& theViewExtent = rendererContext.extent();
   QPainter* theQPainter = rendererContext.painter();
@@ -4407,6 +4437,96 @@ bool QgsRasterLayer::writeXml( QDomNode & layer_node,
 // Private methods
 //
 /////////////////////////////////////////////////////////
+bool QgsRasterLayer::drawReprojected( QgsRenderContext& rendererContext )
+{
+  const QgsCoordinateTransform* ct = rendererContext.coordinateTransform();
+  const QgsMapToPixel& theQgsMapToPixel = rendererContext.mapToPixel();
+  QPainter* theQPainter = rendererContext.painter();
+  if ( !theQPainter || !theQPainter->device() )
+  {
+    return false;
+  }
+
+  // visible part of the map in destination coordinates (the painter may be
+  // scaled by the raster scale factor)
+  double myScale = rendererContext.rasterScaleFactor();
+  int myDeviceWidth = static_cast<int>( theQPainter->device()->width() * myScale + 0.5 );
+  int myDeviceHeight = static_cast<int>( theQPainter->device()->height() * myScale + 0.5 );
+  QgsPoint myTopLeft = theQgsMapToPixel.toMapCoordinates( 0, 0 );
+  QgsPoint myBottomRight = theQgsMapToPixel.toMapCoordinates( myDeviceWidth, myDeviceHeight );
+  QgsRectangle myViewExtent( myTopLeft, myBottomRight );
+
+  // layer extent in destination coordinates
+  QgsRectangle myDestExtent;
+  try
+  {
+    myDestExtent = ct->transformBoundingBox( mLayerExtent );
+    myDestExtent = myDestExtent.intersect( &myViewExtent );
+  }
+  catch ( QgsCsException &cse )
+  {
+    Q_UNUSED( cse );
+    myDestExtent = myViewExtent;
+  }
+  if ( myDestExtent.isEmpty() )
+  {
+    QgsDebugMsg( "draw request outside view extent." );
+    return true;
+  }
+
+  // snap the destination image to device pixels
+  QgsPoint myDestTopLeft = theQgsMapToPixel.transform( myDestExtent.xMinimum(), myDestExtent.yMaximum() );
+  QgsPoint myDestBottomRight = theQgsMapToPixel.transform( myDestExtent.xMaximum(), myDestExtent.yMinimum() );
+  int myDestLeft = static_cast<int>( floor( myDestTopLeft.x() ) );
+  int myDestTop = static_cast<int>( floor( myDestTopLeft.y() ) );
+  int myDestCols = static_cast<int>( ceil( myDestBottomRight.x() ) ) - myDestLeft;
+  int myDestRows = static_cast<int>( ceil( myDestBottomRight.y() ) ) - myDestTop;
+  if ( myDestCols <= 0 || myDestRows <= 0 )
+  {
+    return true;
+  }
+  myDestExtent = QgsRectangle( theQgsMapToPixel.toMapCoordinates( myDestLeft, myDestTop + myDestRows ),
+                               theQgsMapToPixel.toMapCoordinates( myDestLeft + myDestCols, myDestTop ) );
+
+  QSettings mySettings;
+  double myMaxError = mySettings.value( "/Raster/reprojectionMaxError", 0.5 ).toDouble();
+  QgsRasterProjector myProjector( *ct, myDestExtent, myDestRows, myDestCols, myMaxError );
+
+  QgsRectangle mySrcExtent = myProjector.sourceExtent();
+  mySrcExtent = mySrcExtent.intersect( &mLayerExtent );
+  if ( mySrcExtent.isEmpty() )
+  {
+    return true;
+  }
+
+  // draw the needed part of the layer in its own CRS at about the destination resolution
+  double mySrcUnitsPerPixel = qMax( mySrcExtent.width() / myDestCols, mySrcExtent.height() / myDestRows );
+  int mySrcCols = qMax( 1, static_cast<int>( ceil( mySrcExtent.width() / mySrcUnitsPerPixel ) ) );
+  int mySrcRows = qMax( 1, static_cast<int>( ceil( mySrcExtent.height() / mySrcUnitsPerPixel ) ) );
+  mySrcExtent.setXMaximum( mySrcExtent.xMinimum() + mySrcCols * mySrcUnitsPerPixel );
+  mySrcExtent.setYMinimum( mySrcExtent.yMaximum() - mySrcRows * mySrcUnitsPerPixel );
+
+  QImage mySrcImage( mySrcCols, mySrcRows, QImage::Format_ARGB32 );
+  mySrcImage.fill( 0 );
+  QPainter mySrcPainter( &mySrcImage );
+
+  QgsRenderContext mySrcContext;
+  mySrcContext.setPainter( &mySrcPainter );
+  mySrcContext.setExtent( mySrcExtent );
+  mySrcContext.setMapToPixel( QgsMapToPixel( mySrcUnitsPerPixel, mySrcRows, mySrcExtent.yMinimum(), mySrcExtent.xMinimum() ) );
+  mySrcContext.setScaleFactor( rendererContext.scaleFactor() );
+  mySrcContext.setRasterScaleFactor( 1.0 );
+  mySrcContext.setRendererScale( rendererContext.rendererScale() );
+  bool myResult = draw( mySrcContext );
+  mySrcPainter.end();
+
+  QImage myDestImage( myDestCols, myDestRows, QImage::Format_ARGB32 );
+  myProjector.warp( mySrcImage, mySrcExtent, myDestImage );
+  theQPainter->drawImage( myDestLeft, myDestTop, myDestImage );
+
+  return myResult;
+}
+
 void QgsRasterLayer::drawMultiBandColor( QPainter * theQPainter, QgsRasterViewPort * theRasterViewPort,
     const QgsMapToPixel* theQgsMapToPixel )
 {
@@ -4436,16 +4556,8 @@ void QgsRasterLayer::drawMultiBandColor( QPainter * theQPainter, QgsRasterViewPo
   GDALRasterBandH myGdalGreenBand = GDALGetRasterBand( mGdalDataset, myGreenBandNo );
   GDALRasterBandH myGdalBlueBand = GDALGetRasterBand( mGdalDataset, myBlueBandNo );
 
-  GDALDataType myRedType = GDALGetRasterDataType( myGdalRedBand );
-  GDALDataType myGreenType = GDALGetRasterDataType( myGdalGreenBand );
-  GDALDataType myBlueType = GDALGetRasterDataType( myGdalBlueBand );
-
-  QRgb* redImageScanLine = 0;
-  void* redRasterScanLine = 0;
-  QRgb* greenImageScanLine = 0;
-  void* greenRasterScanLine = 0;
-  QRgb* blueImageScanLine = 0;
-  void* blueRasterScanLine = 0;
+  QRgb* imageScanLine = 0;
+  void* rasterScanLine = 0;
 
   QRgb myDefaultColor = qRgba( 255, 255, 255, 0 );
 
@@ -4504,24 +4616,20 @@ void QgsRasterLayer::drawMultiBandColor( QPainter * theQPainter, QgsRasterViewPo
   QgsContrastEnhancement* myGreenContrastEnhancement = contrastEnhancement( myGreenBandNo );
   QgsContrastEnhancement* myBlueContrastEnhancement = contrastEnhancement( myBlueBandNo );
 
-  QgsRasterImageBuffer redImageBuffer( myGdalRedBand, theQPainter, theRasterViewPort, theQgsMapToPixel, &mGeoTransform[0] );
-  redImageBuffer.reset();
-  QgsRasterImageBuffer greenImageBuffer( myGdalGreenBand, theQPainter, theRasterViewPort, theQgsMapToPixel, &mGeoTransform[0] );
-  greenImageBuffer.setWritingEnabled( false ); //only draw to redImageBuffer
-  greenImageBuffer.reset();
-  QgsRasterImageBuffer blueImageBuffer( myGdalBlueBand, theQPainter, theRasterViewPort, theQgsMapToPixel, &mGeoTransform[0] );
-  blueImageBuffer.setWritingEnabled( false ); //only draw to redImageBuffer
-  blueImageBuffer.reset();
+  //read the three bands pixel interleaved in one go instead of band by band
+  QList<int> myBandNumbers;
+  myBandNumbers << myRedBandNo << myGreenBandNo << myBlueBandNo;
+  QgsRasterImageBuffer imageBuffer( mGdalDataset, myBandNumbers, theQPainter, theRasterViewPort, theQgsMapToPixel, &mGeoTransform[0] );
+  imageBuffer.reset();
+  GDALDataType myDataType = imageBuffer.dataType();
 
-  while ( redImageBuffer.nextScanLine( &redImageScanLine, &redRasterScanLine )
-          && greenImageBuffer.nextScanLine( &greenImageScanLine, &greenRasterScanLine )
-          && blueImageBuffer.nextScanLine( &blueImageScanLine, &blueRasterScanLine ) )
+  while ( imageBuffer.nextScanLine( &imageScanLine, &rasterScanLine ) )
   {
     for ( int i = 0; i < theRasterViewPort->drawableAreaXDim; ++i )
     {
-      myRedValue   = readValue( redRasterScanLine, ( GDALDataType )myRedType, i );
-      myGreenValue = readValue( greenRasterScanLine, ( GDALDataType )myGreenType, i );
-      myBlueValue  = readValue( blueRasterScanLine, ( GDALDataType )myBlueType, i );
+      myRedValue   = readValue( rasterScanLine, myDataType, 3 * i );
+      myGreenValue = readValue( rasterScanLine, myDataType, 3 * i + 1 );
+      myBlueValue  = readValue( rasterScanLine, myDataType, 3 * i + 2 );
 
       if ( mValidNoDataValue &&
            (
@@ -4531,7 +4639,7 @@ void QgsRasterLayer::drawMultiBandColor( QPainter * theQPainter, QgsRasterViewPo
            )
          )
       {
-        redImageScanLine[ i ] = myDefaultColor;
+        imageScanLine[ i ] = myDefaultColor;
         continue;
       }
 
@@ -4539,14 +4647,14 @@ void QgsRasterLayer::drawMultiBandColor( QPainter * theQPainter, QgsRasterViewPo
            !myGreenContrastEnhancement->isValueInDisplayableRange( myGreenValue ) ||
            !myBlueContrastEnhancement->isValueInDisplayableRange( myBlueValue ) )
       {
-        redImageScanLine[ i ] = myDefaultColor;
+        imageScanLine[ i ] = myDefaultColor;
         continue;
       }
 
       myAlphaValue = mRasterTransparency.alphaValue( myRedValue, myGreenValue, myBlueValue, mTransparencyLevel );
       if ( 0 == myAlphaValue )
       {
-        redImageScanLine[ i ] = myDefaultColor;
+        imageScanLine[ i ] = myDefaultColor;
         continue;
       }
 
@@ -4561,7 +4669,7 @@ void QgsRasterLayer::drawMultiBandColor( QPainter * theQPainter, QgsRasterViewPo
         myStretchedBlueValue = 255 - myStretchedBlueValue;
       }
 
-      redImageScanLine[ i ] = qRgba( myStretchedRedValue, myStretchedGreenValue, myStretchedBlueValue, myAlphaValue );
+      imageScanLine[ i ] = qRgba( myStretchedRedValue, myStretchedGreenValue, myStretchedBlueValue, myAlphaValue );
     }
   }
 }
@@ -5671,9 +5779,41 @@ QString QgsRasterLayer::validateBandName( QString const & theBandName )
 }
 
 QgsRasterImageBuffer::QgsRasterImageBuffer( GDALRasterBandH rasterBand, QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* mapToPixel, double* geoTransform ):
-    mRasterBand( rasterBand ), mPainter( p ), mViewPort( viewPort ), mMapToPixel( mapToPixel ), mGeoTransform( geoTransform ), mValid( false ), mWritingEnabled( true ), mDrawPixelRect( false ), mCurrentImage( 0 ), mCurrentGDALData( 0 )
+    mRasterBand( rasterBand ), mDataset( 0 ), mDataType( GDT_Unknown ), mPixelSize( 0 ), mPainter( p ), mViewPort( viewPort ), mMapToPixel( mapToPixel ), mGeoTransform( geoTransform ), mValid( false ), mWritingEnabled( true ), mDrawPixelRect( false ), mCurrentImage( 0 ), mCurrentGDALData( 0 )
+{
+  if ( mRasterBand )
+  {
+    mDataType = GDALGetRasterDataType( mRasterBand );
+    mPixelSize = GDALGetDataTypeSize( mDataType ) / 8;
+  }
+}
+
+QgsRasterImageBuffer::QgsRasterImageBuffer( GDALDatasetH dataset, const QList<int>& bandNumbers, QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* mapToPixel, double* geoTransform ):
+    mRasterBand( 0 ), mDataset( dataset ), mBandNumbers( bandNumbers.toVector() ), mDataType( GDT_Unknown ), mPixelSize( 0 ), mPainter( p ), mViewPort( viewPort ), mMapToPixel( mapToPixel ), mGeoTransform( geoTransform ), mValid( false ), mWritingEnabled( true ), mDrawPixelRect( false ), mCurrentImage( 0 ), mCurrentGDALData( 0 )
 {
+  if ( !mDataset || mBandNumbers.isEmpty() )
+  {
+    return;
+  }
 
+  //the first band also determines the partition and is used as validity check
+  mRasterBand = GDALGetRasterBand( mDataset, mBandNumbers[0] );
+
+  //bands of different types are converted to double by GDAL
+  for ( int i = 0; i < mBandNumbers.size(); ++i )
+  {
+    GDALDataType type = GDALGetRasterDataType( GDALGetRasterBand( mDataset, mBandNumbers[i] ) );
+    if ( i == 0 )
+    {
+      mDataType = type;
+    }
+    else if ( type != mDataType )
+    {
+      mDataType = GDT_Float64;
+      break;
+    }
+  }
+  mPixelSize = GDALGetDataTypeSize( mDataType ) / 8 * mBandNumbers.size();
 }
 
 QgsRasterImageBuffer::~QgsRasterImageBuffer()
@@ -5738,9 +5878,7 @@ bool QgsRasterImageBuffer::nextScanLine( QRgb** imageScanLine, void** rasterScan
   {
     *imageScanLine = 0;
   }
-  GDALDataType type = GDALGetRasterDataType( mRasterBand );
-  int size = GDALGetDataTypeSize( type ) / 8;
-  *rasterScanLine = ( unsigned char * )mCurrentGDALData + mCurrentPartImageRow * mViewPort->drawableAreaXDim * size;
+  *rasterScanLine = ( unsigned char * )mCurrentGDALData + mCurrentPartImageRow * mViewPort->drawableAreaXDim * mPixelSize;
 
   ++mCurrentPartImageRow;
   ++mCurrentRow;
@@ -5812,8 +5950,6 @@ bool QgsRasterImageBuffer::createNextPartImage()
   mCurrentPartImageRow = 0;
 
   //read GDAL image data
-  GDALDataType type = GDALGetRasterDataType( mRasterBand );
-  int size = GDALGetDataTypeSize( type ) / 8;
   int xSize = mViewPort->drawableAreaXDim;
   int ySize = mViewPort->drawableAreaYDim;
 
@@ -5846,10 +5982,29 @@ bool QgsRasterImageBuffer::createNextPartImage()
     return false;
   }
   mNumCurrentImageRows = ySize;
-  mCurrentGDALData = VSIMalloc( size * xSize * ySize );
-  CPLErr myErr = GDALRasterIO( mRasterBand, GF_Read, mViewPort->rectXOffset,
-                               mViewPort->rectYOffset + mCurrentRow, mViewPort->clippedWidth, rasterYSize,
-                               mCurrentGDALData, xSize, ySize, type, 0, 0 );
+  mCurrentGDALData = VSIMalloc( mPixelSize * xSize * ySize );
+  if ( !mCurrentGDALData )
+  {
+    return false;
+  }
+
+  CPLErr myErr;
+  if ( mDataset )
+  {
+    //one request for all bands, so that blocks of pixel interleaved files are decoded only once
+    int valueSize = GDALGetDataTypeSize( mDataType ) / 8;
+    myErr = GDALDatasetRasterIO( mDataset, GF_Read, mViewPort->rectXOffset,
+                                 mViewPort->rectYOffset + mCurrentRow, mViewPort->clippedWidth, rasterYSize,
+                                 mCurrentGDALData, xSize, ySize, mDataType,
+                                 mBandNumbers.size(), mBandNumbers.data(),
+                                 mPixelSize, mPixelSize * xSize, valueSize );
+  }
+  else
+  {
+    myErr = GDALRasterIO( mRasterBand, GF_Read, mViewPort->rectXOffset,
+                          mViewPort->rectYOffset + mCurrentRow, mViewPort->clippedWidth, rasterYSize,
+                          mCurrentGDALData, xSize, ySize, mDataType, 0, 0 );
+  }
 
   if ( myErr != CPLE_None )
   {
@@ -326,6 +326,11 @@ class CORE_EXPORT QgsRasterLayer : public QgsMapLayer
     /** \brief Accessor for mHasPyramids (READ ONLY) */
     bool hasPyramids() { return mHasPyramids; }
 
+    /** \brief Whether cancelPyramidBuild() was called during the current buildPyramids() call
+     * @note added in QGIS 1.6
+     */
+    bool isPyramidBuildCanceled() const { return mPyramidBuildCanceled; }
+
     /** \brief Accessor for mUserDefinedGrayMinimumMaximum */
     bool hasUserDefinedGrayMinimumMaximum() const { return mUserDefinedGrayMinimumMaximum; }
 
@@ -652,11 +657,26 @@ class CORE_EXPORT QgsRasterLayer : public QgsMapLayer
 
 
   public slots:
-    /** \brief Create GDAL pyramid overviews */
+    /** \brief Create GDAL pyramid overviews
+     * All levels are built in one pass on a dataset handle of its own, so the
+     * method may run in a worker thread while the layer is used; progress is reported
+     * with progressUpdate(). When it runs in another thread than the layer's, call
+     * reloadDataset() in the layer's thread afterwards to use the new overviews. Returns "CANCELED" if cancelPyramidBuild() was called.
+     */
     QString buildPyramids( const RasterPyramidList &,
                            const QString &  theResamplingMethod = "NEAREST",
                            bool theTryInternalFlag = false );
 
+    /** \brief Stop a running buildPyramids() call at the next progress report
+     * @note added in QGIS 1.6
+     */
+    void cancelPyramidBuild() { mPyramidBuildCanceled = true; }
+
+    /** \brief Reopen the GDAL dataset, so that overviews written by buildPyramids() are used
+     * @note added in QGIS 1.6
+     */
+    void reloadDataset();
+
     /** \brief Populate the histogram vector for a given band */
     void populateHistogram( int theBandNoInt,
                             int theBinCountInt = 256,
@@ -702,6 +722,11 @@ class CORE_EXPORT QgsRasterLayer : public QgsMapLayer
     // Private methods
     //
 
+    /** \brief Draws the layer in the source CRS into an image and warps it to the
+     * destination CRS of the render context with QgsRasterProjector
+     * @note added in 1.6 */
+    bool drawReprojected( QgsRenderContext& rendererContext );
+
     /** \brief Drawing routine for multiband image  */
     void drawMultiBandColor( QPainter * theQPainter,
                              QgsRasterViewPort * theRasterViewPort,
@@ -849,6 +874,9 @@ class CORE_EXPORT QgsRasterLayer : public QgsMapLayer
     /** \brief Whether this raster has overviews / pyramids or not */
     bool mHasPyramids;
 
+    /** \brief Set by cancelPyramidBuild() */
+    volatile bool mPyramidBuildCanceled;
+
     /** \brief  Raster width */
     int mWidth;
 
@@ -924,6 +952,12 @@ class CORE_EXPORT QgsRasterImageBuffer
   public:
     QgsRasterImageBuffer( GDALRasterBandH rasterBand, QPainter* p,
                           QgsRasterViewPort* viewPort, const QgsMapToPixel* mapToPixel, double* mGeoTransform );
+    /**Reads several bands of the dataset with one RasterIO call per part into a pixel interleaved
+      buffer, i.e. value b of pixel i of a raster scan line is at index i * bandCount + b.
+      The bands are converted to a common data type (see dataType()).
+      @note added in 1.6*/
+    QgsRasterImageBuffer( GDALDatasetH dataset, const QList<int>& bandNumbers, QPainter* p,
+                          QgsRasterViewPort* viewPort, const QgsMapToPixel* mapToPixel, double* mGeoTransform );
     ~QgsRasterImageBuffer();
     void reset( int maxPixelsInVirtualMemory = 5000000 );
     /**Returns a pointer to the next scan line (or 0 if end)*/
@@ -931,6 +965,10 @@ class CORE_EXPORT QgsRasterImageBuffer
 
     void setWritingEnabled( bool enabled ) { mWritingEnabled = enabled; }
 
+    /**Data type of the values in the raster scan lines
+      @note added in 1.6*/
+    GDALDataType dataType() const { return mDataType; }
+
   private:
     QgsRasterImageBuffer(); //forbidden
     /**Creates next part image. Returns false if at end*/
@@ -940,6 +978,10 @@ class CORE_EXPORT QgsRasterImageBuffer
     void drawPixelRectangle();
 
     GDALRasterBandH mRasterBand; //raster band
+    GDALDatasetH mDataset; //dataset for interleaved reading of several bands, 0 for a single band
+    QVector<int> mBandNumbers; //bands read from mDataset
+    GDALDataType mDataType; //type of the values in mCurrentGDALData
+    int mPixelSize; //size of the values of one pixel in bytes
     QPainter* mPainter;
     QgsRasterViewPort* mViewPort;
     const QgsMapToPixel* mMapToPixel;
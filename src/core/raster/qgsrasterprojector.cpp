@@ -0,0 +1,337 @@
+/***************************************************************************
+    qgsrasterprojector.cpp - warps raster images between coordinate systems
+    ----------------------
+    begin                : October 2010
+    copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrasterprojector.h"
+#include "qgscoordinatetransform.h"
+#include "qgscsexception.h"
+#include "qgslogger.h"
+
+#include <QImage>
+#include <qnumeric.h>
+
+#include <cmath>
+
+//limit of grid rows / columns, so that the number of proj calls stays small
+static const int sMaxGridPositions = 200;
+//number of grid cells in each direction before refinement
+static const int sInitialGridCells = 4;
+
+QgsRasterProjector::QgsRasterProjector( const QgsCoordinateTransform& ct, const QgsRectangle& destExtent,
+                                        int destRows, int destCols, double maxError )
+    : mCoordinateTransform( ct )
+    , mDestExtent( destExtent )
+    , mDestRows( destRows )
+    , mDestCols( destCols )
+{
+  mDestXRes = destCols > 0 ? destExtent.width() / destCols : 0;
+  mDestYRes = destRows > 0 ? destExtent.height() / destRows : 0;
+
+  if ( destRows <= 0 || destCols <= 0 )
+  {
+    return;
+  }
+
+  for ( int i = 0; i <= sInitialGridCells; ++i )
+  {
+    mRowPositions << ( double ) destRows * i / sInitialGridCells;
+    mColPositions << ( double ) destCols * i / sInitialGridCells;
+  }
+  calculateGrid();
+  updateSourceExtent();
+
+  if ( mSourceExtent.isEmpty() )
+  {
+    return;
+  }
+
+  //express the error limit in source units, using the mean source size of a destination pixel
+  double srcUnitsPerPixel = sqrt( mSourceExtent.width() * mSourceExtent.height() / (( double ) destRows * destCols ) );
+  while ( refineGrid( maxError * srcUnitsPerPixel ) )
+    ;
+  updateSourceExtent();
+
+  QgsDebugMsg( QString( "grid %1 x %2 for %3 x %4 pixels" ).arg( mRowPositions.size() ).arg( mColPositions.size() ).arg( destRows ).arg( destCols ) );
+}
+
+bool QgsRasterProjector::sourcePoint( double row, double col, double& x, double& y ) const
+{
+  x = mDestExtent.xMinimum() + col * mDestXRes;
+  y = mDestExtent.yMaximum() - row * mDestYRes;
+  double z = 0;
+  try
+  {
+    mCoordinateTransform.transformInPlace( x, y, z, QgsCoordinateTransform::ReverseTransform );
+  }
+  catch ( QgsCsException &cse )
+  {
+    Q_UNUSED( cse );
+    return false;
+  }
+  return !qIsNaN( x ) && !qIsNaN( y ) && !qIsInf( x ) && !qIsInf( y );
+}
+
+void QgsRasterProjector::calculateGrid()
+{
+  int nRows = mRowPositions.size();
+  int nCols = mColPositions.size();
+  mSrcX.resize( nRows * nCols );
+  mSrcY.resize( nRows * nCols );
+  mValid.resize( nRows * nCols );
+
+  for ( int i = 0; i < nRows; ++i )
+  {
+    for ( int j = 0; j < nCols; ++j )
+    {
+      int n = i * nCols + j;
+      mValid[n] = sourcePoint( mRowPositions[i], mColPositions[j], mSrcX[n], mSrcY[n] );
+    }
+  }
+}
+
+bool QgsRasterProjector::refineGrid( double maxError )
+{
+  int nRows = mRowPositions.size();
+  int nCols = mColPositions.size();
+  double maxSqrError = maxError * maxError;
+  double x, y;
+
+  QVector<bool> splitCol( nCols - 1, false );
+  QVector<bool> splitRow( nRows - 1, false );
+  int newCols = 0;
+  int newRows = 0;
+
+  //columns: check the midpoints between horizontally adjacent nodes
+  for ( int j = 0; j < nCols - 1 && nCols + newCols < sMaxGridPositions; ++j )
+  {
+    if ( mColPositions[j + 1] - mColPositions[j] <= 1.0 )
+      continue;
+
+    double col = ( mColPositions[j] + mColPositions[j + 1] ) / 2.0;
+    for ( int i = 0; i < nRows; ++i )
+    {
+      int n = i * nCols + j;
+      //cells crossing the border of the projection domain are split to recover their valid part
+      if ( mValid[n] != mValid[n + 1] )
+      {
+        splitCol[j] = true;
+        ++newCols;
+        break;
+      }
+      if ( !mValid[n] || !sourcePoint( mRowPositions[i], col, x, y ) )
+        continue;
+
+      double dx = x - ( mSrcX[n] + mSrcX[n + 1] ) / 2.0;
+      double dy = y - ( mSrcY[n] + mSrcY[n + 1] ) / 2.0;
+      if ( dx * dx + dy * dy > maxSqrError )
+      {
+        splitCol[j] = true;
+        ++newCols;
+        break;
+      }
+    }
+  }
+
+  //rows: check the midpoints between vertically adjacent nodes
+  for ( int i = 0; i < nRows - 1 && nRows + newRows < sMaxGridPositions; ++i )
+  {
+    if ( mRowPositions[i + 1] - mRowPositions[i] <= 1.0 )
+      continue;
+
+    double row = ( mRowPositions[i] + mRowPositions[i + 1] ) / 2.0;
+    for ( int j = 0; j < nCols; ++j )
+    {
+      int n = i * nCols + j;
+      if ( mValid[n] != mValid[n + nCols] )
+      {
+        splitRow[i] = true;
+        ++newRows;
+        break;
+      }
+      if ( !mValid[n] || !sourcePoint( row, mColPositions[j], x, y ) )
+        continue;
+
+      double dx = x - ( mSrcX[n] + mSrcX[n + nCols] ) / 2.0;
+      double dy = y - ( mSrcY[n] + mSrcY[n + nCols] ) / 2.0;
+      if ( dx * dx + dy * dy > maxSqrError )
+      {
+        splitRow[i] = true;
+        ++newRows;
+        break;
+      }
+    }
+  }
+
+  if ( newCols == 0 && newRows == 0 )
+  {
+    return false;
+  }
+
+  //insert the new positions and keep track of the old nodes, which need no new transformation
+  QVector<double> rowPositions, colPositions;
+  QVector<int> oldRow, oldCol;
+  for ( int i = 0; i < nRows; ++i )
+  {
+    rowPositions << mRowPositions[i];
+    oldRow << i;
+    if ( i < nRows - 1 && splitRow[i] )
+    {
+      rowPositions << ( mRowPositions[i] + mRowPositions[i + 1] ) / 2.0;
+      oldRow << -1;
+    }
+  }
+  for ( int j = 0; j < nCols; ++j )
+  {
+    colPositions << mColPositions[j];
+    oldCol << j;
+    if ( j < nCols - 1 && splitCol[j] )
+    {
+      colPositions << ( mColPositions[j] + mColPositions[j + 1] ) / 2.0;
+      oldCol << -1;
+    }
+  }
+
+  int nNewRows = rowPositions.size();
+  int nNewCols = colPositions.size();
+  QVector<double> srcX( nNewRows * nNewCols );
+  QVector<double> srcY( nNewRows * nNewCols );
+  QVector<bool> valid( nNewRows * nNewCols );
+  for ( int i = 0; i < nNewRows; ++i )
+  {
+    for ( int j = 0; j < nNewCols; ++j )
+    {
+      int n = i * nNewCols + j;
+      if ( oldRow[i] >= 0 && oldCol[j] >= 0 )
+      {
+        int o = oldRow[i] * nCols + oldCol[j];
+        srcX[n] = mSrcX[o];
+        srcY[n] = mSrcY[o];
+        valid[n] = mValid[o];
+      }
+      else
+      {
+        valid[n] = sourcePoint( rowPositions[i], colPositions[j], srcX[n], srcY[n] );
+      }
+    }
+  }
+
+  mRowPositions = rowPositions;
+  mColPositions = colPositions;
+  mSrcX = srcX;
+  mSrcY = srcY;
+  mValid = valid;
+  return true;
+}
+
+void QgsRasterProjector::updateSourceExtent()
+{
+  mSourceExtent.setMinimal();
+  bool found = false;
+  for ( int n = 0; n < mValid.size(); ++n )
+  {
+    if ( !mValid[n] )
+      continue;
+
+    if ( mSrcX[n] < mSourceExtent.xMinimum() )
+      mSourceExtent.setXMinimum( mSrcX[n] );
+    if ( mSrcX[n] > mSourceExtent.xMaximum() )
+      mSourceExtent.setXMaximum( mSrcX[n] );
+    if ( mSrcY[n] < mSourceExtent.yMinimum() )
+      mSourceExtent.setYMinimum( mSrcY[n] );
+    if ( mSrcY[n] > mSourceExtent.yMaximum() )
+      mSourceExtent.setYMaximum( mSrcY[n] );
+    found = true;
+  }
+
+  if ( !found )
+  {
+    mSourceExtent = QgsRectangle();
+  }
+}
+
+void QgsRasterProjector::warp( const QImage& srcImage, const QgsRectangle& srcExtent, QImage& destImage ) const
+{
+  destImage.fill( 0 );
+  if ( srcImage.isNull() || srcExtent.isEmpty() || mValid.isEmpty() )
+  {
+    return;
+  }
+
+  int nRows = mRowPositions.size();
+  int nCols = mColPositions.size();
+  int srcWidth = srcImage.width();
+  int srcHeight = srcImage.height();
+  double srcXRes = srcExtent.width() / srcWidth;
+  double srcYRes = srcExtent.height() / srcHeight;
+
+  //grid cell and weight of each destination column
+  QVector<int> cellCol( mDestCols );
+  QVector<double> weightCol( mDestCols );
+  int k = 0;
+  for ( int c = 0; c < mDestCols; ++c )
+  {
+    double pos = c + 0.5;
+    while ( k < nCols - 2 && mColPositions[k + 1] < pos )
+      ++k;
+    cellCol[c] = k;
+    weightCol[c] = ( pos - mColPositions[k] ) / ( mColPositions[k + 1] - mColPositions[k] );
+  }
+
+  //source coordinates of the grid columns interpolated to the current row
+  QVector<double> rowX( nCols ), rowY( nCols );
+  QVector<bool> rowValid( nCols ), rowAnyValid( nCols );
+
+  int cellRow = 0;
+  for ( int r = 0; r < mDestRows; ++r )
+  {
+    double pos = r + 0.5;
+    while ( cellRow < nRows - 2 && mRowPositions[cellRow + 1] < pos )
+      ++cellRow;
+    double v = ( pos - mRowPositions[cellRow] ) / ( mRowPositions[cellRow + 1] - mRowPositions[cellRow] );
+
+    for ( int j = 0; j < nCols; ++j )
+    {
+      int n = cellRow * nCols + j;
+      rowValid[j] = mValid[n] && mValid[n + nCols];
+      rowAnyValid[j] = mValid[n] || mValid[n + nCols];
+      rowX[j] = mSrcX[n] + v * ( mSrcX[n + nCols] - mSrcX[n] );
+      rowY[j] = mSrcY[n] + v * ( mSrcY[n + nCols] - mSrcY[n] );
+    }
+
+    QRgb* destLine = ( QRgb* ) destImage.scanLine( r );
+    for ( int c = 0; c < mDestCols; ++c )
+    {
+      int j = cellCol[c];
+      double x, y;
+      if ( rowValid[j] && rowValid[j + 1] )
+      {
+        double u = weightCol[c];
+        x = rowX[j] + u * ( rowX[j + 1] - rowX[j] );
+        y = rowY[j] + u * ( rowY[j + 1] - rowY[j] );
+      }
+      else if ( !( rowAnyValid[j] || rowAnyValid[j + 1] ) || !sourcePoint( pos, c + 0.5, x, y ) )
+      {
+        //cells at the border of the projection domain (which the grid limit kept from being split further)
+        //are transformed pixel by pixel, cells without any valid node are left transparent
+        continue;
+      }
+
+      int srcCol = ( int ) floor(( x - srcExtent.xMinimum() ) / srcXRes );
+      int srcRow = ( int ) floor(( srcExtent.yMaximum() - y ) / srcYRes );
+      if ( srcCol < 0 || srcRow < 0 || srcCol >= srcWidth || srcRow >= srcHeight )
+        continue;
+
+      destLine[c] = (( const QRgb* ) srcImage.scanLine( srcRow ) )[srcCol];
+    }
+  }
+}
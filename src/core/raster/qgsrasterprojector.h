@@ -0,0 +1,88 @@
+/***************************************************************************
+    qgsrasterprojector.h - warps raster images between coordinate systems
+    ----------------------
+    begin                : October 2010
+    copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERPROJECTOR_H
+#define QGSRASTERPROJECTOR_H
+
+#include <QVector>
+
+#include "qgsrectangle.h"
+
+class QImage;
+class QgsCoordinateTransform;
+
+/** \ingroup core
+ * Maps the pixels of a destination image to source coordinates.
+ * Only the nodes of a coarse grid over the destination image are transformed
+ * exactly, the source coordinates in between are interpolated bilinearly.
+ * Rows and columns are inserted into the grid until the interpolation error
+ * at the cell edge midpoints is below the given limit.
+ * @note added in 1.6
+ */
+class CORE_EXPORT QgsRasterProjector
+{
+  public:
+    /** Builds the approximation grid
+     * @param ct transformation from source to destination coordinates
+     * @param destExtent extent covered by the destination image
+     * @param destRows height of the destination image
+     * @param destCols width of the destination image
+     * @param maxError allowed error of interpolated source coordinates, in destination pixels
+     */
+    QgsRasterProjector( const QgsCoordinateTransform& ct, const QgsRectangle& destExtent,
+                        int destRows, int destCols, double maxError = 0.5 );
+
+    /** bounding box of the source coordinates of all grid nodes, empty if none could be transformed */
+    QgsRectangle sourceExtent() const { return mSourceExtent; }
+
+    /** number of exactly transformed points */
+    int gridRows() const { return mRowPositions.size(); }
+    int gridCols() const { return mColPositions.size(); }
+
+    /** Fills destImage (nearest neighbour) from srcImage, which covers srcExtent.
+     *  Pixels without source are transparent. destImage must have the
+     *  size given in the constructor and 32 bit format. */
+    void warp( const QImage& srcImage, const QgsRectangle& srcExtent, QImage& destImage ) const;
+
+  private:
+    const QgsCoordinateTransform& mCoordinateTransform;
+    QgsRectangle mDestExtent;
+    int mDestRows;
+    int mDestCols;
+    double mDestXRes;
+    double mDestYRes;
+
+    /** destination pixel coordinates of the grid rows and columns (ascending) */
+    QVector<double> mRowPositions;
+    QVector<double> mColPositions;
+
+    /** source coordinates of the grid nodes, row by row. Invalid nodes
+      (outside the domain of the projection) have mValid false */
+    QVector<double> mSrcX;
+    QVector<double> mSrcY;
+    QVector<bool> mValid;
+
+    QgsRectangle mSourceExtent;
+
+    /** transforms the destination pixel position exactly, false if outside of the projection domain */
+    bool sourcePoint( double row, double col, double& x, double& y ) const;
+    /** computes the grid nodes from the row and column positions */
+    void calculateGrid();
+    /** inserts rows and columns where the midpoints are off by more than maxError,
+      returns false if nothing was inserted */
+    bool refineGrid( double maxError );
+    void updateSourceExtent();
+};
+
+#endif // QGSRASTERPROJECTOR_H
@@ -0,0 +1,538 @@
+/***************************************************************************
+    qgsrtree.cpp  - pointer based in-memory R-tree
+    ----------------------
+    begin                : October 2010
+    copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrtree.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+namespace
+{
+  template <class T>
+  bool centerXLessThan( const T& t1, const T& t2 )
+  {
+    return t1.box.xMin + t1.box.xMax < t2.box.xMin + t2.box.xMax;
+  }
+
+  template <class T>
+  bool centerYLessThan( const T& t1, const T& t2 )
+  {
+    return t1.box.yMin + t1.box.yMax < t2.box.yMin + t2.box.yMax;
+  }
+
+  /** orders the entries for sort tile recursive packing: vertical slices sorted by x,
+    each slice sorted by y. Consecutive runs of nodeCapacity entries form the nodes */
+  template <class T>
+  void strOrder( QVector<T>& entries, int nodeCapacity )
+  {
+    int n = entries.size();
+    int nodeCount = ( n + nodeCapacity - 1 ) / nodeCapacity;
+    int sliceCount = ( int ) ceil( sqrt(( double ) nodeCount ) );
+    int sliceSize = (( nodeCount + sliceCount - 1 ) / sliceCount ) * nodeCapacity;
+
+    std::sort( entries.begin(), entries.end(), centerXLessThan<T> );
+    for ( int start = 0; start < n; start += sliceSize )
+    {
+      int end = qMin( start + sliceSize, n );
+      std::sort( entries.begin() + start, entries.begin() + end, centerYLessThan<T> );
+    }
+  }
+
+  double squaredDistance( const QgsRTree::Box& box, double x, double y )
+  {
+    double dx = 0.0;
+    double dy = 0.0;
+    if ( x < box.xMin )
+      dx = box.xMin - x;
+    else if ( x > box.xMax )
+      dx = x - box.xMax;
+    if ( y < box.yMin )
+      dy = box.yMin - y;
+    else if ( y > box.yMax )
+      dy = y - box.yMax;
+    return dx * dx + dy * dy;
+  }
+}
+
+void QgsRTree::Box::combine( const Box& b )
+{
+  xMin = qMin( xMin, b.xMin );
+  yMin = qMin( yMin, b.yMin );
+  xMax = qMax( xMax, b.xMax );
+  yMax = qMax( yMax, b.yMax );
+}
+
+QgsRTree::QgsRTree(): mRoot( createNode( 0 ) ), mSize( 0 )
+{
+}
+
+QgsRTree::~QgsRTree()
+{
+  deleteTree( mRoot );
+}
+
+QgsRTree::Node* QgsRTree::createNode( int level )
+{
+  Node* node = new Node;
+  node->level = level;
+  node->count = 0;
+  return node;
+}
+
+void QgsRTree::deleteTree( Node* node )
+{
+  if ( node->level > 0 )
+  {
+    for ( int i = 0; i < node->count; ++i )
+    {
+      deleteTree( node->entry[i].child );
+    }
+  }
+  delete node;
+}
+
+QgsRTree::Box QgsRTree::nodeBox( const Node* node )
+{
+  Box box = node->box[0];
+  for ( int i = 1; i < node->count; ++i )
+  {
+    box.combine( node->box[i] );
+  }
+  return box;
+}
+
+void QgsRTree::insert( int id, const Box& box )
+{
+  Node* sibling = insert( mRoot, box, id, 0, 0 );
+  if ( sibling )
+  {
+    //grow the tree at the root
+    Node* newRoot = createNode( mRoot->level + 1 );
+    newRoot->box[0] = nodeBox( mRoot );
+    newRoot->entry[0].child = mRoot;
+    newRoot->box[1] = nodeBox( sibling );
+    newRoot->entry[1].child = sibling;
+    newRoot->count = 2;
+    mRoot = newRoot;
+  }
+  ++mSize;
+}
+
+QgsRTree::Node* QgsRTree::insert( Node* node, const Box& box, int id, Node* child, int level )
+{
+  if ( node->level == level )
+  {
+    node->box[node->count] = box;
+    if ( level == 0 )
+      node->entry[node->count].id = id;
+    else
+      node->entry[node->count].child = child;
+    ++node->count;
+    return node->count > MaxEntries ? split( node ) : 0;
+  }
+
+  //choose the subtree which needs the least enlargement (ties: the smallest one)
+  int best = 0;
+  double bestEnlargement = 0.0;
+  double bestArea = 0.0;
+  for ( int i = 0; i < node->count; ++i )
+  {
+    Box combined = node->box[i];
+    combined.combine( box );
+    double area = node->box[i].area();
+    double enlargement = combined.area() - area;
+    if ( i == 0 || enlargement < bestEnlargement || ( enlargement == bestEnlargement && area < bestArea ) )
+    {
+      best = i;
+      bestEnlargement = enlargement;
+      bestArea = area;
+    }
+  }
+
+  Node* sibling = insert( node->entry[best].child, box, id, child, level );
+  if ( !sibling )
+  {
+    node->box[best].combine( box );
+    return 0;
+  }
+
+  node->box[best] = nodeBox( node->entry[best].child );
+  node->box[node->count] = nodeBox( sibling );
+  node->entry[node->count].child = sibling;
+  ++node->count;
+  return node->count > MaxEntries ? split( node ) : 0;
+}
+
+QgsRTree::Node* QgsRTree::split( Node* node )
+{
+  //only overflowing nodes are split
+  const int n = MaxEntries + 1;
+  Box boxes[MaxEntries + 1];
+  Node entries; //only used as storage for the entry union
+  for ( int i = 0; i < n; ++i )
+  {
+    boxes[i] = node->box[i];
+    entries.entry[i] = node->entry[i];
+  }
+
+  //pick the two entries which would waste most area in one node
+  int seed1 = 0;
+  int seed2 = 1;
+  double maxWaste = -1.0;
+  for ( int i = 0; i < n - 1; ++i )
+  {
+    for ( int j = i + 1; j < n; ++j )
+    {
+      Box combined = boxes[i];
+      combined.combine( boxes[j] );
+      double waste = combined.area() - boxes[i].area() - boxes[j].area();
+      if ( waste > maxWaste )
+      {
+        maxWaste = waste;
+        seed1 = i;
+        seed2 = j;
+      }
+    }
+  }
+
+  Node* sibling = createNode( node->level );
+  node->count = 0;
+
+  bool assigned[MaxEntries + 1];
+  for ( int i = 0; i < n; ++i )
+    assigned[i] = false;
+
+  node->box[0] = boxes[seed1];
+  node->entry[0] = entries.entry[seed1];
+  node->count = 1;
+  Box box1 = boxes[seed1];
+  assigned[seed1] = true;
+
+  sibling->box[0] = boxes[seed2];
+  sibling->entry[0] = entries.entry[seed2];
+  sibling->count = 1;
+  Box box2 = boxes[seed2];
+  assigned[seed2] = true;
+
+  int remaining = n - 2;
+  while ( remaining > 0 )
+  {
+    //one group needs all the rest to reach the minimum fill
+    Node* target = 0;
+    if ( node->count + remaining <= MinEntries )
+      target = node;
+    else if ( sibling->count + remaining <= MinEntries )
+      target = sibling;
+
+    if ( target )
+    {
+      for ( int i = 0; i < n; ++i )
+      {
+        if ( assigned[i] )
+          continue;
+        target->box[target->count] = boxes[i];
+        target->entry[target->count] = entries.entry[i];
+        ++target->count;
+        ( target == node ? box1 : box2 ).combine( boxes[i] );
+        assigned[i] = true;
+      }
+      break;
+    }
+
+    //pick the entry with the strongest preference for one group
+    int next = -1;
+    double maxDifference = -1.0;
+    double nextD1 = 0.0;
+    double nextD2 = 0.0;
+    for ( int i = 0; i < n; ++i )
+    {
+      if ( assigned[i] )
+        continue;
+      Box c1 = box1;
+      c1.combine( boxes[i] );
+      Box c2 = box2;
+      c2.combine( boxes[i] );
+      double d1 = c1.area() - box1.area();
+      double d2 = c2.area() - box2.area();
+      double difference = qAbs( d1 - d2 );
+      if ( difference > maxDifference )
+      {
+        maxDifference = difference;
+        next = i;
+        nextD1 = d1;
+        nextD2 = d2;
+      }
+    }
+
+    bool toFirst;
+    if ( nextD1 != nextD2 )
+      toFirst = nextD1 < nextD2;
+    else if ( box1.area() != box2.area() )
+      toFirst = box1.area() < box2.area();
+    else
+      toFirst = node->count <= sibling->count;
+
+    Node* group = toFirst ? node : sibling;
+    group->box[group->count] = boxes[next];
+    group->entry[group->count] = entries.entry[next];
+    ++group->count;
+    ( toFirst ? box1 : box2 ).combine( boxes[next] );
+    assigned[next] = true;
+    --remaining;
+  }
+
+  return sibling;
+}
+
+bool QgsRTree::remove( int id, const Box& box )
+{
+  QVector<Item> orphans;
+  if ( !remove( mRoot, box, id, orphans ) )
+    return false;
+
+  --mSize;
+
+  //shorten the tree
+  while ( mRoot->level > 0 && mRoot->count == 1 )
+  {
+    Node* oldRoot = mRoot;
+    mRoot = mRoot->entry[0].child;
+    delete oldRoot;
+  }
+  if ( mRoot->level > 0 && mRoot->count == 0 )
+  {
+    delete mRoot;
+    mRoot = createNode( 0 );
+  }
+
+  //the items of underfull nodes are inserted again
+  mSize -= orphans.size();
+  for ( int i = 0; i < orphans.size(); ++i )
+  {
+    insert( orphans[i].id, orphans[i].box );
+  }
+  return true;
+}
+
+bool QgsRTree::remove( Node* node, const Box& box, int id, QVector<Item>& orphans )
+{
+  if ( node->level == 0 )
+  {
+    for ( int i = 0; i < node->count; ++i )
+    {
+      if ( node->entry[i].id == id )
+      {
+        --node->count;
+        node->box[i] = node->box[node->count];
+        node->entry[i] = node->entry[node->count];
+        return true;
+      }
+    }
+    return false;
+  }
+
+  for ( int i = 0; i < node->count; ++i )
+  {
+    if ( !node->box[i].contains( box ) )
+      continue;
+
+    Node* child = node->entry[i].child;
+    if ( !remove( child, box, id, orphans ) )
+      continue;
+
+    if ( child->count < MinEntries )
+    {
+      collectItems( child, orphans );
+      deleteTree( child );
+      --node->count;
+      node->box[i] = node->box[node->count];
+      node->entry[i] = node->entry[node->count];
+    }
+    else
+    {
+      node->box[i] = nodeBox( child );
+    }
+    return true;
+  }
+  return false;
+}
+
+void QgsRTree::collectItems( const Node* node, QVector<Item>& items )
+{
+  for ( int i = 0; i < node->count; ++i )
+  {
+    if ( node->level == 0 )
+    {
+      Item item;
+      item.box = node->box[i];
+      item.id = node->entry[i].id;
+      items.push_back( item );
+    }
+    else
+    {
+      collectItems( node->entry[i].child, items );
+    }
+  }
+}
+
+void QgsRTree::bulkLoad( QVector<Item>& items )
+{
+  deleteTree( mRoot );
+  mRoot = createNode( 0 );
+  mSize = items.size();
+  if ( items.isEmpty() )
+    return;
+
+  //leaf level
+  strOrder( items, MaxEntries );
+  QVector<NodeItem> nodes;
+  nodes.reserve(( items.size() + MaxEntries - 1 ) / MaxEntries );
+  for ( int start = 0; start < items.size(); start += MaxEntries )
+  {
+    Node* leaf = createNode( 0 );
+    int end = qMin( start + MaxEntries, items.size() );
+    for ( int i = start; i < end; ++i )
+    {
+      leaf->box[leaf->count] = items[i].box;
+      leaf->entry[leaf->count].id = items[i].id;
+      ++leaf->count;
+    }
+    NodeItem nodeItem;
+    nodeItem.box = nodeBox( leaf );
+    nodeItem.node = leaf;
+    nodes.push_back( nodeItem );
+  }
+
+  //upper levels
+  int level = 1;
+  while ( nodes.size() > 1 )
+  {
+    strOrder( nodes, MaxEntries );
+    QVector<NodeItem> parents;
+    parents.reserve(( nodes.size() + MaxEntries - 1 ) / MaxEntries );
+    for ( int start = 0; start < nodes.size(); start += MaxEntries )
+    {
+      Node* parent = createNode( level );
+      int end = qMin( start + MaxEntries, nodes.size() );
+      for ( int i = start; i < end; ++i )
+      {
+        parent->box[parent->count] = nodes[i].box;
+        parent->entry[parent->count].child = nodes[i].node;
+        ++parent->count;
+      }
+      NodeItem nodeItem;
+      nodeItem.box = nodeBox( parent );
+      nodeItem.node = parent;
+      parents.push_back( nodeItem );
+    }
+    nodes = parents;
+    ++level;
+  }
+
+  delete mRoot;
+  mRoot = nodes[0].node;
+}
+
+void QgsRTree::intersects( const Box& box, QList<int>& result ) const
+{
+  QVarLengthArray<const Node*, 64> stack;
+  stack.append( mRoot );
+  while ( !stack.isEmpty() )
+  {
+    const Node* node = stack[stack.size() - 1];
+    stack.removeLast();
+    if ( node->level == 0 )
+    {
+      for ( int i = 0; i < node->count; ++i )
+      {
+        if ( node->box[i].intersects( box ) )
+          result.append( node->entry[i].id );
+      }
+    }
+    else
+    {
+      for ( int i = 0; i < node->count; ++i )
+      {
+        if ( node->box[i].intersects( box ) )
+          stack.append( node->entry[i].child );
+      }
+    }
+  }
+}
+
+namespace
+{
+  /** queue entry of the nearest neighbor search, either a node or an item id */
+  struct QgsRTreeQueueEntry
+  {
+    double distance;
+    const void* node;
+    int id;
+
+    bool operator<( const QgsRTreeQueueEntry& other ) const
+    {
+      //std::priority_queue returns the largest element first
+      return distance > other.distance;
+    }
+  };
+}
+
+void QgsRTree::nearestNeighbor( double x, double y, int k, QList<int>& result ) const
+{
+  if ( k < 1 || mSize < 1 )
+    return;
+
+  //best first search
+  std::priority_queue<QgsRTreeQueueEntry> queue;
+  QgsRTreeQueueEntry rootEntry;
+  rootEntry.distance = 0.0;
+  rootEntry.node = mRoot;
+  rootEntry.id = -1;
+  queue.push( rootEntry );
+
+  int found = 0;
+  while ( !queue.empty() && found < k )
+  {
+    QgsRTreeQueueEntry current = queue.top();
+    queue.pop();
+    if ( !current.node )
+    {
+      result.append( current.id );
+      ++found;
+      continue;
+    }
+
+    const Node* node = static_cast<const Node*>( current.node );
+    for ( int i = 0; i < node->count; ++i )
+    {
+      QgsRTreeQueueEntry e;
+      e.distance = squaredDistance( node->box[i], x, y );
+      if ( node->level == 0 )
+      {
+        e.node = 0;
+        e.id = node->entry[i].id;
+      }
+      else
+      {
+        e.node = node->entry[i].child;
+        e.id = -1;
+      }
+      queue.push( e );
+    }
+  }
+}
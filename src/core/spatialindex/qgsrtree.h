@@ -0,0 +1,125 @@
+/***************************************************************************
+    qgsrtree.h  - pointer based in-memory R-tree
+    ----------------------
+    begin                : October 2010
+    copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRTREE_H
+#define QGSRTREE_H
+
+#include <QList>
+#include <QVector>
+
+/** \ingroup core
+ * R-tree (quadratic split) whose nodes are kept as plain structs linked by pointers.
+ * In contrast to the trees of the spatial index library nothing is serialized,
+ * so queries only touch the node memory. Used as a backend of QgsSpatialIndex.
+ * @note added in 1.6
+ */
+class QgsRTree
+{
+  public:
+
+    /** axis aligned bounding box */
+    struct Box
+    {
+      double xMin, yMin, xMax, yMax;
+
+      bool intersects( const Box& b ) const
+      {
+        return xMin <= b.xMax && b.xMin <= xMax && yMin <= b.yMax && b.yMin <= yMax;
+      }
+      bool contains( const Box& b ) const
+      {
+        return xMin <= b.xMin && yMin <= b.yMin && b.xMax <= xMax && b.yMax <= yMax;
+      }
+      double area() const { return ( xMax - xMin ) * ( yMax - yMin ); }
+      void combine( const Box& b );
+    };
+
+    /** data entry (feature id and its bounding box) */
+    struct Item
+    {
+      Box box;
+      int id;
+    };
+
+    QgsRTree();
+    ~QgsRTree();
+
+    /** adds an item */
+    void insert( int id, const Box& box );
+
+    /** removes the item with the given id. The box has to be the one used for insertion
+      @return false if the item was not found */
+    bool remove( int id, const Box& box );
+
+    /** replaces the content of the tree with the items, which are packed with
+      sort tile recursive (STR) loading. The order of items is changed */
+    void bulkLoad( QVector<Item>& items );
+
+    /** appends the ids of the items intersecting box */
+    void intersects( const Box& box, QList<int>& result ) const;
+
+    /** appends the ids of the k items closest to the point (by bounding box distance) */
+    void nearestNeighbor( double x, double y, int k, QList<int>& result ) const;
+
+    /** number of items in the tree */
+    int size() const { return mSize; }
+
+  private:
+
+    enum
+    {
+      MaxEntries = 16,
+      MinEntries = 6
+    };
+
+    struct Node
+    {
+      /** 0 for leaves */
+      int level;
+      int count;
+      /** one additional slot for the overflow before a split */
+      Box box[MaxEntries + 1];
+      union
+      {
+        Node* child;
+        int id;
+      } entry[MaxEntries + 1];
+    };
+
+    Node* mRoot;
+    int mSize;
+
+    static Node* createNode( int level );
+    static void deleteTree( Node* node );
+    static Box nodeBox( const Node* node );
+
+    /** inserts an entry at the node level and returns the new sibling if the node had to be split */
+    Node* insert( Node* node, const Box& box, int id, Node* child, int level );
+    /** quadratic split, moves part of the entries to a new node */
+    Node* split( Node* node );
+    bool remove( Node* node, const Box& box, int id, QVector<Item>& orphans );
+    static void collectItems( const Node* node, QVector<Item>& items );
+
+    /** node with its bounding box, used for bulk loading the upper levels */
+    struct NodeItem
+    {
+      Box box;
+      Node* node;
+    };
+
+    QgsRTree( const QgsRTree& );
+    QgsRTree& operator=( const QgsRTree& );
+};
+
+#endif // QGSRTREE_H
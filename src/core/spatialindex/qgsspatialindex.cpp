@@ -20,9 +20,14 @@
 #include "qgsfeature.h"
 #include "qgsrectangle.h"
 #include "qgslogger.h"
+#include "qgsvectordataprovider.h"
+#include "qgsrtree.h"
 
 #include "SpatialIndex.h"
 
+#include <QFile>
+#include <QFileInfo>
+
 using namespace SpatialIndex;
 
 
@@ -47,8 +52,76 @@ class QgisVisitor : public SpatialIndex::IVisitor
 };
 
 
-QgsSpatialIndex::QgsSpatialIndex()
+static QgsRTree::Box regionToBox( const Tools::Geometry::Region& r )
+{
+  QgsRTree::Box box;
+  box.xMin = r.m_pLow[0];
+  box.yMin = r.m_pLow[1];
+  box.xMax = r.m_pHigh[0];
+  box.yMax = r.m_pHigh[1];
+  return box;
+}
+
+
+// data stream for bulk loading which reads the features of a provider
+class QgsFeatureDataStream : public SpatialIndex::IDataStream
+{
+  public:
+    QgsFeatureDataStream( QgsVectorDataProvider* provider )
+        : mProvider( provider ), mNextData( 0 )
+    {
+      readNextEntry();
+    }
+
+    ~QgsFeatureDataStream()
+    {
+      delete mNextData;
+    }
+
+    IData* getNext()
+    {
+      RTree::Data* current = mNextData;
+      mNextData = 0;
+      readNextEntry();
+      return current;
+    }
+
+    bool hasNext() { return mNextData != 0; }
+
+    unsigned long size() { throw Tools::NotSupportedException( "QgsFeatureDataStream::size: operation not supported." ); }
+
+    void rewind() { throw Tools::NotSupportedException( "QgsFeatureDataStream::rewind: operation not supported." ); }
+
+  protected:
+    void readNextEntry()
+    {
+      QgsFeature f;
+      Tools::Geometry::Region r;
+      long id;
+      while ( mProvider->nextFeature( f ) )
+      {
+        if ( !QgsSpatialIndex::featureInfo( f, r, id ) )
+          continue;
+
+        mNextData = new RTree::Data( 0, 0, r, id );
+        return;
+      }
+    }
+
+  private:
+    QgsVectorDataProvider* mProvider;
+    RTree::Data* mNextData;
+};
+
+
+QgsSpatialIndex::QgsSpatialIndex( Backend backend ): mStorageManager( 0 ), mStorage( 0 ), mRTree( 0 ), mPointerTree( 0 )
 {
+  if ( backend == PointerTreeBackend )
+  {
+    mPointerTree = new QgsRTree();
+    return;
+  }
+
   // for now only memory manager
   mStorageManager = StorageManager::createNewMemoryStorageManager();
 
@@ -58,6 +131,50 @@ QgsSpatialIndex::QgsSpatialIndex()
   bool writeThrough = false;
   mStorage = StorageManager::createNewRandomEvictionsBuffer( *mStorageManager, capacity, writeThrough );
 
+  long indexId;
+  mRTree = createTree( *mStorage, 0, indexId );
+}
+
+QgsSpatialIndex::QgsSpatialIndex( QgsVectorDataProvider* provider, Backend backend )
+    : mStorageManager( 0 ), mStorage( 0 ), mRTree( 0 ), mPointerTree( 0 )
+{
+  if ( backend == PointerTreeBackend )
+  {
+    QVector<QgsRTree::Item> items;
+    QgsFeature f;
+    Tools::Geometry::Region r;
+    long id;
+    while ( provider && provider->nextFeature( f ) )
+    {
+      if ( !featureInfo( f, r, id ) )
+        continue;
+      QgsRTree::Item item;
+      item.box = regionToBox( r );
+      item.id = id;
+      items.push_back( item );
+    }
+    mPointerTree = new QgsRTree();
+    mPointerTree->bulkLoad( items );
+    return;
+  }
+
+  mStorageManager = StorageManager::createNewMemoryStorageManager();
+
+  unsigned int capacity = 10;
+  bool writeThrough = false;
+  mStorage = StorageManager::createNewRandomEvictionsBuffer( *mStorageManager, capacity, writeThrough );
+
+  long indexId;
+  mRTree = createTree( *mStorage, provider, indexId );
+}
+
+QgsSpatialIndex::QgsSpatialIndex( IStorageManager* storageManager, StorageManager::IBuffer* storage, ISpatialIndex* rTree )
+    : mStorageManager( storageManager ), mStorage( storage ), mRTree( rTree ), mPointerTree( 0 )
+{
+}
+
+ISpatialIndex* QgsSpatialIndex::createTree( StorageManager::IBuffer& storage, QgsVectorDataProvider* provider, long& indexId )
+{
   // R-Tree parameters
   double fillFactor = 0.7;
   unsigned long indexCapacity = 10;
@@ -65,14 +182,130 @@ QgsSpatialIndex::QgsSpatialIndex()
   unsigned long dimension = 2;
   RTree::RTreeVariant variant = RTree::RV_RSTAR;
 
+  if ( provider )
+  {
+    QgsFeatureDataStream stream( provider );
+    // the bulk loader cannot handle empty input
+    if ( stream.hasNext() )
+    {
+      return RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, stream, storage, fillFactor, indexCapacity,
+             leafCapacity, dimension, variant, indexId );
+    }
+  }
+
   // create R-tree
-  long indexId;
-  mRTree = RTree::createNewRTree( *mStorage, fillFactor, indexCapacity,
-                                  leafCapacity, dimension, variant, indexId );
+  return RTree::createNewRTree( storage, fillFactor, indexCapacity,
+                                leafCapacity, dimension, variant, indexId );
+}
+
+QgsSpatialIndex* QgsSpatialIndex::createDiskIndex( const QString& baseName, QgsVectorDataProvider* provider )
+{
+  if ( !provider )
+    return 0;
+
+  std::string fileName = QFile::encodeName( baseName ).data();
+  IStorageManager* storageManager = 0;
+  StorageManager::IBuffer* storage = 0;
+  ISpatialIndex* rTree = 0;
+  long indexId = 0;
+  bool ok = false;
+  try
+  {
+    unsigned long pageSize = 4096;
+    storageManager = StorageManager::createNewDiskStorageManager( fileName, pageSize );
+    storage = StorageManager::createNewRandomEvictionsBuffer( *storageManager, 10, false );
+    rTree = createTree( *storage, provider, indexId );
+    ok = true;
+  }
+  catch ( Tools::Exception &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "Tools::Exception caught: %1" ).arg( e.what().c_str() ) );
+  }
+  catch ( ... )
+  {
+    QgsDebugMsg( "unknown spatial index exception caught" );
+  }
+
+  // write everything to disk before the files are used, so that an interrupted
+  // session does not leave a partially written index behind
+  delete rTree;
+  delete storage;
+  delete storageManager;
+
+  // the library chooses the page of the index header, loadDiskIndex needs to know it
+  if ( ok )
+  {
+    QFile headerFile( baseName + ".hdr" );
+    ok = headerFile.open( QIODevice::WriteOnly | QIODevice::Truncate )
+         && headerFile.write( QByteArray::number( qlonglong( indexId ) ) ) > 0;
+  }
+  if ( !ok )
+  {
+    removeDiskIndex( baseName );
+    return 0;
+  }
+  return loadDiskIndex( baseName );
+}
+
+QgsSpatialIndex* QgsSpatialIndex::loadDiskIndex( const QString& baseName )
+{
+  if ( !QFile::exists( baseName + ".idx" ) || !QFile::exists( baseName + ".dat" ) )
+    return 0;
+
+  QFile headerFile( baseName + ".hdr" );
+  if ( !headerFile.open( QIODevice::ReadOnly ) )
+    return 0;
+  bool idOk;
+  long indexId = headerFile.readAll().trimmed().toLong( &idOk );
+  if ( !idOk )
+    return 0;
+
+  std::string fileName = QFile::encodeName( baseName ).data();
+  IStorageManager* storageManager = 0;
+  StorageManager::IBuffer* storage = 0;
+  try
+  {
+    storageManager = StorageManager::loadDiskStorageManager( fileName );
+    storage = StorageManager::createNewRandomEvictionsBuffer( *storageManager, 10, false );
+    ISpatialIndex* rTree = RTree::loadRTree( *storage, indexId );
+    return new QgsSpatialIndex( storageManager, storage, rTree );
+  }
+  catch ( Tools::Exception &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "Tools::Exception caught: %1" ).arg( e.what().c_str() ) );
+  }
+  catch ( ... )
+  {
+    QgsDebugMsg( "unknown spatial index exception caught" );
+  }
+  delete storage;
+  delete storageManager;
+  return 0;
+}
+
+bool QgsSpatialIndex::diskIndexUpToDate( const QString& baseName, const QString& dataFile )
+{
+  QFileInfo indexInfo( baseName + ".idx" );
+  QFileInfo dataInfo( baseName + ".dat" );
+  QFileInfo sourceInfo( dataFile );
+  if ( !indexInfo.exists() || !dataInfo.exists() || !QFile::exists( baseName + ".hdr" ) )
+    return false;
+
+  return indexInfo.lastModified() >= sourceInfo.lastModified() && dataInfo.lastModified() >= sourceInfo.lastModified();
+}
+
+void QgsSpatialIndex::removeDiskIndex( const QString& baseName )
+{
+  QFile::remove( baseName + ".idx" );
+  QFile::remove( baseName + ".dat" );
+  QFile::remove( baseName + ".hdr" );
 }
 
 QgsSpatialIndex:: ~QgsSpatialIndex()
 {
+  delete mPointerTree;
   delete mRTree;
   delete mStorage;
   delete mStorageManager;
@@ -106,6 +339,12 @@ bool QgsSpatialIndex::insertFeature( QgsFeature& f )
   if ( !featureInfo( f, r, id ) )
     return false;
 
+  if ( mPointerTree )
+  {
+    mPointerTree->insert( id, regionToBox( r ) );
+    return true;
+  }
+
   // TODO: handle possible exceptions correctly
   try
   {
@@ -136,6 +375,9 @@ bool QgsSpatialIndex::deleteFeature( QgsFeature& f )
   if ( !featureInfo( f, r, id ) )
     return false;
 
+  if ( mPointerTree )
+    return mPointerTree->remove( id, regionToBox( r ) );
+
   // TODO: handle exceptions
   return mRTree->deleteData( r, id );
 }
@@ -143,6 +385,18 @@ bool QgsSpatialIndex::deleteFeature( QgsFeature& f )
 QList<int> QgsSpatialIndex::intersects( QgsRectangle rect )
 {
   QList<int> list;
+
+  if ( mPointerTree )
+  {
+    QgsRTree::Box box;
+    box.xMin = rect.xMinimum();
+    box.yMin = rect.yMinimum();
+    box.xMax = rect.xMaximum();
+    box.yMax = rect.yMaximum();
+    mPointerTree->intersects( box, list );
+    return list;
+  }
+
   QgisVisitor visitor( list );
 
   Tools::Geometry::Region r = rectToRegion( rect );
@@ -155,6 +409,13 @@ QList<int> QgsSpatialIndex::intersects( QgsRectangle rect )
 QList<int> QgsSpatialIndex::nearestNeighbor( QgsPoint point, int neighbors )
 {
   QList<int> list;
+
+  if ( mPointerTree )
+  {
+    mPointerTree->nearestNeighbor( point.x(), point.y(), neighbors, list );
+    return list;
+  }
+
   QgisVisitor visitor( list );
 
   double pt[2];
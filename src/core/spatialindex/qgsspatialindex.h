@@ -40,23 +40,57 @@ namespace Tools
 class QgsFeature;
 class QgsRectangle;
 class QgsPoint;
+class QgsVectorDataProvider;
+class QgsRTree;
 #include <QList>
+#include <QString>
 
 class CORE_EXPORT QgsSpatialIndex
 {
+    friend class QgsFeatureDataStream;
 
   public:
 
+    /** R-tree implementations which can be used for an index in memory
+      @note added in 1.6 */
+    enum Backend
+    {
+      /** R*-tree of the spatial index library. Nodes are serialized into the pages of a storage manager */
+      StorageManagerBackend,
+      /** R-tree with nodes linked by pointers (QgsRTree). Faster for small interactive queries */
+      PointerTreeBackend
+    };
+
     /* creation of spatial index */
 
-    /** create new spatial index that will be stored in memory */
-    //static QgsSpatialIndex* createMemoryIndex();
+    /** create new spatial index that stores its data on disk. The R-tree is bulk loaded (STR packing)
+      with the features returned by the provider after a call to select(). The index is written to
+      baseName.idx and baseName.dat, the identifier of the index header to baseName.hdr
+      @return the index or 0 in case of error
+      @note added in 1.6 */
+    static QgsSpatialIndex* createDiskIndex( const QString& baseName, QgsVectorDataProvider* provider );
+
+    /** load a spatial index previously written with createDiskIndex
+      @return the index or 0 if the files do not exist or cannot be read
+      @note added in 1.6 */
+    static QgsSpatialIndex* loadDiskIndex( const QString& baseName );
+
+    /** returns true if the disk index files exist and are newer than dataFile
+      @note added in 1.6 */
+    static bool diskIndexUpToDate( const QString& baseName, const QString& dataFile );
+
+    /** removes the disk index files
+      @note added in 1.6 */
+    static void removeDiskIndex( const QString& baseName );
 
-    /** create new spatial index that stores its data on disk */
-    //static QgsSpatialIndex* createDiskIndex(QString fileName);
+    /** constructor - creates R-tree. The backend parameter has been added in 1.6 */
+    explicit QgsSpatialIndex( Backend backend = StorageManagerBackend );
 
-    /** constructor - creates R-tree */
-    QgsSpatialIndex();
+    /** constructor - creates R-tree in memory and bulk loads it (STR packing) with the features
+      returned by the provider after a call to select(). Features without geometry are skipped.
+      This is much faster than inserting the features one by one and gives a better packed tree
+      @note added in 1.6 */
+    explicit QgsSpatialIndex( QgsVectorDataProvider* provider, Backend backend = StorageManagerBackend );
 
     /** destructor finalizes work with spatial index */
     ~QgsSpatialIndex();
@@ -82,13 +116,22 @@ class CORE_EXPORT QgsSpatialIndex
 
   protected:
 
-    Tools::Geometry::Region rectToRegion( QgsRectangle rect );
+    static Tools::Geometry::Region rectToRegion( QgsRectangle rect );
 
-    bool featureInfo( QgsFeature& f, Tools::Geometry::Region& r, long& id );
+    static bool featureInfo( QgsFeature& f, Tools::Geometry::Region& r, long& id );
 
 
   private:
 
+    /** constructor for an index which has already been set up. Takes ownership of the objects */
+    QgsSpatialIndex( SpatialIndex::IStorageManager* storageManager, SpatialIndex::StorageManager::IBuffer* storage,
+                     SpatialIndex::ISpatialIndex* rTree );
+
+    /** creates the R-tree on top of storage. If provider is not 0, the tree is bulk loaded with its features.
+      The identifier of the index header (needed to load the tree from storage) is returned in indexId.
+      Throws the exceptions of the spatial index library */
+    static SpatialIndex::ISpatialIndex* createTree( SpatialIndex::StorageManager::IBuffer& storage, QgsVectorDataProvider* provider, long& indexId );
+
     /** storage manager */
     SpatialIndex::IStorageManager* mStorageManager;
 
@@ -98,6 +141,9 @@ class CORE_EXPORT QgsSpatialIndex
     /** R-tree containing spatial index */
     SpatialIndex::ISpatialIndex* mRTree;
 
+    /** pointer based tree, used instead of mRTree with PointerTreeBackend */
+    QgsRTree* mPointerTree;
+
 };
 
 #endif
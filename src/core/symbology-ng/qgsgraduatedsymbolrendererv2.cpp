@@ -308,44 +308,6 @@ static QList<double> _calcEqualIntervalBreaks( double minimum, double maximum, i
   return breaks;
 }
 
-static QList<double> _calcQuantileBreaks( QList<double> values, int classes )
-{
-
-  // q-th quantile of a data set:
-  // value where q fraction of data is below and (1-q) fraction is above this value
-  // Xq = (1 - r) * X_NI1 + r * X_NI2
-  //   NI1 = (int) (q * (n+1))
-  //   NI2 = NI1 + 1
-  //   r = q * (n+1) - (int) (q * (n+1))
-  // (indices of X: 1...n)
-
-  // sort the values first
-  qSort( values );
-
-  QList<double> breaks;
-
-  int n = values.count();
-  double Xq = n > 0 ? values[0] : 0.0;
-
-  for ( int i = 1; i < classes; i++ )
-  {
-    if ( n > 1 )
-    {
-      double q = i  / ( double ) classes;
-      double a = q * ( n - 1 );
-      int aa = ( int )( a );
-
-      double r = a - aa;
-      Xq = ( 1 - r ) * values[aa] + r * values[aa+1];
-    }
-    breaks.append( Xq );
-  }
-
-  breaks.append( values[ n-1 ] );
-
-  return breaks;
-}
-
 static QList<double> _calcPrettyBreaks( double minimum, double maximum, int classes )
 {
 
@@ -702,7 +664,12 @@ QgsGraduatedSymbolRendererV2* QgsGraduatedSymbolRendererV2::createRenderer(
   {
     breaks = _calcPrettyBreaks( minimum, maximum, classes );
   }
-  else if ( mode == Quantile || mode == Jenks || mode == StdDev )
+  else if ( mode == Quantile )
+  {
+    // the provider can calculate the breaks without fetching all values
+    breaks = provider->quantiles( attrNum, classes );
+  }
+  else if ( mode == Jenks || mode == StdDev )
   {
     // get values from layer
     QList<double> values;
@@ -713,11 +680,7 @@ QgsGraduatedSymbolRendererV2* QgsGraduatedSymbolRendererV2::createRenderer(
     while ( provider->nextFeature( f ) )
       values.append( f.attributeMap()[attrNum].toDouble() );
     // calculate the breaks
-    if ( mode == Quantile )
-    {
-      breaks = _calcQuantileBreaks( values, classes );
-    }
-    else if ( mode == Jenks )
+    if ( mode == Jenks )
     {
       breaks = _calcJenksBreaks( values, classes, minimum, maximum );
     }
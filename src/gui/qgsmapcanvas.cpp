@@ -104,6 +104,9 @@ QgsMapCanvas::QgsMapCanvas( QWidget * parent, const char *name )
   setFocusPolicy( Qt::StrongFocus );
 
   mMapRenderer = new QgsMapRenderer;
+  // selections are drawn on their own image (see QgsMapCanvasMap::renderSelection), so that
+  // selection changes don't require rendering the layers again
+  mMapRenderer->rendererContext()->setDrawSelection( false );
 
   // create map canvas item which will show the map
   mMap = new QgsMapCanvasMap( this );
@@ -415,6 +418,7 @@ void QgsMapCanvas::saveAsImage( QString theFileName, QPixmap * theQPixmap, QStri
     QPainter painter;
     painter.begin( theQPixmap );
     mMapRenderer->render( &painter );
+    mMapRenderer->renderSelection( &painter );
     emit renderComplete( &painter );
     painter.end();
 
@@ -422,7 +426,11 @@ void QgsMapCanvas::saveAsImage( QString theFileName, QPixmap * theQPixmap, QStri
   }
   else //use the map view
   {
-    mMap->pixmap().save( theFileName, theFormat.toLocal8Bit().data() );
+    QPixmap pixmap = mMap->pixmap();
+    QPainter painter( &pixmap );
+    painter.drawImage( 0, 0, mMap->selectionImage() );
+    painter.end();
+    pixmap.save( theFileName, theFormat.toLocal8Bit().data() );
   }
   //create a world file to go with the image...
   QgsRectangle myRect = mMapRenderer->extent();
@@ -1450,5 +1458,11 @@ void QgsMapCanvas::selectionChangedSlot()
   // Find out which layer it was that sent the signal.
   QgsMapLayer *layer = qobject_cast<QgsMapLayer *>( sender() );
   emit selectionChanged( layer );
-  refresh();
+
+  // only the selection image is updated. If the map is being
+  // rendered, the selection is drawn at the end anyway
+  if ( !mDrawing && mRenderFlag && !mFrozen )
+  {
+    mMap->renderSelection();
+  }
 }
@@ -34,6 +34,7 @@ void QgsMapCanvasMap::paint( QPainter* p, const QStyleOptionGraphicsItem*, QWidg
 {
   //refreshes the canvas map with the current offscreen image
   p->drawPixmap( 0, 0, mPixmap );
+  p->drawImage( 0, 0, mSelectionImage );
 }
 
 QRectF QgsMapCanvasMap::boundingRect() const
@@ -49,6 +50,8 @@ void QgsMapCanvasMap::resize( QSize size )
   mPixmap = QPixmap( size );
   mPixmap.fill( mBgColor.rgb() );
   mImage = QImage( size, QImage::Format_RGB32 ); // temporary image - build it here so it is available when switching from QPixmap to QImage rendering
+  mSelectionImage = QImage( size, QImage::Format_ARGB32_Premultiplied );
+  mSelectionImage.fill( 0 );
   mCanvas->mapRenderer()->setOutputSize( size, mPixmap.logicalDpiX() );
 }
 
@@ -60,6 +63,9 @@ void QgsMapCanvasMap::setPanningOffset( const QPoint& point )
 
 void QgsMapCanvasMap::render()
 {
+  // the old selection doesn't fit the new map (e.g. after zooming)
+  mSelectionImage.fill( 0 );
+
   // Rendering to a QImage gives incorrectly filled polygons in some
   // cases (as at Qt4.1.4), but it is the only renderer that supports
   // anti-aliasing, so we provide the means to swap between QImage and
@@ -101,6 +107,23 @@ void QgsMapCanvasMap::render()
     mCanvas->mapRenderer()->render( &paint );
     paint.end();
   }
+
+  renderSelection();
+}
+
+void QgsMapCanvasMap::renderSelection()
+{
+  mSelectionImage.fill( 0 );
+
+  QPainter paint;
+  paint.begin( &mSelectionImage );
+  paint.setClipRect( mSelectionImage.rect() );
+  if ( mAntiAliasing )
+    paint.setRenderHint( QPainter::Antialiasing );
+
+  mCanvas->mapRenderer()->renderSelection( &paint );
+
+  paint.end();
   update();
 }
 
@@ -44,6 +44,15 @@ class GUI_EXPORT QgsMapCanvasMap : public QGraphicsRectItem
     //! renders map using QgsMapRenderer to mPixmap
     void render();
 
+    //! renders the selected features to the selection image, which is drawn on top of mPixmap.
+    //! Called after render() and whenever only the selection has changed
+    //! @note added in 1.6
+    void renderSelection();
+
+    //! transparent image with the selected features
+    //! @note added in 1.6
+    const QImage& selectionImage() const { return mSelectionImage; }
+
     void setBackgroundColor( const QColor& color ) { mBgColor = color; }
 
     void setPanningOffset( const QPoint& point );
@@ -73,6 +82,9 @@ class GUI_EXPORT QgsMapCanvasMap : public QGraphicsRectItem
     QPixmap mPixmap;
     QImage mImage;
 
+    //! selection overlay, the map itself is rendered without selection
+    QImage mSelectionImage;
+
     //QgsMapRenderer* mRender;
     QgsMapCanvas* mCanvas;
 
@@ -23,6 +23,7 @@ map service syntax for SOAP/HTTP POST
 #include "qgssoaprequesthandler.h"
 #include "qgsproviderregistry.h"
 #include "qgsmapserverlogger.h"
+#include "qgsmstilecache.h"
 #include "qgswmsserver.h"
 #include "qgsmaprenderer.h"
 #include "qgsmapserviceexception.h"
@@ -32,12 +33,25 @@ map service syntax for SOAP/HTTP POST
 #include <QImage>
 #include <QSettings>
 #include <QDateTime>
+#include <QVector>
+
+#include <cmath>
 
 //for CMAKE_INSTALL_PREFIX
 #include "qgsconfig.h"
 
 #include <fcgi_stdio.h>
 
+#ifndef Q_OS_WIN
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 
 void dummyMessageHandler( QtMsgType type, const char *msg )
 {
@@ -102,6 +116,173 @@ QFileInfo defaultAdminSLD()
   return QFileInfo( "admin.sld" );
 }
 
+/**Renders the block of tiles around the requested one and puts all its tiles into the tile cache. The tiles are
+  keyed by their grid position, so later requests for the neighbours hit the cache whatever rounding the client uses
+  @return the requested tile or 0 if the request is not aligned to the tile grid. The caller takes ownership*/
+QImage* renderMetaTile( QgsWMSServer* server, QgsGetRequestHandler* requestHandler, const std::map<QString, QString>& parameterMap,
+                        const QString& configFilePath )
+{
+  QgsMSTileCache* tileCache = QgsMSTileCache::instance();
+  int metaTileSize = tileCache->metaTileSize();
+  std::map<QString, QString>::const_iterator bboxIt = parameterMap.find( "BBOX" );
+  int column, row;
+  double tileMapWidth, tileMapHeight;
+  if ( bboxIt == parameterMap.end() || !tileCache->gridPosition( bboxIt->second, column, row, tileMapWidth, tileMapHeight ) )
+  {
+    return 0;
+  }
+
+  //the block of the grid containing the requested tile
+  int firstColumn = ( int ) floor(( double ) column / metaTileSize ) * metaTileSize;
+  int firstRow = ( int ) floor(( double ) row / metaTileSize ) * metaTileSize;
+  QgsRectangle metaExtent( tileCache->originX() + firstColumn * tileMapWidth, tileCache->originY() + firstRow * tileMapHeight,
+                           tileCache->originX() + ( firstColumn + metaTileSize ) * tileMapWidth,
+                           tileCache->originY() + ( firstRow + metaTileSize ) * tileMapHeight );
+  QImage* metaImage = server->getMetaTileMap( metaTileSize, metaExtent );
+  if ( !metaImage )
+  {
+    return 0;
+  }
+
+  int tileWidth = metaImage->width() / metaTileSize;
+  int tileHeight = metaImage->height() / metaTileSize;
+  QImage* requestedTile = 0;
+
+  for ( int i = 0; i < metaTileSize; ++i )
+  {
+    for ( int j = 0; j < metaTileSize; ++j )
+    {
+      //j counts from the bottom in map coordinates, but from the top in the image
+      QImage tile = metaImage->copy( i * tileWidth, ( metaTileSize - 1 - j ) * tileHeight, tileWidth, tileHeight );
+      if ( firstColumn + i == column && firstRow + j == row )
+      {
+        requestedTile = new QImage( tile );
+      }
+      QString tileKey = tileCache->tileKey( parameterMap, configFilePath, firstColumn + i, firstRow + j, tileMapWidth, tileMapHeight );
+      tileCache->insertTile( tileKey, requestHandler->encodeImage( &tile ) );
+    }
+  }
+
+  delete metaImage;
+  return requestedTile;
+}
+
+#ifndef Q_OS_WIN
+//a worker exiting earlier than this (in seconds) after its start is restarted with a delay
+static const int sMinWorkerLifetime = 10;
+//maximum delay in seconds before a worker which keeps exiting is restarted
+static const int sMaxRestartDelay = 64;
+//pids of the running workers (0 for free slots), read by the signal handler
+static pid_t* sWorkerPids = 0;
+static int sNumWorkers = 0;
+
+void terminateWorkerProcesses( int signum )
+{
+  //forward the signal to our own workers (the process group may contain the FastCGI process manager) and quit
+  for ( int i = 0; i < sNumWorkers; ++i )
+  {
+    if ( sWorkerPids[i] > 0 )
+    {
+      kill( sWorkerPids[i], signum );
+    }
+  }
+  _exit( 0 );
+}
+
+/**Forks nWorkers processes which all accept requests on the inherited FastCGI socket. Everything set up before
+  (parsed configuration, map renderer) is shared between the workers. The function only returns in the worker
+  processes, the parent stays in it and replaces workers which exit. Workers exiting right after their start
+  are replaced with an increasing delay*/
+void forkWorkerProcesses( int nWorkers )
+{
+  sWorkerPids = new pid_t[nWorkers];
+  QVector<time_t> startTimes( nWorkers );
+  for ( int i = 0; i < nWorkers; ++i )
+  {
+    sWorkerPids[i] = 0;
+  }
+  sNumWorkers = nWorkers;
+
+  signal( SIGTERM, terminateWorkerProcesses );
+  signal( SIGINT, terminateWorkerProcesses );
+
+  int nRunning = 0;
+  int restartDelay = 0;
+  while ( true )
+  {
+    for ( int i = 0; i < nWorkers; ++i )
+    {
+      if ( sWorkerPids[i] > 0 )
+      {
+        continue;
+      }
+
+      pid_t pid = fork();
+      if ( pid == 0 ) //worker
+      {
+        signal( SIGTERM, SIG_DFL );
+        signal( SIGINT, SIG_DFL );
+        sNumWorkers = 0;
+        return;
+      }
+      else if ( pid < 0 )
+      {
+        fprintf( FCGI_stderr, "could not fork worker process: %s\n", strerror( errno ) );
+        if ( nRunning == 0 )
+        {
+          //serve the requests ourselves
+          signal( SIGTERM, SIG_DFL );
+          signal( SIGINT, SIG_DFL );
+          sNumWorkers = 0;
+          return;
+        }
+        break;
+      }
+      sWorkerPids[i] = pid;
+      startTimes[i] = time( 0 );
+      ++nRunning;
+    }
+
+    int status;
+    pid_t pid = wait( &status );
+    if ( pid > 0 )
+    {
+      QgsMSDebugMsg( QString( "worker process %1 exited" ).arg( pid ) );
+      for ( int i = 0; i < nWorkers; ++i )
+      {
+        if ( sWorkerPids[i] != pid )
+        {
+          continue;
+        }
+        sWorkerPids[i] = 0;
+        --nRunning;
+
+        if ( time( 0 ) - startTimes[i] < sMinWorkerLifetime )
+        {
+          //probably a configuration problem, do not fork again and again
+          restartDelay = restartDelay == 0 ? 1 : qMin( 2 * restartDelay, sMaxRestartDelay );
+          fprintf( FCGI_stderr, "worker process %d exited after its start, restarting in %d s\n", ( int ) pid, restartDelay );
+          sleep( restartDelay );
+        }
+        else
+        {
+          restartDelay = 0;
+        }
+        break;
+      }
+    }
+    else if ( errno == ECHILD )
+    {
+      for ( int i = 0; i < nWorkers; ++i )
+      {
+        sWorkerPids[i] = 0;
+      }
+      nRunning = 0;
+    }
+  }
+}
+#endif //Q_OS_WIN
+
 
 
 int main( int argc, char * argv[] )
@@ -159,12 +340,30 @@ int main( int argc, char * argv[] )
   //creating QgsMapRenderer is expensive (access to srs.db), so we do it here before the fcgi loop
   QgsMapRenderer* theMapRenderer = new QgsMapRenderer();
 
+#ifndef Q_OS_WIN
+  //QGIS_SERVER_PROCESSES > 1 lets one server instance handle several requests at the same time.
+  //Worker processes are used instead of threads because the layer registry and the fcgi_stdio streams
+  //are not thread safe. Layers are not shared: their providers may hold database connections
+  char* nProcessesEnv = getenv( "QGIS_SERVER_PROCESSES" );
+  int nProcesses = nProcessesEnv ? atoi( nProcessesEnv ) : 1;
+  if ( nProcesses > 1 && !FCGX_IsCGI() )
+  {
+    //parse the default configuration once, the workers get a copy-on-write view of it
+    if ( !defaultConfigFilePath.isEmpty() )
+    {
+      configCache.searchConfiguration( defaultConfigFilePath );
+    }
+    forkWorkerProcesses( nProcesses );
+  }
+#endif //Q_OS_WIN
+
   while ( FCGI_Accept() >= 0 )
   {
     printRequestInfos(); //print request infos if in debug mode
 
     //use QgsGetRequestHandler in case of HTTP GET and QgsSOAPRequestHandler in case of HTTP POST
     QgsRequestHandler* theRequestHandler = 0;
+    QgsGetRequestHandler* theGetRequestHandler = 0; //only responses to GET requests are cached
     char* requestMethod = getenv( "REQUEST_METHOD" );
     if ( requestMethod != NULL )
     {
@@ -176,13 +375,15 @@ int main( int argc, char * argv[] )
       else
       {
         QgsMSDebugMsg( "Creating QgsGetRequestHandler" )
-        theRequestHandler = new QgsGetRequestHandler();
+        theGetRequestHandler = new QgsGetRequestHandler();
+        theRequestHandler = theGetRequestHandler;
       }
     }
     else
     {
       QgsMSDebugMsg( "Creating QgsGetRequestHandler" )
-      theRequestHandler = new QgsGetRequestHandler();
+      theGetRequestHandler = new QgsGetRequestHandler();
+      theRequestHandler = theGetRequestHandler;
     }
 
     std::map<QString, QString> parameterMap;
@@ -276,10 +477,43 @@ int main( int argc, char * argv[] )
     }
     else if ( requestIt->second == "GetMap" )
     {
+      //answer repeated tile requests from the cache
+      QgsMSTileCache* tileCache = QgsMSTileCache::instance();
+      QString tileKey;
+      if ( theGetRequestHandler && tileCache->enabled() )
+      {
+        tileKey = tileCache->cacheKey( parameterMap, configFilePath );
+        QByteArray* cachedTile = tileCache->searchTile( tileKey );
+        if ( cachedTile )
+        {
+          theGetRequestHandler->sendEncodedGetMapResponse( cachedTile );
+          delete theRequestHandler;
+          delete theServer;
+          continue;
+        }
+      }
+
       QImage* result = 0;
       try
       {
-        result = theServer->getMap();
+        if ( !tileKey.isEmpty() && tileCache->metaTileSize() > 1 )
+        {
+          result = renderMetaTile( theServer, theGetRequestHandler, parameterMap, configFilePath );
+          QByteArray* cachedTile = tileCache->searchTile( tileKey );
+          if ( result && cachedTile )
+          {
+            QgsMSDebugMsg( "Sending GetMap response from metatile" )
+            theGetRequestHandler->sendEncodedGetMapResponse( cachedTile );
+            delete result;
+            delete theRequestHandler;
+            delete theServer;
+            continue;
+          }
+        }
+        if ( !result )
+        {
+          result = theServer->getMap();
+        }
       }
       catch ( QgsMapServiceException& ex )
       {
@@ -290,7 +524,14 @@ int main( int argc, char * argv[] )
         continue;
       }
 
-      if ( result )
+      if ( result && !tileKey.isEmpty() )
+      {
+        QgsMSDebugMsg( "Sending GetMap response and caching it" )
+        QByteArray encodedResult = theGetRequestHandler->encodeImage( result );
+        tileCache->insertTile( tileKey, encodedResult );
+        theGetRequestHandler->sendEncodedGetMapResponse( &encodedResult );
+      }
+      else if ( result )
       {
         QgsMSDebugMsg( "Sending GetMap response" )
         theRequestHandler->sendGetMapResponse( serviceIt->second, result );
@@ -19,6 +19,7 @@
 #include "qgsmapserverlogger.h"
 #include "qgsprojectparser.h"
 #include "qgssldparser.h"
+#include <QFileInfo>
 
 QgsConfigCache::QgsConfigCache()
 {
@@ -35,8 +36,16 @@ QgsConfigCache::~QgsConfigCache()
 
 QgsConfigParser* QgsConfigCache::searchConfiguration( const QString& filePath )
 {
-  QMap<QString, QgsConfigParser*>::const_iterator configIt = mCachedConfigurations.find( filePath );
-  if ( configIt == mCachedConfigurations.constEnd() )
+  QMap<QString, QgsConfigParser*>::iterator configIt = mCachedConfigurations.find( filePath );
+  if ( configIt != mCachedConfigurations.end() && mModificationTimes.value( filePath ) != QFileInfo( filePath ).lastModified() )
+  {
+    QgsMSDebugMsg( "Configuration file has changed" )
+    delete configIt.value();
+    mCachedConfigurations.erase( configIt );
+    configIt = mCachedConfigurations.end();
+  }
+
+  if ( configIt == mCachedConfigurations.end() )
   {
     QgsMSDebugMsg( "Create new configuration" )
     return insertConfiguration( filePath );
@@ -95,6 +104,7 @@ QgsConfigParser* QgsConfigCache::insertConfiguration( const QString& filePath )
   }
 
   mCachedConfigurations.insert( filePath, configParser );
+  mModificationTimes.insert( filePath, QFileInfo( filePath ).lastModified() );
   delete configFile;
   return configParser;
 }
@@ -18,6 +18,7 @@
 #ifndef QGSCONFIGCACHE_H
 #define QGSCONFIGCACHE_H
 
+#include <QDateTime>
 #include <QMap>
 #include <QString>
 
@@ -40,6 +41,8 @@ class QgsConfigCache
     QgsConfigParser* insertConfiguration( const QString& filePath );
     /**Cached XML configuration documents. Key: file path, value: config parser. Default configuration has key '$default$'*/
     QMap<QString, QgsConfigParser*> mCachedConfigurations;
+    /**Modification time of the configuration files when they were parsed. Changed files are parsed again*/
+    QMap<QString, QDateTime> mModificationTimes;
 };
 
 #endif // QGSCONFIGCACHE_H
@@ -11,9 +11,34 @@
 #include <QImage>
 #include <QStringList>
 #include <QUrl>
+#include <QVector>
+#include <QHash>
+#include <algorithm>
 
-QgsGetRequestHandler::QgsGetRequestHandler(): QgsHttpRequestHandler()
+QgsGetRequestHandler::QgsGetRequestHandler(): QgsHttpRequestHandler(), mPngQuality( -1 ), mJpegQuality( -1 )
 {
+  //png compression level 0-9. QImage::save maps its quality argument to the zlib level with (100 - quality) * 9 / 91
+  const char* pngCompression = getenv( "QGIS_SERVER_PNG_COMPRESSION" );
+  if ( pngCompression )
+  {
+    bool conversionOk;
+    int level = QString( pngCompression ).toInt( &conversionOk );
+    if ( conversionOk && level >= 0 && level <= 9 )
+    {
+      mPngQuality = 100 - ( level * 91 + 8 ) / 9;
+    }
+  }
+
+  const char* jpegQuality = getenv( "QGIS_SERVER_JPEG_QUALITY" );
+  if ( jpegQuality )
+  {
+    bool conversionOk;
+    int quality = QString( jpegQuality ).toInt( &conversionOk );
+    if ( conversionOk && quality >= 0 && quality <= 100 )
+    {
+      mJpegQuality = quality;
+    }
+  }
 }
 
 std::map<QString, QString> QgsGetRequestHandler::parseInput()
@@ -107,6 +132,11 @@ std::map<QString, QString> QgsGetRequestHandler::parseInput()
       {
         formatString = "PNG";
       }
+      else if ( formatString.compare( "image/png; mode=8bit", Qt::CaseInsensitive ) == 0
+                || formatString.compare( "png8", Qt::CaseInsensitive ) == 0 )
+      {
+        formatString = "PNG8";
+      }
       mFormat = formatString;
     }
   }
@@ -117,28 +147,337 @@ std::map<QString, QString> QgsGetRequestHandler::parseInput()
 
 void QgsGetRequestHandler::sendGetMapResponse( const QString& service, QImage* img ) const
 {
+  if ( !img )
+  {
+    return;
+  }
+
+  //encode before sending the header, such that an encoder error is still reported as service exception
+  QByteArray ba = encodeImage( img );
+  sendEncodedGetMapResponse( &ba );
+}
+
+QByteArray QgsGetRequestHandler::encodeImage( QImage* img ) const
+{
+  //store the image in a QByteArray
+  QByteArray ba;
   if ( img )
   {
-    //store the image in a QByteArray and send it directly
-    QByteArray ba;
     QBuffer buffer( &ba );
     buffer.open( QIODevice::WriteOnly );
-    img->save( &buffer, mFormat.toLocal8Bit().data(), -1 );
-    QString mimetype; //official mime-type string differs sometimes
-    if ( mFormat == "PNG" )
+    if ( !writeImage( img, &buffer ) )
+    {
+      QgsMSDebugMsg( "Error, could not encode image" )
+      ba.clear();
+    }
+  }
+  return ba;
+}
+
+void QgsGetRequestHandler::sendEncodedGetMapResponse( QByteArray* ba ) const
+{
+  if ( !ba || ba->isEmpty() )
+  {
+    sendServiceException( QgsMapServiceException( "InvalidFormat", "The map could not be encoded in the requested format" ) );
+    return;
+  }
+  sendHttpResponse( ba, mimeType() );
+}
+
+QString QgsGetRequestHandler::mimeType() const
+{
+  QString mimetype; //official mime-type string differs sometimes
+  if ( mFormat == "PNG" || mFormat == "PNG8" )
+  {
+    mimetype = "image/png";
+  }
+  else if ( mFormat == "JPG" )
+  {
+    mimetype = "image/jpeg";
+  }
+  else
+  {
+    //we don't support other formats yet...
+  }
+  return mimetype;
+}
+
+bool QgsGetRequestHandler::writeImage( QImage* img, QIODevice* device ) const
+{
+  if ( !img || !device )
+  {
+    return false;
+  }
+
+  if ( mFormat == "PNG8" )
+  {
+    QImage paletteImage = convertToPalette( *img );
+    return paletteImage.save( device, "PNG", mPngQuality );
+  }
+  else if ( mFormat == "PNG" )
+  {
+    return img->save( device, "PNG", mPngQuality );
+  }
+  else if ( mFormat == "JPG" )
+  {
+    return img->save( device, "JPG", mJpegQuality );
+  }
+  return img->save( device, mFormat.toLocal8Bit().data(), -1 );
+}
+
+namespace
+{
+  /**Entry of the color histogram used for median cut. Colors are reduced to 5 bits per channel*/
+  struct QgsHistogramColor
+  {
+    uint key;
+    int channel[4]; //a, r, g, b
+    int count;
+  };
+
+  struct QgsColorChannelLessThan
+  {
+    QgsColorChannelLessThan( int c ): mChannel( c ) {}
+    bool operator()( const QgsHistogramColor& c1, const QgsHistogramColor& c2 ) const
+    {
+      return c1.channel[mChannel] < c2.channel[mChannel];
+    }
+    int mChannel;
+  };
+
+  /**Range of histogram entries [begin, end[ which is represented by one palette color*/
+  struct QgsColorBox
+  {
+    int begin;
+    int end;
+    int count;
+    int splitChannel; //channel with the largest extent, -1 if the box cannot be split
+    int extent;
+  };
+
+  uint reducedColorKey( QRgb c )
+  {
+    return (( qAlpha( c ) >> 3 ) << 15 ) | (( qRed( c ) >> 3 ) << 10 ) | (( qGreen( c ) >> 3 ) << 5 ) | ( qBlue( c ) >> 3 );
+  }
+
+  /**Calculates the channel with the largest extent within the box*/
+  void calculateSplitChannel( const QVector<QgsHistogramColor>& colors, QgsColorBox& box )
+  {
+    box.extent = 0;
+    box.splitChannel = -1;
+    if ( box.end - box.begin < 2 )
+    {
+      return;
+    }
+    for ( int c = 0; c < 4; ++c )
     {
-      mimetype = "image/png";
+      int minValue = 255;
+      int maxValue = 0;
+      for ( int i = box.begin; i < box.end; ++i )
+      {
+        minValue = qMin( minValue, colors[i].channel[c] );
+        maxValue = qMax( maxValue, colors[i].channel[c] );
+      }
+      if ( maxValue - minValue > box.extent )
+      {
+        box.extent = maxValue - minValue;
+        box.splitChannel = c;
+      }
     }
-    else if ( mFormat == "JPG" )
+  }
+}
+
+QImage QgsGetRequestHandler::convertToPalette( const QImage& img )
+{
+  const QImage argbImage = img.convertToFormat( QImage::Format_ARGB32 );
+  int width = argbImage.width();
+  int height = argbImage.height();
+  QImage paletteImage( width, height, QImage::Format_Indexed8 );
+  if ( argbImage.isNull() || paletteImage.isNull() )
+  {
+    return paletteImage;
+  }
+
+  //exact palette if there are not more than 256 colors (typical for maps without antialiasing)
+  QHash<QRgb, int> exactColors;
+  bool exact = true;
+  for ( int y = 0; y < height && exact; ++y )
+  {
+    const QRgb* line = ( const QRgb* )argbImage.scanLine( y );
+    for ( int x = 0; x < width; ++x )
     {
-      mimetype = "image/jpeg";
+      if ( !exactColors.contains( line[x] ) )
+      {
+        if ( exactColors.size() >= 256 )
+        {
+          exact = false;
+          break;
+        }
+        exactColors.insert( line[x], exactColors.size() );
+      }
     }
-    else
+  }
+
+  QVector<QRgb> colorTable;
+  if ( exact )
+  {
+    colorTable.resize( exactColors.size() );
+    QHash<QRgb, int>::const_iterator colorIt = exactColors.constBegin();
+    for ( ; colorIt != exactColors.constEnd(); ++colorIt )
+    {
+      colorTable[colorIt.value()] = colorIt.key();
+    }
+    paletteImage.setColorTable( colorTable );
+
+    QRgb lastColor = 0;
+    uchar lastIndex = 0;
+    bool first = true;
+    for ( int y = 0; y < height; ++y )
+    {
+      const QRgb* line = ( const QRgb* )argbImage.scanLine( y );
+      uchar* paletteLine = paletteImage.scanLine( y );
+      for ( int x = 0; x < width; ++x )
+      {
+        //neighbour pixels often have the same color, avoid the hash lookup in this case
+        if ( first || line[x] != lastColor )
+        {
+          lastColor = line[x];
+          lastIndex = exactColors.value( lastColor );
+          first = false;
+        }
+        paletteLine[x] = lastIndex;
+      }
+    }
+    return paletteImage;
+  }
+
+  //histogram with 5 bits per channel
+  QHash<uint, int> histogram;
+  for ( int y = 0; y < height; ++y )
+  {
+    const QRgb* line = ( const QRgb* )argbImage.scanLine( y );
+    for ( int x = 0; x < width; ++x )
     {
-      //we don't support other formats yet...
+      ++histogram[reducedColorKey( line[x] )];
+    }
+  }
+
+  QVector<QgsHistogramColor> colors;
+  colors.reserve( histogram.size() );
+  QHash<uint, int>::const_iterator histIt = histogram.constBegin();
+  for ( ; histIt != histogram.constEnd(); ++histIt )
+  {
+    QgsHistogramColor c;
+    c.key = histIt.key();
+    c.channel[0] = ( c.key >> 15 ) & 0x1F;
+    c.channel[1] = ( c.key >> 10 ) & 0x1F;
+    c.channel[2] = ( c.key >> 5 ) & 0x1F;
+    c.channel[3] = c.key & 0x1F;
+    c.count = histIt.value();
+    colors.push_back( c );
+  }
+
+  //median cut: split the box with the largest extent at the weighted median until there are 256 boxes
+  QList<QgsColorBox> boxes;
+  QgsColorBox firstBox;
+  firstBox.begin = 0;
+  firstBox.end = colors.size();
+  firstBox.count = width * height;
+  calculateSplitChannel( colors, firstBox );
+  boxes.push_back( firstBox );
+
+  while ( boxes.size() < 256 )
+  {
+    int splitBox = -1;
+    int maxExtent = 0;
+    for ( int i = 0; i < boxes.size(); ++i )
+    {
+      if ( boxes.at( i ).splitChannel >= 0 && boxes.at( i ).extent > maxExtent )
+      {
+        maxExtent = boxes.at( i ).extent;
+        splitBox = i;
+      }
+    }
+    if ( splitBox < 0 )
+    {
+      break; //every box contains a single color
+    }
+
+    QgsColorBox box = boxes.at( splitBox );
+    std::sort( colors.begin() + box.begin, colors.begin() + box.end, QgsColorChannelLessThan( box.splitChannel ) );
+
+    //both halves keep at least one color
+    int median = box.begin;
+    int halfCount = colors[median].count;
+    while ( median < box.end - 2 && halfCount < box.count / 2 )
+    {
+      ++median;
+      halfCount += colors[median].count;
+    }
+
+    QgsColorBox lowerBox;
+    lowerBox.begin = box.begin;
+    lowerBox.end = median + 1;
+    lowerBox.count = halfCount;
+    QgsColorBox upperBox;
+    upperBox.begin = median + 1;
+    upperBox.end = box.end;
+    upperBox.count = box.count - halfCount;
+    calculateSplitChannel( colors, lowerBox );
+    calculateSplitChannel( colors, upperBox );
+    boxes[splitBox] = lowerBox;
+    boxes.push_back( upperBox );
+  }
+
+  //palette color is the weighted mean of the box
+  QHash<uint, uchar> paletteIndex;
+  for ( int i = 0; i < boxes.size(); ++i )
+  {
+    const QgsColorBox& box = boxes.at( i );
+    qint64 sum[4] = { 0, 0, 0, 0 };
+    qint64 count = 0;
+    for ( int j = box.begin; j < box.end; ++j )
+    {
+      for ( int c = 0; c < 4; ++c )
+      {
+        sum[c] += ( qint64 )colors[j].channel[c] * colors[j].count;
+      }
+      count += colors[j].count;
+      paletteIndex.insert( colors[j].key, ( uchar )i );
+    }
+    if ( count < 1 )
+    {
+      count = 1;
+    }
+    //scale 5 bit values back to 8 bit
+    int a = ( sum[0] * 255 ) / ( count * 31 );
+    int r = ( sum[1] * 255 ) / ( count * 31 );
+    int g = ( sum[2] * 255 ) / ( count * 31 );
+    int b = ( sum[3] * 255 ) / ( count * 31 );
+    colorTable.push_back( qRgba( r, g, b, a ) );
+  }
+  paletteImage.setColorTable( colorTable );
+
+  uint lastKey = 0;
+  uchar lastIndex = 0;
+  bool first = true;
+  for ( int y = 0; y < height; ++y )
+  {
+    const QRgb* line = ( const QRgb* )argbImage.scanLine( y );
+    uchar* paletteLine = paletteImage.scanLine( y );
+    for ( int x = 0; x < width; ++x )
+    {
+      uint key = reducedColorKey( line[x] );
+      if ( first || key != lastKey )
+      {
+        lastKey = key;
+        lastIndex = paletteIndex.value( key );
+        first = false;
+      }
+      paletteLine[x] = lastIndex;
     }
-    sendHttpResponse( &ba, mimetype );
   }
+  return paletteImage;
 }
 
 void QgsGetRequestHandler::sendGetCapabilitiesResponse( const QDomDocument& doc ) const
@@ -18,6 +18,11 @@
 
 #include "qgshttprequesthandler.h"
 
+class QIODevice;
+
+/**Request handler for HTTP GET. The image encoding can be tuned with the environment variables
+QGIS_SERVER_PNG_COMPRESSION (zlib level 0-9) and QGIS_SERVER_JPEG_QUALITY (0-100).
+FORMAT=image/png; mode=8bit (or png8) produces a paletted png*/
 class QgsGetRequestHandler: public QgsHttpRequestHandler
 {
   public:
@@ -25,9 +30,28 @@ class QgsGetRequestHandler: public QgsHttpRequestHandler
     std::map<QString, QString> parseInput();
     /**Sends the image back (but does not delete it)*/
     void sendGetMapResponse( const QString& service, QImage* img ) const;
+    /**Encodes the image in the format requested with the FORMAT parameter. Returns an empty array if encoding failed*/
+    QByteArray encodeImage( QImage* img ) const;
+    /**Sends an image which has already been encoded with encodeImage (e.g. from the tile cache).
+      An empty array is answered with a service exception*/
+    void sendEncodedGetMapResponse( QByteArray* ba ) const;
     void sendGetCapabilitiesResponse( const QDomDocument& doc ) const;
     void sendGetFeatureInfoResponse( const QDomDocument& infoDoc, const QString& infoFormat ) const;
     void sendServiceException( const QgsMapServiceException& ex ) const;
     void sendGetStyleResponse( const QDomDocument& doc ) const;
     void sendGetPrintResponse( QByteArray* ba, const QString& formatString ) const;
+
+  private:
+    /**Quality value passed to QImage::save for png output (-1 is the Qt default)*/
+    int mPngQuality;
+    /**Quality value passed to QImage::save for jpeg output (-1 is the Qt default)*/
+    int mJpegQuality;
+
+    /**Returns the mime type corresponding to mFormat*/
+    QString mimeType() const;
+    /**Writes the image in the requested format to the device*/
+    bool writeImage( QImage* img, QIODevice* device ) const;
+    /**Converts an image to an 8 bit paletted image. Images with up to 256 colors are converted
+    without loss, otherwise the palette is calculated with median cut*/
+    static QImage convertToPalette( const QImage& img );
 };
@@ -0,0 +1,173 @@
+/***************************************************************************
+                              qgsmstilecache.cpp
+                              ------------------
+  begin                : October 2010
+  copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmstilecache.h"
+#include "qgsmapserverlogger.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QStringList>
+#include <cmath>
+#include <stdlib.h>
+
+QgsMSTileCache* QgsMSTileCache::mInstance = 0;
+
+QgsMSTileCache* QgsMSTileCache::instance()
+{
+  if ( !mInstance )
+  {
+    mInstance = new QgsMSTileCache();
+  }
+  return mInstance;
+}
+
+QgsMSTileCache::QgsMSTileCache(): mMaxSize( 0 ), mMetaTileSize( 1 ), mOriginX( 0 ), mOriginY( 0 )
+{
+  char* cacheSizeEnv = getenv( "QGIS_SERVER_TILE_CACHE_SIZE" );
+  if ( cacheSizeEnv )
+  {
+    mMaxSize = atoi( cacheSizeEnv ) * 1024;
+  }
+  mTiles.setMaxCost( qMax( mMaxSize, 0 ) );
+
+  char* metaTileEnv = getenv( "QGIS_SERVER_METATILE_SIZE" );
+  if ( metaTileEnv )
+  {
+    mMetaTileSize = qMax( atoi( metaTileEnv ), 1 );
+  }
+
+  char* originEnv = getenv( "QGIS_SERVER_TILE_ORIGIN" );
+  if ( originEnv )
+  {
+    QStringList originList = QString( originEnv ).split( "," );
+    if ( originList.size() == 2 )
+    {
+      mOriginX = originList.at( 0 ).toDouble();
+      mOriginY = originList.at( 1 ).toDouble();
+    }
+  }
+}
+
+QgsMSTileCache::~QgsMSTileCache()
+{
+}
+
+QStringList QgsMSTileCache::keyElements( const std::map<QString, QString>& parameters, const QString& configFilePath ) const
+{
+  QStringList elements;
+  QFileInfo configFileInfo( configFilePath );
+  elements << configFileInfo.absoluteFilePath() << QString::number( configFileInfo.lastModified().toTime_t() );
+
+  //parameter keys are already upper case and sorted in the map
+  std::map<QString, QString>::const_iterator paramIt = parameters.begin();
+  for ( ; paramIt != parameters.end(); ++paramIt )
+  {
+    if ( paramIt->first != "BBOX" )
+    {
+      elements << paramIt->first + "=" + paramIt->second;
+    }
+  }
+  return elements;
+}
+
+QString QgsMSTileCache::cacheKey( const std::map<QString, QString>& parameters, const QString& configFilePath ) const
+{
+  std::map<QString, QString>::const_iterator bboxIt = parameters.find( "BBOX" );
+  if ( bboxIt == parameters.end() )
+  {
+    return keyElements( parameters, configFilePath ).join( "&" );
+  }
+
+  int column, row;
+  double tileWidth, tileHeight;
+  if ( gridPosition( bboxIt->second, column, row, tileWidth, tileHeight ) )
+  {
+    return tileKey( parameters, configFilePath, column, row, tileWidth, tileHeight );
+  }
+
+  QStringList elements = keyElements( parameters, configFilePath );
+  //the coordinates with full precision, such that nearby extents get different keys
+  QStringList bboxList = bboxIt->second.split( "," );
+  if ( bboxList.size() != 4 )
+  {
+    elements << "BBOX=" + bboxIt->second;
+  }
+  else
+  {
+    elements << QString( "BBOX=%1,%2,%3,%4" ).arg( bboxList.at( 0 ).toDouble(), 0, 'g', 17 ).arg( bboxList.at( 1 ).toDouble(), 0, 'g', 17 )
+    .arg( bboxList.at( 2 ).toDouble(), 0, 'g', 17 ).arg( bboxList.at( 3 ).toDouble(), 0, 'g', 17 );
+  }
+  return elements.join( "&" );
+}
+
+QString QgsMSTileCache::tileKey( const std::map<QString, QString>& parameters, const QString& configFilePath,
+                                 int column, int row, double tileWidth, double tileHeight ) const
+{
+  //7 significant digits of the tile size separate the zoom levels but not the rounding of different clients
+  QStringList elements = keyElements( parameters, configFilePath );
+  elements << QString( "TILE=%1,%2,%3,%4" ).arg( column ).arg( row ).arg( tileWidth, 0, 'g', 7 ).arg( tileHeight, 0, 'g', 7 );
+  return elements.join( "&" );
+}
+
+bool QgsMSTileCache::gridPosition( const QString& bbox, int& column, int& row, double& tileWidth, double& tileHeight ) const
+{
+  QStringList bboxList = bbox.split( "," );
+  if ( bboxList.size() != 4 )
+  {
+    return false;
+  }
+  double minx = bboxList.at( 0 ).toDouble() - mOriginX;
+  double miny = bboxList.at( 1 ).toDouble() - mOriginY;
+  double maxx = bboxList.at( 2 ).toDouble() - mOriginX;
+  double maxy = bboxList.at( 3 ).toDouble() - mOriginY;
+  if ( maxx <= minx || maxy <= miny )
+  {
+    return false;
+  }
+
+  //is the tile aligned to a grid of its own size?
+  double columnValue = minx / ( maxx - minx );
+  double rowValue = miny / ( maxy - miny );
+  if ( fabs( columnValue - floor( columnValue + 0.5 ) ) > 0.001 || fabs( rowValue - floor( rowValue + 0.5 ) ) > 0.001 )
+  {
+    return false;
+  }
+  column = ( int ) floor( columnValue + 0.5 );
+  row = ( int ) floor( rowValue + 0.5 );
+
+  //dividing the grid line farthest from the origin by its index keeps the rounding error of the client small
+  tileWidth = ( abs( column ) >= abs( column + 1 ) ) ? minx / column : maxx / ( column + 1 );
+  tileHeight = ( abs( row ) >= abs( row + 1 ) ) ? miny / row : maxy / ( row + 1 );
+  return true;
+}
+
+QByteArray* QgsMSTileCache::searchTile( const QString& key )
+{
+  QByteArray* tile = mTiles.object( key );
+  if ( tile )
+  {
+    QgsMSDebugMsg( "Return tile from cache" )
+  }
+  return tile;
+}
+
+void QgsMSTileCache::insertTile( const QString& key, const QByteArray& data )
+{
+  if ( !enabled() || data.isEmpty() )
+  {
+    return;
+  }
+  mTiles.insert( key, new QByteArray( data ), qMax( data.size() / 1024, 1 ) );
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+                              qgsmstilecache.h
+                              ----------------
+  begin                : October 2010
+  copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMSTILECACHE_H
+#define QGSMSTILECACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QString>
+#include <QStringList>
+#include <map>
+
+/**A singleton class that caches encoded GetMap responses. The cache is enabled with the environment variable
+QGIS_SERVER_TILE_CACHE_SIZE (maximum size in megabytes). QGIS_SERVER_METATILE_SIZE=n makes the server render
+blocks of n x n tiles for requests aligned to a tile grid and cache all tiles of the block. The grid origin is
+0/0 unless QGIS_SERVER_TILE_ORIGIN=x,y is set (in the coordinates of the requested SRS).
+The cache lives in the memory of one server process. FastCGI workers don't share their hits and each
+of them may use up to QGIS_SERVER_TILE_CACHE_SIZE, so the total memory is that size times the number of workers*/
+class QgsMSTileCache
+{
+  public:
+    static QgsMSTileCache* instance();
+    ~QgsMSTileCache();
+
+    /**True if GetMap responses should be cached*/
+    bool enabled() const { return mMaxSize > 0; }
+    /**Number of tiles per side of a metatile (1 if metatiling is disabled)*/
+    int metaTileSize() const { return mMetaTileSize; }
+
+    /**Creates the cache key for a GetMap request.
+      @param parameters the request parameters
+      @param configFilePath path of the project / sld file (its modification time is part of the key)
+      @return the key. A BBOX which is a tile of the grid is replaced by its grid position, such that
+      the rounded coordinates of tiling clients map to the key of the tile. Other BBOXes are normalized
+      to 17 significant digits*/
+    QString cacheKey( const std::map<QString, QString>& parameters, const QString& configFilePath ) const;
+    /**Creates the cache key of the tile at a grid position (e.g. a neighbour tile of a metatile)
+      @param parameters the request parameters (BBOX is ignored)
+      @param configFilePath path of the project / sld file
+      @param column column of the tile in the grid
+      @param row row of the tile in the grid (counted from the bottom)
+      @param tileWidth width of a tile in map units
+      @param tileHeight height of a tile in map units*/
+    QString tileKey( const std::map<QString, QString>& parameters, const QString& configFilePath,
+                     int column, int row, double tileWidth, double tileHeight ) const;
+
+    /**Snaps a BBOX parameter to the tile grid.
+      @param bbox BBOX parameter (minx,miny,maxx,maxy)
+      @param column out: column of the tile in a grid of its own size
+      @param row out: row of the tile (counted from the bottom)
+      @param tileWidth out: tile width, calculated from the grid line farthest from the origin to reduce client rounding errors
+      @param tileHeight out: tile height
+      @return true if the BBOX is a grid tile (up to 1/1000 of the tile size)*/
+    bool gridPosition( const QString& bbox, int& column, int& row, double& tileWidth, double& tileHeight ) const;
+    /**X-coordinate of the tile grid origin*/
+    double originX() const { return mOriginX; }
+    /**Y-coordinate of the tile grid origin*/
+    double originY() const { return mOriginY; }
+
+    /**Returns the cached response for the key or 0. The cache keeps ownership*/
+    QByteArray* searchTile( const QString& key );
+    /**Inserts an encoded response into the cache*/
+    void insertTile( const QString& key, const QByteArray& data );
+
+  protected:
+    /**Protected singleton constructor*/
+    QgsMSTileCache();
+
+  private:
+    static QgsMSTileCache* mInstance;
+
+    /**Configuration file and all request parameters except BBOX as key elements*/
+    QStringList keyElements( const std::map<QString, QString>& parameters, const QString& configFilePath ) const;
+
+    /**Encoded responses, cost is the size in kilobytes*/
+    QCache<QString, QByteArray> mTiles;
+    /**Maximum size in kilobytes*/
+    int mMaxSize;
+    int mMetaTileSize;
+    double mOriginX;
+    double mOriginY;
+};
+
+#endif // QGSMSTILECACHE_H
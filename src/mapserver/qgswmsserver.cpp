@@ -50,6 +50,7 @@
 #include <QBuffer>
 #include <QPrinter>
 #include <QSvgGenerator>
+#include <cmath>
 
 QgsWMSServer::QgsWMSServer( std::map<QString, QString> parameters, QgsMapRenderer* renderer )
     : mParameterMap( parameters )
@@ -180,6 +181,10 @@ QDomDocument QgsWMSServer::getCapabilities()
   QDomText pngFormatText = doc.createTextNode( "image/png" );
   pngFormatElement.appendChild( pngFormatText );
   getMapElement.appendChild( pngFormatElement );
+  QDomElement png8FormatElement = doc.createElement( "Format"/*wms:Format*/ );
+  QDomText png8FormatText = doc.createTextNode( "image/png; mode=8bit" );
+  png8FormatElement.appendChild( png8FormatText );
+  getMapElement.appendChild( png8FormatElement );
   QDomElement getMapDhcTypeElement = dcpTypeElement.cloneNode().toElement();//this is the same as for 'GetCapabilities'
   getMapElement.appendChild( getMapDhcTypeElement );
 
@@ -462,6 +467,51 @@ QImage* QgsWMSServer::getMap()
   return theImage;
 }
 
+QImage* QgsWMSServer::getMetaTileMap( int metaTileSize, const QgsRectangle& metaExtent )
+{
+  std::map<QString, QString>::const_iterator widthIt = mParameterMap.find( "WIDTH" );
+  std::map<QString, QString>::const_iterator heightIt = mParameterMap.find( "HEIGHT" );
+  std::map<QString, QString>::const_iterator bboxIt = mParameterMap.find( "BBOX" );
+  if ( metaTileSize < 2 || widthIt == mParameterMap.end() || heightIt == mParameterMap.end() || bboxIt == mParameterMap.end() )
+  {
+    return 0;
+  }
+
+  int width = widthIt->second.toInt();
+  int height = heightIt->second.toInt();
+  if ( width < 1 || height < 1 || width * metaTileSize > 4096 || height * metaTileSize > 4096 )
+  {
+    return 0;
+  }
+
+  //render the block with the tile parameters replaced, a fallback to getMap() needs the original ones
+  QString requestWidth = widthIt->second;
+  QString requestHeight = heightIt->second;
+  QString requestBBox = bboxIt->second;
+  mParameterMap["WIDTH"] = QString::number( width * metaTileSize );
+  mParameterMap["HEIGHT"] = QString::number( height * metaTileSize );
+  mParameterMap["BBOX"] = QString( "%1,%2,%3,%4" ).arg( metaExtent.xMinimum(), 0, 'g', 17 ).arg( metaExtent.yMinimum(), 0, 'g', 17 )
+                          .arg( metaExtent.xMaximum(), 0, 'g', 17 ).arg( metaExtent.yMaximum(), 0, 'g', 17 );
+
+  QImage* metaImage = 0;
+  try
+  {
+    metaImage = getMap();
+  }
+  catch ( QgsMapServiceException& ex )
+  {
+    mParameterMap["WIDTH"] = requestWidth;
+    mParameterMap["HEIGHT"] = requestHeight;
+    mParameterMap["BBOX"] = requestBBox;
+    throw;
+  }
+
+  mParameterMap["WIDTH"] = requestWidth;
+  mParameterMap["HEIGHT"] = requestHeight;
+  mParameterMap["BBOX"] = requestBBox;
+  return metaImage;
+}
+
 int QgsWMSServer::getFeatureInfo( QDomDocument& result )
 {
   if ( !mMapRenderer || !mConfigParser )
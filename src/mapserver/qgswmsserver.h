@@ -30,6 +30,7 @@ class QgsMapLayer;
 class QgsMapRenderer;
 class QgsPoint;
 class QgsRasterLayer;
+class QgsRectangle;
 class QgsConfigParser;
 class QgsVectorLayer;
 class QgsSymbol;
@@ -57,6 +58,13 @@ class QgsWMSServer
     /**Returns the map as an image (or a null pointer in case of error). The caller takes ownership\
     of the image object)*/
     QImage* getMap();
+    /**Renders a block of metaTileSize x metaTileSize tiles of the requested size. Rendering neighbouring
+      tiles together saves the per request overhead and avoids labels cut at tile borders.
+      @param metaTileSize number of tiles per side of the block
+      @param metaExtent the extent of the block (snapped to the tile grid by the caller)
+      @return the rendered block (the caller takes ownership) or 0 if the block would be too large. The request
+      parameters are left unchanged*/
+    QImage* getMetaTileMap( int metaTileSize, const QgsRectangle& metaExtent );
     /**Returns an SLD file with the style of the requested layer. Exception is raised in case of troubles :-)*/
     QDomDocument getStyle();
 
@@ -49,6 +49,18 @@ double QgsDiagramFactory::diagramSizeScaleFactor( const QgsRenderContext& contex
   return 1.0;
 }
 
+QString QgsDiagramFactory::diagramCacheKey( int size, const QgsFeature& f, const QgsRenderContext& renderContext ) const
+{
+  QString key = QString( "%1;%2;%3" ).arg( size ).arg( diagramSizeScaleFactor( renderContext ), 0, 'g', 17 ).arg( renderContext.rasterScaleFactor(), 0, 'g', 17 );
+  const QgsAttributeMap& attributes = f.attributeMap();
+  QgsAttributeMap::const_iterator it = attributes.constBegin();
+  for ( ; it != attributes.constEnd(); ++it )
+  {
+    key += QString( ";%1=%2" ).arg( it.key() ).arg( it.value().toString() );
+  }
+  return key;
+}
+
 bool QgsDiagramFactory::writeSizeUnits( QDomElement& factoryElem, QDomDocument& doc ) const
 {
   if ( factoryElem.isNull() )
@@ -73,6 +73,12 @@ class QgsDiagramFactory
     @param width out: the width of the diagram image in pixels
     @param height out: the height of the diagram image in pixels*/
     virtual int getDiagramDimensions( int size, const QgsFeature& f, const QgsRenderContext& context, int& width, int& height ) const = 0;
+    /**Returns a key that is the same for all features getting an identical diagram image. It is used by the renderer to cache the images.
+     The default implementation considers the size, the scale factors of the render context and the attribute values of the feature
+    @param size diagram size calculated by diagram renderer
+    @param f feature that is symbolized by the diagram
+    @param renderContext rendering parameters*/
+    virtual QString diagramCacheKey( int size, const QgsFeature& f, const QgsRenderContext& renderContext ) const;
     virtual bool writeXML( QDomNode& overlay_node, QDomDocument& doc ) const = 0;
 
     /**Calculates the size multiplicator. Considers the size unit as well as the render context parameters*/
@@ -4,7 +4,10 @@
 #include <cmath>
 #include <QDomElement>
 
-QgsDiagramRenderer::QgsDiagramRenderer( const QList<int>& classificationAttributes ): mClassificationAttributes( classificationAttributes ), mScaleFactor( 1.0 )
+/**Maximum size of the cached diagram images of a renderer (in kB)*/
+static const int sDiagramCacheSize = 20480;
+
+QgsDiagramRenderer::QgsDiagramRenderer( const QList<int>& classificationAttributes ): mClassificationAttributes( classificationAttributes ), mScaleFactor( 1.0 ), mDiagramCache( sDiagramCacheSize )
 {
 }
 
@@ -13,7 +16,7 @@ QgsDiagramRenderer::~QgsDiagramRenderer()
   delete mFactory;
 }
 
-QgsDiagramRenderer::QgsDiagramRenderer(): mScaleFactor( 1.0 )
+QgsDiagramRenderer::QgsDiagramRenderer(): mScaleFactor( 1.0 ), mDiagramCache( sDiagramCacheSize )
 {
 }
 
@@ -36,7 +39,19 @@ QImage* QgsDiagramRenderer::renderDiagram( const QgsFeature& f, const QgsRenderC
     return 0;
   }
 
-  return mFactory->createDiagram( size, f, renderContext );
+  QString cacheKey = mFactory->diagramCacheKey( size, f, renderContext );
+  QImage* cachedImage = mDiagramCache.object( cacheKey );
+  if ( cachedImage )
+  {
+    return new QImage( *cachedImage ); //implicitly shared, no pixel copy
+  }
+
+  QImage* diagramImage = mFactory->createDiagram( size, f, renderContext );
+  if ( diagramImage )
+  {
+    mDiagramCache.insert( cacheKey, new QImage( *diagramImage ), diagramImage->width() * diagramImage->height() * 4 / 1024 + 1 );
+  }
+  return diagramImage;
 }
 
 int QgsDiagramRenderer::getDiagramDimensions( int& width, int& height, const QgsFeature& f, const QgsRenderContext& renderContext ) const
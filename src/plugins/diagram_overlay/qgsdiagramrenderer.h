@@ -18,6 +18,8 @@
 #ifndef QGSDIAGRAMRENDERER_H
 #define QGSDIAGRAMRENDERER_H
 
+#include <QCache>
+#include <QImage>
 #include <QList>
 #include <QMap>
 #include <QVariant>
@@ -27,7 +29,6 @@ class QgsFeature;
 class QgsRenderContext;
 class QDomDocument;
 class QDomNode;
-class QImage;
 
 //structure that describes a renderer entry
 class QgsDiagramItem
@@ -53,7 +54,8 @@ class QgsDiagramRenderer
 
     QgsDiagramRenderer( const QList<int>& classificationAttributes );
     virtual ~QgsDiagramRenderer();
-    /**Returns a diagram image for a feature.*/
+    /**Returns a diagram image for a feature. The caller takes ownership of the image.
+      Images of features with equal diagram cache keys are only rendered once*/
     virtual QImage* renderDiagram( const QgsFeature& f, const QgsRenderContext& renderContext ) const;
     /**Returns only the size of the diagram.
        @param width the width of the diagram in pixels
@@ -65,7 +67,7 @@ class QgsDiagramRenderer
     //setters and getters
     QgsDiagramFactory* factory() const {return mFactory;}
     /**Set a (properly configured) factory class. Takes ownership of the factory object*/
-    void setFactory( QgsDiagramFactory* f ) {mFactory = f;}
+    void setFactory( QgsDiagramFactory* f ) {mFactory = f; mDiagramCache.clear();}
     void addClassificationAttribute( int attrNr );
     QList<int> classificationAttributes() const {return mClassificationAttributes;}
     /**Reads the specific renderer settings from project file*/
@@ -76,7 +78,7 @@ class QgsDiagramRenderer
      @return 0 in case of success*/
     virtual int createLegendContent( const QgsRenderContext& renderContext, QMap<QString, QImage*> items ) const;
     /**Sets the items for interpolation. The values of the items must be in ascending order*/
-    void setDiagramItems( const QList<QgsDiagramItem>& items ) {mItems = items;}
+    void setDiagramItems( const QList<QgsDiagramItem>& items ) {mItems = items; mDiagramCache.clear();}
     /**Returns the interpolation items*/
     QList<QgsDiagramItem> diagramItems() const {return mItems;}
     void setItemInterpretation( ItemInterpretation i ) {mItemInterpretation = i;}
@@ -98,6 +100,9 @@ class QgsDiagramRenderer
     ItemInterpretation mItemInterpretation;
     /**Factor to multiply the sizes (e.g. used by QGIS mapserver dependent on the current scale)*/
     double mScaleFactor;
+    /**Recently rendered diagram images (least recently used are removed first). The key is
+      QgsDiagramFactory::diagramCacheKey, the cost the image size in kB*/
+    mutable QCache<QString, QImage> mDiagramCache;
 
     /**Searches the value of the classification attribute(s). Considers that there
        may be several attributes in case of numeric values (sum).
@@ -17,10 +17,15 @@
 
 #include "qgssvgdiagramfactory.h"
 #include "qgsrendercontext.h"
+#include <QCache>
 #include <QImage>
 #include <QPainter>
 #include <QDomNode>
 
+/**Rasterized svg files, shared by all svg factories. The key is the file path and the image size,
+  the cost is the image size in kB*/
+static QCache<QString, QImage> svgImageCache( 10240 );
+
 QgsSVGDiagramFactory::QgsSVGDiagramFactory(): QgsDiagramFactory()
 {
 
@@ -50,6 +55,19 @@ QImage* QgsSVGDiagramFactory::createDiagram( int size, const QgsFeature& f, cons
 
   imageWidth = ( int )( defaultSize.width() * scaleFactor );
   imageHeight = ( int )( defaultSize.height() * scaleFactor );
+
+  //the image may have been rendered already (by this or another factory using the same file)
+  QString cacheKey;
+  if ( !mSvgFilePath.isEmpty() )
+  {
+    cacheKey = QString( "%1;%2;%3" ).arg( mSvgFilePath ).arg( imageWidth ).arg( imageHeight );
+    QImage* cachedImage = svgImageCache.object( cacheKey );
+    if ( cachedImage )
+    {
+      return new QImage( *cachedImage ); //implicitly shared, no pixel copy
+    }
+  }
+
   QImage* diagramImage = new QImage( QSize( imageWidth, imageHeight ), QImage::Format_ARGB32_Premultiplied );
   diagramImage->fill( qRgba( 0, 0, 0, 0 ) ); //transparent background
 
@@ -62,6 +80,11 @@ QImage* QgsSVGDiagramFactory::createDiagram( int size, const QgsFeature& f, cons
   mRenderer.render( &p );
 
   p.end();
+
+  if ( !cacheKey.isEmpty() )
+  {
+    svgImageCache.insert( cacheKey, new QImage( *diagramImage ), imageWidth * imageHeight * 4 / 1024 + 1 );
+  }
   return diagramImage;
 }
 
@@ -83,8 +106,25 @@ int QgsSVGDiagramFactory::getDiagramDimensions( int size, const QgsFeature& f, c
   return 0;
 }
 
+QString QgsSVGDiagramFactory::diagramCacheKey( int size, const QgsFeature& f, const QgsRenderContext& renderContext ) const
+{
+  Q_UNUSED( f );
+  return QString( "%1;%2;%3" ).arg( size ).arg( diagramSizeScaleFactor( renderContext ), 0, 'g', 17 ).arg( renderContext.rasterScaleFactor(), 0, 'g', 17 );
+}
+
 bool QgsSVGDiagramFactory::setSVGData( const QByteArray& data, const QString& filePath )
 {
+  //the file may have been changed since it was rasterized
+  QList<QString> cacheKeys = svgImageCache.keys();
+  QList<QString>::const_iterator keyIt = cacheKeys.constBegin();
+  for ( ; keyIt != cacheKeys.constEnd(); ++keyIt )
+  {
+    if ( keyIt->startsWith( filePath + ";" ) )
+    {
+      svgImageCache.remove( *keyIt );
+    }
+  }
+
   mSvgFilePath = filePath;
   return mRenderer.load( data );
 }
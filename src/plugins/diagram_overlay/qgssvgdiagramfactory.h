@@ -49,6 +49,9 @@ class QgsSVGDiagramFactory: public QgsDiagramFactory
     @param height out: the height of the diagram image in pixels*/
     int getDiagramDimensions( int size, const QgsFeature& f, const QgsRenderContext& context, int& width, int& height ) const;
 
+    /**The svg image does not depend on the attributes, so only size and scale factors are considered*/
+    QString diagramCacheKey( int size, const QgsFeature& f, const QgsRenderContext& renderContext ) const;
+
     bool writeXML( QDomNode& overlay_node, QDomDocument& doc ) const;
 
     /**Sets the SVG data to be rendered.
@@ -121,6 +121,9 @@ void QgsGeorefConfigDialog::readSettings()
 
   mLeftMarginSpinBox->setValue( s.value( "/Plugin-GeoReferencer/Config/LeftMarginPDF", "2.0" ).toDouble() );
   mRightMarginSpinBox->setValue( s.value( "/Plugin-GeoReferencer/Config/RightMarginPDF", "2.0" ).toDouble() );
+
+  mWarpMemorySpinBox->setValue( s.value( "/Plugin-GeoReferencer/Config/WarpMemoryLimit", 256 ).toInt() );
+  mWarpMaxErrorSpinBox->setValue( s.value( "/Plugin-GeoReferencer/Config/WarpMaxError", 0.125 ).toDouble() );
 }
 
 void QgsGeorefConfigDialog::writeSettings()
@@ -139,6 +142,8 @@ void QgsGeorefConfigDialog::writeSettings()
   }
   s.setValue( "/Plugin-GeoReferencer/Config/LeftMarginPDF", mLeftMarginSpinBox->value() );
   s.setValue( "/Plugin-GeoReferencer/Config/RightMarginPDF", mRightMarginSpinBox->value() );
+  s.setValue( "/Plugin-GeoReferencer/Config/WarpMemoryLimit", mWarpMemorySpinBox->value() );
+  s.setValue( "/Plugin-GeoReferencer/Config/WarpMaxError", mWarpMaxErrorSpinBox->value() );
 
   s.setValue( "/Plugin-GeoReferencer/Config/WidthPDFMap", mPaperSizeComboBox->itemData( mPaperSizeComboBox->currentIndex() ).toSizeF().width() );
   s.setValue( "/Plugin-GeoReferencer/Config/HeightPDFMap", mPaperSizeComboBox->itemData( mPaperSizeComboBox->currentIndex() ).toSizeF().height() );
@@ -16,6 +16,7 @@
 
 #include <QDesktopWidget>
 #include <QDialogButtonBox>
+#include <QDir>
 #include <QClipboard>
 #include <QFileDialog>
 #include <QFileInfo>
@@ -303,6 +304,51 @@ void QgsGeorefPluginGui::doGeoreference()
   }
 }
 
+void QgsGeorefPluginGui::batchGeoreference()
+{
+  if ( QgsGeorefTransform::InvalidTransform == mTransformParam )
+  {
+    QMessageBox::information( this, tr( "Info" ), tr( "Please set transformation type" ) );
+    if ( !getTransformSettings() )
+      return;
+  }
+
+  QSettings s;
+  QString dir = QFileDialog::getExistingDirectory( this, tr( "Choose a directory of rasters with GCP files" ),
+                s.value( "/Plugin-GeoReferencer/rasterdirectory" ).toString() );
+  if ( dir.isEmpty() )
+    return;
+
+  // every raster with a .points file next to it
+  QStringList inputs, outputs;
+  QDir rasterDir( dir );
+  foreach( QString name, rasterDir.entryList( QDir::Files, QDir::Name ) )
+  {
+    QString fileName = rasterDir.filePath( name );
+    if ( name.endsWith( ".points" ) || !QFile::exists( fileName + ".points" ) )
+      continue;
+
+    inputs << fileName;
+    outputs << QgsTransformSettingsDialog::generateModifiedRasterFileName( fileName );
+  }
+
+  if ( inputs.isEmpty() )
+  {
+    QMessageBox::information( this, tr( "Info" ), tr( "No raster with GCP file found in %1" ).arg( dir ) );
+    return;
+  }
+
+  QgsImageWarper warper( this );
+  warper.setMemoryLimit( s.value( "/Plugin-GeoReferencer/Config/WarpMemoryLimit", 256 ).toInt() );
+  warper.setMaxError( s.value( "/Plugin-GeoReferencer/Config/WarpMaxError", 0.125 ).toDouble() );
+  int res = warper.warpFiles( inputs, outputs, mTransformParam, mResamplingMethod,
+                              mUseZeroForTrans, mCompressionMethod, mProjection );
+  if ( res == -1 ) // operation canceled
+    return;
+
+  QMessageBox::information( this, tr( "Info" ), tr( "%1 of %2 rasters georeferenced" ).arg( res ).arg( inputs.size() ) );
+}
+
 bool QgsGeorefPluginGui::getTransformSettings()
 {
   QgsTransformSettingsDialog d( mRasterFileName, mModifiedRasterFileName, mPoints.size() );
@@ -792,6 +838,8 @@ void QgsGeorefPluginGui::createActions()
   mActionGDALScript->setIcon( getThemeIcon( "/mActionGDALScript.png" ) );
   connect( mActionGDALScript, SIGNAL( triggered() ), this, SLOT( generateGDALScript() ) );
 
+  connect( mActionBatchGeoref, SIGNAL( triggered() ), this, SLOT( batchGeoreference() ) );
+
   mActionLoadGCPpoints->setIcon( getThemeIcon( "/mActionLoadGCPpoints.png" ) );
   connect( mActionLoadGCPpoints, SIGNAL( triggered() ), this, SLOT( loadGCPsDialog() ) );
 
@@ -1080,40 +1128,15 @@ void QgsGeorefPluginGui::writeSettings()
 // GCP points
 void QgsGeorefPluginGui::loadGCPs( /*bool verbose*/ )
 {
-  QFile pointFile( mGCPpointsFileName );
-  if ( pointFile.open( QIODevice::ReadOnly ) )
+  std::vector<QgsPoint> mapCoords, pixelCoords;
+  std::vector<bool> enabled;
+  if ( QgsImageWarper::readGCPs( mGCPpointsFileName, mapCoords, pixelCoords, &enabled ) )
   {
     clearGCPData();
 
-    QTextStream points( &pointFile );
-    QString line = points.readLine();
-    int i = 0;
-    while ( !points.atEnd() )
+    for ( unsigned int i = 0; i < mapCoords.size(); ++i )
     {
-      line = points.readLine();
-      QStringList ls;
-      if ( line.contains( QRegExp( "," ) ) ) // in previous format "\t" is delimeter of points in new - ","
-      {
-        // points from new georeferencer
-        ls = line.split( "," );
-      }
-      else
-      {
-        // points from prev georeferencer
-        ls = line.split( "\t" );
-      }
-
-      QgsPoint mapCoords( ls.at( 0 ).toDouble(), ls.at( 1 ).toDouble() ); // map x,y
-      QgsPoint pixelCoords( ls.at( 2 ).toDouble(), ls.at( 3 ).toDouble() ); // pixel x,y
-      if ( ls.count() == 5 )
-      {
-        bool enable = ls.at( 4 ).toInt();
-        addPoint( pixelCoords, mapCoords, enable, false/*, verbose*/ ); // enabled
-      }
-      else
-        addPoint( pixelCoords, mapCoords, true, false );
-
-      ++i;
+      addPoint( pixelCoords[i], mapCoords[i], enabled[i], false/*, verbose*/ );
     }
 
     mInitialPoints = mPoints;
@@ -1231,6 +1254,9 @@ bool QgsGeorefPluginGui::georeference()
   else // Helmert, Polinom 1, Polinom 2, Polinom 3
   {
     QgsImageWarper warper( this );
+    QSettings s;
+    warper.setMemoryLimit( s.value( "/Plugin-GeoReferencer/Config/WarpMemoryLimit", 256 ).toInt() );
+    warper.setMaxError( s.value( "/Plugin-GeoReferencer/Config/WarpMaxError", 0.125 ).toDouble() );
     int res = warper.warpFile( mRasterFileName, mModifiedRasterFileName, mGeorefTransform,
                                mResamplingMethod, mUseZeroForTrans, mCompressionMethod, mProjection, mUserResX, mUserResY );
     if ( res == 0 ) // fault to compute GCP transform
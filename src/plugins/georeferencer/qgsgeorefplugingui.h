@@ -54,6 +54,7 @@ class QgsGeorefPluginGui : public QMainWindow, private Ui::QgsGeorefPluginGuiBas
     // file
     void openRaster();
     void doGeoreference();
+    void batchGeoreference();
     void generateGDALScript();
     bool getTransformSettings();
 
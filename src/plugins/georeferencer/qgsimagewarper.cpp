@@ -22,25 +22,84 @@
 #include <cpl_conv.h>
 #include <cpl_string.h>
 #include <gdal.h>
+#include <gdal_alg.h>
 #include <gdalwarper.h>
 #include <ogr_spatialref.h>
 
+#include <QApplication>
 #include <QFile>
+#include <QFutureWatcher>
+#include <QMutex>
 #include <QProgressDialog>
+#include <QTextStream>
+#include <QVector>
+#include <QtConcurrentMap>
 
 #include "qgsimagewarper.h"
 #include "qgsgeoreftransform.h"
 
-bool QgsImageWarper::mWarpCanceled = false;
+struct QgsImageWarper::WarpJob
+{
+  QString input;
+  QString output;
+  //! transform to use, 0 to fit one of type parametrisation to the GCPs of the input
+  const QgsGeorefTransform *transform;
+  QgsGeorefTransform::TransformParametrisation parametrisation;
+  ResamplingMethod resampling;
+  bool useZeroAsTrans;
+  QString compression;
+  QString projection;
+  double destResX;
+  double destResY;
+  //! position of the job in its progress
+  int index;
+};
+
+struct QgsImageWarper::WarpProgress
+{
+  //! argument of the GDAL progress callback of one job
+  struct JobArg
+  {
+    WarpProgress *progress;
+    int index;
+  };
+
+  QProgressDialog *dialog;
+  QAtomicInt canceled;
+
+  //! completed fraction of each job and the overall percentage
+  QMutex mutex;
+  QVector<double> complete;
+  int percent;
+};
+
+class QgsImageWarper::WarpFunctor
+{
+  public:
+    typedef int result_type;
+
+    WarpFunctor( const QgsImageWarper *warper, WarpProgress *progress )
+        : mWarper( warper )
+        , mProgress( progress )
+    {}
+
+    int operator()( const WarpJob &job ) { return mWarper->warpJob( job, mProgress ); }
+
+  private:
+    const QgsImageWarper *mWarper;
+    WarpProgress *mProgress;
+};
 
 QgsImageWarper::QgsImageWarper( QWidget *theParent )
     : mParent( theParent )
+    , mMemoryLimit( 0 )
+    , mMaxError( 0.0 )
 {
 }
 
 bool QgsImageWarper::openSrcDSAndGetWarpOpt( const QString &input, const ResamplingMethod &resampling,
     const GDALTransformerFunc &pfnTransform,
-    GDALDatasetH &hSrcDS, GDALWarpOptions *&psWarpOptions )
+    GDALDatasetH &hSrcDS, GDALWarpOptions *&psWarpOptions ) const
 {
   // Open input file
   GDALAllRegister();
@@ -70,7 +129,7 @@ bool QgsImageWarper::openSrcDSAndGetWarpOpt( const QString &input, const Resampl
 bool QgsImageWarper::createDestinationDataset(
   const QString &outputName, GDALDatasetH hSrcDS, GDALDatasetH &hDstDS,
   uint resX, uint resY, double *adfGeoTransform, bool useZeroAsTrans,
-  const QString& compression, const QString &projection )
+  const QString& compression, const QString &projection ) const
 {
   // create the output file
   GDALDriverH driver = GDALGetDriverByName( "GTiff" );
@@ -156,27 +215,183 @@ int QgsImageWarper::warpFile( const QString& input,
   if ( !georefTransform.parametersInitialized() )
     return false;
 
+  WarpJob job;
+  job.input = input;
+  job.output = output;
+  job.transform = &georefTransform;
+  job.parametrisation = georefTransform.transformParametrisation();
+  job.resampling = resampling;
+  job.useZeroAsTrans = useZeroAsTrans;
+  job.compression = compression;
+  job.projection = projection;
+  job.destResX = destResX;
+  job.destResY = destResY;
+  job.index = 0;
+
+  return runJobs( QList<WarpJob>() << job );
+}
+
+int QgsImageWarper::warpFiles( const QStringList& inputs,
+                               const QStringList& outputs,
+                               QgsGeorefTransform::TransformParametrisation parametrisation,
+                               ResamplingMethod resampling,
+                               bool useZeroAsTrans,
+                               const QString& compression,
+                               const QString& projection )
+{
+  QList<WarpJob> jobs;
+  for ( int i = 0; i < inputs.size() && i < outputs.size(); ++i )
+  {
+    WarpJob job;
+    job.input = inputs[i];
+    job.output = outputs[i];
+    job.transform = 0;
+    job.parametrisation = parametrisation;
+    job.resampling = resampling;
+    job.useZeroAsTrans = useZeroAsTrans;
+    job.compression = compression;
+    job.projection = projection;
+    job.destResX = 0.0;
+    job.destResY = 0.0;
+    job.index = i;
+    jobs << job;
+  }
+
+  return runJobs( jobs );
+}
+
+bool QgsImageWarper::readGCPs( const QString& fileName, std::vector<QgsPoint> &mapCoords, std::vector<QgsPoint> &pixelCoords,
+                               std::vector<bool> *enabled )
+{
+  QFile pointFile( fileName );
+  if ( !pointFile.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QTextStream points( &pointFile );
+  // skip the header
+  points.readLine();
+  while ( !points.atEnd() )
+  {
+    QString line = points.readLine();
+    // in previous format "\t" is delimeter of points in new - ","
+    QStringList ls = line.split( line.contains( "," ) ? "," : "\t" );
+    if ( ls.count() < 4 )
+      continue;
+
+    bool enable = ls.count() != 5 || ls.at( 4 ).toInt();
+    // disabled points are only returned together with their flags
+    if ( !enable && !enabled )
+      continue;
+
+    mapCoords.push_back( QgsPoint( ls.at( 0 ).toDouble(), ls.at( 1 ).toDouble() ) );
+    pixelCoords.push_back( QgsPoint( ls.at( 2 ).toDouble(), ls.at( 3 ).toDouble() ) );
+    if ( enabled )
+      enabled->push_back( enable );
+  }
+
+  return true;
+}
+
+int QgsImageWarper::runJobs( const QList<WarpJob> &jobs )
+{
+  // Create a QT progress dialog
+  QProgressDialog *progressDialog = new QProgressDialog( mParent );
+  progressDialog->setWindowTitle( tr( "Progress indication" ) );
+  progressDialog->setRange( 0, 100 );
+  progressDialog->setAutoClose( true );
+  progressDialog->setModal( true );
+  progressDialog->setMinimumDuration( 0 );
+
+  WarpProgress progress;
+  progress.dialog = progressDialog;
+  progress.canceled = 0;
+  progress.percent = 0;
+  progress.complete.fill( 0.0, jobs.size() );
+
+  progressDialog->show();
+  progressDialog->raise();
+  progressDialog->activateWindow();
+
+  QFuture<int> future = QtConcurrent::mapped( jobs, WarpFunctor( this, &progress ) );
+
+  // the watcher posts an event when the jobs are done, which ends the wait for events
+  QFutureWatcher<int> watcher;
+  watcher.setFuture( future );
+  while ( !future.isFinished() )
+  {
+    qApp->processEvents( QEventLoop::WaitForMoreEvents );
+    if ( progressDialog->wasCanceled() && progress.canceled == 0 )
+    {
+      // abort the running jobs and don't start the queued ones
+      progress.canceled = 1;
+      future.cancel();
+    }
+  }
+  future.waitForFinished();
+
+  delete progressDialog;
+
+  if ( progress.canceled != 0 )
+    return -1;
+
+  int warped = 0;
+  QList<int> results = future.results();
+  for ( int i = 0; i < results.size(); ++i )
+  {
+    if ( results[i] == 1 )
+      warped++;
+  }
+  return warped;
+}
+
+int QgsImageWarper::warpJob( const WarpJob &job, WarpProgress *progress ) const
+{
+  // in batch mode the transform is fitted to the GCPs saved with the input
+  QgsGeorefTransform fittedTransform;
+  const QgsGeorefTransform *georefTransform = job.transform;
+  if ( progress->canceled != 0 )
+    return -1;
+
+  if ( !georefTransform )
+  {
+    std::vector<QgsPoint> mapCoords, pixelCoords;
+    fittedTransform.selectTransformParametrisation( job.parametrisation );
+    if ( !readGCPs( job.input + ".points", mapCoords, pixelCoords )
+         || mapCoords.size() < fittedTransform.getMinimumGCPCount()
+         || !fittedTransform.updateParametersFromGCPs( mapCoords, pixelCoords ) )
+    {
+      return 0;
+    }
+    georefTransform = &fittedTransform;
+  }
+
+  if ( !georefTransform->parametersInitialized() )
+    return 0;
+
   CPLErr eErr;
   GDALDatasetH hSrcDS, hDstDS;
   GDALWarpOptions *psWarpOptions;
-  if ( !openSrcDSAndGetWarpOpt( input, resampling, georefTransform.GDALTransformer(), hSrcDS, psWarpOptions ) )
+  if ( !openSrcDSAndGetWarpOpt( job.input, job.resampling, georefTransform->GDALTransformer(), hSrcDS, psWarpOptions ) )
   {
     // TODO: be verbose about failures
-    return false;
+    return 0;
   }
 
   double adfGeoTransform[6];
   int destPixels, destLines;
-  eErr = GDALSuggestedWarpOutput( hSrcDS, georefTransform.GDALTransformer(),
-                                  georefTransform.GDALTransformerArgs(),
+  eErr = GDALSuggestedWarpOutput( hSrcDS, georefTransform->GDALTransformer(),
+                                  georefTransform->GDALTransformerArgs(),
                                   adfGeoTransform, &destPixels, &destLines );
   if ( eErr != CE_None )
   {
     GDALClose( hSrcDS );
     GDALDestroyWarpOptions( psWarpOptions );
-    return false;
+    return 0;
   }
 
+  double destResX = job.destResX;
+  double destResY = job.destResY;
+
   // If specified, override the suggested resolution with user values
   if ( destResX != 0.0 || destResY != 0.0 )
   {
@@ -206,55 +421,85 @@ int QgsImageWarper::warpFile( const QString& input,
     adfGeoTransform[5] = destResY;
   }
 
-  if ( !createDestinationDataset( output, hSrcDS, hDstDS, destPixels, destLines,
-                                  adfGeoTransform, useZeroAsTrans, compression,
-                                  projection ) )
+  if ( progress->canceled != 0 )
   {
     GDALClose( hSrcDS );
     GDALDestroyWarpOptions( psWarpOptions );
-    return false;
+    return -1;
   }
 
-  // Create a QT progress dialog
-  QProgressDialog *progressDialog = new QProgressDialog( mParent );
-  progressDialog->setWindowTitle( tr( "Progress indication" ) );
-  progressDialog->setRange( 0, 100 );
-  progressDialog->setAutoClose( true );
-  progressDialog->setModal( true );
-  progressDialog->setMinimumDuration( 0 );
+  if ( !createDestinationDataset( job.output, hSrcDS, hDstDS, destPixels, destLines,
+                                  adfGeoTransform, job.useZeroAsTrans, job.compression,
+                                  job.projection ) )
+  {
+    GDALClose( hSrcDS );
+    GDALDestroyWarpOptions( psWarpOptions );
+    return 0;
+  }
 
   // Set GDAL callbacks for the progress dialog
-  psWarpOptions->pProgressArg = createWarpProgressArg( progressDialog );
+  WarpProgress::JobArg progressArg;
+  progressArg.progress = progress;
+  progressArg.index = job.index;
+  psWarpOptions->pProgressArg = &progressArg;
   psWarpOptions->pfnProgress  = updateWarpProgress;
 
   psWarpOptions->hSrcDS = hSrcDS;
   psWarpOptions->hDstDS = hDstDS;
 
+  // Size of the chunks, which are read, warped and written in turn
+  psWarpOptions->dfWarpMemoryLimit = mMemoryLimit * 1024.0 * 1024.0;
+  // Warp each chunk on all cores (honored by GDAL 1.10 and later)
+  psWarpOptions->papszWarpOptions = CSLSetNameValue( psWarpOptions->papszWarpOptions, "NUM_THREADS", "ALL_CPUS" );
+
   // Create a transformer which transforms from source to destination pixels (and vice versa)
-  psWarpOptions->pfnTransformer  = GeoToPixelTransform;
-  psWarpOptions->pTransformerArg = addGeoToPixelTransform( georefTransform.GDALTransformer(),
-                                   georefTransform.GDALTransformerArgs(),
-                                   adfGeoTransform );
+  void *geoToPixelArg = addGeoToPixelTransform( georefTransform->GDALTransformer(),
+                        georefTransform->GDALTransformerArgs(),
+                        adfGeoTransform );
+
+  // Transforms which are not affine are expensive to evaluate (e.g. thin plate splines),
+  // interpolate them between exactly transformed points within the error threshold
+  void *approxArg = NULL;
+  if ( mMaxError > 0.0 && geoToPixelArg && !georefTransform->providesAccurateInverseTransformation() )
+  {
+    approxArg = GDALCreateApproxTransformer( GeoToPixelTransform, geoToPixelArg, mMaxError );
+  }
+
+  if ( approxArg )
+  {
+    psWarpOptions->pfnTransformer  = GDALApproxTransform;
+    psWarpOptions->pTransformerArg = approxArg;
+  }
+  else
+  {
+    psWarpOptions->pfnTransformer  = GeoToPixelTransform;
+    psWarpOptions->pTransformerArg = geoToPixelArg;
+  }
 
   // Initialize and execute the warp operation.
   GDALWarpOperation oOperation;
   oOperation.Initialize( psWarpOptions );
 
-  progressDialog->show();
-  progressDialog->raise();
-  progressDialog->activateWindow();
-
-  eErr = oOperation.ChunkAndWarpImage( 0, 0, destPixels, destLines );
-//  eErr = oOperation.ChunkAndWarpMulti(0, 0, destPixels, destLines);
+  // Chunks are warped on a separate thread while the previous one is written
+  eErr = oOperation.ChunkAndWarpMulti( 0, 0, destPixels, destLines );
 
-  destroyGeoToPixelTransform( psWarpOptions->pTransformerArg );
+  if ( approxArg )
+  {
+    GDALDestroyApproxTransformer( approxArg );
+  }
+  destroyGeoToPixelTransform( geoToPixelArg );
   GDALDestroyWarpOptions( psWarpOptions );
-  delete progressDialog;
 
   GDALClose( hSrcDS );
   GDALClose( hDstDS );
 
-  return mWarpCanceled ? -1 : eErr == CE_None ? 1 : 0;
+  int result = progress->canceled != 0 ? -1 : eErr == CE_None ? 1 : 0;
+  if ( result != 1 )
+  {
+    // don't leave a partially warped file behind
+    QFile::remove( job.output );
+  }
+  return result;
 }
 
 
@@ -324,23 +569,29 @@ int QgsImageWarper::GeoToPixelTransform( void *pTransformerArg, int bDstToSrc, i
   return true;
 }
 
-void *QgsImageWarper::createWarpProgressArg( QProgressDialog *progressDialog ) const
-{
-  return ( void * )progressDialog;
-}
-
 int CPL_STDCALL QgsImageWarper::updateWarpProgress( double dfComplete, const char *pszMessage, void *pProgressArg )
 {
-  QProgressDialog *progress = static_cast<QProgressDialog*>( pProgressArg );
-  progress->setValue( qMin( 100u, ( uint )( dfComplete*100.0 ) ) );
-  qApp->processEvents();
-  // TODO: call QEventLoop manually to make "cancel" button more responsive
-  if ( progress->wasCanceled() )
+  Q_UNUSED( pszMessage );
+  WarpProgress::JobArg *arg = static_cast<WarpProgress::JobArg *>( pProgressArg );
+  WarpProgress *progress = arg->progress;
+
+  progress->mutex.lock();
+  progress->complete[ arg->index ] = dfComplete;
+  double sum = 0.0;
+  for ( int i = 0; i < progress->complete.size(); ++i )
   {
-    mWarpCanceled = true;
-    return false;
+    sum += progress->complete[i];
   }
+  int percent = qMin( 100, ( int )( sum * 100.0 / progress->complete.size() ) );
+  bool changed = percent != progress->percent;
+  progress->percent = percent;
+  progress->mutex.unlock();
 
-  mWarpCanceled = false;
-  return true;
+  // called from the warping threads, the dialog is updated by the GUI thread
+  if ( changed )
+  {
+    QMetaObject::invokeMethod( progress->dialog, "setValue", Qt::QueuedConnection, Q_ARG( int, percent ) );
+  }
+
+  return progress->canceled == 0;
 }
@@ -18,12 +18,13 @@
 
 #include <QCoreApplication>
 #include <QString>
+#include <QStringList>
 
 #include <gdalwarper.h>
 #include <vector>
 #include "qgspoint.h"
+#include "qgsgeoreftransform.h"
 
-class QgsGeorefTransform;
 class QProgressDialog;
 class QWidget;
 
@@ -43,6 +44,17 @@ class QgsImageWarper
       Lanczos          = GRA_Lanczos
     };
 
+    //! \brief Sets the memory GDAL may use for a chunk of the warp operation, in megabytes. Zero means the GDAL default.
+    void setMemoryLimit( int megabytes ) { mMemoryLimit = megabytes; }
+
+    /**
+     * \brief Sets the error threshold (in pixels) for transforms which are not affine.
+     *
+     * Polynomial, projective and thin plate spline transforms are then evaluated exactly only at a few points
+     * per scanline and interpolated linearly in between. Zero evaluates the transform for every pixel.
+     */
+    void setMaxError( double pixels ) { mMaxError = pixels; }
+
     /**
      * Warp the file specified by "input" and write the resulting raster to the file "output".
      * \param georefTransform Specified the warp transformation which should be applied to "input".
@@ -59,6 +71,27 @@ class QgsImageWarper
                   const QString& compression,
                   const QString& projection,
                   double destResX = 0.0, double destResY = 0.0 );
+
+    /**
+     * Warps the files "inputs" concurrently and writes the results to the files "outputs".
+     * Each input is warped with a transform of type "parametrisation", fitted to the GCPs of its ".points" file.
+     * \returns the number of warped files, -1 if canceled
+     */
+    int warpFiles( const QStringList& inputs,
+                   const QStringList& outputs,
+                   QgsGeorefTransform::TransformParametrisation parametrisation,
+                   ResamplingMethod resampling,
+                   bool useZeroAsTrans,
+                   const QString& compression,
+                   const QString& projection );
+
+    /**
+     * Reads the GCPs of a ".points" file written by the georeferencer.
+     * Without "enabled" only the enabled GCPs are returned, otherwise all GCPs together with their enabled flags.
+     */
+    static bool readGCPs( const QString& fileName, std::vector<QgsPoint> &mapCoords, std::vector<QgsPoint> &pixelCoords,
+                          std::vector<bool> *enabled = 0 );
+
   private:
     struct TransformChain
     {
@@ -68,6 +101,12 @@ class QgsImageWarper
       double              adfInvGeotransform[6];
     };
 
+    //! \brief Warp operation of one file, executed on a worker thread
+    struct WarpJob;
+    //! \brief Progress and cancel state shared by the jobs of a warpFile / warpFiles call
+    struct WarpProgress;
+    class WarpFunctor;
+
     //! \sa addGeoToPixelTransform
     static int GeoToPixelTransform( void *pTransformerArg, int bDstToSrc, int nPointCount,
                                     double *x, double *y, double *z, int *panSuccess );
@@ -85,17 +124,23 @@ class QgsImageWarper
 
     bool openSrcDSAndGetWarpOpt( const QString &input, const ResamplingMethod &resampling,
                                  const GDALTransformerFunc &pfnTransform, GDALDatasetH &hSrcDS,
-                                 GDALWarpOptions *&psWarpOptions );
+                                 GDALWarpOptions *&psWarpOptions ) const;
 
     bool createDestinationDataset( const QString &outputName, GDALDatasetH hSrcDS, GDALDatasetH &hDstDS, uint resX, uint resY,
-                                   double *adfGeoTransform, bool useZeroAsTrans, const QString& compression, const QString &projection );
+                                   double *adfGeoTransform, bool useZeroAsTrans, const QString& compression, const QString &projection ) const;
+
+    //! \brief Runs the jobs concurrently while a progress dialog is shown, returns the number of warped files or -1 if canceled
+    int runJobs( const QList<WarpJob> &jobs );
+
+    //! \brief Warps one file, returns 1 on success, 0 on failure and -1 if canceled
+    int warpJob( const WarpJob &job, WarpProgress *progress ) const;
 
     QWidget *mParent;
-    void      *createWarpProgressArg( QProgressDialog *progressDialog ) const;
-    //! \brief GDAL progress callback, used to display warping progress via a QProgressDialog
-    static int CPL_STDCALL updateWarpProgress( double dfComplete, const char *pszMessage, void *pProgressArg );
+    int mMemoryLimit;
+    double mMaxError;
 
-    static bool mWarpCanceled;
+    //! \brief GDAL progress callback, passes the progress of a job on to the progress dialog and checks for cancellation
+    static int CPL_STDCALL updateWarpProgress( double dfComplete, const char *pszMessage, void *pProgressArg );
 };
 
 
@@ -35,6 +35,8 @@ class QgsTransformSettingsDialog : public QDialog, private Ui::QgsTransformSetti
                                QString &raster, QString &proj, QString& pdfMapFile, QString& pdfReportFile, bool &zt, bool &loadInQgis,
                                double& resX, double& resY );
     static void resetSettings();
+    //! \brief Default name of the warped raster: "_modified" appended to the base name, in GeoTIFF format
+    static QString generateModifiedRasterFileName( const QString &raster );
 
   protected:
     void changeEvent( QEvent *e );
@@ -52,7 +54,6 @@ class QgsTransformSettingsDialog : public QDialog, private Ui::QgsTransformSetti
 
   private:
     bool checkGCPpoints( int count, int &minGCPpoints );
-    QString generateModifiedRasterFileName( const QString &raster );
 
     QRegExpValidator *mRegExpValidator;
     QString mModifiedRaster;
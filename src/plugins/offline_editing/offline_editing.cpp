@@ -20,6 +20,8 @@
 #include "offline_editing_progress_dialog.h"
 
 #include <qgsapplication.h>
+#include <qgscoordinatetransform.h>
+#include <qgscsexception.h>
 #include <qgsdatasourceuri.h>
 #include <qgsgeometry.h>
 #include <qgslegendinterface.h>
@@ -33,6 +35,7 @@
 #include <QDomNode>
 #include <QFile>
 #include <QMessageBox>
+#include <QSet>
 
 extern "C"
 {
@@ -50,6 +53,9 @@ extern "C"
 #define PROJECT_ENTRY_SCOPE_OFFLINE "OfflineEditingPlugin"
 #define PROJECT_ENTRY_KEY_OFFLINE_DB_PATH "/OfflineDbPath"
 
+// number of features copied within one transaction
+static const int sCopyTransactionSize = 10000;
+
 QgsOfflineEditing::QgsOfflineEditing( QgsOfflineEditingProgressDialog* progressDialog )
 {
   mProgressDialog = progressDialog;
@@ -69,7 +75,8 @@ QgsOfflineEditing::~QgsOfflineEditing()
  * convert current project to offline project
  * returns offline project file path
  */
-bool QgsOfflineEditing::convertToOfflineProject( const QString& offlineDataPath, const QString& offlineDbFile, const QStringList& layerIds )
+bool QgsOfflineEditing::convertToOfflineProject( const QString& offlineDataPath, const QString& offlineDbFile, const QStringList& layerIds,
+    const QgsRectangle& extent, const QgsCoordinateReferenceSystem& extentCrs )
 {
   if ( layerIds.isEmpty() )
   {
@@ -98,8 +105,12 @@ bool QgsOfflineEditing::convertToOfflineProject( const QString& offlineDataPath,
       {
         mProgressDialog->setCurrentLayer( i + 1, layerIds.count() );
 
-        QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerIds.at( i ) );
-        copyVectorLayer( qobject_cast<QgsVectorLayer*>( layer ), db, dbPath );
+        QgsVectorLayer* layer = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( layerIds.at( i ) ) );
+        if ( layer == NULL )
+        {
+          continue;
+        }
+        copyVectorLayer( layer, db, dbPath, layerExtent( layer, extent, extentCrs ) );
       }
 
       mProgressDialog->hide();
@@ -135,6 +146,27 @@ bool QgsOfflineEditing::convertToOfflineProject( const QString& offlineDataPath,
   // mark as offline project
 }
 
+QgsRectangle QgsOfflineEditing::layerExtent( QgsVectorLayer* layer, const QgsRectangle& extent, const QgsCoordinateReferenceSystem& extentCrs )
+{
+  QgsCoordinateReferenceSystem layerCrs = layer->crs();
+  if ( extent.isEmpty() || !extentCrs.isValid() || layerCrs == extentCrs )
+  {
+    return extent;
+  }
+
+  try
+  {
+    QgsCoordinateTransform ct( extentCrs, layerCrs );
+    return ct.transformBoundingBox( extent );
+  }
+  catch ( QgsCsException &cse )
+  {
+    Q_UNUSED( cse );
+    showWarning( tr( "Could not transform the extent to the coordinate system of layer %1, all features are copied" ).arg( layer->name() ) );
+    return QgsRectangle();
+  }
+}
+
 bool QgsOfflineEditing::isOfflineProject()
 {
   return !QgsProject::instance()->readEntry( PROJECT_ENTRY_SCOPE_OFFLINE, PROJECT_ENTRY_KEY_OFFLINE_DB_PATH ).isEmpty();
@@ -196,23 +228,38 @@ void QgsOfflineEditing::synchronize( QgsLegendInterface* legendInterface )
       {
         remoteLayer->startEditing();
 
+        // NOTE: read the fid lookup once instead of querying it for each logged change
+        QMap<int, int> fidLookup = sqlQueryFidLookup( db, layerId );
+
         // TODO: only get commitNos of this layer?
         int commitNo = getCommitNo( db );
         for ( int i = 0; i < commitNo; i++ )
         {
           // apply commits chronologically
           applyAttributesAdded( remoteLayer, db, layerId, i );
-          applyAttributeValueChanges( offlineLayer, remoteLayer, db, layerId, i );
-          applyGeometryChanges( remoteLayer, db, layerId, i );
+          applyAttributeValueChanges( offlineLayer, remoteLayer, db, layerId, i, fidLookup );
+          applyGeometryChanges( remoteLayer, db, layerId, i, fidLookup );
         }
 
-        applyFeaturesAdded( offlineLayer, remoteLayer, db, layerId );
-        applyFeaturesRemoved( remoteLayer, db, layerId );
+        QList<int> addedOfflineFids = applyFeaturesAdded( offlineLayer, remoteLayer, db, layerId );
+        applyFeaturesRemoved( remoteLayer, db, layerId, fidLookup );
+
+        // NOTE: remote fids above the highest one before the commit belong to the added features
+        int maxRemoteFid = addedOfflineFids.isEmpty() ? -1 : maxProviderFid( remoteLayer );
+
+        // the edit buffer hands each kind of change to the provider in one call,
+        // the fids of the added features are reported back with committedFeaturesAdded
+        mRemoteAddedFids.clear();
+        connect( remoteLayer, SIGNAL( committedFeaturesAdded( const QString&, const QgsFeatureList& ) ),
+                 this, SLOT( committedRemoteFeaturesAdded( const QString&, const QgsFeatureList& ) ) );
+        bool committed = remoteLayer->commitChanges();
+        disconnect( remoteLayer, SIGNAL( committedFeaturesAdded( const QString&, const QgsFeatureList& ) ),
+                    this, SLOT( committedRemoteFeaturesAdded( const QString&, const QgsFeatureList& ) ) );
 
-        if ( remoteLayer->commitChanges() )
+        if ( committed )
         {
           // update fid lookup
-          updateFidLookup( remoteLayer, db, layerId );
+          updateFidLookup( remoteLayer, db, layerId, addedOfflineFids, maxRemoteFid );
 
           // clear edit log for this layer
           sql = QString( "DELETE FROM 'log_added_attrs' WHERE \"layer_id\" = %1" ).arg( layerId );
@@ -376,6 +423,10 @@ void QgsOfflineEditing::createLoggingTables( sqlite3* db )
   sql = "CREATE TABLE 'log_added_features' ('layer_id' INTEGER, 'fid' INTEGER)";
   sqlExec( db, sql );
 
+  // NOTE: each logged change looks up whether its feature was added offline
+  sql = "CREATE INDEX 'log_added_features_fid' ON 'log_added_features' ('layer_id', 'fid')";
+  sqlExec( db, sql );
+
   // removed features
   sql = "CREATE TABLE 'log_removed_features' ('layer_id' INTEGER, 'fid' INTEGER)";
   sqlExec( db, sql );
@@ -393,7 +444,7 @@ void QgsOfflineEditing::createLoggingTables( sqlite3* db )
   */
 }
 
-void QgsOfflineEditing::copyVectorLayer( QgsVectorLayer* layer, sqlite3* db, const QString& offlineDbPath )
+void QgsOfflineEditing::copyVectorLayer( QgsVectorLayer* layer, sqlite3* db, const QString& offlineDbPath, const QgsRectangle& extent )
 {
   if ( layer == NULL )
   {
@@ -463,117 +514,167 @@ void QgsOfflineEditing::copyVectorLayer( QgsVectorLayer* layer, sqlite3* db, con
                        .arg( layer->crs().epsg() )
                        .arg( geomType );
 
-  // create spatial index
+  // NOTE: the spatial index is created after the features are copied, building it at once is much faster than updating it with each insert
   QString sqlCreateIndex = QString( "SELECT CreateSpatialIndex('%1', 'Geometry')" ).arg( tableName );
 
   int rc = sqlExec( db, sql );
   if ( rc == SQLITE_OK )
   {
     rc = sqlExec( db, sqlAddGeom );
-    if ( rc == SQLITE_OK )
-    {
-      rc = sqlExec( db, sqlCreateIndex );
-    }
+  }
+  if ( rc != SQLITE_OK )
+  {
+    return;
   }
 
-  if ( rc == SQLITE_OK )
+  // copy features
+  QList<int> offlineFeatureIds;
+  QList<int> remoteFeatureIds;
+  if ( !copyFeatures( layer, db, tableName, extent, offlineFeatureIds, remoteFeatureIds ) )
   {
-    // add new layer
-    QgsVectorLayer* newLayer = new QgsVectorLayer( QString( "dbname='%1' table='%2'(Geometry) sql=" )
-        .arg( offlineDbPath ).arg( tableName ), tableName + " (offline)", "spatialite" );
-    if ( newLayer->isValid() )
-    {
-      // mark as offline layer
-      newLayer->setCustomProperty( CUSTOM_PROPERTY_IS_OFFLINE_EDITABLE, true );
+    return;
+  }
 
-      // store original layer source
-      newLayer->setCustomProperty( CUSTOM_PROPERTY_REMOTE_SOURCE, layer->source() );
-      newLayer->setCustomProperty( CUSTOM_PROPERTY_REMOTE_PROVIDER, layer->providerType() );
+  if ( sqlExec( db, sqlCreateIndex ) != SQLITE_OK )
+  {
+    return;
+  }
 
-      // copy style
-      bool hasLabels = layer->hasLabelsEnabled();
-      if ( !hasLabels )
-      {
-        // NOTE: copy symbology before adding the layer so it is displayed correctly
-        copySymbology( layer, newLayer );
-      }
+  // add new layer
+  QgsVectorLayer* newLayer = new QgsVectorLayer( QString( "dbname='%1' table='%2'(Geometry) sql=" )
+      .arg( offlineDbPath ).arg( tableName ), tableName + " (offline)", "spatialite" );
+  if ( newLayer->isValid() )
+  {
+    // mark as offline layer
+    newLayer->setCustomProperty( CUSTOM_PROPERTY_IS_OFFLINE_EDITABLE, true );
 
-      // register this layer with the central layers registry
-      QgsMapLayerRegistry::instance()->addMapLayer( newLayer );
+    // store original layer source
+    newLayer->setCustomProperty( CUSTOM_PROPERTY_REMOTE_SOURCE, layer->source() );
+    newLayer->setCustomProperty( CUSTOM_PROPERTY_REMOTE_PROVIDER, layer->providerType() );
 
-      if ( hasLabels )
-      {
-        // NOTE: copy symbology of layers with labels enabled after adding to project, as it will crash otherwise (WORKAROUND)
-        copySymbology( layer, newLayer );
-      }
+    // copy style
+    bool hasLabels = layer->hasLabelsEnabled();
+    if ( !hasLabels )
+    {
+      // NOTE: copy symbology before adding the layer so it is displayed correctly
+      copySymbology( layer, newLayer );
+    }
 
-      // TODO: layer order
+    // register this layer with the central layers registry
+    QgsMapLayerRegistry::instance()->addMapLayer( newLayer );
 
-      // copy features
-      newLayer->startEditing();
-      QgsFeature f;
+    if ( hasLabels )
+    {
+      // NOTE: copy symbology of layers with labels enabled after adding to project, as it will crash otherwise (WORKAROUND)
+      copySymbology( layer, newLayer );
+    }
 
-      // NOTE: force feature recount for PostGIS layer, else only visible features are counted, before iterating over all features (WORKAROUND)
-      layer->setSubsetString( "" );
+    // TODO: layer order
 
-      layer->select( layer->pendingAllAttributesList(), QgsRectangle(), true, false );
+    // update feature id lookup
+    int layerId = getOrCreateLayerId( db, newLayer->getLayerID() );
+    addFidLookups( db, layerId, offlineFeatureIds, remoteFeatureIds );
 
-      mProgressDialog->setupProgressBar( tr( "%v / %m features copied" ), layer->featureCount() );
-      int featureCount = 1;
+    // remove remote layer
+    QgsMapLayerRegistry::instance()->removeMapLayer( layer->getLayerID() );
+  }
+  else
+  {
+    delete newLayer;
+  }
+}
 
-      QList<int> remoteFeatureIds;
-      while ( layer->nextFeature( f ) )
-      {
-        remoteFeatureIds << f.id();
-
-        // NOTE: Spatialite provider ignores position of geometry column
-        // fill gap in QgsAttributeMap if geometry column is not last (WORKAROUND)
-        int column = 0;
-        QgsAttributeMap newAttrMap;
-        QgsAttributeMap attrMap = f.attributeMap();
-        for ( QgsAttributeMap::const_iterator it = attrMap.begin(); it != attrMap.end(); ++it )
-        {
-          newAttrMap.insert( column++, it.value() );
-        }
-        f.setAttributeMap( newAttrMap );
+bool QgsOfflineEditing::copyFeatures( QgsVectorLayer* layer, sqlite3* db, const QString& tableName, const QgsRectangle& extent,
+                                      QList<int>& offlineFeatureIds, QList<int>& remoteFeatureIds )
+{
+  // NOTE: Spatialite provider ignores position of geometry column
+  // the attributes are inserted in field order, the geometry is always the last column
+  const QgsFieldMap& fields = layer->dataProvider()->fields();
+  QString sql = QString( "INSERT INTO '%1' VALUES (" ).arg( tableName );
+  for ( int i = 0; i < fields.size(); i++ )
+  {
+    sql += "?,";
+  }
+  sql += QString( "GeomFromWKB(?, %1))" ).arg( layer->crs().epsg() );
 
-        newLayer->addFeature( f, false );
+  sqlite3_stmt* stmt = NULL;
+  if ( sqlite3_prepare_v2( db, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  {
+    showWarning( sqlite3_errmsg( db ) );
+    return false;
+  }
 
-        mProgressDialog->setProgressValue( featureCount++ );
-      }
-      if ( newLayer->commitChanges() )
-      {
-        mProgressDialog->setupProgressBar( tr( "%v / %m features processed" ), layer->featureCount() );
-        featureCount = 1;
-
-        // update feature id lookup
-        int layerId = getOrCreateLayerId( db, newLayer->getLayerID() );
-        QList<int> offlineFeatureIds;
-        newLayer->select( QgsAttributeList(), QgsRectangle(), false, false );
-        while ( newLayer->nextFeature( f ) )
-        {
-          offlineFeatureIds << f.id();
-        }
+  // NOTE: force feature recount for PostGIS layer, else only visible features are counted, before iterating over all features (WORKAROUND)
+  layer->setSubsetString( "" );
 
-        // NOTE: insert fids in this loop, as the db is locked during newLayer->nextFeature()
-        sqlExec( db, "BEGIN" );
-        for ( int i = 0; i < remoteFeatureIds.size(); i++ )
-        {
-          addFidLookup( db, layerId, offlineFeatureIds.at( i ), remoteFeatureIds.at( i ) );
+  layer->select( layer->pendingAllAttributesList(), extent, true, !extent.isEmpty() );
 
-          mProgressDialog->setProgressValue( featureCount++ );
-        }
-        sqlExec( db, "COMMIT" );
+  mProgressDialog->setupProgressBar( tr( "%v / %m features copied" ), layer->featureCount() );
+  int featureCount = 1;
+
+  bool success = true;
+  QgsFeature f;
+  sqlExec( db, "BEGIN" );
+  while ( layer->nextFeature( f ) )
+  {
+    const QgsAttributeMap& attrMap = f.attributeMap();
+    int column = 1;
+    for ( QgsFieldMap::const_iterator it = fields.begin(); it != fields.end(); ++it, ++column )
+    {
+      QVariant value = attrMap.value( it.key() );
+      if ( value.isNull() )
+      {
+        sqlite3_bind_null( stmt, column );
+      }
+      else if ( it.value().type() == QVariant::Int )
+      {
+        sqlite3_bind_int( stmt, column, value.toInt() );
+      }
+      else if ( it.value().type() == QVariant::Double )
+      {
+        sqlite3_bind_double( stmt, column, value.toDouble() );
       }
       else
       {
-        showWarning( newLayer->commitErrors().join( "\n" ) );
+        QByteArray text = value.toString().toUtf8();
+        sqlite3_bind_text( stmt, column, text.constData(), text.size(), SQLITE_TRANSIENT );
       }
+    }
 
-      // remove remote layer
-      QgsMapLayerRegistry::instance()->removeMapLayer( layer->getLayerID() );
+    QgsGeometry* geom = f.geometry();
+    if ( geom && geom->wkbSize() > 0 )
+    {
+      sqlite3_bind_blob( stmt, column, geom->asWkb(), geom->wkbSize(), SQLITE_TRANSIENT );
+    }
+    else
+    {
+      sqlite3_bind_null( stmt, column );
     }
+
+    if ( sqlite3_step( stmt ) != SQLITE_DONE )
+    {
+      showWarning( sqlite3_errmsg( db ) );
+      success = false;
+      break;
+    }
+    sqlite3_reset( stmt );
+
+    offlineFeatureIds << ( int ) sqlite3_last_insert_rowid( db );
+    remoteFeatureIds << f.id();
+
+    // keep the journal small, but write many features with each transaction
+    if ( featureCount % sCopyTransactionSize == 0 )
+    {
+      sqlExec( db, "COMMIT" );
+      sqlExec( db, "BEGIN" );
+    }
+
+    mProgressDialog->setProgressValue( featureCount++ );
   }
+  sqlExec( db, success ? "COMMIT" : "ROLLBACK" );
+  sqlite3_finalize( stmt );
+
+  return success;
 }
 
 void QgsOfflineEditing::applyAttributesAdded( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo )
@@ -613,33 +714,36 @@ void QgsOfflineEditing::applyAttributesAdded( QgsVectorLayer* remoteLayer, sqlit
   }
 }
 
-void QgsOfflineEditing::applyFeaturesAdded( QgsVectorLayer* offlineLayer, QgsVectorLayer* remoteLayer, sqlite3* db, int layerId )
+QList<int> QgsOfflineEditing::applyFeaturesAdded( QgsVectorLayer* offlineLayer, QgsVectorLayer* remoteLayer, sqlite3* db, int layerId )
 {
   QString sql = QString( "SELECT \"fid\" FROM 'log_added_features' WHERE \"layer_id\" = %1" ).arg( layerId );
   QList<int> newFeatureIds = sqlQueryInts( db, sql );
 
   // get new features from offline layer
   QgsFeatureList features;
+  QList<int> addedFeatureIds;
   for ( int i = 0; i < newFeatureIds.size(); i++ )
   {
     QgsFeature feature;
     if ( offlineLayer->featureAtId( newFeatureIds.at( i ), feature, true, true ) )
     {
       features << feature;
+      addedFeatureIds << newFeatureIds.at( i );
     }
   }
 
   // copy features to remote layer
   mProgressDialog->setupProgressBar( tr( "%v / %m features added" ), features.size() );
 
+  // NOTE: Spatialite provider ignores position of geometry column
+  // restore gap in QgsAttributeMap if geometry column is not last (WORKAROUND)
+  QMap<int, int> attrLookup = attributeLookup( offlineLayer, remoteLayer );
+
   int i = 1;
   for ( QgsFeatureList::iterator it = features.begin(); it != features.end(); ++it )
   {
     QgsFeature f = *it;
 
-    // NOTE: Spatialite provider ignores position of geometry column
-    // restore gap in QgsAttributeMap if geometry column is not last (WORKAROUND)
-    QMap<int, int> attrLookup = attributeLookup( offlineLayer, remoteLayer );
     QgsAttributeMap newAttrMap;
     QgsAttributeMap attrMap = f.attributeMap();
     for ( QgsAttributeMap::const_iterator it = attrMap.begin(); it != attrMap.end(); ++it )
@@ -652,9 +756,11 @@ void QgsOfflineEditing::applyFeaturesAdded( QgsVectorLayer* offlineLayer, QgsVec
 
     mProgressDialog->setProgressValue( i++ );
   }
+
+  return addedFeatureIds;
 }
 
-void QgsOfflineEditing::applyFeaturesRemoved( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId )
+void QgsOfflineEditing::applyFeaturesRemoved( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, const QMap<int, int>& fidLookup )
 {
   QString sql = QString( "SELECT \"fid\" FROM 'log_removed_features' WHERE \"layer_id\" = %1" ).arg( layerId );
   QgsFeatureIds values = sqlQueryFeaturesRemoved( db, sql );
@@ -664,14 +770,15 @@ void QgsOfflineEditing::applyFeaturesRemoved( QgsVectorLayer* remoteLayer, sqlit
   int i = 1;
   for ( QgsFeatureIds::const_iterator it = values.begin(); it != values.end(); ++it )
   {
-    int fid = remoteFid( db, layerId, *it );
+    int fid = fidLookup.value( *it, -1 );
     remoteLayer->deleteFeature( fid );
 
     mProgressDialog->setProgressValue( i++ );
   }
 }
 
-void QgsOfflineEditing::applyAttributeValueChanges( QgsVectorLayer* offlineLayer, QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo )
+void QgsOfflineEditing::applyAttributeValueChanges( QgsVectorLayer* offlineLayer, QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo,
+    const QMap<int, int>& fidLookup )
 {
   QString sql = QString( "SELECT \"fid\", \"attr\", \"value\" FROM 'log_feature_updates' WHERE \"layer_id\" = %1 AND \"commit_no\" = %2 " ).arg( layerId ).arg( commitNo );
   AttributeValueChanges values = sqlQueryAttributeValueChanges( db, sql );
@@ -682,7 +789,7 @@ void QgsOfflineEditing::applyAttributeValueChanges( QgsVectorLayer* offlineLayer
 
   for ( int i = 0; i < values.size(); i++ )
   {
-    int fid = remoteFid( db, layerId, values.at( i ).fid );
+    int fid = fidLookup.value( values.at( i ).fid, -1 );
 
     remoteLayer->changeAttributeValue( fid, attrLookup[ values.at( i ).attr ], values.at( i ).value, false );
 
@@ -690,7 +797,7 @@ void QgsOfflineEditing::applyAttributeValueChanges( QgsVectorLayer* offlineLayer
   }
 }
 
-void QgsOfflineEditing::applyGeometryChanges( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo )
+void QgsOfflineEditing::applyGeometryChanges( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo, const QMap<int, int>& fidLookup )
 {
   QString sql = QString( "SELECT \"fid\", \"geom_wkt\" FROM 'log_geometry_updates' WHERE \"layer_id\" = %1 AND \"commit_no\" = %2" ).arg( layerId ).arg( commitNo );
   GeometryChanges values = sqlQueryGeometryChanges( db, sql );
@@ -699,56 +806,76 @@ void QgsOfflineEditing::applyGeometryChanges( QgsVectorLayer* remoteLayer, sqlit
 
   for ( int i = 0; i < values.size(); i++ )
   {
-    int fid = remoteFid( db, layerId, values.at( i ).fid );
+    int fid = fidLookup.value( values.at( i ).fid, -1 );
     remoteLayer->changeGeometry( fid, QgsGeometry::fromWkt( values.at( i ).geom_wkt ) );
 
     mProgressDialog->setProgressValue( i + 1 );
   }
 }
 
-void QgsOfflineEditing::updateFidLookup( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId )
+void QgsOfflineEditing::updateFidLookup( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId,
+                                         const QList<int>& addedOfflineFids, int maxRemoteFid )
 {
   // update fid lookup for added features
 
-  // get remote added fids
-  // NOTE: use QMap for sorted fids
-  QMap < int, bool /*dummy*/ > newRemoteFids;
-  QgsFeature f;
-  remoteLayer->select( QgsAttributeList(), QgsRectangle(), false, false );
-
-  mProgressDialog->setupProgressBar( tr( "%v / %m features processed" ), remoteLayer->featureCount() );
+  // use the remote fids reported by the commit, if the provider assigned them
+  QList<int> newRemoteFids = mRemoteAddedFids;
+  bool reported = newRemoteFids.size() == addedOfflineFids.size();
+  for ( int i = 0; reported && i < newRemoteFids.size(); i++ )
+  {
+    // temporary ids of the edit buffer are negative
+    reported = newRemoteFids.at( i ) >= 0;
+  }
 
-  int i = 1;
-  while ( remoteLayer->nextFeature( f ) )
+  if ( !reported )
   {
-    if ( offlineFid( db, layerId, f.id() ) == -1 )
+    // get remote added fids
+    // NOTE: use QMap for sorted fids
+    QMap < int, bool /*dummy*/ > remoteFids;
+    QgsFeature f;
+    remoteLayer->select( QgsAttributeList(), QgsRectangle(), false, false );
+
+    mProgressDialog->setupProgressBar( tr( "%v / %m features processed" ), remoteLayer->featureCount() );
+
+    int i = 1;
+    while ( remoteLayer->nextFeature( f ) )
     {
-      newRemoteFids[ f.id()] = true;
-    }
+      if ( f.id() > maxRemoteFid )
+      {
+        remoteFids[ f.id()] = true;
+      }
 
-    mProgressDialog->setProgressValue( i++ );
+      mProgressDialog->setProgressValue( i++ );
+    }
+    newRemoteFids = remoteFids.keys();
   }
 
-  // get local added fids
-  // NOTE: fids are sorted
-  QString sql = QString( "SELECT \"fid\" FROM 'log_added_features' WHERE \"layer_id\" = %1" ).arg( layerId );
-  QList<int> newOfflineFids = sqlQueryInts( db, sql );
-
-  if ( newRemoteFids.size() != newOfflineFids.size() )
+  if ( newRemoteFids.size() != addedOfflineFids.size() )
   {
-    //showWarning( QString( "Different number of new features on offline layer (%1) and remote layer (%2)" ).arg(newOfflineFids.size()).arg(newRemoteFids.size()) );
+    showWarning( tr( "Different number of new features on offline layer (%1) and remote layer (%2). "
+                     "The added features were committed, but their ids are not recorded." )
+                 .arg( addedOfflineFids.size() ).arg( newRemoteFids.size() ) );
   }
   else
   {
     // add new fid lookups
-    i = 0;
-    sqlExec( db, "BEGIN" );
-    for ( QMap<int, bool>::const_iterator it = newRemoteFids.begin(); it != newRemoteFids.end(); ++it )
-    {
-      addFidLookup( db, layerId, newOfflineFids.at( i++ ), it.key() );
-    }
-    sqlExec( db, "COMMIT" );
+    addFidLookups( db, layerId, addedOfflineFids, newRemoteFids );
+  }
+}
+
+int QgsOfflineEditing::maxProviderFid( QgsVectorLayer* layer )
+{
+  // NOTE: read the provider directly, the edit buffer hides removed features and holds temporary fids
+  QgsVectorDataProvider* provider = layer->dataProvider();
+  provider->select( QgsAttributeList(), QgsRectangle(), false, false );
+
+  int maxFid = -1;
+  QgsFeature f;
+  while ( provider->nextFeature( f ) )
+  {
+    maxFid = qMax( maxFid, f.id() );
   }
+  return maxFid;
 }
 
 void QgsOfflineEditing::copySymbology( const QgsVectorLayer* sourceLayer, QgsVectorLayer* targetLayer )
@@ -803,6 +930,11 @@ sqlite3* QgsOfflineEditing::openLoggingDb()
       sqlite3_close( db );
       db = NULL;
     }
+    else
+    {
+      // NOTE: logging databases of earlier versions lack this index
+      sqlExec( db, "CREATE INDEX IF NOT EXISTS 'log_added_features_fid' ON 'log_added_features' ('layer_id', 'fid')" );
+    }
   }
   return db;
 }
@@ -844,22 +976,58 @@ void QgsOfflineEditing::increaseCommitNo( sqlite3* db )
   sqlExec( db, sql );
 }
 
-void QgsOfflineEditing::addFidLookup( sqlite3* db, int layerId, int offlineFid, int remoteFid )
+void QgsOfflineEditing::addFidLookups( sqlite3* db, int layerId, const QList<int>& offlineFids, const QList<int>& remoteFids )
 {
-  QString sql = QString( "INSERT INTO 'log_fids' VALUES ( %1, %2, %3 )" ).arg( layerId ).arg( offlineFid ).arg( remoteFid );
-  sqlExec( db, sql );
-}
+  sqlite3_stmt* stmt = NULL;
+  if ( sqlite3_prepare_v2( db, "INSERT INTO 'log_fids' VALUES ( ?, ?, ? )", -1, &stmt, NULL ) != SQLITE_OK )
+  {
+    showWarning( sqlite3_errmsg( db ) );
+    return;
+  }
 
-int QgsOfflineEditing::remoteFid( sqlite3* db, int layerId, int offlineFid )
-{
-  QString sql = QString( "SELECT \"remote_fid\" FROM 'log_fids' WHERE \"layer_id\" = %1 AND \"offline_fid\" = %2" ).arg( layerId ).arg( offlineFid );
-  return sqlQueryInt( db, sql, -1 );
+  mProgressDialog->setupProgressBar( tr( "%v / %m features processed" ), offlineFids.size() );
+
+  sqlExec( db, "BEGIN" );
+  for ( int i = 0; i < offlineFids.size() && i < remoteFids.size(); i++ )
+  {
+    sqlite3_bind_int( stmt, 1, layerId );
+    sqlite3_bind_int( stmt, 2, offlineFids.at( i ) );
+    sqlite3_bind_int( stmt, 3, remoteFids.at( i ) );
+    if ( sqlite3_step( stmt ) != SQLITE_DONE )
+    {
+      showWarning( sqlite3_errmsg( db ) );
+      break;
+    }
+    sqlite3_reset( stmt );
+
+    mProgressDialog->setProgressValue( i + 1 );
+  }
+  sqlExec( db, "COMMIT" );
+  sqlite3_finalize( stmt );
 }
 
-int QgsOfflineEditing::offlineFid( sqlite3* db, int layerId, int remoteFid )
+QMap<int, int> QgsOfflineEditing::sqlQueryFidLookup( sqlite3* db, int layerId )
 {
-  QString sql = QString( "SELECT \"offline_fid\" FROM 'log_fids' WHERE \"layer_id\" = %1 AND \"remote_fid\" = %2" ).arg( layerId ).arg( remoteFid );
-  return sqlQueryInt( db, sql, -1 );
+  QMap < int /*offline fid*/, int /*remote fid*/ > values;
+
+  QString sql = QString( "SELECT \"offline_fid\", \"remote_fid\" FROM 'log_fids' WHERE \"layer_id\" = %1" ).arg( layerId );
+  sqlite3_stmt* stmt = NULL;
+  if ( sqlite3_prepare_v2( db, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  {
+    showWarning( sqlite3_errmsg( db ) );
+    return values;
+  }
+
+  int ret = sqlite3_step( stmt );
+  while ( ret == SQLITE_ROW )
+  {
+    values.insert( sqlite3_column_int( stmt, 0 ), sqlite3_column_int( stmt, 1 ) );
+
+    ret = sqlite3_step( stmt );
+  }
+  sqlite3_finalize( stmt );
+
+  return values;
 }
 
 bool QgsOfflineEditing::isAddedFeature( sqlite3* db, int layerId, int fid )
@@ -1055,6 +1223,7 @@ void QgsOfflineEditing::committedAttributesAdded( const QString& qgisLayerId, co
   }
 
   // insert log
+  sqlExec( db, "BEGIN" );
   int layerId = getOrCreateLayerId( db, qgisLayerId );
   int commitNo = getCommitNo( db );
 
@@ -1073,6 +1242,7 @@ void QgsOfflineEditing::committedAttributesAdded( const QString& qgisLayerId, co
   }
 
   increaseCommitNo( db );
+  sqlExec( db, "COMMIT" );
   sqlite3_close( db );
 }
 
@@ -1085,6 +1255,7 @@ void QgsOfflineEditing::committedFeaturesAdded( const QString& qgisLayerId, cons
   }
 
   // insert log
+  sqlExec( db, "BEGIN" );
   int layerId = getOrCreateLayerId( db, qgisLayerId );
 
   // get new feature ids from db
@@ -1102,6 +1273,7 @@ void QgsOfflineEditing::committedFeaturesAdded( const QString& qgisLayerId, cons
     sqlExec( db, sql );
   }
 
+  sqlExec( db, "COMMIT" );
   sqlite3_close( db );
 }
 
@@ -1114,6 +1286,7 @@ void QgsOfflineEditing::committedFeaturesRemoved( const QString& qgisLayerId, co
   }
 
   // insert log
+  sqlExec( db, "BEGIN" );
   int layerId = getOrCreateLayerId( db, qgisLayerId );
 
   for ( QgsFeatureIds::const_iterator it = deletedFeatureIds.begin(); it != deletedFeatureIds.end(); ++it )
@@ -1133,6 +1306,7 @@ void QgsOfflineEditing::committedFeaturesRemoved( const QString& qgisLayerId, co
     }
   }
 
+  sqlExec( db, "COMMIT" );
   sqlite3_close( db );
 }
 
@@ -1145,6 +1319,7 @@ void QgsOfflineEditing::committedAttributeValuesChanges( const QString& qgisLaye
   }
 
   // insert log
+  sqlExec( db, "BEGIN" );
   int layerId = getOrCreateLayerId( db, qgisLayerId );
   int commitNo = getCommitNo( db );
 
@@ -1170,6 +1345,7 @@ void QgsOfflineEditing::committedAttributeValuesChanges( const QString& qgisLaye
   }
 
   increaseCommitNo( db );
+  sqlExec( db, "COMMIT" );
   sqlite3_close( db );
 }
 
@@ -1182,6 +1358,7 @@ void QgsOfflineEditing::committedGeometriesChanges( const QString& qgisLayerId,
   }
 
   // insert log
+  sqlExec( db, "BEGIN" );
   int layerId = getOrCreateLayerId( db, qgisLayerId );
   int commitNo = getCommitNo( db );
 
@@ -1205,5 +1382,15 @@ void QgsOfflineEditing::committedGeometriesChanges( const QString& qgisLayerId,
   }
 
   increaseCommitNo( db );
+  sqlExec( db, "COMMIT" );
   sqlite3_close( db );
 }
+
+void QgsOfflineEditing::committedRemoteFeaturesAdded( const QString& qgisLayerId, const QgsFeatureList& addedFeatures )
+{
+  Q_UNUSED( qgisLayerId );
+  for ( QgsFeatureList::const_iterator it = addedFeatures.begin(); it != addedFeatures.end(); ++it )
+  {
+    mRemoteAddedFids << it->id();
+  }
+}
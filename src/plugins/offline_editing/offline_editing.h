@@ -19,7 +19,9 @@
 #ifndef QGS_OFFLINE_EDITING_H
 #define QGS_OFFLINE_EDITING_H
 
+#include <qgscoordinatereferencesystem.h>
 #include <qgsfeature.h>
+#include <qgsrectangle.h>
 #include <qgsvectorlayer.h>
 
 #include <QObject>
@@ -39,7 +41,13 @@ class QgsOfflineEditing : public QObject
     QgsOfflineEditing( QgsOfflineEditingProgressDialog* progressDialog );
     ~QgsOfflineEditing();
 
-    bool convertToOfflineProject( const QString& offlineDataPath, const QString& offlineDbFile, const QStringList& layerIds );
+    /** copies the layers to a new SpatiaLite database and replaces them with the offline copies
+     * @param extent if not empty, only features within this extent are copied
+     * @param extentCrs coordinate system of extent, the layer's if invalid
+     */
+    bool convertToOfflineProject( const QString& offlineDataPath, const QString& offlineDbFile, const QStringList& layerIds,
+                                  const QgsRectangle& extent = QgsRectangle(),
+                                  const QgsCoordinateReferenceSystem& extentCrs = QgsCoordinateReferenceSystem() );
     bool isOfflineProject();
     void synchronize( QgsLegendInterface* legendInterface );
 
@@ -47,14 +55,23 @@ class QgsOfflineEditing : public QObject
     void initializeSpatialMetadata( sqlite3 *sqlite_handle );
     bool createSpatialiteDB( const QString& offlineDbPath );
     void createLoggingTables( sqlite3* db );
-    void copyVectorLayer( QgsVectorLayer* layer, sqlite3* db, const QString& offlineDbPath );
+    void copyVectorLayer( QgsVectorLayer* layer, sqlite3* db, const QString& offlineDbPath, const QgsRectangle& extent );
+    /** inserts the features of layer within extent with a prepared statement and returns the fids of the copies and the originals */
+    bool copyFeatures( QgsVectorLayer* layer, sqlite3* db, const QString& tableName, const QgsRectangle& extent,
+                       QList<int>& offlineFeatureIds, QList<int>& remoteFeatureIds );
+    QgsRectangle layerExtent( QgsVectorLayer* layer, const QgsRectangle& extent, const QgsCoordinateReferenceSystem& extentCrs );
 
     void applyAttributesAdded( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo );
-    void applyFeaturesAdded( QgsVectorLayer* offlineLayer, QgsVectorLayer* remoteLayer, sqlite3* db, int layerId );
-    void applyFeaturesRemoved( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId );
-    void applyAttributeValueChanges( QgsVectorLayer* offlineLayer, QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo );
-    void applyGeometryChanges( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo );
-    void updateFidLookup( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId );
+    /** returns the offline fids of the added features in the order they were added */
+    QList<int> applyFeaturesAdded( QgsVectorLayer* offlineLayer, QgsVectorLayer* remoteLayer, sqlite3* db, int layerId );
+    void applyFeaturesRemoved( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, const QMap<int, int>& fidLookup );
+    void applyAttributeValueChanges( QgsVectorLayer* offlineLayer, QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo,
+                                     const QMap<int, int>& fidLookup );
+    void applyGeometryChanges( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId, int commitNo, const QMap<int, int>& fidLookup );
+    void updateFidLookup( QgsVectorLayer* remoteLayer, sqlite3* db, int layerId,
+                          const QList<int>& addedOfflineFids, int maxRemoteFid );
+    /** returns the highest fid of the features stored by the provider of layer, -1 if there are none */
+    int maxProviderFid( QgsVectorLayer* layer );
     void copySymbology( const QgsVectorLayer* sourceLayer, QgsVectorLayer* targetLayer );
     QMap<int, int> attributeLookup( QgsVectorLayer* offlineLayer, QgsVectorLayer* remoteLayer );
 
@@ -64,14 +81,14 @@ class QgsOfflineEditing : public QObject
     int getOrCreateLayerId( sqlite3* db, const QString& qgisLayerId );
     int getCommitNo( sqlite3* db );
     void increaseCommitNo( sqlite3* db );
-    void addFidLookup( sqlite3* db, int layerId, int offlineFid, int remoteFid );
-    int remoteFid( sqlite3* db, int layerId, int offlineFid );
-    int offlineFid( sqlite3* db, int layerId, int remoteFid );
+    void addFidLookups( sqlite3* db, int layerId, const QList<int>& offlineFids, const QList<int>& remoteFids );
     bool isAddedFeature( sqlite3* db, int layerId, int fid );
 
     int sqlExec( sqlite3* db, const QString& sql );
     int sqlQueryInt( sqlite3* db, const QString& sql, int defaultValue );
     QList<int> sqlQueryInts( sqlite3* db, const QString& sql );
+    /** offline fid -> remote fid of all features of a layer */
+    QMap<int, int> sqlQueryFidLookup( sqlite3* db, int layerId );
 
     QList<QgsField> sqlQueryAttributesAdded( sqlite3* db, const QString& sql );
     QgsFeatureIds sqlQueryFeaturesRemoved( sqlite3* db, const QString& sql );
@@ -94,6 +111,8 @@ class QgsOfflineEditing : public QObject
     GeometryChanges sqlQueryGeometryChanges( sqlite3* db, const QString& sql );
 
     QgsOfflineEditingProgressDialog* mProgressDialog;
+    /** fids of the features added to the remote layer by the last commit */
+    QList<int> mRemoteAddedFids;
 
   private slots:
     void layerAdded( QgsMapLayer* layer );
@@ -102,6 +121,7 @@ class QgsOfflineEditing : public QObject
     void committedFeaturesRemoved( const QString& qgisLayerId, const QgsFeatureIds& deletedFeatureIds );
     void committedAttributeValuesChanges( const QString& qgisLayerId, const QgsChangedAttributesMap& changedAttrsMap );
     void committedGeometriesChanges( const QString& qgisLayerId, const QgsGeometryMap& changedGeometries );
+    void committedRemoteFeaturesAdded( const QString& qgisLayerId, const QgsFeatureList& addedFeatures );
 };
 
 #endif // QGS_OFFLINE_EDITING_H
@@ -23,6 +23,8 @@
 
 #include <qgisinterface.h>
 #include <qgisgui.h>
+#include <qgsmapcanvas.h>
+#include <qgsmaprenderer.h>
 #include <qgsmaplayerregistry.h>
 #include <qgsproject.h>
 
@@ -96,7 +98,20 @@ void QgsOfflineEditingPlugin::convertProject()
       return;
     }
 
-    if ( mOfflineEditing->convertToOfflineProject( myPluginGui->offlineDataPath(), myPluginGui->offlineDbFile(), selectedLayerIds ) )
+    QgsRectangle extent;
+    QgsCoordinateReferenceSystem extentCrs;
+    if ( myPluginGui->onlyCurrentExtent() )
+    {
+      extent = mQGisIface->mapCanvas()->extent();
+      QgsMapRenderer* renderer = mQGisIface->mapCanvas()->mapRenderer();
+      if ( renderer->hasCrsTransformEnabled() )
+      {
+        extentCrs = renderer->destinationSrs();
+      }
+    }
+
+    if ( mOfflineEditing->convertToOfflineProject( myPluginGui->offlineDataPath(), myPluginGui->offlineDbFile(), selectedLayerIds,
+         extent, extentCrs ) )
     {
       updateActions();
     }
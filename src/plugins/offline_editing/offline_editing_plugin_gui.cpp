@@ -29,6 +29,7 @@
 #include <QSettings>
 
 #define SETTINGS_OFFLINE_DATA_PATH "Plugin-OfflineEditing/offline_data_path"
+#define SETTINGS_ONLY_CURRENT_EXTENT "Plugin-OfflineEditing/only_current_extent"
 
 QgsOfflineEditingPluginGui::QgsOfflineEditingPluginGui( QWidget* parent /*= 0*/, Qt::WFlags fl /*= 0*/ )
     : QDialog( parent, fl )
@@ -39,6 +40,8 @@ QgsOfflineEditingPluginGui::QgsOfflineEditingPluginGui( QWidget* parent /*= 0*/,
   QSettings settings;
   mOfflineDataPath = settings.value( SETTINGS_OFFLINE_DATA_PATH, dir.absolutePath() ).toString();
   mOfflineDbFile = "offline.sqlite";
+  mOnlyCurrentExtent = settings.value( SETTINGS_ONLY_CURRENT_EXTENT, false ).toBool();
+  checkboxCurrentExtent->setChecked( mOnlyCurrentExtent );
   ui_offlineDataPath->setText( QDir( mOfflineDataPath ).absoluteFilePath( mOfflineDbFile ) );
 
   updateLayerList( checkboxShowEditableLayers->checkState() == Qt::Checked );
@@ -63,6 +66,11 @@ QStringList& QgsOfflineEditingPluginGui::selectedLayerIds()
   return mSelectedLayerIds;
 }
 
+bool QgsOfflineEditingPluginGui::onlyCurrentExtent()
+{
+  return mOnlyCurrentExtent;
+}
+
 void QgsOfflineEditingPluginGui::updateLayerList( bool filterEditableLayers )
 {
   ui_layerList->clear();
@@ -137,8 +145,11 @@ void QgsOfflineEditingPluginGui::on_buttonBox_accepted()
     mSelectedLayerIds.append(( *it )->data( Qt::UserRole ).toString() );
   }
 
+  mOnlyCurrentExtent = checkboxCurrentExtent->isChecked();
+
   QSettings settings;
   settings.setValue( SETTINGS_OFFLINE_DATA_PATH, mOfflineDataPath );
+  settings.setValue( SETTINGS_ONLY_CURRENT_EXTENT, mOnlyCurrentExtent );
 
   accept();
 }
@@ -33,6 +33,7 @@ class QgsOfflineEditingPluginGui : public QDialog, private Ui::QgsOfflineEditing
     QString offlineDataPath();
     QString offlineDbFile();
     QStringList& selectedLayerIds();
+    bool onlyCurrentExtent();
 
   private:
     void updateLayerList( bool filterEditableLayers );
@@ -41,6 +42,7 @@ class QgsOfflineEditingPluginGui : public QDialog, private Ui::QgsOfflineEditing
     QString mOfflineDataPath;
     QString mOfflineDbFile;
     QStringList mSelectedLayerIds;
+    bool mOnlyCurrentExtent;
 
   private slots:
     void on_butBrowse_clicked();
@@ -19,14 +19,31 @@
 #include "qgsgeometry.h"
 #include "qgslogger.h"
 #include "qgsrendererv2registry.h"
-#include "qgsspatialindex.h"
 #include "qgssymbolv2.h"
 #include "qgssymbollayerv2utils.h"
 #include "qgsvectorlayer.h"
 #include <QDomElement>
 #include <QPainter>
+#include <QVector>
 #include <cmath>
 
+/**Returns the root of the union-find tree containing i and shortens the path on the way*/
+static int findRoot( QVector<int>& parent, int i )
+{
+  while ( parent[i] != i )
+  {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+/**Returns the cell of a grid with the given cell size, which contains p*/
+static QPair<qint64, qint64> gridCell( const QgsPoint& p, double cellSize )
+{
+  return qMakePair(( qint64 ) floor( p.x() / cellSize ), ( qint64 ) floor( p.y() / cellSize ) );
+}
+
 QgsPointDisplacementRenderer::QgsPointDisplacementRenderer( const QString& labelAttributeName )
     : QgsFeatureRendererV2( "pointDisplacement" )
     , mLabelAttributeName( labelAttributeName )
@@ -85,28 +102,28 @@ void QgsPointDisplacementRenderer::renderFeature( QgsFeature& feature, QgsRender
   QStringList labelAttributeList;
   QList<QgsMarkerSymbolV2*> symbolList;
 
-  if ( mDisplacementIds.contains( feature.id() ) )
+  QHash<int, int>::const_iterator groupIt = mDisplacementIds.find( feature.id() );
+  if ( groupIt != mDisplacementIds.constEnd() )
   {
     //create the symbol for the whole display group if the id is the first entry in a display group
-    QList<QMap<int, QgsFeature> >::iterator it = mDisplacementGroups.begin();
-    for ( ; it != mDisplacementGroups.end(); ++it )
+    const QMap<int, QgsAttributeMap>& group = mDisplacementGroups.at( groupIt.value() );
+    if ( feature.id() == group.constBegin().key() )
     {
-      //create the symbol for the whole display group if the id is the first entry in a display group
-      if ( feature.id() == it->begin().key() )
+      QgsFeature groupFeature;
+      QMap<int, QgsAttributeMap>::const_iterator attIt = group.constBegin();
+      for ( ; attIt != group.constEnd(); ++attIt )
       {
-        QMap<int, QgsFeature>::iterator attIt = it->begin();
-        for ( ; attIt != it->end(); ++attIt )
+        groupFeature.setFeatureId( attIt.key() );
+        groupFeature.setAttributeMap( attIt.value() );
+        if ( mDrawLabels )
         {
-          if ( mDrawLabels )
-          {
-            labelAttributeList << getLabel( attIt.value() );
-          }
-          else
-          {
-            labelAttributeList << QString();
-          }
-          symbolList << dynamic_cast<QgsMarkerSymbolV2*>( mRenderer->symbolForFeature( attIt.value() ) );
+          labelAttributeList << getLabel( groupFeature );
+        }
+        else
+        {
+          labelAttributeList << QString();
         }
+        symbolList << dynamic_cast<QgsMarkerSymbolV2*>( mRenderer->symbolForFeature( groupFeature ) );
       }
     }
   }
@@ -344,9 +361,6 @@ void QgsPointDisplacementRenderer::createDisplacementGroups( QgsVectorLayer* vla
   mDisplacementGroups.clear();
   mDisplacementIds.clear();
 
-  //use a spatial index to check if there is already a point at a position
-  QgsSpatialIndex spatialIndex;
-
   //attributes
   QgsAttributeList attList;
   QList<QString> attributeStrings = usedAttributes();
@@ -356,63 +370,99 @@ void QgsPointDisplacementRenderer::createDisplacementGroups( QgsVectorLayer* vla
     attList.push_back( vlayer->fieldNameIndex( *attStringIt ) );
   }
 
-  QgsFeature f;
-  QList<int> intersectList;
+  //features in the view extent. The attribute maps are implicitly shared, so keeping them is cheap
+  QVector<int> ids;
+  QVector<QgsPoint> points;
+  QVector<QgsAttributeMap> attributes;
+  //union-find forest over the feature indices, features of one tree belong to the same group
+  QVector<int> parent;
+  //features which had no other point within the tolerance when they were read, hashed by grid cell
+  QHash< QPair<qint64, qint64>, QList<int> > grid;
+  //the cell size must not be too small compared to the coordinates, otherwise the cell numbers overflow
+  double cellSize = qMax( mTolerance, 1E-12 * qMax( qMax( qAbs( viewExtent.xMinimum() ), qAbs( viewExtent.xMaximum() ) ),
+                          qMax( qAbs( viewExtent.yMinimum() ), qAbs( viewExtent.yMaximum() ) ) ) );
+  if ( cellSize <= 0 )
+  {
+    cellSize = 1.0;
+  }
 
+  QgsFeature f;
   vlayer->select( attList, viewExtent, true, false );
   while ( vlayer->nextFeature( f ) )
   {
-    intersectList.clear();
+    if ( !f.geometry() )
+    {
+      continue;
+    }
 
-    //check, if there is already a point at that position
-    if ( f.geometry() )
+    int index = ids.size();
+    QgsPoint p = f.geometry()->asPoint();
+    ids << f.id();
+    points << p;
+    attributes << f.attributeMap();
+    parent << index;
+
+    //check, if there is already a point at that position. With the cell size being the tolerance, the
+    //candidates are in the neighbouring cells
+    QPair<qint64, qint64> cell = gridCell( p, cellSize );
+    bool found = false;
+    for ( qint64 cx = cell.first - 1; cx <= cell.first + 1; ++cx )
     {
-      intersectList = spatialIndex.intersects( searchRect( f.geometry()->asPoint() ) );
-      if ( intersectList.empty() )
-      {
-        spatialIndex.insertFeature( f );
-      }
-      else
+      for ( qint64 cy = cell.second - 1; cy <= cell.second + 1; ++cy )
       {
-        //go through all the displacement group maps and search an entry where the id equals the result of the spatial search
-        int existingEntry = intersectList.at( 0 );
-        bool found = false;
-        QList<QMap<int, QgsFeature> >::iterator it = mDisplacementGroups.begin();
-        for ( ; it != mDisplacementGroups.end(); ++it )
+        QHash< QPair<qint64, qint64>, QList<int> >::const_iterator cellIt = grid.find( qMakePair( cx, cy ) );
+        if ( cellIt == grid.constEnd() )
+        {
+          continue;
+        }
+        QList<int>::const_iterator candidateIt = cellIt->constBegin();
+        for ( ; candidateIt != cellIt->constEnd(); ++candidateIt )
         {
-          if ( it->size() > 0 && it->contains( existingEntry ) )
+          const QgsPoint& c = points[*candidateIt];
+          if ( qAbs( c.x() - p.x() ) <= mTolerance && qAbs( c.y() - p.y() ) <= mTolerance )
           {
+            //join the group of the candidate
+            parent[findRoot( parent, *candidateIt )] = index;
             found = true;
-            QgsFeature feature;
-            it->insert( f.id(), f );
-            mDisplacementIds.insert( f.id() );
-            break;
           }
         }
-
-        if ( !found )//insert the already existing feature and the new one into a map
-        {
-          QMap<int, QgsFeature> newMap;
-          QgsFeature existingFeature;
-          vlayer->featureAtId( existingEntry, existingFeature );
-          newMap.insert( existingEntry, existingFeature );
-          mDisplacementIds.insert( existingEntry );
-          newMap.insert( f.id(), f );
-          mDisplacementIds.insert( f.id() );
-          mDisplacementGroups.push_back( newMap );
-        }
       }
     }
+
+    if ( !found )
+    {
+      grid[cell].append( index );
+    }
+  }
+
+  //collect the groups with more than one feature
+  int nFeatures = ids.size();
+  QVector<int> groupSize( nFeatures, 0 );
+  for ( int i = 0; i < nFeatures; ++i )
+  {
+    ++groupSize[findRoot( parent, i )];
+  }
+  QVector<int> groupIndex( nFeatures, -1 );
+  for ( int i = 0; i < nFeatures; ++i )
+  {
+    int root = findRoot( parent, i );
+    if ( groupSize[root] < 2 )
+    {
+      continue;
+    }
+    if ( groupIndex[root] < 0 )
+    {
+      groupIndex[root] = mDisplacementGroups.size();
+      mDisplacementGroups.push_back( QMap<int, QgsAttributeMap>() );
+    }
+    mDisplacementGroups[groupIndex[root]].insert( ids[i], attributes[i] );
+    mDisplacementIds.insert( ids[i], groupIndex[root] );
   }
+
   //refresh the selection because the vector layer is going to step through all features now
   vlayer->select( attList, viewExtent, true, false );
 }
 
-QgsRectangle QgsPointDisplacementRenderer::searchRect( const QgsPoint& p ) const
-{
-  return QgsRectangle( p.x() - mTolerance, p.y() - mTolerance, p.x() + mTolerance, p.y() + mTolerance );
-}
-
 void QgsPointDisplacementRenderer::printInfoDisplacementGroups()
 {
   int nGroups = mDisplacementGroups.size();
@@ -420,32 +470,31 @@ void QgsPointDisplacementRenderer::printInfoDisplacementGroups()
   for ( int i = 0; i < nGroups; ++i )
   {
     QgsDebugMsg( "***************displacement group " + QString::number( i ) );
-    QMap<int, QgsFeature>::const_iterator it = mDisplacementGroups.at( i ).constBegin();
+    QMap<int, QgsAttributeMap>::const_iterator it = mDisplacementGroups.at( i ).constBegin();
     for ( ; it != mDisplacementGroups.at( i ).constEnd(); ++it )
     {
       QgsDebugMsg( QString::number( it.key() ) );
     }
   }
   QgsDebugMsg( "********all displacement ids*********" );
-  QSet<int>::const_iterator iIt = mDisplacementIds.constBegin();
+  QHash<int, int>::const_iterator iIt = mDisplacementIds.constBegin();
   for ( ; iIt != mDisplacementIds.constEnd(); ++iIt )
   {
-    QgsDebugMsg( QString::number( *iIt ) );
+    QgsDebugMsg( QString::number( iIt.key() ) );
   }
 }
 
-void QgsPointDisplacementRenderer::setDisplacementGroups( const QList<QMap<int, QgsFeature> >& list )
+void QgsPointDisplacementRenderer::setDisplacementGroups( const QList<QMap<int, QgsAttributeMap> >& list )
 {
   mDisplacementGroups = list;
   mDisplacementIds.clear();
 
-  QList<QMap<int, QgsFeature> >::const_iterator list_it = mDisplacementGroups.constBegin();
-  for ( ; list_it != mDisplacementGroups.constEnd(); ++list_it )
+  for ( int i = 0; i < mDisplacementGroups.size(); ++i )
   {
-    QMap<int, QgsFeature>::const_iterator map_it = list_it->constBegin();
-    for ( ; map_it != list_it->constEnd(); ++map_it )
+    QMap<int, QgsAttributeMap>::const_iterator map_it = mDisplacementGroups.at( i ).constBegin();
+    for ( ; map_it != mDisplacementGroups.at( i ).constEnd(); ++map_it )
     {
-      mDisplacementIds.insert( map_it.key() );
+      mDisplacementIds.insert( map_it.key(), i );
     }
   }
 }
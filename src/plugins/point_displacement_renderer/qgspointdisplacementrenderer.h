@@ -23,7 +23,7 @@
 #include "qgspoint.h"
 #include "qgsrendererv2.h"
 #include <QFont>
-#include <QSet>
+#include <QHash>
 
 class QgsVectorLayer;
 
@@ -63,7 +63,8 @@ class QgsPointDisplacementRenderer: public QgsFeatureRendererV2
     void setEmbeddedRenderer( QgsFeatureRendererV2* r );
     QgsFeatureRendererV2* embeddedRenderer() { return mRenderer;}
 
-    void setDisplacementGroups( const QList<QMap<int, QgsFeature> >& list );
+    /**Sets the groups of features with the same position. Each group maps the feature ids to the attributes needed for symbology and labels*/
+    void setDisplacementGroups( const QList<QMap<int, QgsAttributeMap> >& list );
 
     void setLabelFont( const QFont& f ) { mLabelFont = f; }
     QFont labelFont() const { return mLabelFont;}
@@ -121,15 +122,13 @@ class QgsPointDisplacementRenderer: public QgsFeatureRendererV2
     /**Maximum scale denominator for label display. Negative number means no scale limitation*/
     double mMaxLabelScaleDenominator;
 
-    /**Groups of features that have the same position*/
-    QList<QMap<int, QgsFeature> > mDisplacementGroups;
-    /**Set that contains all the ids the display groups (for quicker lookup)*/
-    QSet<int> mDisplacementIds;
+    /**Groups of features that have the same position (feature id and the attributes used for rendering)*/
+    QList<QMap<int, QgsAttributeMap> > mDisplacementGroups;
+    /**Index of the displacement group for all the ids in the display groups (for quicker lookup)*/
+    QHash<int, int> mDisplacementIds;
 
-    /**Create the displacement groups efficiently using a spatial index*/
+    /**Create the displacement groups efficiently using a grid with cell size mTolerance*/
     void createDisplacementGroups( QgsVectorLayer *vlayer, const QgsRectangle& viewExtent );
-    /**Creates a search rectangle with mTolerance*/
-    QgsRectangle searchRect( const QgsPoint& p ) const;
     /**This is a debugging function to check the entries in the displacement groups*/
     void printInfoDisplacementGroups();
 
@@ -25,7 +25,7 @@
 #include "qgsgeometrycoordinatetransform.h"
 #include "qgsspatialquery.h"
 
-QgsSpatialQuery::QgsSpatialQuery( MngProgressBar *pb )
+QgsSpatialQuery::QgsSpatialQuery( MngProgressBar *pb ): mIndexReference( QgsSpatialIndex::PointerTreeBackend )
 {
   mPb = pb;
   mUseTargetSelection = mUseReferenceSelection = false;
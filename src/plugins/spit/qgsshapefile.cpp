@@ -40,6 +40,11 @@
 #include "qgspgutil.h"
 #include "qgslogger.h"
 
+//features between progress updates and checks for cancellation
+static const int sProgressInterval = 100;
+//amount of COPY data which is collected before it is sent to the server
+static const int sCopyBufferSize = 1 << 16;
+
 // for htonl
 #ifdef WIN32
 #include <winsock.h>
@@ -291,7 +296,8 @@ bool QgsShapeFile::insertLayer( QString dbname, QString schema, QString primary_
   import_canceled = false;
   bool result = true;
 
-  QString query = QString( "CREATE TABLE %1.%2(%3 SERIAL PRIMARY KEY" )
+  // the primary key index is created after loading the data
+  QString query = QString( "CREATE TABLE %1.%2(%3 SERIAL" )
                   .arg( QgsPgUtil::quotedIdentifier( schema ) )
                   .arg( QgsPgUtil::quotedIdentifier( table_name ) )
                   .arg( QgsPgUtil::quotedIdentifier( primary_key ) );
@@ -382,104 +388,193 @@ bool QgsShapeFile::insertLayer( QString dbname, QString schema, QString primary_
 
   }
 
-  //adding the data into the table
+  //stream the data into the table with COPY, the geometries as hex encoded EWKB
+  query = QString( "COPY %1.%2(" )
+          .arg( QgsPgUtil::quotedIdentifier( schema ) )
+          .arg( QgsPgUtil::quotedIdentifier( table_name ) );
+  for ( uint n = 0; n < column_names.size(); n++ )
+  {
+    query += QgsPgUtil::quotedIdentifier( column_names[n] ) + ",";
+  }
+  query += QgsPgUtil::quotedIdentifier( geom_col ) + ") FROM STDIN";
+
+  res = PQexec( conn, query.toUtf8() );
+  if ( PQresultStatus( res ) != PGRES_COPY_IN )
+  {
+    errorText += tr( "The database gave an error while executing this SQL:\n%1\nThe error was:\n%2\n" )
+                 .arg( query ).arg( PQresultErrorMessage( res ) );
+    PQclear( res );
+    return false;
+  }
+  PQclear( res );
+
+  QByteArray buffer;
+  int progress = pro.value();
   for ( int m = 0; m < features && result; m++ )
   {
-    if ( import_canceled )
+    if ( m % sProgressInterval == 0 )
     {
-      fin = true;
-      break;
+      pro.setValue( progress + m );
+      qApp->processEvents();
+      if ( import_canceled )
+      {
+        fin = true;
+        break;
+      }
     }
 
     OGRFeatureH feat = OGR_L_GetNextFeature( ogrLayer );
-    if ( feat )
+    if ( !feat )
     {
-      OGRGeometryH geom = OGR_F_GetGeometryRef( feat );
-      if ( geom )
-      {
-        query = QString( "INSERT INTO %1.%2(" )
-                .arg( QgsPgUtil::quotedIdentifier( schema ) )
-                .arg( QgsPgUtil::quotedIdentifier( table_name ) );
-        QString values = " VALUES (";
-
-        char *geo_temp;
-        // 'GeometryFromText' supports only 2D coordinates
-        // TODO for proper 2.5D support we would need to use 'GeomFromEWkt'
-        if ( hasMoreDimensions )
-          OGR_G_SetCoordinateDimension( geom, 2 );
-        OGR_G_ExportToWkt( geom, &geo_temp );
-        QString geometry( geo_temp );
-        CPLFree( geo_temp );
-
-        for ( uint n = 0; n < column_types.size(); n++ )
-        {
-          QString val;
-
-          // FIXME: OGR_F_GetFieldAsString returns junk when called with a 8.255 float field
-          if ( column_types[n] == "float" )
-            val = QString::number( OGR_F_GetFieldAsDouble( feat, n ) );
-          else
-            val = codec->toUnicode( OGR_F_GetFieldAsString( feat, n ) );
-
-          if ( val.isEmpty() )
-            val = "NULL";
-          else
-            val = QgsPgUtil::quotedValue( val );
-
-          if ( n > 0 )
-          {
-            query += ",";
-            values += ",";
-          }
-          query += QgsPgUtil::quotedIdentifier( column_names[n] );
-          values += val;
-        }
-        query += "," + QgsPgUtil::quotedIdentifier( geom_col );
-        values += QString( ",GeometryFromText(%1,%2)" )
-                  .arg( QgsPgUtil::quotedValue( geometry ) )
-                  .arg( srid );
-
-        query += ")" + values + ")";
+      continue;
+    }
 
-        if ( result )
-          res = PQexec( conn, query.toUtf8() );
+    OGRGeometryH geom = OGR_F_GetGeometryRef( feat );
+    if ( geom )
+    {
+      // the geometry column is 2D
+      if ( hasMoreDimensions )
+        OGR_G_SetCoordinateDimension( geom, 2 );
 
-        if ( PQresultStatus( res ) != PGRES_COMMAND_OK )
+      for ( uint n = 0; n < column_types.size(); n++ )
+      {
+        if ( !OGR_F_IsFieldSet( feat, n ) )
         {
-          // flag error and send query and error message to stdout on debug
-          result = false;
-          errorText += tr( "The database gave an error while executing this SQL:" ) + "\n";
-          // the query string can be quite long. Trim if necessary...
-          if ( query.count() > 100 )
-            errorText += query.left( 150 ) +
-                         tr( "... (rest of SQL trimmed)", "is appended to a truncated SQL statement" ) +
-                         "\n";
-          else
-            errorText += query + '\n';
-          errorText += tr( "The error was:\n%1\n" ).arg( PQresultErrorMessage( res ) );
-          errorText += '\n';
+          buffer += "\\N\t";
+          continue;
         }
+
+        QString val;
+        // FIXME: OGR_F_GetFieldAsString returns junk when called with a 8.255 float field
+        if ( column_types[n] == "float" )
+          val = QString::number( OGR_F_GetFieldAsDouble( feat, n ), 'g', 17 );
         else
-        {
-          PQclear( res );
-        }
+          val = codec->toUnicode( OGR_F_GetFieldAsString( feat, n ) );
 
-        pro.setValue( pro.value() + 1 );
-        qApp->processEvents();
+        if ( val.isEmpty() )
+          buffer += "\\N";
+        else
+          buffer += copyEscaped( val );
+        buffer += '\t';
       }
-      OGR_F_Destroy( feat );
+      buffer += ewkbHex( geom, srid.toInt() );
+      buffer += '\n';
+    }
+    OGR_F_Destroy( feat );
+
+    if ( buffer.size() >= sCopyBufferSize )
+    {
+      if ( PQputCopyData( conn, buffer.constData(), buffer.size() ) != 1 )
+        result = false;
+      buffer.clear();
     }
   }
-  // create the GIST index if the the load was successful
-  if ( result )
+
+  if ( result && !fin && !buffer.isEmpty() && PQputCopyData( conn, buffer.constData(), buffer.size() ) != 1 )
   {
-    // prompt user to see if they want to build the index and warn
-    // them about the potential time-cost
+    result = false;
   }
+
+  // an error message makes the server abort the COPY
+  if ( PQputCopyEnd( conn, result && !fin ? NULL : "import canceled" ) != 1 )
+  {
+    result = false;
+  }
+
+  res = PQgetResult( conn );
+  if ( !fin && PQresultStatus( res ) != PGRES_COMMAND_OK )
+  {
+    result = false;
+    errorText += tr( "The database gave an error while executing this SQL:\n%1\nThe error was:\n%2\n" )
+                 .arg( query ).arg( res ? PQresultErrorMessage( res ) : PQerrorMessage( conn ) );
+  }
+  PQclear( res );
+  // consume the remaining results to make the connection usable again
+  while (( res = PQgetResult( conn ) ) != NULL )
+  {
+    PQclear( res );
+  }
+
+  // create the indexes after loading, which is much faster than updating them for every row
+  if ( result && !fin )
+  {
+    pro.setValue( progress + features );
+
+    QStringList indexQueries;
+    query = QString( "ALTER TABLE %1.%2 ADD PRIMARY KEY (%3)" )
+            .arg( QgsPgUtil::quotedIdentifier( schema ) )
+            .arg( QgsPgUtil::quotedIdentifier( table_name ) )
+            .arg( QgsPgUtil::quotedIdentifier( primary_key ) );
+    indexQueries << query;
+    query = QString( "CREATE INDEX %1 ON %2.%3 USING GIST (%4)" )
+            .arg( QgsPgUtil::quotedIdentifier( table_name + "_" + geom_col + "_gist" ) )
+            .arg( QgsPgUtil::quotedIdentifier( schema ) )
+            .arg( QgsPgUtil::quotedIdentifier( table_name ) )
+            .arg( QgsPgUtil::quotedIdentifier( geom_col ) );
+    indexQueries << query;
+
+    for ( int k = 0; k < indexQueries.size() && result; k++ )
+    {
+      res = PQexec( conn, indexQueries[k].toUtf8() );
+      if ( PQresultStatus( res ) != PGRES_COMMAND_OK )
+      {
+        result = false;
+        errorText += tr( "The database gave an error while executing this SQL:\n%1\nThe error was:\n%2\n" )
+                     .arg( indexQueries[k] ).arg( PQresultErrorMessage( res ) );
+      }
+      PQclear( res );
+    }
+  }
+
   OGR_L_ResetReading( ogrLayer );
   return result;
 }
 
+QByteArray QgsShapeFile::copyEscaped( const QString& value )
+{
+  QByteArray result;
+  QByteArray utf8 = value.toUtf8();
+  for ( int i = 0; i < utf8.size(); i++ )
+  {
+    switch ( utf8[i] )
+    {
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\t':
+        result += "\\t";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      case '\r':
+        result += "\\r";
+        break;
+      default:
+        result += utf8[i];
+        break;
+    }
+  }
+  return result;
+}
+
+QByteArray QgsShapeFile::ewkbHex( OGRGeometryH geom, int srid )
+{
+  int size = OGR_G_WkbSize( geom );
+  QByteArray wkb( size, 0 );
+  OGR_G_ExportToWkb( geom, wkbNDR, ( unsigned char * ) wkb.data() );
+
+  // EWKB: the wkb type gets the SRID flag and the SRID follows it (little endian)
+  QByteArray ewkb = wkb.left( 5 );
+  ewkb[4] = ( char )( ewkb[4] | 0x20 );
+  for ( int i = 0; i < 4; i++ )
+  {
+    ewkb += ( char )(( srid >> ( 8 * i ) ) & 0xff );
+  }
+  ewkb += wkb.mid( 5 );
+  return ewkb.toHex();
+}
+
 void QgsShapeFile::cancelImport()
 {
   import_canceled = true;
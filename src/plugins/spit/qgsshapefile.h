@@ -20,6 +20,7 @@
 #define QGSSHAPEFILE_H
 
 #include <vector>
+#include <QByteArray>
 #include <QString>
 #include <QStringList>
 #include <QObject>
@@ -61,6 +62,11 @@ class QgsShapeFile : public QObject
 
 
   private:
+    //! Escapes a value for the text format of COPY
+    static QByteArray copyEscaped( const QString& value );
+    //! Returns the geometry as hex encoded EWKB with the given SRID
+    static QByteArray ewkbHex( OGRGeometryH geom, int srid );
+
     QString table_name;
     OGRDataSourceH ogrDataSource;
     OGRLayerH ogrLayer;
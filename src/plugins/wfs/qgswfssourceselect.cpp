@@ -400,7 +400,13 @@ void QgsWFSSourceSelect::addLayer()
                    .arg( currentExtent.xMaximum(), 0, 'f' )
                    .arg( currentExtent.yMaximum(), 0, 'f' );
     }
-    mIface->addVectorLayer( uri + "SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=" + typeName + crsString + bBoxString, typeName, "WFS" );
+    //let the provider fetch the features of the visible area in tiles instead of downloading the whole layer
+    QString tiledString;
+    if ( mTiledCheckBox->isChecked() )
+    {
+      tiledString = "&TILED=1";
+    }
+    mIface->addVectorLayer( uri + "SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=" + typeName + crsString + bBoxString + tiledString, typeName, "WFS" );
   }
   accept();
 }
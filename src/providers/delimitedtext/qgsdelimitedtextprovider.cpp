@@ -38,6 +38,7 @@
 #include "qgslogger.h"
 #include "qgsmessageoutput.h"
 #include "qgsrectangle.h"
+#include "qgsspatialindex.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgis.h"
 
@@ -143,6 +144,9 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( QString uri )
     , mFirstDataLine( 0 )
     , mShowInvalidLines( true )
     , mWkbType( QGis::WKBNoGeometry )
+    , mSpatialIndex( 0 )
+    , mSpatialIndexInitialized( false )
+    , mUseSpatialIndex( false )
 {
   // Get the file name and mDelimiter out of the uri
   mFileName = uri.left( uri.indexOf( "?" ) );
@@ -428,6 +432,7 @@ QgsDelimitedTextProvider::~QgsDelimitedTextProvider()
   mFile->close();
   delete mFile;
   delete mStream;
+  delete mSpatialIndex;
 }
 
 
@@ -458,6 +463,13 @@ bool QgsDelimitedTextProvider::nextFeature( QgsFeature& feature )
 
     if ( mHasWktField && mWktFieldIndex >= 0 )
     {
+      // skip the wkt parsing for features the spatial index excludes
+      if ( mUseSpatialIndex && !mSelectedFeatureIds.contains( mFid + 1 ) )
+      {
+        mFid++;
+        continue;
+      }
+
       try
       {
         QString &sWkt = tokens[mWktFieldIndex];
@@ -495,7 +507,7 @@ bool QgsDelimitedTextProvider::nextFeature( QgsFeature& feature )
       if ( xOk && yOk )
       {
         mFid++;
-        if ( boundsCheck( x, y ) )
+        if (( !mUseSpatialIndex || mSelectedFeatureIds.contains( mFid ) ) && boundsCheck( x, y ) )
         {
           geom = QgsGeometry::fromPoint( QgsPoint( x, y ) );
         }
@@ -580,6 +592,20 @@ void QgsDelimitedTextProvider::select( QgsAttributeList fetchAttributes,
                                        bool fetchGeometry,
                                        bool useIntersect )
 {
+  // building the index uses select() itself, so do it first
+  bool useIndex = fetchGeometry && !rect.isEmpty() && !rect.contains( mExtent );
+  if ( useIndex && !mSpatialIndexInitialized )
+  {
+    initSpatialIndex();
+  }
+  mUseSpatialIndex = false;
+  mSelectedFeatureIds.clear();
+  if ( useIndex && mSpatialIndex )
+  {
+    mSelectedFeatureIds = mSpatialIndex->intersects( rect ).toSet();
+    mUseSpatialIndex = true;
+  }
+
   mSelectionRectangle = rect;
   mAttributesToFetch = fetchAttributes;
   mFetchGeom = fetchGeometry;
@@ -634,6 +660,33 @@ const QgsFieldMap & QgsDelimitedTextProvider::fields() const
   return attributeFields;
 }
 
+void QgsDelimitedTextProvider::initSpatialIndex()
+{
+  mSpatialIndexInitialized = true;
+  mUseSpatialIndex = false;
+
+  // the index is stored next to the data file and reused as long as the file is unchanged
+  QString indexBaseName = mFileName + ".qgsidx";
+  if ( QgsSpatialIndex::diskIndexUpToDate( indexBaseName, mFileName ) )
+  {
+    mSpatialIndex = QgsSpatialIndex::loadDiskIndex( indexBaseName );
+  }
+
+  if ( !mSpatialIndex )
+  {
+    select( QgsAttributeList(), QgsRectangle(), true, false );
+    mSpatialIndex = QgsSpatialIndex::createDiskIndex( indexBaseName, this );
+  }
+
+  if ( !mSpatialIndex )
+  {
+    // e.g. the directory is not writable
+    QgsDebugMsg( "Could not write spatial index " + indexBaseName + ", using an index in memory" );
+    select( QgsAttributeList(), QgsRectangle(), true, false );
+    mSpatialIndex = new QgsSpatialIndex( this, QgsSpatialIndex::PointerTreeBackend );
+  }
+}
+
 void QgsDelimitedTextProvider::rewind()
 {
   // Reset feature id to 0
@@ -20,11 +20,13 @@
 #include "qgsvectordataprovider.h"
 
 #include <QStringList>
+#include <QSet>
 
 class QgsFeature;
 class QgsField;
 class QFile;
 class QTextStream;
+class QgsSpatialIndex;
 
 
 /**
@@ -175,6 +177,12 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
     */
     bool boundsCheck( QgsGeometry *geom );
 
+    /**
+     * Loads the spatial index file next to the data file or builds it
+     * (and tries to save it) with a pass through all features
+     */
+    void initSpatialIndex();
+
   private:
 
     //! Fields
@@ -232,6 +240,14 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
     //! Feature id
     long mFid;
 
+    //! Spatial index for rectangle selections, created on the first one
+    QgsSpatialIndex *mSpatialIndex;
+    bool mSpatialIndexInitialized;
+    //! True if the current selection only returns the ids in mSelectedFeatureIds
+    bool mUseSpatialIndex;
+    //! Candidate feature ids for the selection rectangle found with the spatial index
+    QSet<int> mSelectedFeatureIds;
+
     struct wkbPoint
     {
       unsigned char byteOrder;
@@ -506,6 +506,7 @@ bool QgsGPXProvider::isValid()
 
 bool QgsGPXProvider::addFeatures( QgsFeatureList & flist )
 {
+  clearMinMaxCache();
 
   // add all the features
   for ( QgsFeatureList::iterator iter = flist.begin();
@@ -699,6 +700,8 @@ bool QgsGPXProvider::addFeature( QgsFeature& f )
 
 bool QgsGPXProvider::deleteFeatures( const QgsFeatureIds & id )
 {
+  clearMinMaxCache();
+
   if ( mFeatureType == WaypointType )
     data->removeWaypoints( id );
   else if ( mFeatureType == RouteType )
@@ -718,6 +721,8 @@ bool QgsGPXProvider::deleteFeatures( const QgsFeatureIds & id )
 
 bool QgsGPXProvider::changeAttributeValues( const QgsChangedAttributesMap & attr_map )
 {
+  clearMinMaxCache();
+
   QgsChangedAttributesMap::const_iterator aIter = attr_map.begin();
   if ( mFeatureType == WaypointType )
   {
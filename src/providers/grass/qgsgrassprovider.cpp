@@ -251,6 +251,9 @@ void QgsGrassProvider::update( void )
 
   mMapVersion = mMaps[mLayers[mLayerId].mapId].version;
 
+  // the map was changed, cached values may be outdated
+  clearMinMaxCache();
+
   mValid = true;
 }
 
@@ -1702,6 +1705,7 @@ int QgsGrassProvider::writeLine( int type, struct line_pnts *Points, struct line
   if ( !isEdited() )
     return -1;
 
+  clearMinMaxCache();
   return (( int ) Vect_write_line( mMap, type, Points, Cats ) );
 }
 
@@ -1712,6 +1716,7 @@ int QgsGrassProvider::rewriteLine( int line, int type, struct line_pnts *Points,
   if ( !isEdited() )
     return -1;
 
+  clearMinMaxCache();
   return ( Vect_rewrite_line( mMap, line, type, Points, Cats ) );
 }
 
@@ -1723,6 +1728,7 @@ int QgsGrassProvider::deleteLine( int line )
   if ( !isEdited() )
     return -1;
 
+  clearMinMaxCache();
   return ( Vect_delete_line( mMap, line ) );
 }
 
@@ -2074,6 +2080,7 @@ QString *QgsGrassProvider::updateAttributes( int field, int cat, const QString &
   QgsDebugMsg( QString( "SQL: %1" ).arg( db_get_string( &dbstr ) ) );
 
   int ret = db_execute_immediate( driver, &dbstr );
+  clearMinMaxCache();
 
   if ( ret != DB_OK )
   {
@@ -2141,6 +2148,7 @@ QString *QgsGrassProvider::executeSql( int field, const QString &sql )
   QgsDebugMsg( QString( "SQL: %1" ).arg( db_get_string( &dbstr ) ) );
 
   int ret = db_execute_immediate( driver, &dbstr );
+  clearMinMaxCache();
 
   if ( ret != DB_OK )
   {
@@ -2206,6 +2214,7 @@ QString *QgsGrassProvider::createTable( int field, const QString &key, const QSt
   QgsDebugMsg( QString( "SQL: %1" ).arg( db_get_string( &dbstr ) ) );
 
   int ret = db_execute_immediate( driver, &dbstr );
+  clearMinMaxCache();
 
   if ( ret != DB_OK )
   {
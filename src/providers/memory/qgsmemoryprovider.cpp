@@ -251,7 +251,7 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList & flist )
     mNextFeatureId++;
   }
 
-
+  clearMinMaxCache();
   updateExtent();
 
   return true;
@@ -274,6 +274,7 @@ bool QgsMemoryProvider::deleteFeatures( const QgsFeatureIds & id )
     mFeatures.erase( fit );
   }
 
+  clearMinMaxCache();
   updateExtent();
 
   return true;
@@ -307,6 +308,7 @@ bool QgsMemoryProvider::deleteAttributes( const QgsAttributeIds& attributes )
 {
   for ( QgsAttributeIds::const_iterator it = attributes.begin(); it != attributes.end(); ++it )
     mFields.remove( *it );
+  clearMinMaxCache();
   return true;
 }
 
@@ -322,6 +324,7 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap & a
     for ( QgsAttributeMap::const_iterator it2 = attrs.begin(); it2 != attrs.end(); ++it2 )
       fit->changeAttribute( it2.key(), it2.value() );
   }
+  clearMinMaxCache();
   return true;
 }
 
@@ -353,7 +356,7 @@ bool QgsMemoryProvider::createSpatialIndex()
 {
   if ( !mSpatialIndex )
   {
-    mSpatialIndex = new QgsSpatialIndex();
+    mSpatialIndex = new QgsSpatialIndex( QgsSpatialIndex::PointerTreeBackend );
 
     // add existing features to index
     for ( QgsFeatureMap::iterator it = mFeatures.begin(); it != mFeatures.end(); ++it )
@@ -256,6 +256,8 @@ bool QgsOgrProvider::setSubsetString( QString theSQL )
     OGR_DS_ReleaseResultSet( ogrDataSource, prevLayer );
   }
 
+  clearMinMaxCache();
+
   QString uri = mFilePath;
   if ( !mLayerName.isNull() )
   {
@@ -1907,6 +1909,55 @@ QVariant QgsOgrProvider::maximumValue( int index )
   return value;
 }
 
+QVariant QgsOgrProvider::aggregateValue( int index, Aggregate aggregate )
+{
+  if ( aggregate == Minimum )
+    return minimumValue( index );
+  if ( aggregate == Maximum )
+    return maximumValue( index );
+
+  QgsField fld = mAttributeFields[index];
+  if ( aggregate == Sum && fld.type() != QVariant::Int && fld.type() != QVariant::Double )
+    return QVariant();
+
+  QString theLayerName = OGR_FD_GetName( OGR_L_GetLayerDefn( ogrLayer ) );
+
+  QString sql = QString( "SELECT %1(%2) FROM %3 WHERE %2 IS NOT NULL" )
+                .arg( aggregate == Count ? "COUNT" : "SUM" )
+                .arg( quotedIdentifier( fld.name() ) )
+                .arg( quotedIdentifier( theLayerName ) );
+
+  if ( !mSubsetString.isEmpty() )
+  {
+    sql += QString( " AND (%1)" ).arg( mSubsetString );
+  }
+
+  OGRLayerH l = OGR_DS_ExecuteSQL( ogrDataSource, mEncoding->fromUnicode( sql ).data(), NULL, "SQL" );
+  if ( l == 0 )
+    return QgsVectorDataProvider::aggregateValue( index, aggregate );
+
+  OGRFeatureH f = OGR_L_GetNextFeature( l );
+  if ( f == 0 )
+  {
+    OGR_DS_ReleaseResultSet( ogrDataSource, l );
+    return QVariant();
+  }
+
+  QVariant value;
+  if ( OGR_F_IsFieldSet( f, 0 ) )
+  {
+    if ( aggregate == Count )
+      value = OGR_F_GetFieldAsInteger( f, 0 );
+    else
+      value = OGR_F_GetFieldAsDouble( f, 0 );
+  }
+  OGR_F_Destroy( f );
+
+  OGR_DS_ReleaseResultSet( ogrDataSource, l );
+
+  return value;
+}
+
 QString QgsOgrProvider::quotedIdentifier( QString field )
 {
   field.replace( '\\', "\\\\" );
@@ -198,6 +198,10 @@ class QgsOgrProvider : public QgsVectorDataProvider
      *  @param index the index of the attribute */
     QVariant maximumValue( int index );
 
+    /** Returns an aggregate of an attribute, calculated with OGR SQL
+     *  @note added in 1.6 */
+    QVariant aggregateValue( int index, Aggregate aggregate );
+
     /** Return the unique values of an attribute
      *  @param index the index of the attribute
      *  @param values reference to the list of unique values */
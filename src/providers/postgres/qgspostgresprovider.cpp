@@ -49,6 +49,11 @@ const QString POSTGRES_DESCRIPTION = "PostgreSQL/PostGIS data provider";
 // code this parameter is duplicated there.
 static const int sGeomTypeSelectLimit = 100;
 
+// Maximal number of rows inserted or updated by one multi-row statement
+static const int sEditBatchSize = 100;
+// Maximal number of parameters of a prepared statement
+static const int sMaxStatementParams = 65535;
+
 QMap<QString, QgsPostgresProvider::Conn *> QgsPostgresProvider::Conn::connectionsRO;
 QMap<QString, QgsPostgresProvider::Conn *> QgsPostgresProvider::Conn::connectionsRW;
 QMap<QString, QString> QgsPostgresProvider::Conn::passwordCache;
@@ -2104,6 +2109,137 @@ QVariant QgsPostgresProvider::maximumValue( int index )
   }
 }
 
+QVariant QgsPostgresProvider::aggregateValue( int index, Aggregate aggregate )
+{
+  if ( aggregate == Minimum )
+    return minimumValue( index );
+  if ( aggregate == Maximum )
+    return maximumValue( index );
+
+  try
+  {
+    const QgsField &fld = field( index );
+    if ( aggregate == Sum && fld.type() != QVariant::Int && fld.type() != QVariant::LongLong && fld.type() != QVariant::Double )
+    {
+      return QVariant();
+    }
+
+    QString sql = QString( "select %1(%2) from %3" )
+                  .arg( aggregate == Count ? "count" : "sum" )
+                  .arg( quotedIdentifier( fld.name() ) )
+                  .arg( mQuery );
+
+    if ( !sqlWhereClause.isEmpty() )
+    {
+      sql += QString( " where %1" ).arg( sqlWhereClause );
+    }
+
+    Result res = connectionRO->PQexec( sql );
+    if ( PQresultStatus( res ) != PGRES_TUPLES_OK || PQntuples( res ) < 1 || PQgetisnull( res, 0, 0 ) )
+    {
+      return QVariant();
+    }
+
+    QString value = QString::fromUtf8( PQgetvalue( res, 0, 0 ) );
+    if ( aggregate == Count )
+      return value.toInt();
+
+    return value.toDouble();
+  }
+  catch ( PGFieldNotFound )
+  {
+    return QVariant();
+  }
+}
+
+QList<double> QgsPostgresProvider::quantiles( int index, int classes )
+{
+  // window functions are available since PostgreSQL 8.4
+  if ( connectionRO->pgVersion() < 80400 )
+  {
+    return QgsVectorDataProvider::quantiles( index, classes );
+  }
+
+  QList<double> breaks;
+
+  try
+  {
+    const QgsField &fld = field( index );
+    QString column = quotedIdentifier( fld.name() );
+    QString where = QString( "%1 is not null" ).arg( column );
+    if ( !sqlWhereClause.isEmpty() )
+    {
+      where += QString( " and (%1)" ).arg( sqlWhereClause );
+    }
+
+    Result rcount = connectionRO->PQexec( QString( "select count(*) from %1 where %2" ).arg( mQuery ).arg( where ) );
+    if ( PQresultStatus( rcount ) != PGRES_TUPLES_OK || PQntuples( rcount ) < 1 )
+    {
+      return breaks;
+    }
+
+    int n = QString::fromUtf8( PQgetvalue( rcount, 0, 0 ) ).toInt();
+    if ( n == 0 )
+    {
+      return breaks;
+    }
+
+    // q-th quantile: Xq = (1 - r) * X[a] + r * X[a+1] with a = q * (n-1) (the last break is the maximum).
+    // The rows around all breaks are fetched with a single sort.
+    QList<int> positions;
+    QList<double> ratios;
+    QStringList rows;
+    for ( int i = 1; i <= classes; i++ )
+    {
+      int aa = n - 1;
+      double r = 0.0;
+      if ( i < classes )
+      {
+        double a = ( i / ( double ) classes ) * ( n - 1 );
+        aa = ( int )( a );
+        r = a - aa;
+      }
+      positions << aa;
+      ratios << r;
+      rows << QString::number( aa ) << QString::number( aa + 1 );
+    }
+
+    QString sql = QString( "select rn,value from (select %1 as value,row_number() over (order by %1)-1 as rn from %2 where %3) as q where rn in (%4)" )
+                  .arg( column ).arg( mQuery ).arg( where ).arg( rows.join( "," ) );
+
+    Result res = connectionRO->PQexec( sql );
+    if ( PQresultStatus( res ) != PGRES_TUPLES_OK )
+    {
+      QgsDebugMsg( "quantile query failed: " + sql );
+      return QList<double>();
+    }
+
+    QMap<int, double> values;
+    for ( int i = 0; i < PQntuples( res ); i++ )
+    {
+      values.insert( QString::fromUtf8( PQgetvalue( res, i, 0 ) ).toInt(), QString::fromUtf8( PQgetvalue( res, i, 1 ) ).toDouble() );
+    }
+
+    for ( int i = 0; i < positions.size(); i++ )
+    {
+      if ( !values.contains( positions[i] ) )
+      {
+        QgsDebugMsg( "quantile query returned too few rows: " + sql );
+        return QList<double>();
+      }
+      double lower = values[ positions[i] ];
+      double upper = values.value( positions[i] + 1, lower );
+      breaks.append(( 1 - ratios[i] ) * lower + ratios[i] * upper );
+    }
+  }
+  catch ( PGFieldNotFound )
+  {
+    return QList<double>();
+  }
+
+  return breaks;
+}
+
 
 bool QgsPostgresProvider::isValid()
 {
@@ -2221,31 +2357,64 @@ QString QgsPostgresProvider::Conn::postgisVersion()
   return postgisVersionInfo;
 }
 
-QString QgsPostgresProvider::paramValue( QString fieldValue, const QString &defaultValue ) const
+QStringList QgsPostgresProvider::paramValues( const QString &defaultValue, int count ) const
 {
-  if ( fieldValue.isNull() )
-    return QString::null;
+  QStringList values;
+  if ( count == 0 )
+    return values;
 
-  if ( fieldValue == defaultValue && !defaultValue.isNull() )
-  {
-    PGresult *result = connectionRW->PQexec( QString( "select %1" ).arg( defaultValue ) );
-    if ( PQresultStatus( result ) == PGRES_FATAL_ERROR )
-      throw PGException( result );
+  PGresult *result = connectionRW->PQexec( QString( "select %1 from generate_series(1,%2)" ).arg( defaultValue ).arg( count ) );
+  if ( result == 0 || PQresultStatus( result ) == PGRES_FATAL_ERROR )
+    throw PGException( result );
 
-    if ( PQgetisnull( result, 0, 0 ) )
-    {
-      PQclear( result );
-      return QString::null;
-    }
+  for ( int i = 0; i < PQntuples( result ); i++ )
+  {
+    if ( PQgetisnull( result, i, 0 ) )
+      values << QString::null;
     else
-    {
-      QString val = QString::fromUtf8( PQgetvalue( result, 0, 0 ) );
-      PQclear( result );
-      return val;
-    }
+      values << QString::fromUtf8( PQgetvalue( result, i, 0 ) );
+  }
+  PQclear( result );
+
+  return values;
+}
+
+QList<int> QgsPostgresProvider::newFeatureIds( int count )
+{
+  QList<int> ids;
+
+  if ( !primaryKeyDefault().startsWith( "max(" ) )
+  {
+    QStringList values = paramValues( primaryKeyDefault(), count );
+    for ( int i = 0; i < values.size(); i++ )
+      ids << values[i].toInt();
+    return ids;
   }
 
-  return fieldValue;
+  // "max(key)+1 from table" only yields the next free key, the following ones are counted up
+  PGresult *result = connectionRW->PQexec( QString( "select %1" ).arg( primaryKeyDefault() ) );
+  if ( result == 0 || PQresultStatus( result ) == PGRES_FATAL_ERROR )
+    throw PGException( result );
+
+  int id = PQntuples( result ) > 0 ? QString::fromUtf8( PQgetvalue( result, 0, 0 ) ).toInt() : 0;
+  PQclear( result );
+
+  for ( int i = 0; i < count; i++ )
+    ids << id + i;
+
+  return ids;
+}
+
+int QgsPostgresProvider::editBatchSize( int nParams ) const
+{
+  // multi-row VALUES lists are supported since PostgreSQL 8.2
+  if ( connectionRW->pgVersion() < 80200 )
+    return 1;
+
+  if ( nParams == 0 )
+    return sEditBatchSize;
+
+  return qMax( 1, qMin( sEditBatchSize, sMaxStatementParams / nParams ) );
 }
 
 bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
@@ -2260,37 +2429,35 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
     return false;
 
   bool returnvalue = true;
+  QStringList statements;
 
   try
   {
     connectionRW->PQexecNR( "BEGIN" );
 
-    // Prepare the INSERT statement
+    // Collect the columns of the INSERT statement and their values.
+    // Values that are passed as parameter contain %1 for the parameter number
     QString insert = QString( "INSERT INTO %1 (" ).arg( mQuery );
-    QString values = ") VALUES (";
-    QString delim = ",";
-    int offset = 1;
+    QStringList values;
+    QList<bool> isParam;
+    QString delim = "";
 
     if ( !geometryColumn.isNull() )
     {
       insert += quotedIdentifier( geometryColumn );
-      values += QString( "GeomFromWKB($%1%2,%3)" )
-                .arg( offset )
-                .arg( connectionRW->useWkbHex() ? "" : "::bytea" )
-                .arg( srid );
-      offset += 1;
+      values << "GeomFromWKB($%1" + QString( "%1,%2)" )
+      .arg( connectionRW->useWkbHex() ? "" : "::bytea" )
+      .arg( srid );
+      isParam << true;
       delim = ",";
     }
-    else
-    {
-      delim = "";
-    }
 
-    if ( primaryKeyType != "tid" && primaryKeyType != "oid" )
+    bool hasKey = primaryKeyType != "tid" && primaryKeyType != "oid";
+    if ( hasKey )
     {
       insert += delim + quotedIdentifier( primaryKey );
-      values += delim + QString( "$%1" ).arg( offset );
-      offset += 1;
+      values << "$%1";
+      isParam << true;
       delim = ",";
     }
 
@@ -2337,41 +2504,43 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
         {
           if ( defVal.isNull() )
           {
-            values += delim + "NULL";
+            values << "NULL";
           }
           else
           {
-            values += delim + defVal;
+            values << defVal;
           }
         }
         else if ( fit->typeName() == "geometry" )
         {
-          values += QString( "%1geomfromewkt(%2)" ).arg( delim ).arg( quotedValue( it->toString() ) );
+          values << QString( "geomfromewkt(%1)" ).arg( quotedValue( it->toString() ) );
         }
         else if ( fit->typeName() == "geography" )
         {
-          values += QString( "%1st_geographyfromewkt(%2)" ).arg( delim ).arg( quotedValue( it->toString() ) );
+          values << QString( "st_geographyfromewkt(%1)" ).arg( quotedValue( it->toString() ) );
         }
         else
         {
-          values += delim + quotedValue( it->toString() );
+          values << quotedValue( it->toString() );
         }
+        isParam << false;
       }
       else
       {
         // value is not unique => add parameter
         if ( fit->typeName() == "geometry" )
         {
-          values += QString( "%1geomfromewkt($%2)" ).arg( delim ).arg( defaultValues.size() + offset );
+          values << "geomfromewkt($%1)";
         }
         else if ( fit->typeName() == "geography" )
         {
-          values += QString( "%1st_geographyfromewkt($%2)" ).arg( delim ).arg( defaultValues.size() + offset );
+          values << "st_geographyfromewkt($%1)";
         }
         else
         {
-          values += QString( "%1$%2" ).arg( delim ).arg( defaultValues.size() + offset );
+          values << "$%1";
         }
+        isParam << true;
         defaultValues.append( defVal );
         fieldId.append( it.key() );
       }
@@ -2379,40 +2548,94 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
       delim = ",";
     }
 
-    insert += values + ")";
+    insert += ") VALUES ";
 
-    QgsDebugMsg( QString( "prepare addfeatures: %1" ).arg( insert ) );
-    PGresult *stmt = connectionRW->PQprepare( "addfeatures", insert, fieldId.size() + offset - 1, NULL );
-    if ( stmt == 0 || PQresultStatus( stmt ) == PGRES_FATAL_ERROR )
-      throw PGException( stmt );
-    PQclear( stmt );
+    int nParams = isParam.count( true );
+    int batchSize = editBatchSize( nParams );
 
+    // evaluate the default values of all features with one query per field
     QList<int> newIds;
+    if ( hasKey )
+      newIds = newFeatureIds( flist.size() );
+
+    QList<QStringList> evaluatedDefaults;
+    for ( int i = 0; i < fieldId.size(); i++ )
+    {
+      int count = 0;
+      if ( !defaultValues[i].isNull() )
+      {
+        for ( int j = 0; j < flist.size(); j++ )
+          if ( flist[j].attributeMap()[ fieldId[i] ].toString() == defaultValues[i] )
+            count++;
+      }
+      evaluatedDefaults << paramValues( defaultValues[i], count );
+    }
+    QList<int> usedDefaults;
+    for ( int i = 0; i < fieldId.size(); i++ )
+      usedDefaults << 0;
+
+    QList<QByteArray> params;
+    QList<int> formats;
 
-    for ( QgsFeatureList::iterator features = flist.begin(); features != flist.end(); features++ )
+    for ( int start = 0; start < flist.size(); start += batchSize )
     {
-      const QgsAttributeMap &attributevec = features->attributeMap();
+      int rows = qMin( batchSize, flist.size() - start );
 
-      QStringList params;
-      if ( !geometryColumn.isNull() )
+      // full batches share one statement, the remainder gets its own
+      QString stmtName = QString( "addfeatures%1" ).arg( rows );
+      if ( !statements.contains( stmtName ) )
       {
-        QString geomParam;
-        appendGeomString( features->geometry(), geomParam );
+        QString sql = insert;
+        int param = 1;
+        for ( int r = 0; r < rows; r++ )
+        {
+          sql += r == 0 ? "(" : ",(";
+          for ( int j = 0; j < values.size(); j++ )
+          {
+            if ( j > 0 )
+              sql += ",";
+            sql += isParam[j] ? values[j].arg( param++ ) : values[j];
+          }
+          sql += ")";
+        }
 
-        params << geomParam;
+        QgsDebugMsg( QString( "prepare %1: %2" ).arg( stmtName ).arg( sql ) );
+        PGresult *stmt = connectionRW->PQprepare( stmtName, sql, rows * nParams, NULL );
+        if ( stmt == 0 || PQresultStatus( stmt ) == PGRES_FATAL_ERROR )
+          throw PGException( stmt );
+        PQclear( stmt );
+        statements << stmtName;
       }
 
-      if ( primaryKeyType != "tid" && primaryKeyType != "oid" )
+      params.clear();
+      formats.clear();
+
+      for ( int r = start; r < start + rows; r++ )
       {
-        int id = paramValue( primaryKeyDefault(), primaryKeyDefault() ).toInt();
-        params << QString::number( id );
-        newIds << id;
-      }
+        const QgsAttributeMap &attributevec = flist[r].attributeMap();
+
+        if ( !geometryColumn.isNull() )
+          appendGeomParam( flist[r].geometry(), params, formats );
+
+        if ( hasKey )
+        {
+          params << QByteArray::number( newIds[r] );
+          formats << 0;
+        }
 
-      for ( int i = 0; i < fieldId.size(); i++ )
-        params << paramValue( attributevec[ fieldId[i] ].toString(), defaultValues[i] );
+        for ( int i = 0; i < fieldId.size(); i++ )
+        {
+          QString value = attributevec[ fieldId[i] ].toString();
+          if ( value == defaultValues[i] && !defaultValues[i].isNull() )
+            value = evaluatedDefaults[i].value( usedDefaults[i]++ );
+
+          // keep empty strings apart from NULL
+          params << ( value.isNull() ? QByteArray() : value.isEmpty() ? QByteArray( "" ) : value.toUtf8() );
+          formats << 0;
+        }
+      }
 
-      PGresult *result = connectionRW->PQexecPrepared( "addfeatures", params );
+      PGresult *result = connectionRW->PQexecPrepared( stmtName, params, formats );
       if ( result == 0 || PQresultStatus( result ) == PGRES_FATAL_ERROR )
         throw PGException( result );
       PQclear( result );
@@ -2422,7 +2645,8 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
       for ( int i = 0; i < flist.size(); i++ )
         flist[i].setFeatureId( newIds[i] );
 
-    connectionRW->PQexecNR( "DEALLOCATE addfeatures" );
+    for ( int i = 0; i < statements.size(); i++ )
+      connectionRW->PQexecNR( "DEALLOCATE " + statements[i] );
     connectionRW->PQexecNR( "COMMIT" );
 
     featuresCounted += flist.size();
@@ -2431,7 +2655,8 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
   {
     e.showErrorMessage( tr( "Error while adding features" ) );
     connectionRW->PQexecNR( "ROLLBACK" );
-    connectionRW->PQexecNR( "DEALLOCATE addfeatures" );
+    for ( int i = 0; i < statements.size(); i++ )
+      connectionRW->PQexecNR( "DEALLOCATE " + statements[i] );
     returnvalue = false;
   }
 
@@ -2602,6 +2827,9 @@ bool QgsPostgresProvider::changeAttributeValues( const QgsChangedAttributesMap &
   if ( !connectRW() )
     return false;
 
+  // prepared statements by the list of changed attributes
+  QMap<QString, QString> statements;
+
   try
   {
     connectionRW->PQexecNR( "BEGIN" );
@@ -2615,8 +2843,10 @@ bool QgsPostgresProvider::changeAttributeValues( const QgsChangedAttributesMap &
       if ( fid < 0 )
         continue;
 
+      QString key;
       QString sql = QString( "UPDATE %1 SET " ).arg( mQuery );
-      bool first = true;
+      QList<QByteArray> params;
+      QList<int> formats;
 
       const QgsAttributeMap& attrs = iter.value();
 
@@ -2627,16 +2857,19 @@ bool QgsPostgresProvider::changeAttributeValues( const QgsChangedAttributesMap &
         {
           QgsField fld = field( siter.key() );
 
-          if ( !first )
+          if ( !params.isEmpty() )
             sql += ",";
-          else
-            first = false;
 
-          sql += QString( fld.typeName() == "geometry" ? "%1=geomfromewkt(%2)" :
-                          fld.typeName() == "geography" ? "%1=st_geographyfromewkt(%2)" :
-                          "%1=%2" )
+          sql += QString( fld.typeName() == "geometry" ? "%1=geomfromewkt($%2)" :
+                          fld.typeName() == "geography" ? "%1=st_geographyfromewkt($%2)" :
+                          "%1=$%2" )
                  .arg( quotedIdentifier( fld.name() ) )
-                 .arg( quotedValue( siter->toString() ) );
+                 .arg( params.size() + 1 );
+          key += QString( "%1," ).arg( siter.key() );
+
+          QString value = siter->toString();
+          params << ( value.isNull() ? QByteArray() : value.isEmpty() ? QByteArray( "" ) : value.toUtf8() );
+          formats << 0;
         }
         catch ( PGFieldNotFound )
         {
@@ -2644,20 +2877,44 @@ bool QgsPostgresProvider::changeAttributeValues( const QgsChangedAttributesMap &
         }
       }
 
-      sql += QString( " WHERE %1" ).arg( whereClause( fid ) );
+      if ( params.isEmpty() )
+        continue;
 
-      PGresult *result = connectionRW->PQexec( sql );
+      // features changing the same attributes share a prepared statement
+      if ( !statements.contains( key ) )
+      {
+        sql += QString( " WHERE %1=$%2" ).arg( quotedIdentifier( primaryKey ) ).arg( params.size() + 1 );
+        if ( !sqlWhereClause.isEmpty() )
+          sql += " and (" + sqlWhereClause + ")";
+
+        QString stmtName = QString( "updateattributes%1" ).arg( statements.size() );
+        QgsDebugMsg( QString( "prepare %1: %2" ).arg( stmtName ).arg( sql ) );
+        PGresult *stmt = connectionRW->PQprepare( stmtName, sql, params.size() + 1, NULL );
+        if ( stmt == 0 || PQresultStatus( stmt ) == PGRES_FATAL_ERROR )
+          throw PGException( stmt );
+        PQclear( stmt );
+        statements.insert( key, stmtName );
+      }
+
+      params << keyParam( fid );
+      formats << 0;
+
+      PGresult *result = connectionRW->PQexecPrepared( statements[key], params, formats );
       if ( result == 0 || PQresultStatus( result ) == PGRES_FATAL_ERROR )
         throw PGException( result );
       PQclear( result );
     }
 
+    foreach( QString stmtName, statements )
+      connectionRW->PQexecNR( "DEALLOCATE " + stmtName );
     connectionRW->PQexecNR( "COMMIT" );
   }
   catch ( PGException &e )
   {
     e.showErrorMessage( tr( "Error while changing attributes" ) );
     connectionRW->PQexecNR( "ROLLBACK" );
+    foreach( QString stmtName, statements )
+      connectionRW->PQexecNR( "DEALLOCATE " + stmtName );
     returnvalue = false;
   }
 
@@ -2678,6 +2935,77 @@ void QgsPostgresProvider::appendGeomString( QgsGeometry *geom, QString &geomStri
   }
 }
 
+void QgsPostgresProvider::appendGeomParam( QgsGeometry *geom, QList<QByteArray> &params, QList<int> &formats ) const
+{
+  if ( !geom || !geom->asWkb() )
+  {
+    params << QByteArray();
+    formats << 0;
+  }
+  else if ( connectionRW->useWkbHex() )
+  {
+    QString geomString;
+    appendGeomString( geom, geomString );
+    params << geomString.toAscii();
+    formats << 0;
+  }
+  else
+  {
+    // the binary representation of bytea is the plain wkb
+    params << QByteArray(( const char * ) geom->asWkb(), geom->wkbSize() );
+    formats << 1;
+  }
+}
+
+QByteArray QgsPostgresProvider::keyParam( int featureId ) const
+{
+  if ( primaryKeyType != "tid" )
+    return QByteArray::number( featureId );
+  else
+    return QString( "(%1,%2)" ).arg( featureId >> 16 ).arg( featureId & 0xffff ).toAscii();
+}
+
+void QgsPostgresProvider::prepareGeometryUpdate( const QString &stmtName, int rows )
+{
+  QString update;
+  QString cast = connectionRW->useWkbHex() ? "" : "::bytea";
+
+  if ( rows == 1 )
+  {
+    update = QString( "UPDATE %1 SET %2=GeomFromWKB($1%3,%4) WHERE %5=$2" )
+             .arg( mQuery )
+             .arg( quotedIdentifier( geometryColumn ) )
+             .arg( cast )
+             .arg( srid )
+             .arg( quotedIdentifier( primaryKey ) );
+  }
+  else
+  {
+    // join the new geometries from a VALUES list
+    QString keyType = primaryKeyType.isEmpty() ? "int4" : primaryKeyType;
+    QString rowValues;
+    for ( int r = 0; r < rows; r++ )
+    {
+      if ( r > 0 )
+        rowValues += ",";
+      rowValues += QString( "($%1%2,$%3::%4)" ).arg( 2 * r + 1 ).arg( cast ).arg( 2 * r + 2 ).arg( keyType );
+    }
+
+    update = QString( "UPDATE %1 SET %2=GeomFromWKB(v.geom,%3) FROM (VALUES %4) AS v(geom,fid) WHERE %1.%5=v.fid" )
+             .arg( mQuery )
+             .arg( quotedIdentifier( geometryColumn ) )
+             .arg( srid )
+             .arg( rowValues )
+             .arg( quotedIdentifier( primaryKey ) );
+  }
+
+  QgsDebugMsg( QString( "prepare %1: %2" ).arg( stmtName ).arg( update ) );
+  PGresult *stmt = connectionRW->PQprepare( stmtName, update, 2 * rows, NULL );
+  if ( stmt == 0 || PQresultStatus( stmt ) == PGRES_FATAL_ERROR )
+    throw PGException( stmt );
+  PQclear( stmt );
+}
+
 bool QgsPostgresProvider::changeGeometryValues( QgsGeometryMap & geometry_map )
 {
   QgsDebugMsg( "entering." );
@@ -2689,65 +3017,63 @@ bool QgsPostgresProvider::changeGeometryValues( QgsGeometryMap & geometry_map )
     return false;
 
   bool returnvalue = true;
+  QStringList statements;
 
   try
   {
     // Start the PostGIS transaction
     connectionRW->PQexecNR( "BEGIN" );
 
-    QString update = QString( "UPDATE %1 SET %2=GeomFromWKB($1%3,%4) WHERE %5=$2" )
-                     .arg( mQuery )
-                     .arg( quotedIdentifier( geometryColumn ) )
-                     .arg( connectionRW->useWkbHex() ? "" : "::bytea" )
-                     .arg( srid )
-                     .arg( quotedIdentifier( primaryKey ) );
-
-    PGresult *stmt = connectionRW->PQprepare( "updatefeatures", update, 2, NULL );
-    if ( stmt == 0 || PQresultStatus( stmt ) == PGRES_FATAL_ERROR )
-      throw PGException( stmt );
-    PQclear( stmt );
-
-    for ( QgsGeometryMap::iterator iter  = geometry_map.begin();
-          iter != geometry_map.end();
-          ++iter )
+    QList<QgsGeometryMap::iterator> changed;
+    for ( QgsGeometryMap::iterator iter = geometry_map.begin(); iter != geometry_map.end(); ++iter )
     {
+      if ( iter->asWkb() )
+        changed << iter;
+    }
 
-      QgsDebugMsg( "iterating over the map of changed geometries..." );
+    // hex encoded wkb of old PostGIS versions is updated row by row
+    int batchSize = connectionRW->useWkbHex() ? 1 : editBatchSize( 2 );
 
-      if ( iter->asWkb() )
-      {
-        QgsDebugMsg( "iterating over feature id " + QString::number( iter.key() ) );
+    QList<QByteArray> params;
+    QList<int> formats;
 
-        QString geomParam;
-        appendGeomString( &*iter, geomParam );
+    for ( int start = 0; start < changed.size(); start += batchSize )
+    {
+      int rows = qMin( batchSize, changed.size() - start );
 
-        QStringList params;
-        params << geomParam;
-        if ( primaryKeyType != "tid" )
-        {
-          params << QString( "%1" ).arg( iter.key() );
-        }
-        else
-        {
-          params << QString( "(%1,%2)" ).arg( iter.key() >> 16 ).arg( iter.key() & 0xffff );
-        }
+      QString stmtName = QString( "updatefeatures%1" ).arg( rows );
+      if ( !statements.contains( stmtName ) )
+      {
+        prepareGeometryUpdate( stmtName, rows );
+        statements << stmtName;
+      }
 
-        PGresult *result = connectionRW->PQexecPrepared( "updatefeatures", params );
-        if ( result == 0 || PQresultStatus( result ) == PGRES_FATAL_ERROR )
-          throw PGException( result );
-        PQclear( result );
-      } // if (*iter)
+      params.clear();
+      formats.clear();
+      for ( int r = start; r < start + rows; r++ )
+      {
+        QgsDebugMsg( "updating feature id " + QString::number( changed[r].key() ) );
+        appendGeomParam( &*changed[r], params, formats );
+        params << keyParam( changed[r].key() );
+        formats << 0;
+      }
 
-    } // for each feature
+      PGresult *result = connectionRW->PQexecPrepared( stmtName, params, formats );
+      if ( result == 0 || PQresultStatus( result ) == PGRES_FATAL_ERROR )
+        throw PGException( result );
+      PQclear( result );
+    }
 
-    connectionRW->PQexecNR( "DEALLOCATE updatefeatures" );
+    for ( int i = 0; i < statements.size(); i++ )
+      connectionRW->PQexecNR( "DEALLOCATE " + statements[i] );
     connectionRW->PQexecNR( "COMMIT" );
   }
   catch ( PGException &e )
   {
     e.showErrorMessage( tr( "Error while changing geometry values" ) );
     connectionRW->PQexecNR( "ROLLBACK" );
-    connectionRW->PQexecNR( "DEALLOCATE updatefeatures" );
+    for ( int i = 0; i < statements.size(); i++ )
+      connectionRW->PQexecNR( "DEALLOCATE " + statements[i] );
     returnvalue = false;
   }
 
@@ -3365,22 +3691,39 @@ PGresult *QgsPostgresProvider::Conn::PQprepare( QString stmtName, QString query,
 
 PGresult *QgsPostgresProvider::Conn::PQexecPrepared( QString stmtName, const QStringList &params )
 {
-  const char **param = new const char *[ params.size()];
   QList<QByteArray> qparam;
 
   for ( int i = 0; i < params.size(); i++ )
   {
-    qparam << params[i].toUtf8();
-
     if ( params[i].isNull() )
-      param[i] = 0;
+      qparam << QByteArray();
+    else if ( params[i].isEmpty() )
+      qparam << QByteArray( "" );
     else
-      param[i] = qparam[i];
+      qparam << params[i].toUtf8();
+  }
+
+  return PQexecPrepared( stmtName, qparam, QList<int>() );
+}
+
+PGresult *QgsPostgresProvider::Conn::PQexecPrepared( QString stmtName, const QList<QByteArray> &params, const QList<int> &formats )
+{
+  const char **param = new const char *[ params.size()];
+  int *lengths = new int[ params.size()];
+  int *paramFormats = new int[ params.size()];
+
+  for ( int i = 0; i < params.size(); i++ )
+  {
+    param[i] = params[i].isNull() ? 0 : params[i].constData();
+    lengths[i] = params[i].size();
+    paramFormats[i] = i < formats.size() ? formats[i] : 0;
   }
 
-  PGresult *res = ::PQexecPrepared( conn, stmtName.toUtf8(), params.size(), param, NULL, NULL, 0 );
+  PGresult *res = ::PQexecPrepared( conn, stmtName.toUtf8(), params.size(), param, lengths, paramFormats, 0 );
 
   delete [] param;
+  delete [] lengths;
+  delete [] paramFormats;
 
   return res;
 }
@@ -183,6 +183,16 @@ class QgsPostgresProvider : public QgsVectorDataProvider
      *  @param index the index of the attribute */
     QVariant maximumValue( int index );
 
+    /** Returns an aggregate of an attribute, calculated by the server
+     *  @note added in 1.6 */
+    QVariant aggregateValue( int index, Aggregate aggregate );
+
+    /** Returns the quantile class breaks of an attribute. The values around
+     *  all breaks are fetched with one row_number() query from the server
+     *  (PostgreSQL 8.4 and later, older servers use the default implementation)
+     *  @note added in 1.6 */
+    QList<double> quantiles( int index, int classes );
+
     /** Return the unique values of an attribute
      *  @param index the index of the attribute
      *  @param values reference to the list of unique values */
@@ -573,7 +583,18 @@ class QgsPostgresProvider : public QgsVectorDataProvider
     int enabledCapabilities;
 
     void appendGeomString( QgsGeometry *geom, QString &geomParam ) const;
-    QString paramValue( QString fieldvalue, const QString &defaultValue ) const;
+    /** geometry as parameter of GeomFromWKB(), binary if supported by the server */
+    void appendGeomParam( QgsGeometry *geom, QList<QByteArray> &params, QList<int> &formats ) const;
+    /** evaluates the default value expression count times in a single query */
+    QStringList paramValues( const QString &defaultValue, int count ) const;
+    /** feature id as parameter for the primary key column */
+    QByteArray keyParam( int featureId ) const;
+    /** fetches the keys of count new features */
+    QList<int> newFeatureIds( int count );
+    /** number of rows of a multi-row statement with nParams parameters per row */
+    int editBatchSize( int nParams ) const;
+    /** prepares the geometry update of rows features */
+    void prepareGeometryUpdate( const QString &stmtName, int rows );
 
     class Conn
     {
@@ -627,6 +648,8 @@ class QgsPostgresProvider : public QgsVectorDataProvider
         PGresult *PQgetResult();
         PGresult *PQprepare( QString stmtName, QString query, int nParams, const Oid *paramTypes );
         PGresult *PQexecPrepared( QString stmtName, const QStringList &params );
+        //! execute with text (format 0) or binary (format 1) parameters, null arrays are passed as NULL
+        PGresult *PQexecPrepared( QString stmtName, const QList<QByteArray> &params, const QList<int> &formats );
 
         static Conn *connectDb( const QString &conninfo, bool readonly );
         static void disconnectRW( Conn *&conn );
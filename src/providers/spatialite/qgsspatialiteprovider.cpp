@@ -293,8 +293,6 @@ QString QgsSpatiaLiteProvider::storageType() const
 
 bool QgsSpatiaLiteProvider::featureAtId( int featureId, QgsFeature & feature, bool fetchGeometry, QgsAttributeList fetchAttributes )
 {
-  sqlite3_stmt *stmt = NULL;
-
   feature.setValid( false );
 
   QString primaryKey = !isQuery ? "ROWID" : quotedIdentifier( mPrimaryKey );
@@ -308,124 +306,40 @@ bool QgsSpatiaLiteProvider::featureAtId( int featureId, QgsFeature & feature, bo
   }
   if ( fetchGeometry )
   {
-    sql += QString( ", AsBinary(%1)" ).arg( quotedIdentifier( mGeometryColumn ) );
+    sql += "," + quotedIdentifier( mGeometryColumn );
   }
-  sql += QString( " FROM %1 WHERE %2 = %3" )
+  sql += QString( " FROM %1 WHERE %2 = ?" )
          .arg( mQuery )
-         .arg( primaryKey )
-         .arg( featureId );
+         .arg( primaryKey );
 
-  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  // identify and the attribute table fetch many single features, which share the same statement
+  sqlite3_stmt *stmt = preparedStatement( sql );
+  if ( stmt == NULL )
   {
-    // some error occurred
-    QgsDebugMsg( QString( "SQLite error: %1\n\nSQL: %2" )
-                 .arg( sql )
-                 .arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ) );
     return false;
   }
+  sqlite3_bind_int( stmt, 1, featureId );
 
   int ret = sqlite3_step( stmt );
   if ( ret == SQLITE_DONE )
   {
-    // there are no more rows to fetch - we can stop looping destroying the SQLite statement
-    sqlite3_finalize( stmt );
+    // there are no more rows to fetch
+    sqlite3_reset( stmt );
     return false;
   }
-  if ( ret == SQLITE_ROW )
-  {
-    // one valid row has been fetched from the result set
-    if ( !mFetchGeom )
-    {
-      // no geometry was required
-      feature.setGeometryAndOwnership( 0, 0 );
-    }
-
-    feature.clearAttributeMap();
-
-    int ic;
-    int n_columns = sqlite3_column_count( stmt );
-    for ( ic = 0; ic < n_columns; ic++ )
-    {
-      if ( ic == 0 )
-      {
-        // first column always contains the ROWID (or the primary key)
-        feature.setFeatureId( sqlite3_column_int( stmt, ic ) );
-      }
-      else
-      {
-        // iterate attributes
-        bool fetched = false;
-        int nAttr = 1;
-        for ( QgsAttributeList::const_iterator it = fetchAttributes.constBegin(); it != fetchAttributes.constEnd(); it++ )
-        {
-          if ( nAttr == ic )
-          {
-            // ok, this one is the corresponding attribure
-            if ( sqlite3_column_type( stmt, ic ) == SQLITE_INTEGER )
-            {
-              // INTEGER value
-              feature.addAttribute( *it, sqlite3_column_int( stmt, ic ) );
-              fetched = true;
-            }
-            else if ( sqlite3_column_type( stmt, ic ) == SQLITE_FLOAT )
-            {
-              // DOUBLE value
-              feature.addAttribute( *it, sqlite3_column_double( stmt, ic ) );
-              fetched = true;
-            }
-            else if ( sqlite3_column_type( stmt, ic ) == SQLITE_TEXT )
-            {
-              // TEXT value
-              const char *txt = ( const char * ) sqlite3_column_text( stmt, ic );
-              QString str = QString::fromUtf8( txt );
-              feature.addAttribute( *it, str );
-              fetched = true;
-            }
-            else
-            {
-              // assuming NULL
-              feature.addAttribute( *it, QVariant( QString::null ) );
-              fetched = true;
-            }
-          }
-          nAttr++;
-        }
-        if ( fetched )
-        {
-          continue;
-        }
-        if ( mFetchGeom )
-        {
-          QString geoCol = QString( "AsBinary(%1)" ).arg( quotedIdentifier( mGeometryColumn ) );
-          if ( strcasecmp( geoCol.toUtf8().constData(), sqlite3_column_name( stmt, ic ) ) == 0 )
-          {
-            if ( sqlite3_column_type( stmt, ic ) == SQLITE_BLOB )
-            {
-              const void *blob = sqlite3_column_blob( stmt, ic );
-              size_t blob_size = sqlite3_column_bytes( stmt, ic );
-              unsigned char *featureGeom = new unsigned char[blob_size + 1];
-              memset( featureGeom, '\0', blob_size + 1 );
-              memcpy( featureGeom, blob, blob_size );
-              feature.setGeometryAndOwnership( featureGeom, blob_size + 1 );
-            }
-            else
-            {
-              // NULL geometry
-              feature.setGeometryAndOwnership( 0, 0 );
-            }
-          }
-        }
-      }
-    }
-  }
-  else
+  if ( ret != SQLITE_ROW )
   {
     // some unexpected error occurred
     QgsDebugMsg( QString( "sqlite3_step() error: %1" ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ) );
-    sqlite3_finalize( stmt );
+    sqlite3_reset( stmt );
     return false;
   }
-  sqlite3_finalize( stmt );
+
+  // one valid row has been fetched from the result set
+  getFeature( stmt, fetchGeometry, fetchAttributes, feature );
+
+  // release the read lock, the statement stays prepared for the next call
+  sqlite3_reset( stmt );
 
   feature.setValid( true );
 
@@ -450,109 +364,245 @@ bool QgsSpatiaLiteProvider::nextFeature( QgsFeature & feature )
   int ret = sqlite3_step( sqliteStatement );
   if ( ret == SQLITE_DONE )
   {
-    // there are no more rows to fetch - we can stop looping destroying the SQLite statement
-    sqlite3_finalize( sqliteStatement );
+    // there are no more rows to fetch - we can stop looping and give the statement back to the cache
+    sqlite3_reset( sqliteStatement );
     sqliteStatement = NULL;
     return false;
   }
-  if ( ret == SQLITE_ROW )
+  if ( ret != SQLITE_ROW )
+  {
+    // some unexpected error occurred
+    QgsDebugMsg( QString( "sqlite3_step() error: %1" ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ) );
+    sqlite3_reset( sqliteStatement );
+    sqliteStatement = NULL;
+    return false;
+  }
+
+  // one valid row has been fetched from the result set
+  getFeature( sqliteStatement, mFetchGeom, mAttributesToFetch, feature );
+
+  feature.setValid( true );
+  return true;
+}
+
+void QgsSpatiaLiteProvider::getFeature( sqlite3_stmt *stmt, bool fetchGeometry, const QgsAttributeList &fetchAttributes, QgsFeature &feature )
+{
+  // first column always contains the ROWID (or the primary key)
+  feature.setFeatureId( sqlite3_column_int( stmt, 0 ) );
+
+  feature.clearAttributeMap();
+
+  // then the requested attributes in the order of fetchAttributes
+  int ic = 1;
+  for ( QgsAttributeList::const_iterator it = fetchAttributes.constBegin(); it != fetchAttributes.constEnd(); ++it, ++ic )
   {
-    // one valid row has been fetched from the result set
-    if ( !mFetchGeom )
+    switch ( sqlite3_column_type( stmt, ic ) )
     {
-      // no geometry was required
-      feature.setGeometryAndOwnership( 0, 0 );
+      case SQLITE_INTEGER:
+        // INTEGER value
+        feature.addAttribute( *it, sqlite3_column_int( stmt, ic ) );
+        break;
+
+      case SQLITE_FLOAT:
+        // DOUBLE value
+        feature.addAttribute( *it, sqlite3_column_double( stmt, ic ) );
+        break;
+
+      case SQLITE_TEXT:
+        // TEXT value
+        feature.addAttribute( *it, QString::fromUtf8(( const char * ) sqlite3_column_text( stmt, ic ), sqlite3_column_bytes( stmt, ic ) ) );
+        break;
+
+      default:
+        // assuming NULL
+        feature.addAttribute( *it, QVariant( QString::null ) );
+        break;
     }
+  }
 
-    feature.clearAttributeMap();
+  // and the geometry last
+  if ( !fetchGeometry )
+  {
+    // no geometry was required
+    feature.setGeometryAndOwnership( 0, 0 );
+    return;
+  }
 
-    int ic;
-    int n_columns = sqlite3_column_count( sqliteStatement );
-    for ( ic = 0; ic < n_columns; ic++ )
+  unsigned char *featureGeom = NULL;
+  size_t geomSize = 0;
+  if ( sqlite3_column_type( stmt, ic ) == SQLITE_BLOB )
+  {
+    const unsigned char *blob = ( const unsigned char * ) sqlite3_column_blob( stmt, ic );
+    size_t blob_size = sqlite3_column_bytes( stmt, ic );
+    convertToWkb( blob, blob_size, &featureGeom, &geomSize );
+  }
+  // NULL or undecodable geometry clears the geometry of the feature
+  feature.setGeometryAndOwnership( featureGeom, geomSize );
+}
+
+int QgsSpatiaLiteProvider::computeWkbBodySize( const unsigned char *p, const unsigned char *end, int type, int endian_arch )
+{
+  // body of a single geometry of a plain 2D class, as shared by SpatiaLite BLOBs and WKB
+  const unsigned char *start = p;
+  switch ( type )
+  {
+    case GAIA_POINT:
+      p += 2 * sizeof( double );
+      break;
+
+    case GAIA_LINESTRING:
+    {
+      if ( end - p < 4 )
+        return -1;
+      int points = gaiaImport32( p, endian_arch, endian_arch );
+      if ( points < 0 || points > ( end - p ) / ( int )( 2 * sizeof( double ) ) )
+        return -1;
+      p += 4 + points * 2 * sizeof( double );
+      break;
+    }
+
+    case GAIA_POLYGON:
     {
-      if ( ic == 0 )
+      if ( end - p < 4 )
+        return -1;
+      int rings = gaiaImport32( p, endian_arch, endian_arch );
+      if ( rings < 0 )
+        return -1;
+      p += 4;
+      for ( int ir = 0; ir < rings; ir++ )
       {
-        // first column always contains the ROWID (or the primary key)
-        feature.setFeatureId( sqlite3_column_int( sqliteStatement, ic ) );
+        if ( end - p < 4 )
+          return -1;
+        int points = gaiaImport32( p, endian_arch, endian_arch );
+        if ( points < 0 || points > ( end - p ) / ( int )( 2 * sizeof( double ) ) )
+          return -1;
+        p += 4 + points * 2 * sizeof( double );
       }
-      else
+      break;
+    }
+
+    default:
+      return -1;
+  }
+
+  return p <= end ? p - start : -1;
+}
+
+void QgsSpatiaLiteProvider::convertToWkb( const unsigned char *blob, size_t blob_size, unsigned char **wkb, size_t *wkb_size )
+{
+  *wkb = NULL;
+  *wkb_size = 0;
+
+  // SpatiaLite BLOB: START, endianness, SRID, MBR, MBR_END, class, geometry body, END
+  const size_t headerSize = 39;
+  if ( blob_size < headerSize + 5 || blob[0] != GAIA_MARK_START || blob[headerSize - 1] != GAIA_MARK_MBR || blob[blob_size - 1] != GAIA_MARK_END )
+  {
+    return;
+  }
+
+  int endian_arch = gaiaEndianArch();
+  int little_endian = blob[1] == GAIA_LITTLE_ENDIAN;
+  int type = gaiaImport32( blob + headerSize, little_endian, endian_arch );
+
+  if ( little_endian == endian_arch && type >= GAIA_POINT && type <= GAIA_GEOMETRYCOLLECTION )
+  {
+    // a plain 2D geometry in native byte order has the same body as its WKB,
+    // only the entity markers of collections are replaced by the byte order
+    size_t size = 1 + blob_size - headerSize - 1;
+    unsigned char *data = new unsigned char[size];
+    data[0] = blob[1];
+    memcpy( data + 1, blob + headerSize, blob_size - headerSize - 1 );
+
+    unsigned char *p = data + 5;
+    unsigned char *end = data + size;
+    bool ok = true;
+    if ( type <= GAIA_POLYGON )
+    {
+      ok = computeWkbBodySize( p, end, type, endian_arch ) == end - p;
+    }
+    else
+    {
+      int entities = end - p >= 4 ? gaiaImport32( p, endian_arch, endian_arch ) : -1;
+      ok = entities >= 0;
+      p += 4;
+      for ( int ie = 0; ok && ie < entities; ie++ )
       {
-        // iterate attributes
-        bool fetched = false;
-        int nAttr = 1;
-        for ( QgsAttributeList::const_iterator it = mAttributesToFetch.constBegin(); it != mAttributesToFetch.constEnd(); it++ )
-        {
-          if ( nAttr == ic )
-          {
-            // ok, this one is the corresponding attribure
-            if ( sqlite3_column_type( sqliteStatement, ic ) == SQLITE_INTEGER )
-            {
-              // INTEGER value
-              feature.addAttribute( *it, sqlite3_column_int( sqliteStatement, ic ) );
-              fetched = true;
-            }
-            else if ( sqlite3_column_type( sqliteStatement, ic ) == SQLITE_FLOAT )
-            {
-              // DOUBLE value
-              feature.addAttribute( *it, sqlite3_column_double( sqliteStatement, ic ) );
-              fetched = true;
-            }
-            else if ( sqlite3_column_type( sqliteStatement, ic ) == SQLITE_TEXT )
-            {
-              // TEXT value
-              const char *txt = ( const char * ) sqlite3_column_text( sqliteStatement, ic );
-              QString str = QString::fromUtf8( txt );
-              feature.addAttribute( *it, str );
-              fetched = true;
-            }
-            else
-            {
-              // assuming NULL
-              feature.addAttribute( *it, QVariant( QString::null ) );
-              fetched = true;
-            }
-          }
-          nAttr++;
-        }
-        if ( fetched )
-        {
-          continue;
-        }
-        if ( mFetchGeom )
+        if ( end - p < 5 || *p != GAIA_MARK_ENTITY )
         {
-          QString geoCol = QString( "AsBinary(%1)" ).arg( quotedIdentifier( mGeometryColumn ) );
-          if ( strcasecmp( geoCol.toUtf8().constData(), sqlite3_column_name( sqliteStatement, ic ) ) == 0 )
-          {
-            if ( sqlite3_column_type( sqliteStatement, ic ) == SQLITE_BLOB )
-            {
-              const void *blob = sqlite3_column_blob( sqliteStatement, ic );
-              size_t blob_size = sqlite3_column_bytes( sqliteStatement, ic );
-              unsigned char *featureGeom = new unsigned char[blob_size + 1];
-              memset( featureGeom, '\0', blob_size + 1 );
-              memcpy( featureGeom, blob, blob_size );
-              feature.setGeometryAndOwnership( featureGeom, blob_size + 1 );
-            }
-            else
-            {
-              // NULL geometry
-              feature.setGeometryAndOwnership( 0, 0 );
-            }
-          }
+          ok = false;
+          break;
         }
+        *p = blob[1];
+        int bodySize = computeWkbBodySize( p + 5, end, gaiaImport32( p + 1, endian_arch, endian_arch ), endian_arch );
+        ok = bodySize >= 0;
+        p += 5 + bodySize;
       }
+      ok = ok && p == end;
+    }
+
+    if ( ok )
+    {
+      *wkb = data;
+      *wkb_size = size;
+      return;
     }
+    delete [] data;
   }
-  else
+
+  // 3D, measured and compressed geometries are decoded by SpatiaLite
+  gaiaGeomCollPtr geom = gaiaFromSpatiaLiteBlobWkb( blob, blob_size );
+  if ( geom == NULL )
   {
-    // some unexpected error occurred
-    QgsDebugMsg( QString( "sqlite3_step() error: %1" ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ) );
-    sqlite3_finalize( sqliteStatement );
-    sqliteStatement = NULL;
-    return false;
+    return;
   }
 
-  feature.setValid( true );
-  return true;
+  unsigned char *result = NULL;
+  int size = 0;
+  gaiaToWkb( geom, &result, &size );
+  gaiaFreeGeomColl( geom );
+  if ( result == NULL )
+  {
+    return;
+  }
+
+  // QgsGeometry releases its WKB with delete []
+  *wkb = new unsigned char[size];
+  memcpy( *wkb, result, size );
+  *wkb_size = size;
+  free( result );
+}
+
+sqlite3_stmt *QgsSpatiaLiteProvider::preparedStatement( const QString &sql )
+{
+  sqlite3_stmt *stmt = mStatements.value( sql, NULL );
+  if ( stmt )
+  {
+    sqlite3_reset( stmt );
+    sqlite3_clear_bindings( stmt );
+    return stmt;
+  }
+
+  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  {
+    // some error occurred
+    QgsDebugMsg( QString( "SQLite error: %1\n\nSQL: %2" )
+                 .arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) )
+                 .arg( sql ) );
+    return NULL;
+  }
+
+  mStatements.insert( sql, stmt );
+  return stmt;
+}
+
+void QgsSpatiaLiteProvider::finalizeStatements()
+{
+  sqliteStatement = NULL;
+  for ( QMap<QString, sqlite3_stmt *>::iterator it = mStatements.begin(); it != mStatements.end(); ++it )
+  {
+    sqlite3_finalize( it.value() );
+  }
+  mStatements.clear();
 }
 
 QString QgsSpatiaLiteProvider::subsetString()
@@ -565,6 +615,9 @@ bool QgsSpatiaLiteProvider::setSubsetString( QString theSQL )
   QString prevSubsetString = mSubsetString;
   mSubsetString = theSQL;
 
+  // statements with the previous subset are not used anymore
+  finalizeStatements();
+
   // update URI
   QgsDataSourceURI uri = QgsDataSourceURI( dataSourceUri() );
   uri.setSql( mSubsetString );
@@ -598,13 +651,14 @@ void QgsSpatiaLiteProvider::select( QgsAttributeList fetchAttributes, QgsRectang
 
   if ( sqliteStatement != NULL )
   {
-    // finalizing the current SQLite statement
-    sqlite3_finalize( sqliteStatement );
+    // giving the current SQLite statement back to the cache
+    sqlite3_reset( sqliteStatement );
     sqliteStatement = NULL;
   }
 
   QString primaryKey = !isQuery ? "ROWID" : quotedIdentifier( mPrimaryKey );
 
+  // only the requested attributes are fetched, the geometry as SpatiaLite BLOB
   QString sql = QString( "SELECT %1" ).arg( primaryKey );
   for ( QgsAttributeList::const_iterator it = fetchAttributes.constBegin(); it != fetchAttributes.constEnd(); ++it )
   {
@@ -614,11 +668,16 @@ void QgsSpatiaLiteProvider::select( QgsAttributeList fetchAttributes, QgsRectang
   }
   if ( fetchGeometry )
   {
-    sql += QString( ", AsBinary(%1)" ).arg( quotedIdentifier( mGeometryColumn ) );
+    sql += "," + quotedIdentifier( mGeometryColumn );
   }
   sql += QString( " FROM %1" ).arg( mQuery );
 
+  // the rectangle is bound as parameters, so that the statement is reused while panning and zooming
   QString whereClause;
+  QList<double> params;
+  QString mbr = "?, ?, ?, ?";
+  QList<double> mbrParams;
+  mbrParams << rect.xMinimum() << rect.yMinimum() << rect.xMaximum() << rect.yMaximum();
 
   if ( !rect.isEmpty() )
   {
@@ -627,30 +686,22 @@ void QgsSpatiaLiteProvider::select( QgsAttributeList fetchAttributes, QgsRectang
     if ( useIntersect )
     {
       // we are requested to evaluate a true INTERSECT relationship
-      QString mbr = QString( "%1, %2, %3, %4" ).
-                    arg( QString::number( rect.xMinimum(), 'f', 6 ) ).
-                    arg( QString::number( rect.yMinimum(), 'f', 6 ) ).
-                    arg( QString::number( rect.xMaximum(), 'f', 6 ) ).arg( QString::number( rect.yMaximum(), 'f', 6 ) );
       whereClause += QString( "Intersects(%1, BuildMbr(%2)) AND " ).arg( quotedIdentifier( mGeometryColumn ) ).arg( mbr );
+      params << mbrParams;
     }
     if ( mVShapeBased )
     {
       // handling a VirtualShape layer
-      QString mbr = QString( "%1, %2, %3, %4" ).
-                    arg( QString::number( rect.xMinimum(), 'f', 6 ) ).
-                    arg( QString::number( rect.yMinimum(), 'f', 6 ) ).
-                    arg( QString::number( rect.xMaximum(), 'f', 6 ) ).arg( QString::number( rect.yMaximum(), 'f', 6 ) );
       whereClause += QString( "MbrIntersects(%1, BuildMbr(%2))" ).arg( quotedIdentifier( mGeometryColumn ) ).arg( mbr );
+      params << mbrParams;
     }
     else
     {
       if ( spatialIndexRTree )
       {
         // using the RTree spatial index
-        QString mbrFilter = QString( "xmin <= %1 AND " ).arg( QString::number( rect.xMaximum(), 'f', 6 ) );
-        mbrFilter += QString( "xmax >= %1 AND " ).arg( QString::number( rect.xMinimum(), 'f', 6 ) );
-        mbrFilter += QString( "ymin <= %1 AND " ).arg( QString::number( rect.yMaximum(), 'f', 6 ) );
-        mbrFilter += QString( "ymax >= %1" ).arg( QString::number( rect.yMinimum(), 'f', 6 ) );
+        QString mbrFilter = "xmin <= ? AND xmax >= ? AND ymin <= ? AND ymax >= ?";
+        params << rect.xMaximum() << rect.xMinimum() << rect.yMaximum() << rect.yMinimum();
         QString idxName = QString( "idx_%1_%2" ).arg( mIndexTable ).arg( mIndexGeometry );
         whereClause += QString( "%1 IN (SELECT pkid FROM %2 WHERE %3)" )
                        .arg( quotedIdentifier( primaryKey ) )
@@ -660,24 +711,18 @@ void QgsSpatiaLiteProvider::select( QgsAttributeList fetchAttributes, QgsRectang
       else if ( spatialIndexMbrCache )
       {
         // using the MbrCache spatial index
-        QString mbr = QString( "%1, %2, %3, %4" ).
-                      arg( QString::number( rect.xMinimum(), 'f', 6 ) ).
-                      arg( QString::number( rect.yMinimum(), 'f', 6 ) ).
-                      arg( QString::number( rect.xMaximum(), 'f', 6 ) ).arg( QString::number( rect.yMaximum(), 'f', 6 ) );
         QString idxName = QString( "cache_%1_%2" ).arg( mIndexTable ).arg( mIndexGeometry );
         whereClause += QString( "%1 IN (SELECT rowid FROM %2 WHERE mbr = FilterMbrIntersects(%3))" )
                        .arg( quotedIdentifier( primaryKey ) )
                        .arg( quotedIdentifier( idxName ) )
                        .arg( mbr );
+        params << mbrParams;
       }
       else
       {
         // using simple MBR filtering
-        QString mbr = QString( "%1, %2, %3, %4" ).
-                      arg( QString::number( rect.xMinimum(), 'f', 6 ) ).
-                      arg( QString::number( rect.yMinimum(), 'f', 6 ) ).
-                      arg( QString::number( rect.xMaximum(), 'f', 6 ) ).arg( QString::number( rect.yMaximum(), 'f', 6 ) );
         whereClause += QString( "MbrIntersects(%1, BuildMbr(%2))" ).arg( quotedIdentifier( mGeometryColumn ) ).arg( mbr );
+        params << mbrParams;
       }
     }
   }
@@ -700,11 +745,15 @@ void QgsSpatiaLiteProvider::select( QgsAttributeList fetchAttributes, QgsRectang
 
   mFetchGeom = fetchGeometry;
   mAttributesToFetch = fetchAttributes;
-  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &sqliteStatement, NULL ) != SQLITE_OK )
+  sqliteStatement = preparedStatement( sql );
+  if ( sqliteStatement == NULL )
   {
-    // some error occurred
-    QgsDebugMsg( QString( "SQLite error: %1\n\nSQL: %2" ).arg( sql ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ) );
-    sqliteStatement = NULL;
+    return;
+  }
+
+  for ( int i = 0; i < params.size(); i++ )
+  {
+    sqlite3_bind_double( sqliteStatement, i + 1, params[i] );
   }
 }
 
@@ -750,7 +799,7 @@ void QgsSpatiaLiteProvider::rewind()
 {
   if ( sqliteStatement )
   {
-    sqlite3_finalize( sqliteStatement );
+    sqlite3_reset( sqliteStatement );
     sqliteStatement = NULL;
   }
   loadFields();
@@ -896,6 +945,123 @@ error:
   return QVariant( QString::null );
 }
 
+QVariant QgsSpatiaLiteProvider::aggregateValue( int index, Aggregate aggregate )
+{
+  if ( aggregate == Minimum )
+    return minimumValue( index );
+  if ( aggregate == Maximum )
+    return maximumValue( index );
+
+  sqlite3_stmt *stmt = NULL;
+  QVariant value;
+
+  // get the field name
+  const QgsField & fld = field( index );
+  if ( aggregate == Sum && fld.type() != QVariant::Int && fld.type() != QVariant::LongLong && fld.type() != QVariant::Double )
+  {
+    return value;
+  }
+
+  QString sql = QString( "SELECT %1(%2) FROM %3" )
+                .arg( aggregate == Count ? "Count" : "Sum" )
+                .arg( quotedIdentifier( fld.name() ) )
+                .arg( mQuery );
+
+  if ( !mSubsetString.isEmpty() )
+  {
+    sql += " WHERE ( " + mSubsetString + ")";
+  }
+
+  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QString( "SQLite error: %1\n\nSQL: %2" ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ).arg( sql ) );
+    return value;
+  }
+
+  if ( sqlite3_step( stmt ) == SQLITE_ROW && sqlite3_column_type( stmt, 0 ) != SQLITE_NULL )
+  {
+    if ( aggregate == Count )
+      value = sqlite3_column_int( stmt, 0 );
+    else
+      value = sqlite3_column_double( stmt, 0 );
+  }
+
+  sqlite3_finalize( stmt );
+  return value;
+}
+
+// Returns the quantile class breaks of an attribute
+QList<double> QgsSpatiaLiteProvider::quantiles( int index, int classes )
+{
+  sqlite3_stmt *stmt = NULL;
+  QList<double> breaks;
+
+  // get the field name
+  const QgsField & fld = field( index );
+  QString column = quotedIdentifier( fld.name() );
+
+  QString where = QString( " WHERE %1 IS NOT NULL" ).arg( column );
+  if ( !mSubsetString.isEmpty() )
+  {
+    where += " AND ( " + mSubsetString + ")";
+  }
+
+  int n = 0;
+  QString sql = QString( "SELECT Count(*) FROM %1%2" ).arg( mQuery ).arg( where );
+  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QString( "SQLite error: %1\n\nSQL: %2" ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ).arg( sql ) );
+    return breaks;
+  }
+  if ( sqlite3_step( stmt ) == SQLITE_ROW )
+  {
+    n = sqlite3_column_int( stmt, 0 );
+  }
+  sqlite3_finalize( stmt );
+
+  if ( n == 0 )
+  {
+    return breaks;
+  }
+
+  // the two values around each break are fetched with an offset
+  sql = QString( "SELECT %1 FROM %2%3 ORDER BY %1 LIMIT 2 OFFSET ?" ).arg( column ).arg( mQuery ).arg( where );
+  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QString( "SQLite error: %1\n\nSQL: %2" ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ).arg( sql ) );
+    return breaks;
+  }
+
+  // q-th quantile: Xq = (1 - r) * X[a] + r * X[a+1] with a = q * (n-1), the last break is the maximum
+  for ( int i = 1; i <= classes; i++ )
+  {
+    int aa = n - 1;
+    double r = 0.0;
+    if ( i < classes )
+    {
+      double a = ( i / ( double ) classes ) * ( n - 1 );
+      aa = ( int )( a );
+      r = a - aa;
+    }
+
+    sqlite3_reset( stmt );
+    sqlite3_bind_int( stmt, 1, aa );
+
+    if ( sqlite3_step( stmt ) != SQLITE_ROW )
+    {
+      QgsDebugMsg( QString( "SQL error:\n%1\n%2" ).arg( sql ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ) );
+      sqlite3_finalize( stmt );
+      return QList<double>();
+    }
+    double lower = sqlite3_column_double( stmt, 0 );
+    double upper = sqlite3_step( stmt ) == SQLITE_ROW ? sqlite3_column_double( stmt, 0 ) : lower;
+    breaks.append(( 1 - r ) * lower + r * upper );
+  }
+
+  sqlite3_finalize( stmt );
+  return breaks;
+}
+
 // Returns the list of unique values of an attribute
 void QgsSpatiaLiteProvider::uniqueValues( int index, QList < QVariant > &uniqueValues, int limit )
 {
@@ -908,13 +1074,15 @@ void QgsSpatiaLiteProvider::uniqueValues( int index, QList < QVariant > &uniqueV
   // get the field name
   const QgsField & fld = field( index );
 
-  sql = QString( "SELECT DISTINCT %1 FROM %2 ORDER BY %1" ).arg( quotedIdentifier( fld.name() ) ).arg( mQuery );
+  sql = QString( "SELECT DISTINCT %1 FROM %2" ).arg( quotedIdentifier( fld.name() ) ).arg( mQuery );
 
   if ( !mSubsetString.isEmpty() )
   {
     sql += " WHERE ( " + mSubsetString + ")";
   }
 
+  sql += QString( " ORDER BY %1" ).arg( quotedIdentifier( fld.name() ) );
+
   if ( limit >= 0 )
   {
     sql += QString( " LIMIT %1" ).arg( limit );
@@ -1026,10 +1194,10 @@ bool QgsSpatiaLiteProvider::addFeatures( QgsFeatureList & flist )
   sql += ")";
 
   // SQLite prepared statement
-  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  stmt = preparedStatement( sql );
+  if ( stmt == NULL )
   {
-    // some error occurred
-    QgsDebugMsg( QString( "SQLite error: %1\n\nSQL: %2" ).arg( sql ).arg( sqlite3_errmsg( sqliteHandle ) ) );
+    sqlite3_exec( sqliteHandle, "ROLLBACK", NULL, NULL, NULL );
     return false;
   }
 
@@ -1112,7 +1280,7 @@ bool QgsSpatiaLiteProvider::addFeatures( QgsFeatureList & flist )
     }
 
   }
-  sqlite3_finalize( stmt );
+  sqlite3_reset( stmt );
 
   ret = sqlite3_exec( sqliteHandle, "COMMIT", NULL, NULL, &errMsg );
   if ( ret != SQLITE_OK )
@@ -1129,6 +1297,12 @@ abort:
     sqlite3_free( errMsg );
   }
 
+
+  if ( stmt )
+  {
+    // give the statement back to the cache
+    sqlite3_reset( stmt );
+  }
   if ( toCommit )
   {
     // ROLLBACK after some previous error
@@ -1156,10 +1330,10 @@ bool QgsSpatiaLiteProvider::deleteFeatures( const QgsFeatureIds & id )
   sql = QString( "DELETE FROM %1 WHERE ROWID=?" ).arg( quotedIdentifier( mTableName ) );
 
   // SQLite prepared statement
-  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  stmt = preparedStatement( sql );
+  if ( stmt == NULL )
   {
-    // some error occurred
-    QgsDebugMsg( QString( "SQLite error: %1\n\nSQL: %2" ).arg( sql ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ) );
+    sqlite3_exec( sqliteHandle, "ROLLBACK", NULL, NULL, NULL );
     return false;
   }
 
@@ -1188,7 +1362,7 @@ bool QgsSpatiaLiteProvider::deleteFeatures( const QgsFeatureIds & id )
       goto abort;
     }
   }
-  sqlite3_finalize( stmt );
+  sqlite3_reset( stmt );
 
   ret = sqlite3_exec( sqliteHandle, "COMMIT", NULL, NULL, &errMsg );
   if ( ret != SQLITE_OK )
@@ -1206,6 +1380,12 @@ abort:
     sqlite3_free( errMsg );
   }
 
+
+  if ( stmt )
+  {
+    // give the statement back to the cache
+    sqlite3_reset( stmt );
+  }
   if ( toCommit )
   {
     // ROLLBACK after some previous error
@@ -1273,6 +1453,7 @@ abort:
 
 bool QgsSpatiaLiteProvider::changeAttributeValues( const QgsChangedAttributesMap & attr_map )
 {
+  sqlite3_stmt *stmt = NULL;
   char *errMsg = NULL;
   bool toCommit = false;
   QString sql;
@@ -1293,7 +1474,8 @@ bool QgsSpatiaLiteProvider::changeAttributeValues( const QgsChangedAttributesMap
     if ( fid < 0 )
       continue;
 
-    QString sql = QString( "UPDATE %1 SET " ).arg( quotedIdentifier( mTableName ) );
+    // features with the same changed columns share one prepared statement
+    sql = QString( "UPDATE %1 SET " ).arg( quotedIdentifier( mTableName ) );
     bool first = true;
 
     const QgsAttributeMap & attrs = iter.value();
@@ -1308,6 +1490,19 @@ bool QgsSpatiaLiteProvider::changeAttributeValues( const QgsChangedAttributesMap
       else
         first = false;
 
+      sql += QString( "%1=?" ).arg( quotedIdentifier( fieldName ) );
+    }
+    sql += " WHERE ROWID=?";
+
+    stmt = preparedStatement( sql );
+    if ( stmt == NULL )
+    {
+      goto abort;
+    }
+
+    int ia = 0;
+    for ( QgsAttributeMap::const_iterator siter = attrs.begin(); siter != attrs.end(); ++siter )
+    {
       QVariant::Type type = siter->type();
       if ( siter->toString().isEmpty() )
       {
@@ -1318,27 +1513,45 @@ bool QgsSpatiaLiteProvider::changeAttributeValues( const QgsChangedAttributesMap
       if ( type == QVariant::Invalid )
       {
         // binding a NULL value
-        sql += QString( "%1=NULL" ).arg( quotedIdentifier( fieldName ) );
+        sqlite3_bind_null( stmt, ++ia );
+      }
+      else if ( type == QVariant::Int )
+      {
+        // binding an INTEGER value
+        sqlite3_bind_int( stmt, ++ia, siter->toInt() );
       }
-      else if ( type == QVariant::Int || type == QVariant::Double )
+      else if ( type == QVariant::LongLong )
       {
-        // binding a NUMERIC value
-        sql += QString( "%1=%2" ).arg( quotedIdentifier( fieldName ) ).arg( siter->toString() );
+        // binding an INTEGER value
+        sqlite3_bind_int64( stmt, ++ia, siter->toLongLong() );
+      }
+      else if ( type == QVariant::Double )
+      {
+        // binding a DOUBLE value
+        sqlite3_bind_double( stmt, ++ia, siter->toDouble() );
       }
       else
       {
         // binding a TEXT value
-        sql += QString( "%1=%2" ).arg( quotedIdentifier( fieldName ) ).arg( quotedValue( siter->toString() ) );
+        QByteArray txt = siter->toString().toUtf8();
+        sqlite3_bind_text( stmt, ++ia, txt.constData(), txt.length(), SQLITE_TRANSIENT );
       }
     }
-    sql += QString( " WHERE ROWID=%1" ).arg( fid );
+    sqlite3_bind_int( stmt, ++ia, fid );
 
-    ret = sqlite3_exec( sqliteHandle, sql.toUtf8().constData(), NULL, NULL, &errMsg );
-    if ( ret != SQLITE_OK )
+    // performing actual row update
+    ret = sqlite3_step( stmt );
+    if ( ret != SQLITE_DONE && ret != SQLITE_ROW )
     {
-      // some error occurred
+      // some unexpected error occurred
+      const char *err = sqlite3_errmsg( sqliteHandle );
+      int len = strlen( err );
+      errMsg = ( char * ) sqlite3_malloc( len + 1 );
+      strcpy( errMsg, err );
       goto abort;
     }
+    sqlite3_reset( stmt );
+    stmt = NULL;
   }
 
   ret = sqlite3_exec( sqliteHandle, "COMMIT", NULL, NULL, &errMsg );
@@ -1357,6 +1570,12 @@ abort:
     sqlite3_free( errMsg );
   }
 
+  if ( stmt )
+  {
+    // give the statement back to the cache
+    sqlite3_reset( stmt );
+  }
+
   if ( toCommit )
   {
     // ROLLBACK after some previous error
@@ -1388,10 +1607,10 @@ bool QgsSpatiaLiteProvider::changeGeometryValues( QgsGeometryMap & geometry_map
     .arg( mSrid );
 
   // SQLite prepared statement
-  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  stmt = preparedStatement( sql );
+  if ( stmt == NULL )
   {
-    // some error occurred
-    QgsDebugMsg( QString( "SQLite error: %1\n\nSQL: %2" ).arg( sql ).arg( QString::fromUtf8( sqlite3_errmsg( sqliteHandle ) ) ) );
+    sqlite3_exec( sqliteHandle, "ROLLBACK", NULL, NULL, NULL );
     return false;
   }
 
@@ -1426,7 +1645,7 @@ bool QgsSpatiaLiteProvider::changeGeometryValues( QgsGeometryMap & geometry_map
 
     }
   }
-  sqlite3_finalize( stmt );
+  sqlite3_reset( stmt );
 
   ret = sqlite3_exec( sqliteHandle, "COMMIT", NULL, NULL, &errMsg );
   if ( ret != SQLITE_OK )
@@ -1443,6 +1662,12 @@ abort:
     sqlite3_free( errMsg );
   }
 
+
+  if ( stmt )
+  {
+    // give the statement back to the cache
+    sqlite3_reset( stmt );
+  }
   if ( toCommit )
   {
     // ROLLBACK after some previous error
@@ -1461,11 +1686,7 @@ int QgsSpatiaLiteProvider::capabilities() const
 void QgsSpatiaLiteProvider::closeDb()
 {
 // trying to close the SQLite DB
-  if ( sqliteStatement )
-  {
-    sqlite3_finalize( sqliteStatement );
-    sqliteStatement = NULL;
-  }
+  finalizeStatements();
   if ( handle )
   {
     SqliteHandles::closeDb( handle );
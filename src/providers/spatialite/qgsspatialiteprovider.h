@@ -155,6 +155,15 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
      *  @param index the index of the attribute */
     QVariant maximumValue( int index );
 
+    /** Returns an aggregate of an attribute, calculated by SQLite
+     *  @note added in 1.6 */
+    QVariant aggregateValue( int index, Aggregate aggregate );
+
+    /** Returns the quantile class breaks of an attribute, each break is
+     *  fetched with an ordered query
+     *  @note added in 1.6 */
+    QList<double> quantiles( int index, int classes );
+
     /** Return the unique values of an attribute
      *  @param index the index of the attribute
      *  @param values reference to the list of unique values
@@ -324,9 +333,14 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
      */
     sqlite3 *sqliteHandle;
     /**
-      * SQLite statement handle
+      * SQLite statement handle of the current select, owned by mStatements
      */
     sqlite3_stmt *sqliteStatement;
+    /**
+     * Prepared statements by their SQL text, reused by all selects,
+     * featureAtId calls and edits of the same shape
+     */
+    QMap<QString, sqlite3_stmt *> mStatements;
     /**
      * String used to define a subset of the layer
      */
@@ -366,6 +380,16 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
     */
     //void sqliteOpen();
     void closeDb();
+    /** returns the cached statement for sql (reset and without bindings) or prepares and caches it, NULL on error */
+    sqlite3_stmt *preparedStatement( const QString &sql );
+    /** finalizes all cached statements */
+    void finalizeStatements();
+    /** reads the feature id, the attributes and the geometry from the current row of stmt */
+    void getFeature( sqlite3_stmt *stmt, bool fetchGeometry, const QgsAttributeList &fetchAttributes, QgsFeature &feature );
+    /** converts a SpatiaLite BLOB geometry to a new WKB buffer, NULL if the BLOB can't be decoded */
+    static void convertToWkb( const unsigned char *blob, size_t blob_size, unsigned char **wkb, size_t *wkb_size );
+    /** size of the body of a point, linestring or polygon in native byte order, -1 if it exceeds end */
+    static int computeWkbBodySize( const unsigned char *p, const unsigned char *end, int type, int endian_arch );
     QString quotedIdentifier( QString id ) const;
     QString quotedValue( QString value ) const;
     bool checkLayerType();
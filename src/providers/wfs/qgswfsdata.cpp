@@ -19,6 +19,7 @@
 #include "qgslogger.h"
 #include "qgsnetworkaccessmanager.h"
 #include <QBuffer>
+#include <QFile>
 #include <QList>
 #include <QNetworkRequest>
 #include <QNetworkReply>
@@ -29,6 +30,8 @@
 
 const char NS_SEPARATOR = '?';
 const QString GML_NAMESPACE = "http://www.opengis.net/gml";
+//number of bytes read from a GML file and handed to the parser at once
+const qint64 GML_READ_CHUNK_SIZE = 1024 * 1024;
 
 QgsWFSData::QgsWFSData(
   const QString& uri,
@@ -40,6 +43,9 @@ QgsWFSData::QgsWFSData(
   QGis::WkbType* wkbType )
     : QObject(),
     mUri( uri ),
+    mParser( 0 ),
+    mReply( 0 ),
+    mEpsg( 0 ),
     mExtent( extent ),
     mFeatures( features ),
     mIdMap( idMap ),
@@ -49,6 +55,12 @@ QgsWFSData::QgsWFSData(
     mFinished( false ),
     mFeatureCount( 0 )
 {
+  //continue numbering after the features already present (e.g. from requests for other areas)
+  if ( !mFeatures.isEmpty() )
+  {
+    mFeatureCount = ( mFeatures.constEnd() - 1 ).key() + 1;
+  }
+
   //find out mTypeName from uri
   QStringList arguments = uri.split( "&" );
   QStringList::const_iterator it;
@@ -72,15 +84,39 @@ QgsWFSData::QgsWFSData(
 
 QgsWFSData::~QgsWFSData()
 {
+  if ( mReply )
+  {
+    //abort a running background request without getting its finished signal
+    mReply->disconnect( this );
+    mReply->abort();
+    mReply->deleteLater();
+  }
+  if ( mParser )
+  {
+    XML_ParserFree( mParser );
+  }
+}
 
+void QgsWFSData::createParser()
+{
+  if ( mParser )
+  {
+    XML_ParserFree( mParser );
+  }
+  mParser = XML_ParserCreateNS( NULL, NS_SEPARATOR );
+  XML_SetUserData( mParser, this );
+  XML_SetElementHandler( mParser, QgsWFSData::start, QgsWFSData::end );
+  XML_SetCharacterDataHandler( mParser, QgsWFSData::chars );
 }
 
 int QgsWFSData::getWFSData()
 {
-  XML_Parser p = XML_ParserCreateNS( NULL, NS_SEPARATOR );
-  XML_SetUserData( p, this );
-  XML_SetElementHandler( p, QgsWFSData::start, QgsWFSData::end );
-  XML_SetCharacterDataHandler( p, QgsWFSData::chars );
+  if ( !mUri.startsWith( "http" ) )
+  {
+    return getWFSDataFromFile();
+  }
+
+  createParser();
 
   //start with empty extent
   if ( mExtent )
@@ -119,7 +155,7 @@ int QgsWFSData::getWFSData()
     QByteArray readData = reply->readAll();
     if ( readData.size() > 0 )
     {
-      XML_Parse( p, readData.constData(), readData.size(), atEnd );
+      XML_Parse( mParser, readData.constData(), readData.size(), atEnd );
     }
     QCoreApplication::processEvents();
   }
@@ -136,10 +172,115 @@ int QgsWFSData::getWFSData()
     }
   }
 
-  XML_ParserFree( p );
   return 0;
 }
 
+int QgsWFSData::getWFSDataFromFile()
+{
+  QFile gmlFile( mUri );
+  if ( !gmlFile.open( QIODevice::ReadOnly ) )
+  {
+    return 1;
+  }
+
+  createParser();
+
+  //start with empty extent
+  if ( mExtent )
+  {
+    mExtent->set( 0, 0, 0, 0 );
+  }
+
+  //parse the file piecewise instead of building a dom tree of the whole document
+  qint64 fileSize = gmlFile.size();
+  int atEnd = 0;
+  while ( !atEnd )
+  {
+    QByteArray readData = gmlFile.read( GML_READ_CHUNK_SIZE );
+    atEnd = gmlFile.atEnd() || readData.isEmpty();
+    if ( XML_Parse( mParser, readData.constData(), readData.size(), atEnd ) == XML_STATUS_ERROR )
+    {
+      QgsDebugMsg( QString( "GML parse error: %1 at line %2" )
+                   .arg( XML_ErrorString( XML_GetErrorCode( mParser ) ) )
+                   .arg( XML_GetCurrentLineNumber( mParser ) ) );
+      return 2;
+    }
+    handleProgressEvent( gmlFile.pos(), fileSize );
+  }
+
+  if ( mExtent )
+  {
+    if ( mExtent->isEmpty() )
+    {
+      calculateExtentFromFeatures();
+    }
+  }
+
+  return 0;
+}
+
+void QgsWFSData::startWFSData()
+{
+  createParser();
+  mFinished = false;
+  mErrorMessage.clear();
+
+  QNetworkRequest request( mUri );
+  mReply = QgsNetworkAccessManager::instance()->get( request );
+
+  connect( mReply, SIGNAL( readyRead() ), this, SLOT( parseAvailableData() ) );
+  connect( mReply, SIGNAL( finished() ), this, SLOT( backgroundRequestFinished() ) );
+  connect( mReply, SIGNAL( downloadProgress( qint64, qint64 ) ), this, SLOT( handleProgressEvent( qint64, qint64 ) ) );
+}
+
+void QgsWFSData::parseAvailableData()
+{
+  if ( !mReply )
+  {
+    return;
+  }
+
+  QByteArray readData = mReply->readAll();
+  if ( readData.size() > 0 && mErrorMessage.isEmpty() )
+  {
+    parseChunk( readData, 0 );
+  }
+}
+
+void QgsWFSData::backgroundRequestFinished()
+{
+  if ( !mReply )
+  {
+    return;
+  }
+
+  if ( mReply->error() != QNetworkReply::NoError )
+  {
+    mErrorMessage = tr( "WFS request failed: %1" ).arg( mReply->errorString() );
+    QgsDebugMsg( mErrorMessage );
+  }
+  else if ( mErrorMessage.isEmpty() )
+  {
+    parseChunk( mReply->readAll(), 1 );
+  }
+
+  mReply->deleteLater();
+  mReply = 0;
+  mFinished = true;
+  emit dataReadFinished();
+}
+
+void QgsWFSData::parseChunk( const QByteArray& data, int atEnd )
+{
+  if ( XML_Parse( mParser, data.constData(), data.size(), atEnd ) == XML_STATUS_ERROR )
+  {
+    mErrorMessage = tr( "GML parse error: %1 at line %2" )
+                    .arg( XML_ErrorString( XML_GetErrorCode( mParser ) ) )
+                    .arg( XML_GetCurrentLineNumber( mParser ) );
+    QgsDebugMsg( mErrorMessage );
+  }
+}
+
 void QgsWFSData::setFinished( )
 {
   mFinished = true;
@@ -186,6 +327,7 @@ void QgsWFSData::startElement( const XML_Char* el, const XML_Char** attr )
   else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "featureMember" )
   {
     mCurrentFeature = new QgsFeature( mFeatureCount );
+    mCurrentFeatureId.clear();
     mParseModeStack.push( QgsWFSData::featureMember );
   }
   else if ( localName == mTypeName )
@@ -200,6 +342,10 @@ void QgsWFSData::startElement( const XML_Char* el, const XML_Char** attr )
     {
       QgsDebugMsg( "error, could not get epsg id" );
     }
+    else
+    {
+      mEpsg = epsgNr;
+    }
   }
   else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "Polygon" )
   {
@@ -318,6 +464,12 @@ void QgsWFSData::endElement( const XML_Char* el )
 
 
     mCurrentFeature->setGeometryAndOwnership( mCurrentWKB, mCurrentWKBSize );
+    //the provider may have added features with the next ids meanwhile (findNewKey)
+    while ( mFeatures.contains( mFeatureCount ) )
+    {
+      ++mFeatureCount;
+    }
+    mCurrentFeature->setFeatureId( mFeatureCount );
     mFeatures.insert( mCurrentFeature->id(), mCurrentFeature );
     if ( !mCurrentFeatureId.isEmpty() )
     {
@@ -325,6 +477,7 @@ void QgsWFSData::endElement( const XML_Char* el )
     }
     ++mFeatureCount;
     mParseModeStack.pop();
+    emit featureParsed( mCurrentFeature->id() );
   }
   else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "Point" )
   {
@@ -850,9 +1003,11 @@ void QgsWFSData::calculateExtentFromFeatures() const
   QgsGeometry* currentGeometry = 0;
   bool bboxInitialised = false; //gets true once bbox has been set to the first geometry
 
-  for ( int i = 0; i < mFeatures.size(); ++i )
+  //feature ids are not necessarily contiguous, so iterate instead of indexing
+  QMap<int, QgsFeature* >::const_iterator it = mFeatures.constBegin();
+  for ( ; it != mFeatures.constEnd(); ++it )
   {
-    currentFeature = mFeatures[i];
+    currentFeature = it.value();
     if ( !currentFeature )
     {
       continue;
@@ -28,6 +28,7 @@
 #include <QPair>
 class QgsRectangle;
 class QgsCoordinateReferenceSystem;
+class QNetworkReply;
 
 
 /**This class reads data from a WFS server or alternatively from a GML file. It uses the expat XML parser and an event based model to keep performance high. The parsing starts when the first data arrives, it does not wait until the request is finished*/
@@ -45,7 +46,8 @@ class QgsWFSData: public QObject
       QGis::WkbType* wkbType );
     ~QgsWFSData();
 
-    /**Does the Http GET request to the wfs server
+    /**Does the Http GET request to the wfs server (or reads the GML file if the uri is not a http url)
+       and waits until all the features have been parsed
        @param query string (to define the requested typename)
        @param extent the extent of the WFS layer
        @param srs the reference system of the layer
@@ -53,17 +55,38 @@ class QgsWFSData: public QObject
     @return 0 in case of success*/
     int getWFSData();
 
+    /**Starts the Http GET request to the wfs server and returns immediately. The features are parsed
+       while the data arrives. Each new feature is announced with the featureParsed signal and
+       dataReadFinished is emitted at the end of the response*/
+    void startWFSData();
+
+    /**Returns the EPSG code of the srsName found in the bounding box of the response (or 0 if there was none)*/
+    int epsg() const { return mEpsg; }
+
+    /**Returns the network or parse error of the last request started with startWFSData (empty if it succeeded)*/
+    QString errorMessage() const { return mErrorMessage; }
+
   private slots:
     void setFinished();
 
     /**Takes progress value and total steps and emit signals 'dataReadProgress' and 'totalStepUpdate'*/
     void handleProgressEvent( qint64 progress, qint64 totalSteps );
 
+    /**Feeds the data received so far by a background request to the parser*/
+    void parseAvailableData();
+
+    /**Parses the rest of the response of a background request and emits dataReadFinished*/
+    void backgroundRequestFinished();
+
   signals:
     void dataReadProgress( int progress );
     void totalStepsUpdate( int totalSteps );
     //also emit signal with progress and totalSteps together (this is better for the status message)
     void dataProgressAndSteps( int progress, int totalSteps );
+    /**Emitted after a feature has been completely parsed and inserted into the feature map*/
+    void featureParsed( int featureId );
+    /**Emitted when the response of a request started with startWFSData has been parsed completely*/
+    void dataReadFinished();
 
   private:
 
@@ -84,6 +107,13 @@ class QgsWFSData: public QObject
 
     QgsWFSData();
 
+    /**Creates mParser and registers the handler methods*/
+    void createParser();
+    /**Reads the GML file mUri in chunks and feeds them to the parser. Returns 0 in case of success*/
+    int getWFSDataFromFile();
+    /**Feeds a chunk of a background response to the parser and records a parse error in mErrorMessage*/
+    void parseChunk( const QByteArray& data, int atEnd );
+
     /**XML handler methods*/
     void startElement( const XML_Char* el, const XML_Char** attr );
     void endElement( const XML_Char* el );
@@ -140,6 +170,12 @@ class QgsWFSData: public QObject
     void calculateExtentFromFeatures() const;
 
     QString mUri;
+    /**The expat parser, kept as member such that background requests can feed it chunk by chunk*/
+    XML_Parser mParser;
+    /**Reply of a request started with startWFSData (or 0)*/
+    QNetworkReply* mReply;
+    /**EPSG code read from the srsName of the bounding box*/
+    int mEpsg;
     //results are members such that handler routines are able to manipulate them
     /**Bounding box of the layer*/
     QgsRectangle* mExtent;
@@ -153,6 +189,8 @@ class QgsWFSData: public QObject
     QGis::WkbType* mWkbType;
     /**True if the request is finished*/
     bool mFinished;
+    /**Error of the background request (network or parse error), empty if there was none*/
+    QString mErrorMessage;
     /**Keep track about the most important nested elements*/
     std::stack<parseMode> mParseModeStack;
     /**This contains the character data if an important element has been encountered*/
@@ -16,12 +16,17 @@
  ***************************************************************************/
 
 #define WFS_THRESHOLD 200
+//number of tile columns / rows the layer extent is divided into for tiled requests
+#define WFS_TILE_GRID_SIZE 16
+//minimum time in ms between two repaints triggered by a running background request
+#define WFS_REFRESH_INTERVAL 1000
 
 #include "qgsapplication.h"
 #include "qgsfeature.h"
 #include "qgsfield.h"
 #include "qgsgeometry.h"
 #include "qgscoordinatereferencesystem.h"
+#include "qgscoordinatetransform.h"
 #include "qgswfsdata.h"
 #include "qgswfsprovider.h"
 #include "qgsspatialindex.h"
@@ -34,9 +39,11 @@
 #include <QNetworkReply>
 #include <QFile>
 #include <QUrl>
+#include <QCryptographicHash>
 #include <QWidget>
 #include <QPair>
 #include <cfloat>
+#include <cmath>
 
 static const QString TEXT_PROVIDER_KEY = "WFS";
 static const QString TEXT_PROVIDER_DESCRIPTION = "WFS data provider";
@@ -48,13 +55,23 @@ QgsWFSProvider::QgsWFSProvider( const QString& uri )
     : QgsVectorDataProvider( uri ),
     mNetworkRequestFinished( true ),
     mUseIntersect( false ),
+    mWKBType( QGis::WKBUnknown ),
     mSourceCRS( 0 ),
     mFeatureCount( 0 ),
-    mValid( true )
+    mValid( true ),
+    mTiledRequests( false ),
+    mBackgroundReader( 0 )
 {
   mSpatialIndex = 0;
+  mTiledRequests = ( parameterFromUrl( "TILED" ) == "1" );
+  bool remote = uri.startsWith( "http" );
+  if ( remote )
+  {
+    //the extent is needed before the features arrive, so look into the capabilities first
+    getLayerCapabilities();
+  }
   reloadData();
-  if ( mValid )
+  if ( mValid && !remote )
   {
     getLayerCapabilities();
   }
@@ -70,18 +87,18 @@ void QgsWFSProvider::reloadData()
 {
   deleteData();
   delete mSpatialIndex;
-  mSpatialIndex = new QgsSpatialIndex();
+  mSpatialIndex = new QgsSpatialIndex( QgsSpatialIndex::PointerTreeBackend );
   mValid = !getFeature( dataSourceUri() );
 }
 
 void QgsWFSProvider::deleteData()
 {
+  abortBackgroundRequests();
   mSelectedFeatures.clear();
-  for ( int i = 0; i < mFeatures.size(); i++ )
-  {
-    delete mFeatures[i];
-  }
+  qDeleteAll( mFeatures );
   mFeatures.clear();
+  mIdMap.clear();
+  mFeatureCount = 0;
 }
 
 void QgsWFSProvider::copyFeature( QgsFeature* f, QgsFeature& feature, bool fetchGeometry, QgsAttributeList fetchAttributes )
@@ -143,7 +160,7 @@ bool QgsWFSProvider::nextFeature( QgsFeature& feature )
       return 0;
     }
 
-    QgsFeature* f = mFeatures[*mFeatureIterator];
+    QgsFeature* f = mFeatures.value( *mFeatureIterator );
     ++mFeatureIterator;
     if ( !f )
     {
@@ -230,6 +247,13 @@ void QgsWFSProvider::select( QgsAttributeList fetchAttributes,
     mSpatialFilter = rect;
   }
 
+  if ( mTiledRequests && !rect.isEmpty() )
+  {
+    //fetch missing parts in the background. The features arriving later trigger a repaint.
+    //An empty rectangle (e.g. attribute table) only iterates the features loaded so far instead of downloading the whole layer
+    requestTiles( mSpatialFilter );
+  }
+
   mSelectedFeatures = mSpatialIndex->intersects( mSpatialFilter );
   mFeatureIterator = mSelectedFeatures.begin();
 }
@@ -266,8 +290,19 @@ int QgsWFSProvider::getFeature( const QString& uri )
     }
   }
 
+  updateThematicAttributes();
+
   if ( mEncoding == QgsWFSProvider::GET )
   {
+    if ( mTiledRequests && getFeatureTiled() == 0 )
+    {
+      return 0;
+    }
+    mTiledRequests = false;
+    if ( getFeatureStreamed( uri ) == 0 )
+    {
+      return 0;
+    }
     return getFeatureGET( uri, mGeometryAttribute );
   }
   else//local file
@@ -341,6 +376,7 @@ bool QgsWFSProvider::addFeatures( QgsFeatureList &flist )
 
   if ( transactionSuccess( serverResponse ) )
   {
+    clearMinMaxCache();
     //transaction successful. Add the features to mSpatialIndex
     if ( mSpatialIndex )
     {
@@ -417,6 +453,7 @@ bool QgsWFSProvider::deleteFeatures( const QgsFeatureIds &id )
 
   if ( transactionSuccess( serverResponse ) )
   {
+    clearMinMaxCache();
     idIt = id.constBegin();
     for ( ; idIt != id.constEnd(); ++idIt )
     {
@@ -497,6 +534,7 @@ bool QgsWFSProvider::changeGeometryValues( QgsGeometryMap & geometry_map )
 
   if ( transactionSuccess( serverResponse ) )
   {
+    clearMinMaxCache();
     geomIt = geometry_map.begin();
     for ( ; geomIt != geometry_map.end(); ++geomIt )
     {
@@ -601,6 +639,7 @@ bool QgsWFSProvider::changeAttributeValues( const QgsChangedAttributesMap &attr_
 
   if ( transactionSuccess( serverResponse ) )
   {
+    clearMinMaxCache();
     //change attributes in mFeatures
     attIt = attr_map.constBegin();
     for ( ; attIt != attr_map.constEnd(); ++attIt )
@@ -648,28 +687,102 @@ int QgsWFSProvider::describeFeatureType( const QString& uri, QString& geometryAt
 int QgsWFSProvider::getFeatureGET( const QString& uri, const QString& geometryAttribute )
 {
   //the new and faster method with the expat SAX parser
+  setCRSFromUrl();
 
-  //allows fast searchings with attribute name. Also needed is attribute Index and type infos
-  QMap<QString, QPair<int, QgsField> > thematicAttributes;
-  for ( QgsFieldMap::const_iterator it = mFields.begin(); it != mFields.end(); ++it )
+  QgsWFSData dataReader( uri, &mExtent, mFeatures, mIdMap, geometryAttribute, mThematicAttributes, &mWKBType );
+  QObject::connect( &dataReader, SIGNAL( dataProgressAndSteps( int , int ) ), this, SLOT( handleWFSProgressMessage( int, int ) ) );
+  //features go into the spatial index while the rest of the response is still being parsed
+  QObject::connect( &dataReader, SIGNAL( featureParsed( int ) ), this, SLOT( handleFeatureParsed( int ) ) );
+
+  connectProgressToMainWindow();
+
+  if ( dataReader.getWFSData() != 0 )
   {
-    thematicAttributes.insert( it.value().name(), qMakePair( it.key(), it.value() ) );
+    QgsDebugMsg( "getWFSData returned with error" );
+    return 1;
   }
 
-  //create mSourceCRS from url if possible
-  QString srsname = parameterFromUrl( "SRSNAME" );
-  if ( !srsname.isEmpty() )
+  QgsDebugMsg( QString( "feature count after request is: %1" ).arg( mFeatures.size() ) );
+  QgsDebugMsg( QString( "mExtent after request is: %1" ).arg( mExtent.toString() ) );
+
+  mFeatureCount = mFeatures.size();
+
+  return 0;
+}
+
+int QgsWFSProvider::getFeatureFILE( const QString& uri, const QString& geometryAttribute )
+{
+  //stream the file through the expat parser instead of loading it into a dom document
+  QgsWFSData dataReader( uri, &mExtent, mFeatures, mIdMap, geometryAttribute, mThematicAttributes, &mWKBType );
+  QObject::connect( &dataReader, SIGNAL( featureParsed( int ) ), this, SLOT( handleFeatureParsed( int ) ) );
+
+  if ( dataReader.getWFSData() != 0 )
   {
-    QStringList epsgSplit = srsname.split( ":" );
-    if ( epsgSplit.size() > 1 )
-    {
-      mSourceCRS.createFromEpsg( epsgSplit.at( 1 ).toInt() );
-    }
+    mValid = false;
+    return 2;
   }
 
-  QgsWFSData dataReader( uri, &mExtent, mFeatures, mIdMap, geometryAttribute, thematicAttributes, &mWKBType );
-  QObject::connect( &dataReader, SIGNAL( dataProgressAndSteps( int , int ) ), this, SLOT( handleWFSProgressMessage( int, int ) ) );
+  if ( dataReader.epsg() != 0 )
+  {
+    mSourceCRS.createFromOgcWmsCrs( QString( "EPSG:%1" ).arg( dataReader.epsg() ) );
+  }
+
+  mFeatureCount = mFeatures.size();
+  return 0;
+}
+
+int QgsWFSProvider::getFeatureStreamed( const QString& uri )
+{
+  setCRSFromUrl();
+
+  //the map canvas asks for the extent as soon as the layer is added
+  mExtent = initialExtent();
+  if ( mExtent.isEmpty() )
+  {
+    QgsDebugMsg( "no layer extent available before the download, waiting for all features" );
+    return 1;
+  }
+
+  connectProgressToMainWindow();
+  mLastRefresh.start();
+  mBackgroundReader = new QgsWFSData( uri, 0, mFeatures, mIdMap, mGeometryAttribute, mThematicAttributes, &mWKBType );
+  connect( mBackgroundReader, SIGNAL( featureParsed( int ) ), this, SLOT( handleFeatureParsed( int ) ) );
+  connect( mBackgroundReader, SIGNAL( dataReadFinished() ), this, SLOT( backgroundReadFinished() ) );
+  connect( mBackgroundReader, SIGNAL( dataProgressAndSteps( int , int ) ), this, SLOT( handleWFSProgressMessage( int, int ) ) );
+  mBackgroundReader->startWFSData();
+  return 0;
+}
+
+int QgsWFSProvider::getFeatureTiled()
+{
+  setCRSFromUrl();
+
+  mExtent = initialExtent();
+  if ( mExtent.isEmpty() )
+  {
+    QgsDebugMsg( "no layer extent available for tiled requests, requesting all features" );
+    return 1;
+  }
+
+  connectProgressToMainWindow();
+  mLastRefresh.start();
+  return 0;
+}
+
+QgsRectangle QgsWFSProvider::initialExtent() const
+{
+  //a BBOX in the layer uri restricts the layer to that area, otherwise use what the server advertises
+  QStringList bboxSplit = parameterFromUrl( "BBOX" ).split( "," );
+  if ( bboxSplit.size() == 4 )
+  {
+    return QgsRectangle( bboxSplit.at( 0 ).toDouble(), bboxSplit.at( 1 ).toDouble(),
+                         bboxSplit.at( 2 ).toDouble(), bboxSplit.at( 3 ).toDouble() );
+  }
+  return mCapabilitiesExtent;
+}
 
+void QgsWFSProvider::connectProgressToMainWindow()
+{
   //also connect to statusChanged signal of qgisapp (if it exists)
   QWidget* mainWindow = 0;
 
@@ -687,60 +800,224 @@ int QgsWFSProvider::getFeatureGET( const QString& uri, const QString& geometryAt
   {
     QObject::connect( this, SIGNAL( dataReadProgressMessage( QString ) ), mainWindow, SLOT( showStatusMessage( QString ) ) );
   }
+}
 
-  if ( dataReader.getWFSData() != 0 )
+void QgsWFSProvider::setCRSFromUrl()
+{
+  //create mSourceCRS from url if possible
+  QString srsname = parameterFromUrl( "SRSNAME" );
+  if ( !srsname.isEmpty() )
   {
-    QgsDebugMsg( "getWFSData returned with error" );
-    return 1;
+    QStringList epsgSplit = srsname.split( ":" );
+    if ( epsgSplit.size() > 1 )
+    {
+      mSourceCRS.createFromEpsg( epsgSplit.at( 1 ).toInt() );
+    }
   }
+}
 
-  QgsDebugMsg( QString( "feature count after request is: %1" ).arg( mFeatures.size() ) );
-  QgsDebugMsg( QString( "mExtent after request is: %1" ).arg( mExtent.toString() ) );
+void QgsWFSProvider::updateThematicAttributes()
+{
+  //allows fast searchings with attribute name. Also needed is attribute Index and type infos
+  mThematicAttributes.clear();
+  for ( QgsFieldMap::const_iterator it = mFields.begin(); it != mFields.end(); ++it )
+  {
+    mThematicAttributes.insert( it.value().name(), qMakePair( it.key(), it.value() ) );
+  }
+}
 
-  for ( QMap<int, QgsFeature*>::iterator it = mFeatures.begin(); it != mFeatures.end(); ++it )
+void QgsWFSProvider::handleFeatureParsed( int featureId )
+{
+  QgsFeature* f = mFeatures.value( featureId );
+  if ( !f )
+  {
+    return;
+  }
+
+  if ( mTiledRequests )
+  {
+    //features crossing tile borders are returned for each of the tiles. Features without
+    //fid are recognized by their geometry and attributes
+    QMap<int, QString>::iterator fidIt = mIdMap.find( featureId );
+    QString key = fidIt != mIdMap.end() ? fidIt.value() : QString( "#" ) + featureHash( f );
+    if ( mServerIds.contains( key ) )
+    {
+      if ( fidIt != mIdMap.end() )
+      {
+        mIdMap.erase( fidIt );
+      }
+      mFeatures.remove( featureId );
+      delete f;
+      return;
+    }
+    mServerIds.insert( key );
+  }
+  else if ( mBackgroundReader && f->geometry() )
   {
-    QgsDebugMsg( "feature " + QString::number(( *it )->id() ) );
-    mSpatialIndex->insertFeature( *( it.value() ) );
+    //the extent from the capabilities is only an estimate while the layer is streamed
+    mExtent.unionRect( f->geometry()->boundingBox() );
   }
 
+  mSpatialIndex->insertFeature( *f );
   mFeatureCount = mFeatures.size();
+  clearMinMaxCache();
 
-  return 0;
+  if ( mBackgroundReader && mLastRefresh.elapsed() > WFS_REFRESH_INTERVAL )
+  {
+    mLastRefresh.restart();
+    emit dataChanged();
+  }
 }
 
-int QgsWFSProvider::getFeatureFILE( const QString& uri, const QString& geometryAttribute )
+QString QgsWFSProvider::featureHash( QgsFeature* f ) const
 {
-  QFile gmlFile( uri );
-  if ( !gmlFile.open( QIODevice::ReadOnly ) )
+  QCryptographicHash hash( QCryptographicHash::Md5 );
+  QgsGeometry* geometry = f->geometry();
+  if ( geometry )
   {
-    mValid = false;
-    return 1;
+    hash.addData(( const char* ) geometry->asWkb(), geometry->wkbSize() );
   }
+  const QgsAttributeMap& attributes = f->attributeMap();
+  for ( QgsAttributeMap::const_iterator it = attributes.constBegin(); it != attributes.constEnd(); ++it )
+  {
+    hash.addData( it.value().toString().toUtf8() );
+    hash.addData( "\0", 1 );
+  }
+  return hash.result().toHex();
+}
 
-  QDomDocument gmlDoc;
-  QString errorMsg;
-  int errorLine, errorColumn;
-  if ( !gmlDoc.setContent( &gmlFile, true, &errorMsg, &errorLine, &errorColumn ) )
+void QgsWFSProvider::requestTiles( const QgsRectangle& rect )
+{
+  if ( !rect.intersects( mExtent ) )
   {
-    mValid = false;
-    return 2;
+    return;
   }
+  QgsRectangle requestRect = rect.intersect( &mExtent );
 
-  QDomElement featureCollectionElement = gmlDoc.documentElement();
-  //get and set Extent
-  if ( getExtentFromGML2( &mExtent, featureCollectionElement ) != 0 )
+  double tileWidth = mExtent.width() / WFS_TILE_GRID_SIZE;
+  double tileHeight = mExtent.height() / WFS_TILE_GRID_SIZE;
+  if ( tileWidth <= 0 || tileHeight <= 0 )
   {
-    return 3;
+    return;
   }
 
-  setCRSFromGML2( featureCollectionElement );
+  int minCol = qBound( 0, ( int ) floor(( requestRect.xMinimum() - mExtent.xMinimum() ) / tileWidth ), WFS_TILE_GRID_SIZE - 1 );
+  int maxCol = qBound( 0, ( int ) floor(( requestRect.xMaximum() - mExtent.xMinimum() ) / tileWidth ), WFS_TILE_GRID_SIZE - 1 );
+  int minRow = qBound( 0, ( int ) floor(( requestRect.yMinimum() - mExtent.yMinimum() ) / tileHeight ), WFS_TILE_GRID_SIZE - 1 );
+  int maxRow = qBound( 0, ( int ) floor(( requestRect.yMaximum() - mExtent.yMinimum() ) / tileHeight ), WFS_TILE_GRID_SIZE - 1 );
 
-  if ( getFeaturesFromGML2( featureCollectionElement, geometryAttribute ) != 0 )
+  //collect the missing tiles into one request to keep the number of round trips low
+  QgsRectangle missingArea;
+  QSet< QPair<int, int> > missingTiles;
+  bool tilesMissing = false;
+  for ( int col = minCol; col <= maxCol; ++col )
   {
-    return 4;
+    for ( int row = minRow; row <= maxRow; ++row )
+    {
+      QPair<int, int> tile( col, row );
+      if ( mRequestedTiles.contains( tile ) )
+      {
+        continue;
+      }
+      mRequestedTiles.insert( tile );
+      missingTiles.insert( tile );
+
+      QgsRectangle tileRect( mExtent.xMinimum() + col * tileWidth, mExtent.yMinimum() + row * tileHeight,
+                             mExtent.xMinimum() + ( col + 1 ) * tileWidth, mExtent.yMinimum() + ( row + 1 ) * tileHeight );
+      if ( tilesMissing )
+      {
+        missingArea.unionRect( tileRect );
+      }
+      else
+      {
+        missingArea = tileRect;
+        tilesMissing = true;
+      }
+    }
   }
 
-  return 0;
+  if ( tilesMissing )
+  {
+    mPendingTileRequests.append( missingArea );
+    mPendingTileSets.append( missingTiles );
+    startNextTileRequest();
+  }
+}
+
+void QgsWFSProvider::startNextTileRequest()
+{
+  if ( mBackgroundReader || mPendingTileRequests.isEmpty() )
+  {
+    return;
+  }
+
+  QgsRectangle bbox = mPendingTileRequests.takeFirst();
+  mBackgroundTiles = mPendingTileSets.takeFirst();
+  mBackgroundReader = new QgsWFSData( tileRequestUri( bbox ), 0, mFeatures, mIdMap, mGeometryAttribute, mThematicAttributes, &mWKBType );
+  connect( mBackgroundReader, SIGNAL( featureParsed( int ) ), this, SLOT( handleFeatureParsed( int ) ) );
+  connect( mBackgroundReader, SIGNAL( dataReadFinished() ), this, SLOT( backgroundReadFinished() ) );
+  connect( mBackgroundReader, SIGNAL( dataProgressAndSteps( int , int ) ), this, SLOT( handleWFSProgressMessage( int, int ) ) );
+  mBackgroundReader->startWFSData();
+}
+
+void QgsWFSProvider::backgroundReadFinished()
+{
+  if ( mBackgroundReader )
+  {
+    QString error = mBackgroundReader->errorMessage();
+    if ( !error.isEmpty() )
+    {
+      pushError( error );
+      //forget the tiles of the failed request such that the next select() for this area requests them again
+      mRequestedTiles.subtract( mBackgroundTiles );
+    }
+    mBackgroundTiles.clear();
+    mBackgroundReader->deleteLater();
+    mBackgroundReader = 0;
+  }
+
+  clearMinMaxCache();
+  mLastRefresh.restart();
+  emit dataChanged();
+  startNextTileRequest();
+}
+
+QString QgsWFSProvider::tileRequestUri( const QgsRectangle& bbox ) const
+{
+  QStringList urlSplit = dataSourceUri().split( "?" );
+  QStringList parameters;
+  if ( urlSplit.size() > 1 )
+  {
+    QStringList keyValueSplit = urlSplit.at( 1 ).split( "&" );
+    QStringList::const_iterator kvIt = keyValueSplit.constBegin();
+    for ( ; kvIt != keyValueSplit.constEnd(); ++kvIt )
+    {
+      if ( kvIt->startsWith( "BBOX=", Qt::CaseInsensitive ) || kvIt->startsWith( "TILED=", Qt::CaseInsensitive ) )
+      {
+        continue;
+      }
+      parameters << *kvIt;
+    }
+  }
+
+  parameters << QString( "BBOX=%1,%2,%3,%4" )
+  .arg( bbox.xMinimum(), 0, 'f' )
+  .arg( bbox.yMinimum(), 0, 'f' )
+  .arg( bbox.xMaximum(), 0, 'f' )
+  .arg( bbox.yMaximum(), 0, 'f' );
+
+  return urlSplit.at( 0 ) + "?" + parameters.join( "&" );
+}
+
+void QgsWFSProvider::abortBackgroundRequests()
+{
+  delete mBackgroundReader;
+  mBackgroundReader = 0;
+  mPendingTileRequests.clear();
+  mPendingTileSets.clear();
+  mBackgroundTiles.clear();
+  mRequestedTiles.clear();
+  mServerIds.clear();
 }
 
 int QgsWFSProvider::describeFeatureTypeGET( const QString& uri, QString& geometryAttribute, QgsFieldMap& fields )
@@ -902,6 +1179,32 @@ int QgsWFSProvider::readAttributesFromSchema( QDomDocument& schemaDoc, QString&
     if (( type.startsWith( "gml:" ) && type.endsWith( "PropertyType" ) ) || name.isEmpty() )
     {
       geometryAttribute = name;
+
+      //the geometry type is needed before the first features arrive in tiled mode
+      if ( type == "gml:PointPropertyType" )
+      {
+        mWKBType = QGis::WKBPoint;
+      }
+      else if ( type == "gml:MultiPointPropertyType" )
+      {
+        mWKBType = QGis::WKBMultiPoint;
+      }
+      else if ( type == "gml:LineStringPropertyType" )
+      {
+        mWKBType = QGis::WKBLineString;
+      }
+      else if ( type == "gml:MultiLineStringPropertyType" )
+      {
+        mWKBType = QGis::WKBMultiLineString;
+      }
+      else if ( type == "gml:PolygonPropertyType" )
+      {
+        mWKBType = QGis::WKBPolygon;
+      }
+      else if ( type == "gml:MultiPolygonPropertyType" )
+      {
+        mWKBType = QGis::WKBMultiPolygon;
+      }
     }
     else //todo: distinguish between numerical and non-numerical types
     {
@@ -988,781 +1291,6 @@ int QgsWFSProvider::guessAttributesFromFile( const QString& uri, QString& geomet
   return 0;
 }
 
-int QgsWFSProvider::getExtentFromGML2( QgsRectangle* extent, const QDomElement& wfsCollectionElement ) const
-{
-  QDomNodeList boundedByList = wfsCollectionElement.elementsByTagNameNS( GML_NAMESPACE, "boundedBy" );
-  if ( boundedByList.length() < 1 )
-  {
-    return 1;
-  }
-  QDomElement boundedByElement = boundedByList.at( 0 ).toElement();
-  QDomNode childNode = boundedByElement.firstChild();
-  if ( childNode.isNull() )
-  {
-    return 2;
-  }
-
-  //support <gml:Box>, <gml:coordinates> and <gml:Envelope>,<gml::lowerCorner>,<gml::upperCorner>. What
-  //about <gml:Envelope>, <gml:pos>?
-  QString bboxName = childNode.localName();
-  if ( bboxName != "Box" )
-  {
-    return 3;
-  }
-
-  QDomNode coordinatesNode = childNode.firstChild();
-  if ( coordinatesNode.localName() == "coordinates" )
-  {
-    std::list<QgsPoint> boundingPoints;
-    if ( readGML2Coordinates( boundingPoints, coordinatesNode.toElement() ) != 0 )
-    {
-      return 5;
-    }
-
-    if ( boundingPoints.size() != 2 )
-    {
-      return 6;
-    }
-
-    std::list<QgsPoint>::const_iterator it = boundingPoints.begin();
-    extent->setXMinimum( it->x() );
-    extent->setYMinimum( it->y() );
-    ++it;
-    extent->setXMaximum( it->x() );
-    extent->setYMaximum( it->y() );
-    return 0;
-  }
-  else if ( coordinatesNode.localName() == "coord" )
-  {
-    //first <coord> element
-    QDomElement xElement, yElement;
-    bool conversion1, conversion2; //string->double conversion success
-    xElement = coordinatesNode.firstChild().toElement();
-    yElement = xElement.nextSibling().toElement();
-    if ( xElement.isNull() || yElement.isNull() )
-    {
-      return 7;
-    }
-    double x1 = xElement.text().toDouble( &conversion1 );
-    double y1 = yElement.text().toDouble( &conversion2 );
-    if ( !conversion1 || !conversion2 )
-    {
-      return 8;
-    }
-
-    //second <coord> element
-    coordinatesNode = coordinatesNode.nextSibling();
-    xElement = coordinatesNode.firstChild().toElement();
-    yElement = xElement.nextSibling().toElement();
-    if ( xElement.isNull() || yElement.isNull() )
-    {
-      return 9;
-    }
-    double x2 = xElement.text().toDouble( &conversion1 );
-    double y2 = yElement.text().toDouble( &conversion2 );
-    if ( !conversion1 || !conversion2 )
-    {
-      return 10;
-    }
-    extent->setXMinimum( x1 );
-    extent->setYMinimum( y1 );
-    extent->setXMaximum( x2 );
-    extent->setYMaximum( y2 );
-    return 0;
-  }
-  else
-  {
-    return 11; //no valid tag for the bounding box
-  }
-}
-
-int QgsWFSProvider::setCRSFromGML2( const QDomElement& wfsCollectionElement )
-{
-  QgsDebugMsg( "entering." );
-  //search <gml:boundedBy>
-  QDomNodeList boundedByList = wfsCollectionElement.elementsByTagNameNS( GML_NAMESPACE, "boundedBy" );
-  if ( boundedByList.size() < 1 )
-  {
-    QgsDebugMsg( "Error, could not find boundedBy element" );
-    return 1;
-  }
-  //search <gml:Envelope>
-  QDomElement boundedByElem = boundedByList.at( 0 ).toElement();
-  QDomNodeList boxList = boundedByElem.elementsByTagNameNS( GML_NAMESPACE, "Box" );
-  if ( boxList.size() < 1 )
-  {
-    QgsDebugMsg( "Error, could not find Envelope element" );
-    return 2;
-  }
-  QDomElement boxElem = boxList.at( 0 ).toElement();
-  //getAttribute 'srsName'
-  QString srsName = boxElem.attribute( "srsName" );
-  if ( srsName.isEmpty() )
-  {
-    QgsDebugMsg( "Error, srsName is empty" );
-    return 3;
-  }
-  QgsDebugMsg( "srsName is: " + srsName );
-
-
-  //extract the EpsgCrsId id
-  bool conversionSuccess;
-  if ( srsName.contains( "#" ) )//geoserver has "http://www.opengis.net/gml/srs/epsg.xml#4326"
-  {
-    int epsgId = srsName.section( "#", 1, 1 ).toInt( &conversionSuccess );
-    if ( !conversionSuccess )
-    {
-      return 4;
-    }
-    srsName = QString( "EPSG:%1" ).arg( epsgId );
-  }
-  else if ( !srsName.contains( ":" ) ) //mapserver has "EPSG:4326"
-    srsName = GEO_EPSG_CRS_AUTHID;
-
-  if ( !mSourceCRS.createFromOgcWmsCrs( srsName ) )
-  {
-    QgsDebugMsg( "Error, creation of QgsCoordinateReferenceSystem failed" );
-    return 6;
-  }
-  return 0;
-}
-
-int QgsWFSProvider::getFeaturesFromGML2( const QDomElement& wfsCollectionElement, const QString& geometryAttribute )
-{
-  QDomNodeList featureTypeNodeList = wfsCollectionElement.elementsByTagNameNS( GML_NAMESPACE, "featureMember" );
-  QDomElement currentFeatureMemberElem;
-  QDomElement layerNameElem;
-  QDomNode currentAttributeChild;
-  QDomElement currentAttributeElement;
-  int counter = 0;
-  QgsFeature* f = 0;
-  unsigned char* wkb = 0;
-  int wkbSize = 0;
-  QGis::WkbType currentType;
-  mFeatureCount = 0;
-
-  for ( int i = 0; i < featureTypeNodeList.size(); ++i )
-  {
-    f = new QgsFeature( counter );
-    currentFeatureMemberElem = featureTypeNodeList.at( i ).toElement();
-    //the first child element is always <namespace:layer>
-    layerNameElem = currentFeatureMemberElem.firstChild().toElement();
-    //the children are the attributes
-    currentAttributeChild = layerNameElem.firstChild();
-    int attr = 0;
-    bool numeric = false;
-
-    while ( !currentAttributeChild.isNull() )
-    {
-      currentAttributeElement = currentAttributeChild.toElement();
-
-      if ( currentAttributeElement.localName() != "boundedBy" )
-      {
-        currentAttributeElement.text().toDouble( &numeric );
-        if (( currentAttributeElement.localName() ) != geometryAttribute ) //a normal attribute
-        {
-          if ( numeric )
-          {
-            f->addAttribute( attr++, QVariant( currentAttributeElement.text().toDouble() ) );
-          }
-          else
-          {
-            f->addAttribute( attr++, QVariant( currentAttributeElement.text() ) );
-          }
-        }
-        else //a geometry attribute
-        {
-          getWkbFromGML2( currentAttributeElement, &wkb, &wkbSize, &currentType );
-          mWKBType = currentType; //a more sophisticated method is necessary
-          f->setGeometryAndOwnership( wkb, wkbSize );
-        }
-      }
-      currentAttributeChild = currentAttributeChild.nextSibling();
-    }
-    if ( wkb && wkbSize > 0 )
-    {
-      //insert bbox and pointer to feature into search tree
-      mSpatialIndex->insertFeature( *f );
-      mFeatures.insert( f->id(), f );
-      ++mFeatureCount;
-    }
-    ++counter;
-  }
-  return 0;
-}
-
-int QgsWFSProvider::getWkbFromGML2( const QDomNode& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const
-{
-  QDomNode geometryChild = geometryElement.firstChild();
-  if ( geometryChild.isNull() )
-  {
-    return 1;
-  }
-  QDomElement geometryTypeElement = geometryChild.toElement();
-  QString geomType = geometryTypeElement.localName();
-  if ( geomType == "Point" )
-  {
-    return getWkbFromGML2Point( geometryTypeElement, wkb, wkbSize, type );
-  }
-  else if ( geomType == "LineString" )
-  {
-    return getWkbFromGML2LineString( geometryTypeElement, wkb, wkbSize, type );
-  }
-  else if ( geomType == "Polygon" )
-  {
-    return getWkbFromGML2Polygon( geometryTypeElement, wkb, wkbSize, type );
-  }
-  else if ( geomType == "MultiPoint" )
-  {
-    return getWkbFromGML2MultiPoint( geometryTypeElement, wkb, wkbSize, type );
-  }
-  else if ( geomType == "MultiLineString" )
-  {
-    return getWkbFromGML2MultiLineString( geometryTypeElement, wkb, wkbSize, type );
-  }
-  else if ( geomType == "MultiPolygon" )
-  {
-    return getWkbFromGML2MultiPolygon( geometryTypeElement, wkb, wkbSize, type );
-  }
-  else //unknown type
-  {
-    *wkb = 0;
-    *wkbSize = 0;
-  }
-  return 0;
-}
-
-int QgsWFSProvider::getWkbFromGML2Point( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const
-{
-  QDomNodeList coordList = geometryElement.elementsByTagNameNS( GML_NAMESPACE, "coordinates" );
-  if ( coordList.size() < 1 )
-  {
-    return 1;
-  }
-  QDomElement coordElement = coordList.at( 0 ).toElement();
-  std::list<QgsPoint> pointCoordinate;
-  if ( readGML2Coordinates( pointCoordinate, coordElement ) != 0 )
-  {
-    return 2;
-  }
-
-  if ( pointCoordinate.size() < 1 )
-  {
-    return 3;
-  }
-
-  std::list<QgsPoint>::const_iterator point_it = pointCoordinate.begin();
-  char e = QgsApplication::endian();
-  double x = point_it->x();
-  double y = point_it->y();
-  int size = 1 + sizeof( int ) + 2 * sizeof( double );
-  *wkb = new unsigned char[size];
-  *wkbSize = size;
-  *type = QGis::WKBPoint;
-  int wkbPosition = 0; //current offset from wkb beginning (in bytes)
-  memcpy( &( *wkb )[wkbPosition], &e, 1 );
-  wkbPosition += 1;
-  memcpy( &( *wkb )[wkbPosition], type, sizeof( int ) );
-  wkbPosition += sizeof( int );
-  memcpy( &( *wkb )[wkbPosition], &x, sizeof( double ) );
-  wkbPosition += sizeof( double );
-  memcpy( &( *wkb )[wkbPosition], &y, sizeof( double ) );
-  return 0;
-}
-
-int QgsWFSProvider::getWkbFromGML2Polygon( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const
-{
-  //read all the coordinates (as QgsPoint) into memory. Each linear ring has an entry in the vector
-  std::vector<std::list<QgsPoint> > ringCoordinates;
-
-  //read coordinates for outer boundary
-  QDomNodeList outerBoundaryList = geometryElement.elementsByTagNameNS( GML_NAMESPACE, "outerBoundaryIs" );
-  if ( outerBoundaryList.size() < 1 ) //outer ring is necessary
-  {
-    return 1;
-  }
-  QDomElement coordinatesElement = outerBoundaryList.at( 0 ).firstChild().firstChild().toElement();
-  if ( coordinatesElement.isNull() )
-  {
-    return 2;
-  }
-  std::list<QgsPoint> exteriorPointList;
-  if ( readGML2Coordinates( exteriorPointList, coordinatesElement ) != 0 )
-  {
-    return 3;
-  }
-  ringCoordinates.push_back( exteriorPointList );
-
-  //read coordinates for inner boundary
-  QDomNodeList innerBoundaryList = geometryElement.elementsByTagNameNS( GML_NAMESPACE, "innerBoundaryIs" );
-  for ( int i = 0; i < innerBoundaryList.size(); ++i )
-  {
-    std::list<QgsPoint> interiorPointList;
-    QDomElement coordinatesElement = innerBoundaryList.at( i ).firstChild().firstChild().toElement();
-    if ( coordinatesElement.isNull() )
-    {
-      return 4;
-    }
-    if ( readGML2Coordinates( interiorPointList, coordinatesElement ) != 0 )
-    {
-      return 5;
-    }
-    ringCoordinates.push_back( interiorPointList );
-  }
-
-  //calculate number of bytes to allocate
-  int nrings = ringCoordinates.size();
-  int npoints = 0;//total number of points
-  for ( std::vector<std::list<QgsPoint> >::const_iterator it = ringCoordinates.begin(); it != ringCoordinates.end(); ++it )
-  {
-    npoints += it->size();
-  }
-  int size = 1 + 2 * sizeof( int ) + nrings * sizeof( int ) + 2 * npoints * sizeof( double );
-  *wkb = new unsigned char[size];
-  *wkbSize = size;
-  *type = QGis::WKBPolygon;
-  char e = QgsApplication::endian();
-  int wkbPosition = 0; //current offset from wkb beginning (in bytes)
-  int nPointsInRing = 0;
-  double x, y;
-
-  //fill the contents into *wkb
-  memcpy( &( *wkb )[wkbPosition], &e, 1 );
-  wkbPosition += 1;
-  memcpy( &( *wkb )[wkbPosition], type, sizeof( int ) );
-  wkbPosition += sizeof( int );
-  memcpy( &( *wkb )[wkbPosition], &nrings, sizeof( int ) );
-  wkbPosition += sizeof( int );
-  for ( std::vector<std::list<QgsPoint> >::const_iterator it = ringCoordinates.begin(); it != ringCoordinates.end(); ++it )
-  {
-    nPointsInRing = it->size();
-    memcpy( &( *wkb )[wkbPosition], &nPointsInRing, sizeof( int ) );
-    wkbPosition += sizeof( int );
-    //iterate through the string list converting the strings to x-/y- doubles
-    std::list<QgsPoint>::const_iterator iter;
-    for ( iter = it->begin(); iter != it->end(); ++iter )
-    {
-      x = iter->x();
-      y = iter->y();
-      //qWarning("currentCoordinate: " + QString::number(x) + " // " + QString::number(y));
-      memcpy( &( *wkb )[wkbPosition], &x, sizeof( double ) );
-      wkbPosition += sizeof( double );
-      memcpy( &( *wkb )[wkbPosition], &y, sizeof( double ) );
-      wkbPosition += sizeof( double );
-    }
-  }
-  return 0;
-}
-
-int QgsWFSProvider::getWkbFromGML2LineString( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const
-{
-  QDomNodeList coordinatesList = geometryElement.elementsByTagNameNS( GML_NAMESPACE, "coordinates" );
-  if ( coordinatesList.size() < 1 )
-  {
-    return 1;
-  }
-  QDomElement coordinatesElement = coordinatesList.at( 0 ).toElement();
-  std::list<QgsPoint> lineCoordinates;
-  if ( readGML2Coordinates( lineCoordinates, coordinatesElement ) != 0 )
-  {
-    return 2;
-  }
-
-  char e = QgsApplication::endian();
-  int size = 1 + 2 * sizeof( int ) + lineCoordinates.size() * 2 * sizeof( double );
-  *wkb = new unsigned char[size];
-  *wkbSize = size;
-  *type = QGis::WKBLineString;
-  int wkbPosition = 0; //current offset from wkb beginning (in bytes)
-  double x, y;
-  int nPoints = lineCoordinates.size();
-
-  //fill the contents into *wkb
-  memcpy( &( *wkb )[wkbPosition], &e, 1 );
-  wkbPosition += 1;
-  memcpy( &( *wkb )[wkbPosition], type, sizeof( int ) );
-  wkbPosition += sizeof( int );
-  memcpy( &( *wkb )[wkbPosition], &nPoints, sizeof( int ) );
-  wkbPosition += sizeof( int );
-
-  std::list<QgsPoint>::const_iterator iter;
-  for ( iter = lineCoordinates.begin(); iter != lineCoordinates.end(); ++iter )
-  {
-    x = iter->x();
-    y = iter->y();
-    memcpy( &( *wkb )[wkbPosition], &x, sizeof( double ) );
-    wkbPosition += sizeof( double );
-    memcpy( &( *wkb )[wkbPosition], &y, sizeof( double ) );
-    wkbPosition += sizeof( double );
-  }
-  return 0;
-}
-
-int QgsWFSProvider::getWkbFromGML2MultiPoint( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const
-{
-  std::list<QgsPoint> pointList;
-  std::list<QgsPoint> currentPoint;
-  QDomNodeList pointMemberList = geometryElement.elementsByTagNameNS( GML_NAMESPACE, "pointMember" );
-  if ( pointMemberList.size() < 1 )
-  {
-    return 1;
-  }
-  QDomNodeList pointNodeList;
-  QDomNodeList coordinatesList;
-  for ( int i = 0; i < pointMemberList.size(); ++i )
-  {
-    //<Point> element
-    pointNodeList = pointMemberList.at( i ).toElement().elementsByTagNameNS( GML_NAMESPACE, "Point" );
-    if ( pointNodeList.size() < 1 )
-    {
-      continue;
-    }
-    //<coordinates> element
-    coordinatesList = pointNodeList.at( 0 ).toElement().elementsByTagNameNS( GML_NAMESPACE, "coordinates" );
-    if ( coordinatesList.size() < 1 )
-    {
-      continue;
-    }
-    currentPoint.clear();
-    if ( readGML2Coordinates( currentPoint, coordinatesList.at( 0 ).toElement() ) != 0 )
-    {
-      continue;
-    }
-    if ( currentPoint.size() < 1 )
-    {
-      continue;
-    }
-    pointList.push_back(( *currentPoint.begin() ) );
-  }
-
-  //calculate the required wkb size
-  int size = 1 + 2 * sizeof( int ) + pointList.size() * ( 2 * sizeof( double ) + 1 + sizeof( int ) );
-  *wkb = new unsigned char[size];
-  *wkbSize = size;
-  *type = QGis::WKBMultiPoint;
-
-  //fill the wkb content
-  char e = QgsApplication::endian();
-  int wkbPosition = 0; //current offset from wkb beginning (in bytes)
-  int nPoints = pointList.size(); //number of points
-  double x, y;
-  memcpy( &( *wkb )[wkbPosition], &e, 1 );
-  wkbPosition += 1;
-  memcpy( &( *wkb )[wkbPosition], type, sizeof( int ) );
-  wkbPosition += sizeof( int );
-  memcpy( &( *wkb )[wkbPosition], &nPoints, sizeof( int ) );
-  wkbPosition += sizeof( int );
-  for ( std::list<QgsPoint>::const_iterator it = pointList.begin(); it != pointList.end(); ++it )
-  {
-    memcpy( &( *wkb )[wkbPosition], &e, 1 );
-    wkbPosition += 1;
-    memcpy( &( *wkb )[wkbPosition], type, sizeof( int ) );
-    wkbPosition += sizeof( int );
-    x = it->x();
-    memcpy( &( *wkb )[wkbPosition], &x, sizeof( double ) );
-    wkbPosition += sizeof( double );
-    y = it->y();
-    memcpy( &( *wkb )[wkbPosition], &y, sizeof( double ) );
-    wkbPosition += sizeof( double );
-  }
-  return 0;
-}
-
-int QgsWFSProvider::getWkbFromGML2MultiLineString( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const
-{
-  //geoserver has
-  //<gml:MultiLineString>
-  //<gml:lineStringMember>
-  //<gml:LineString>
-
-  //mapserver has directly
-  //<gml:MultiLineString
-  //<gml:LineString
-
-  std::list<std::list<QgsPoint> > lineCoordinates; //first list: lines, second list: points of one line
-  QDomElement currentLineStringElement;
-  QDomNodeList currentCoordList;
-
-  QDomNodeList lineStringMemberList = geometryElement.elementsByTagNameNS( GML_NAMESPACE, "lineStringMember" );
-  if ( lineStringMemberList.size() > 0 ) //geoserver
-  {
-    for ( int i = 0; i < lineStringMemberList.size(); ++i )
-    {
-      QDomNodeList lineStringNodeList = geometryElement.elementsByTagNameNS( GML_NAMESPACE, "LineString" );
-      if ( lineStringNodeList.size() < 1 )
-      {
-        return 1;
-      }
-      currentLineStringElement = lineStringNodeList.at( 0 ).toElement();
-      currentCoordList = currentLineStringElement.elementsByTagNameNS( GML_NAMESPACE, "coordinates" );
-      if ( currentCoordList.size() < 1 )
-      {
-        return 2;
-      }
-      std::list<QgsPoint> currentPointList;
-      if ( readGML2Coordinates( currentPointList, currentCoordList.at( 0 ).toElement() ) != 0 )
-      {
-        return 3;
-      }
-      lineCoordinates.push_back( currentPointList );
-    }
-  }
-  else
-  {
-    QDomNodeList lineStringList = geometryElement.elementsByTagNameNS( GML_NAMESPACE, "LineString" );
-    if ( lineStringList.size() > 0 ) //mapserver
-    {
-      for ( int i = 0; i < lineStringList.size(); ++i )
-      {
-        currentLineStringElement = lineStringList.at( i ).toElement();
-        currentCoordList = currentLineStringElement.elementsByTagNameNS( GML_NAMESPACE, "coordinates" );
-        if ( currentCoordList.size() < 1 )
-        {
-          return 4;
-        }
-        std::list<QgsPoint> currentPointList;
-        if ( readGML2Coordinates( currentPointList, currentCoordList.at( 0 ).toElement() ) != 0 )
-        {
-          return 5;
-        }
-        lineCoordinates.push_back( currentPointList );
-      }
-    }
-    else
-    {
-      return 6;
-    }
-  }
-
-
-  //calculate the required wkb size
-  int size = ( lineCoordinates.size() + 1 ) * ( 1 + 2 * sizeof( int ) );
-  for ( std::list<std::list<QgsPoint> >::const_iterator it = lineCoordinates.begin(); it != lineCoordinates.end(); ++it )
-  {
-    size += it->size() * 2 * sizeof( double );
-  }
-  *wkb = new unsigned char[size];
-  *wkbSize = size;
-  *type = QGis::WKBMultiLineString;
-
-  //fill the wkb content
-  char e = QgsApplication::endian();
-  int wkbPosition = 0; //current offset from wkb beginning (in bytes)
-  int nLines = lineCoordinates.size();
-  int nPoints; //number of points in a line
-  double x, y;
-  memcpy( &( *wkb )[wkbPosition], &e, 1 );
-  wkbPosition += 1;
-  memcpy( &( *wkb )[wkbPosition], type, sizeof( int ) );
-  wkbPosition += sizeof( int );
-  memcpy( &( *wkb )[wkbPosition], &nLines, sizeof( int ) );
-  wkbPosition += sizeof( int );
-  for ( std::list<std::list<QgsPoint> >::const_iterator it = lineCoordinates.begin(); it != lineCoordinates.end(); ++it )
-  {
-    memcpy( &( *wkb )[wkbPosition], &e, 1 );
-    wkbPosition += 1;
-    memcpy( &( *wkb )[wkbPosition], type, sizeof( int ) );
-    wkbPosition += sizeof( int );
-    nPoints = it->size();
-    memcpy( &( *wkb )[wkbPosition], &nPoints, sizeof( int ) );
-    wkbPosition += sizeof( int );
-    for ( std::list<QgsPoint>::const_iterator iter = it->begin(); iter != it->end(); ++iter )
-    {
-      x = iter->x();
-      //qWarning("x is: " + QString::number(x));
-      y = iter->y();
-      //qWarning("y is: " + QString::number(y));
-      memcpy( &( *wkb )[wkbPosition], &x, sizeof( double ) );
-      wkbPosition += sizeof( double );
-      memcpy( &( *wkb )[wkbPosition], &y, sizeof( double ) );
-      wkbPosition += sizeof( double );
-    }
-  }
-  return 0;
-}
-
-int QgsWFSProvider::getWkbFromGML2MultiPolygon( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const
-{
-  //first list: different polygons, second list: different rings, third list: different points
-  std::list<std::list<std::list<QgsPoint> > > multiPolygonPoints;
-  QDomElement currentPolygonMemberElement;
-  QDomNodeList polygonList;
-  QDomElement currentPolygonElement;
-  QDomNodeList outerBoundaryList;
-  QDomElement currentOuterBoundaryElement;
-  QDomElement currentInnerBoundaryElement;
-  QDomNodeList innerBoundaryList;
-  QDomNodeList linearRingNodeList;
-  QDomElement currentLinearRingElement;
-  QDomNodeList currentCoordinateList;
-
-  QDomNodeList polygonMemberList = geometryElement.elementsByTagNameNS( GML_NAMESPACE, "polygonMember" );
-  for ( int i = 0; i < polygonMemberList.size(); ++i )
-  {
-    std::list<std::list<QgsPoint> > currentPolygonList;
-    currentPolygonMemberElement = polygonMemberList.at( i ).toElement();
-    polygonList = currentPolygonMemberElement.elementsByTagNameNS( GML_NAMESPACE, "Polygon" );
-    if ( polygonList.size() < 1 )
-    {
-      continue;
-    }
-    currentPolygonElement = polygonList.at( 0 ).toElement();
-
-    //find exterior ring
-    outerBoundaryList = currentPolygonElement.elementsByTagNameNS( GML_NAMESPACE, "outerBoundaryIs" );
-    if ( outerBoundaryList.size() < 1 )
-    {
-      continue;
-    }
-
-    currentOuterBoundaryElement = outerBoundaryList.at( 0 ).toElement();
-    std::list<QgsPoint> ringCoordinates;
-
-    linearRingNodeList = currentOuterBoundaryElement.elementsByTagNameNS( GML_NAMESPACE, "LinearRing" );
-    if ( linearRingNodeList.size() < 1 )
-    {
-      continue;
-    }
-    currentLinearRingElement = linearRingNodeList.at( 0 ).toElement();
-    currentCoordinateList = currentLinearRingElement.elementsByTagNameNS( GML_NAMESPACE, "coordinates" );
-    if ( currentCoordinateList.size() < 1 )
-    {
-      continue;
-    }
-    if ( readGML2Coordinates( ringCoordinates, currentCoordinateList.at( 0 ).toElement() ) != 0 )
-    {
-      continue;
-    }
-    currentPolygonList.push_back( ringCoordinates );
-
-    //find interior rings
-    QDomNodeList innerBoundaryList = currentPolygonElement.elementsByTagNameNS( GML_NAMESPACE, "innerBoundaryIs" );
-    for ( int j = 0; j < innerBoundaryList.size(); ++j )
-    {
-      std::list<QgsPoint> ringCoordinates;
-      currentInnerBoundaryElement = innerBoundaryList.at( j ).toElement();
-      linearRingNodeList = currentInnerBoundaryElement.elementsByTagNameNS( GML_NAMESPACE, "LinearRing" );
-      if ( linearRingNodeList.size() < 1 )
-      {
-        continue;
-      }
-      currentLinearRingElement = linearRingNodeList.at( 0 ).toElement();
-      currentCoordinateList = currentLinearRingElement.elementsByTagNameNS( GML_NAMESPACE, "coordinates" );
-      if ( currentCoordinateList.size() < 1 )
-      {
-        continue;
-      }
-      if ( readGML2Coordinates( ringCoordinates, currentCoordinateList.at( 0 ).toElement() ) != 0 )
-      {
-        continue;
-      }
-      currentPolygonList.push_back( ringCoordinates );
-    }
-    multiPolygonPoints.push_back( currentPolygonList );
-  }
-
-  int size = 1 + 2 * sizeof( int );
-  //calculate the wkb size
-  for ( std::list<std::list<std::list<QgsPoint> > >::const_iterator it = multiPolygonPoints.begin(); it != multiPolygonPoints.end(); ++it )
-  {
-    size += 1 + 2 * sizeof( int );
-    for ( std::list<std::list<QgsPoint> >::const_iterator iter = it->begin(); iter != it->end(); ++iter )
-    {
-      size += sizeof( int ) + 2 * iter->size() * sizeof( double );
-    }
-  }
-  *wkb = new unsigned char[size];
-  *wkbSize = size;
-  *type = QGis::WKBMultiPolygon;
-  int polygonType = QGis::WKBPolygon;
-  char e = QgsApplication::endian();
-  int wkbPosition = 0; //current offset from wkb beginning (in bytes)
-  double x, y;
-  int nPolygons = multiPolygonPoints.size();
-  int nRings;
-  int nPointsInRing;
-
-  //fill the contents into *wkb
-  memcpy( &( *wkb )[wkbPosition], &e, 1 );
-  wkbPosition += 1;
-  memcpy( &( *wkb )[wkbPosition], type, sizeof( int ) );
-  wkbPosition += sizeof( int );
-  memcpy( &( *wkb )[wkbPosition], &nPolygons, sizeof( int ) );
-  wkbPosition += sizeof( int );
-
-  for ( std::list<std::list<std::list<QgsPoint> > >::const_iterator it = multiPolygonPoints.begin(); it != multiPolygonPoints.end(); ++it )
-  {
-    memcpy( &( *wkb )[wkbPosition], &e, 1 );
-    wkbPosition += 1;
-    memcpy( &( *wkb )[wkbPosition], &polygonType, sizeof( int ) );
-    wkbPosition += sizeof( int );
-    nRings = it->size();
-    memcpy( &( *wkb )[wkbPosition], &nRings, sizeof( int ) );
-    wkbPosition += sizeof( int );
-    for ( std::list<std::list<QgsPoint> >::const_iterator iter = it->begin(); iter != it->end(); ++iter )
-    {
-      nPointsInRing = iter->size();
-      memcpy( &( *wkb )[wkbPosition], &nPointsInRing, sizeof( int ) );
-      wkbPosition += sizeof( int );
-      for ( std::list<QgsPoint>::const_iterator iterator = iter->begin(); iterator != iter->end(); ++iterator )
-      {
-        x = iterator->x();
-        y = iterator->y();
-        memcpy( &( *wkb )[wkbPosition], &x, sizeof( double ) );
-        wkbPosition += sizeof( double );
-        memcpy( &( *wkb )[wkbPosition], &y, sizeof( double ) );
-        wkbPosition += sizeof( double );
-      }
-    }
-  }
-  return 0;
-}
-
-int QgsWFSProvider::readGML2Coordinates( std::list<QgsPoint>& coords, const QDomElement elem ) const
-{
-  QString coordSeparator = ",";
-  QString tupelSeparator = " ";
-  //"decimal" has to be "."
-
-  coords.clear();
-
-  if ( elem.hasAttribute( "cs" ) )
-  {
-    coordSeparator = elem.attribute( "cs" );
-  }
-  if ( elem.hasAttribute( "ts" ) )
-  {
-    tupelSeparator = elem.attribute( "ts" );
-  }
-
-  QStringList tupels = elem.text().split( tupelSeparator, QString::SkipEmptyParts );
-  QStringList tupel_coords;
-  double x, y;
-  bool conversionSuccess;
-
-  QStringList::const_iterator it;
-  for ( it = tupels.constBegin(); it != tupels.constEnd(); ++it )
-  {
-    tupel_coords = ( *it ).split( coordSeparator, QString::SkipEmptyParts );
-    if ( tupel_coords.size() < 2 )
-    {
-      continue;
-    }
-    x = tupel_coords.at( 0 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
-    {
-      return 1;
-    }
-    y = tupel_coords.at( 1 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
-    {
-      return 1;
-    }
-    coords.push_back( QgsPoint( x, y ) );
-  }
-  return 0;
-}
-
 void QgsWFSProvider::handleWFSProgressMessage( int done, int total )
 {
   QString totalString;
@@ -2231,6 +1759,33 @@ void QgsWFSProvider::getLayerCapabilities()
     if ( name == thisLayerName )
     {
       appendSupportedOperations( featureTypeList.at( i ).firstChildElement( "Operations" ), capabilities );
+
+      //the layer extent in WGS 84
+      QDomElement latLongElem = featureTypeList.at( i ).firstChildElement( "LatLongBoundingBox" );
+      if ( !latLongElem.isNull() )
+      {
+        QgsRectangle latLongExtent( latLongElem.attribute( "minx" ).toDouble(), latLongElem.attribute( "miny" ).toDouble(),
+                                    latLongElem.attribute( "maxx" ).toDouble(), latLongElem.attribute( "maxy" ).toDouble() );
+        setCRSFromUrl();
+        if ( mSourceCRS.isValid() && mSourceCRS.epsg() != 4326 )
+        {
+          QgsCoordinateReferenceSystem wgs84( GEO_EPSG_CRS_ID, QgsCoordinateReferenceSystem::EpsgCrsId );
+          QgsCoordinateTransform ct( wgs84, mSourceCRS );
+          try
+          {
+            mCapabilitiesExtent = ct.transformBoundingBox( latLongExtent );
+          }
+          catch ( QgsCsException &cse )
+          {
+            Q_UNUSED( cse );
+            QgsDebugMsg( "could not transform the layer extent from the capabilities" );
+          }
+        }
+        else
+        {
+          mCapabilitiesExtent = latLongExtent;
+        }
+      }
       break;
     }
   }
@@ -19,6 +19,9 @@
 #define QGSWFSPROVIDER_H
 
 #include <QDomElement>
+#include <QPair>
+#include <QSet>
+#include <QTime>
 #include "qgis.h"
 #include "qgsrectangle.h"
 #include "qgscoordinatereferencesystem.h"
@@ -26,8 +29,12 @@
 
 class QgsRectangle;
 class QgsSpatialIndex;
+class QgsWFSData;
 
-/**A provider reading features from a WFS server*/
+/**A provider reading features from a WFS server. If the layer extent is known from the uri or the capabilities,
+  the features are downloaded in the background and the layer is redrawn while they arrive. If the uri contains
+  TILED=1, features are not downloaded for the whole layer at once. Instead, the layer extent is divided into a
+  grid of tiles and the tiles covering the requested area are fetched in the background when they are first needed*/
 class QgsWFSProvider: public QgsVectorDataProvider
 {
     Q_OBJECT
@@ -151,6 +158,13 @@ class QgsWFSProvider: public QgsVectorDataProvider
     /**Sets mNetworkRequestFinished flag to true*/
     void networkRequestFinished();
 
+    /**Inserts a feature received from the server into the spatial index (or drops it
+      if it has already been received with a neighbouring tile)*/
+    void handleFeatureParsed( int featureId );
+
+    /**Cleans up after a background request and starts the next pending tile request*/
+    void backgroundReadFinished();
+
   private:
     bool mNetworkRequestFinished;
 
@@ -188,6 +202,26 @@ class QgsWFSProvider: public QgsVectorDataProvider
     QString mWfsNamespace;
     /**Server capabilities for this layer (generated from capabilities document)*/
     int mCapabilities;
+    /**Index of attribute name -> (attribute index, field), used by the GML parser*/
+    QMap<QString, QPair<int, QgsField> > mThematicAttributes;
+    /**True if features are requested per tile of the visible area instead of for the whole layer*/
+    bool mTiledRequests;
+    /**Layer extent advertised in the capabilities document (transformed to the layer CRS)*/
+    QgsRectangle mCapabilitiesExtent;
+    /**Column / row of the tiles which have already been requested*/
+    QSet< QPair<int, int> > mRequestedTiles;
+    /**Areas waiting to be requested. Requests run one after the other such that feature ids stay unique*/
+    QList<QgsRectangle> mPendingTileRequests;
+    /**Tiles covered by each entry of mPendingTileRequests*/
+    QList< QSet< QPair<int, int> > > mPendingTileSets;
+    /**Tiles covered by the currently running background request. They are requested again if it fails*/
+    QSet< QPair<int, int> > mBackgroundTiles;
+    /**Reader of the currently running background request (or 0)*/
+    QgsWFSData* mBackgroundReader;
+    /**Server ids (or hashes of geometry and attributes for features without id) of the features already received in tiled mode*/
+    QSet<QString> mServerIds;
+    /**Time since dataChanged() has been emitted the last time during a background request*/
+    QTime mLastRefresh;
 
 
     /**Collects information about the field types. Is called internally from QgsWFSProvider::getFeature. The method delegates the work to request specific ones and gives back the name of the geometry attribute and the thematic attributes with their types*/
@@ -195,6 +229,15 @@ class QgsWFSProvider: public QgsVectorDataProvider
 
     //encoding specific methods of getFeature
     int getFeatureGET( const QString& uri, const QString& geometryAttribute );
+    /**Starts downloading all the features in the background. Returns 0 in case of success, 1 if
+      the layer extent is not known before the download (the features are then read with getFeatureGET)*/
+    int getFeatureStreamed( const QString& uri );
+    /**Prepares tiled requests instead of downloading all the features. Returns 0 in case of success*/
+    int getFeatureTiled();
+    /**Returns the extent from the BBOX parameter of the uri or from the capabilities (may be empty)*/
+    QgsRectangle initialExtent() const;
+    /**Shows the progress messages in the status bar of the main window (if it exists)*/
+    void connectProgressToMainWindow();
     int getFeaturePOST( const QString& uri, const QString& geometryAttribute );
     int getFeatureSOAP( const QString& uri, const QString& geometryAttribute );
     int getFeatureFILE( const QString& uri, const QString& geometryAttribute );
@@ -212,31 +255,22 @@ class QgsWFSProvider: public QgsVectorDataProvider
     /**Copies feature attributes / geometry from f to feature*/
     void copyFeature( QgsFeature* f, QgsFeature& feature, bool fetchGeometry, QgsAttributeList fetchAttributes );
 
-    //GML2 specific methods
-    int getExtentFromGML2( QgsRectangle* extent, const QDomElement& wfsCollectionElement ) const;
-
-    int getFeaturesFromGML2( const QDomElement& wfsCollectionElement, const QString& geometryAttribute );
-
-    int getWkbFromGML2( const QDomNode& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const;
-    /**Creates WKB from a <Point> element*/
-    int getWkbFromGML2Point( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const;
-    /**Creates WKB from a <Polygon> element*/
-    int getWkbFromGML2Polygon( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const;
-    /**Creates WKB from a <LineString> element*/
-    int getWkbFromGML2LineString( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const;
-    /**Creates WKB from a <MultiPoint> element*/
-    int getWkbFromGML2MultiPoint( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const;
-    /**Creates WKB from a <MultiLineString> element*/
-    int getWkbFromGML2MultiLineString( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const;
-    /**Creates WKB from a <MultiPolygon> element*/
-    int getWkbFromGML2MultiPolygon( const QDomElement& geometryElement, unsigned char** wkb, int* wkbSize, QGis::WkbType* type ) const;
-    /**Reads the <gml:coordinates> element and extracts the coordinates as points
-       @param coords list where the found coordinates are appended
-       @param elem the <gml:coordinates> element
-       @return 0 in case of success*/
-    int readGML2Coordinates( std::list<QgsPoint>& coords, const QDomElement elem ) const;
-    /**Tries to create a QgsCoordinateReferenceSystem object and assign it to mSourceCRS. Returns 0 in case of success*/
-    int setCRSFromGML2( const QDomElement& wfsCollectionElement );
+    /**Creates mSourceCRS from the SRSNAME parameter of the uri (if present)*/
+    void setCRSFromUrl();
+    /**Fills mThematicAttributes from mFields*/
+    void updateThematicAttributes();
+
+    //tiled requests
+    /**Queues requests for the tiles intersecting rect which have not been fetched yet*/
+    void requestTiles( const QgsRectangle& rect );
+    /**Starts the next pending tile request if no other request is running*/
+    void startNextTileRequest();
+    /**Returns the GetFeature url for the area bbox (BBOX and TILED parameters of the layer uri replaced)*/
+    QString tileRequestUri( const QgsRectangle& bbox ) const;
+    /**Aborts a running background request and forgets the requested tiles*/
+    void abortBackgroundRequests();
+    /**Digest of geometry and attributes, identifies features without fid received with several tiles*/
+    QString featureHash( QgsFeature* f ) const;
 
 
     //methods to write GML2
@@ -0,0 +1,142 @@
+/***************************************************************************
+     testqgstininterpolator.cpp
+     --------------------------------------
+    Date                 : October 2010
+    Copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgsfeature.h>
+#include <qgsfield.h>
+#include <qgsgeometry.h>
+#include <qgsproviderregistry.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectorlayer.h>
+//header for class being tested
+#include <qgstininterpolator.h>
+
+/** \ingroup UnitTests
+ * This is a unit test for the linear TIN interpolation. The points of the
+ * input layers lie on a plane, so every interpolated value is exact.
+ */
+class TestQgsTINInterpolator: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init() {};// will be called before each testfunction is executed.
+    void cleanup() {};// will be called after every testfunction.
+    void linearPlane();
+    void benchmarkLinear();
+
+  private:
+    /** value of the test surface (a plane) */
+    static double planeValue( double x, double y ) { return 2 * x - 3 * y + 100; }
+    /** memory layer with a jittered grid of side x side points, 100 map units
+     * apart, and the plane value as attribute 0 */
+    static QgsVectorLayer* createGridLayer( int side );
+    static QgsInterpolator::LayerData layerData( QgsVectorLayer* layer );
+};
+
+void TestQgsTINInterpolator::initTestCase()
+{
+  QgsApplication::setPrefixPath( INSTALL_PREFIX, true );
+  QgsApplication::showSettings();
+  // Instantiate the plugin directory so that providers are loaded
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+}
+
+void TestQgsTINInterpolator::cleanupTestCase()
+{
+}
+
+QgsVectorLayer* TestQgsTINInterpolator::createGridLayer( int side )
+{
+  QgsVectorLayer* layer = new QgsVectorLayer( "Point", "grid", "memory" );
+  if ( !layer->isValid() )
+  {
+    delete layer;
+    return 0;
+  }
+  layer->dataProvider()->addAttributes( QList<QgsField>() << QgsField( "value", QVariant::Double ) );
+
+  QgsFeatureList features;
+  for ( int row = 0; row < side; ++row )
+  {
+    for ( int col = 0; col < side; ++col )
+    {
+      //move the points off the grid a little, so no four of them are cocircular
+      double x = col * 100 + ( col * 7 + row * 13 ) % 17;
+      double y = row * 100 + ( col * 11 + row * 5 ) % 19;
+      QgsFeature f;
+      f.setGeometry( QgsGeometry::fromPoint( QgsPoint( x, y ) ) );
+      f.addAttribute( 0, planeValue( x, y ) );
+      features << f;
+    }
+  }
+  layer->dataProvider()->addFeatures( features );
+  return layer;
+}
+
+QgsInterpolator::LayerData TestQgsTINInterpolator::layerData( QgsVectorLayer* layer )
+{
+  QgsInterpolator::LayerData data;
+  data.vectorLayer = layer;
+  data.zCoordInterpolation = false;
+  data.interpolationAttribute = 0;
+  data.mInputType = QgsInterpolator::POINTS;
+  return data;
+}
+
+void TestQgsTINInterpolator::linearPlane()
+{
+  QgsVectorLayer* layer = createGridLayer( 100 );
+  QVERIFY( layer );
+
+  QgsTINInterpolator interpolator( QList<QgsInterpolator::LayerData>() << layerData( layer ) );
+  //query points well inside the convex hull
+  for ( double x = 1000.5; x < 9000; x += 250 )
+  {
+    for ( double y = 1000.5; y < 9000; y += 250 )
+    {
+      double result;
+      QCOMPARE( interpolator.interpolatePoint( x, y, result ), 0 );
+      QVERIFY( qAbs( result - planeValue( x, y ) ) < 1e-6 );
+    }
+  }
+  delete layer;
+}
+
+void TestQgsTINInterpolator::benchmarkLinear()
+{
+  if ( qgetenv( "QGIS_LARGE_BENCHMARKS" ).isEmpty() )
+  {
+    QSKIP( "triangulating 1M points takes long, set QGIS_LARGE_BENCHMARKS to run it", SkipSingle );
+  }
+
+  QgsVectorLayer* layer = createGridLayer( 1000 );
+  QVERIFY( layer );
+
+  QBENCHMARK_ONCE
+  {
+    QgsTINInterpolator interpolator( QList<QgsInterpolator::LayerData>() << layerData( layer ) );
+    //the triangulation is built with the first query
+    double result;
+    interpolator.interpolatePoint( 50000, 50000, result );
+  }
+  delete layer;
+}
+
+QTEST_MAIN( TestQgsTINInterpolator )
+#include "moc_testqgstininterpolator.cxx"
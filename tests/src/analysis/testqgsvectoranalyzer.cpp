@@ -16,8 +16,10 @@ Email                : sherman at mrcc dot com
 
 //header for class being tested
 #include <qgsgeometryanalyzer.h>
+#include <qgsvectorfilewriter.h>
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
+#include <qgsvectordataprovider.h>
 
 class TestQgsVectorAnalyzer: public QObject
 {
@@ -36,7 +38,12 @@ class TestQgsVectorAnalyzer: public QObject
     void simplifyGeometry(  );
     void polygonCentroids(  );
     void layerExtent(  );
+    void dissolveGroups(  );
+    void bufferOrder(  );
   private:
+    /** memory layer with a grid of 20 x 20 unit squares, attribute 0 is
+     * the row (the dissolve group) and attribute 1 the feature number */
+    QgsVectorLayer * createSquaresLayer(  );
     QgsGeometryAnalyzer mAnalyzer;
     QgsVectorLayer * mpLineLayer;
     QgsVectorLayer * mpPolyLayer;
@@ -133,6 +140,74 @@ void TestQgsVectorAnalyzer::layerExtent(  )
   QVERIFY( mAnalyzer.extent( mpPointLayer, myFileName ) );
 }
 
+QgsVectorLayer * TestQgsVectorAnalyzer::createSquaresLayer(  )
+{
+  QgsVectorLayer * myLayer = new QgsVectorLayer( "Polygon", "squares", "memory" );
+  myLayer->dataProvider()->addAttributes( QList<QgsField>()
+                                          << QgsField( "row", QVariant::Int )
+                                          << QgsField( "number", QVariant::Int ) );
+  QgsFeatureList myFeatures;
+  for ( int i = 0; i < 400; ++i )
+  {
+    int myRow = i / 20;
+    int myCol = i % 20;
+    QgsFeature myFeature;
+    myFeature.setGeometry( QgsGeometry::fromRect( QgsRectangle( myCol, myRow, myCol + 1, myRow + 1 ) ) );
+    myFeature.addAttribute( 0, myRow );
+    myFeature.addAttribute( 1, i );
+    myFeatures << myFeature;
+  }
+  myLayer->dataProvider()->addFeatures( myFeatures );
+  return myLayer;
+}
+
+void TestQgsVectorAnalyzer::dissolveGroups(  )
+{
+  QgsVectorLayer * mySquares = createSquaresLayer();
+  QString myFileName = QDir::tempPath() + QDir::separator() + "dissolve_layer.shp";
+  QgsVectorFileWriter::deleteShapeFile( myFileName );
+  QVERIFY( mAnalyzer.dissolve( mySquares, myFileName, false, 0 ) );
+  delete mySquares;
+
+  //one 20 x 1 rectangle per row
+  QgsVectorLayer myResult( myFileName, "dissolve", "ogr" );
+  QVERIFY( myResult.isValid() );
+  QCOMPARE(( int ) myResult.featureCount(), 20 );
+  myResult.select( myResult.pendingAllAttributesList() );
+  QgsFeature myFeature;
+  while ( myResult.nextFeature( myFeature ) )
+  {
+    QVERIFY( qAbs( myFeature.geometry()->area() - 20.0 ) < 1e-9 );
+    QgsRectangle myBox = myFeature.geometry()->boundingBox();
+    QCOMPARE( myBox.yMinimum(), myFeature.attributeMap()[0].toDouble() );
+    QCOMPARE( myBox.width(), 20.0 );
+  }
+}
+
+void TestQgsVectorAnalyzer::bufferOrder(  )
+{
+  QgsVectorLayer * mySquares = createSquaresLayer();
+  QString myFileName = QDir::tempPath() + QDir::separator() + "buffer_layer.shp";
+  QgsVectorFileWriter::deleteShapeFile( myFileName );
+  QVERIFY( mAnalyzer.buffer( mySquares, myFileName, 0.25 ) );
+  delete mySquares;
+
+  //the buffers are processed in blocks on a worker thread, but written in input order
+  QgsVectorLayer myResult( myFileName, "buffer", "ogr" );
+  QVERIFY( myResult.isValid() );
+  QCOMPARE(( int ) myResult.featureCount(), 400 );
+  myResult.select( myResult.pendingAllAttributesList() );
+  QgsFeature myFeature;
+  int myNumber = 0;
+  while ( myResult.nextFeature( myFeature ) )
+  {
+    QCOMPARE( myFeature.attributeMap()[1].toInt(), myNumber );
+    QVERIFY( myFeature.geometry()->area() > 1.0 );
+    ++myNumber;
+  }
+  QCOMPARE( myNumber, 400 );
+}
+
 QTEST_MAIN( TestQgsVectorAnalyzer )
 #include "moc_testqgsvectoranalyzer.cxx"
 
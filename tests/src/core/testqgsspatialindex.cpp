@@ -0,0 +1,258 @@
+/***************************************************************************
+     testqgsspatialindex.cpp
+     --------------------------------------
+    Date                 : October 2010
+    Copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QDir>
+#include <QList>
+#include <QSet>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgsfeature.h>
+#include <qgsgeometry.h>
+#include <qgspoint.h>
+#include <qgsproviderregistry.h>
+#include <qgsrectangle.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectorlayer.h>
+//header for class being tested
+#include <qgsspatialindex.h>
+
+/** Compares the two QgsSpatialIndex backends with a brute force search
+ * and measures build and query times of both. The benchmarks use 20000 points,
+ * or 1M points if the environment variable QGIS_LARGE_BENCHMARKS is set */
+class TestQgsSpatialIndex: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init() {};// will be called before each testfunction is executed.
+    void cleanup() {};// will be called after every testfunction.
+    void storageManagerQueries();
+    void pointerTreeQueries();
+    void pointerTreeDelete();
+    void diskIndex();
+    void benchmarkBuild_data();
+    void benchmarkBuild();
+    void benchmarkQueries_data();
+    void benchmarkQueries();
+
+  private:
+    /** pseudo random point of the test data set */
+    static QgsPoint testPoint( int i );
+    static void fillIndex( QgsSpatialIndex& index, int count );
+    void checkQueries( QgsSpatialIndex& index, int count, const QSet<int>& deleted );
+    static void addBackendColumn();
+    static int benchmarkSize();
+};
+
+void TestQgsSpatialIndex::initTestCase()
+{
+  QgsApplication::setPrefixPath( INSTALL_PREFIX, true );
+  QgsApplication::showSettings();
+  // Instantiate the plugin directory so that providers are loaded
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+}
+
+void TestQgsSpatialIndex::cleanupTestCase()
+{
+}
+
+QgsPoint TestQgsSpatialIndex::testPoint( int i )
+{
+  //linear congruential sequence, so the data is the same for every run
+  unsigned int x = ( unsigned int )( i * 2654435761u ) % 100000;
+  unsigned int y = ( unsigned int )( i * 40503u + 12345u ) % 100000;
+  return QgsPoint( x / 10.0, y / 10.0 );
+}
+
+void TestQgsSpatialIndex::fillIndex( QgsSpatialIndex& index, int count )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    QgsFeature f( i );
+    f.setGeometry( QgsGeometry::fromPoint( testPoint( i ) ) );
+    index.insertFeature( f );
+  }
+}
+
+void TestQgsSpatialIndex::checkQueries( QgsSpatialIndex& index, int count, const QSet<int>& deleted )
+{
+  for ( int q = 0; q < 50; ++q )
+  {
+    QgsPoint center = testPoint( count + q );
+    QgsRectangle rect( center.x() - 200, center.y() - 200, center.x() + 200, center.y() + 200 );
+
+    QSet<int> expected;
+    for ( int i = 0; i < count; ++i )
+    {
+      if ( !deleted.contains( i ) && rect.contains( testPoint( i ) ) )
+      {
+        expected.insert( i );
+      }
+    }
+    QList<int> found = index.intersects( rect );
+    QCOMPARE( found.size(), expected.size() );
+    QCOMPARE( found.toSet(), expected );
+
+    //the third neighbor must not be farther away than any other point
+    QList<int> neighbors = index.nearestNeighbor( center, 3 );
+    QVERIFY( neighbors.size() >= 3 );
+    double maxDist = 0;
+    for ( int i = 0; i < neighbors.size(); ++i )
+    {
+      QVERIFY( !deleted.contains( neighbors[i] ) );
+      maxDist = qMax( maxDist, center.sqrDist( testPoint( neighbors[i] ) ) );
+    }
+    for ( int i = 0; i < count; ++i )
+    {
+      if ( !deleted.contains( i ) && !neighbors.contains( i ) )
+      {
+        QVERIFY( center.sqrDist( testPoint( i ) ) >= maxDist );
+      }
+    }
+  }
+}
+
+void TestQgsSpatialIndex::storageManagerQueries()
+{
+  QgsSpatialIndex index;
+  fillIndex( index, 5000 );
+  checkQueries( index, 5000, QSet<int>() );
+}
+
+void TestQgsSpatialIndex::pointerTreeQueries()
+{
+  QgsSpatialIndex index( QgsSpatialIndex::PointerTreeBackend );
+  fillIndex( index, 5000 );
+  checkQueries( index, 5000, QSet<int>() );
+}
+
+void TestQgsSpatialIndex::pointerTreeDelete()
+{
+  QgsSpatialIndex index( QgsSpatialIndex::PointerTreeBackend );
+  fillIndex( index, 5000 );
+
+  QSet<int> deleted;
+  for ( int i = 0; i < 5000; i += 3 )
+  {
+    QgsFeature f( i );
+    f.setGeometry( QgsGeometry::fromPoint( testPoint( i ) ) );
+    QVERIFY( index.deleteFeature( f ) );
+    deleted.insert( i );
+  }
+
+  //deleting twice fails
+  QgsFeature f( 0 );
+  f.setGeometry( QgsGeometry::fromPoint( testPoint( 0 ) ) );
+  QVERIFY( !index.deleteFeature( f ) );
+
+  checkQueries( index, 5000, deleted );
+}
+
+void TestQgsSpatialIndex::diskIndex()
+{
+  QgsVectorLayer layer( "Point", "points", "memory" );
+  QVERIFY( layer.isValid() );
+  QgsFeatureList features;
+  for ( int i = 0; i < 2000; ++i )
+  {
+    QgsFeature f;
+    f.setGeometry( QgsGeometry::fromPoint( testPoint( i ) ) );
+    features << f;
+  }
+  QVERIFY( layer.dataProvider()->addFeatures( features ) );
+
+  QString baseName = QDir::tempPath() + QDir::separator() + "qgis_spatialindextest";
+  QgsSpatialIndex::removeDiskIndex( baseName );
+  layer.dataProvider()->select( QgsAttributeList() );
+  QgsSpatialIndex* created = QgsSpatialIndex::createDiskIndex( baseName, layer.dataProvider() );
+  QVERIFY( created );
+  delete created;
+  QVERIFY( QFile::exists( baseName + ".hdr" ) );
+
+  //the header page is found with the stored identifier
+  QgsSpatialIndex* loaded = QgsSpatialIndex::loadDiskIndex( baseName );
+  QVERIFY( loaded );
+  QgsRectangle rect( 2000, 2000, 6000, 6000 );
+  int expected = 0;
+  layer.dataProvider()->select( QgsAttributeList(), rect, true );
+  QgsFeature f;
+  while ( layer.dataProvider()->nextFeature( f ) )
+  {
+    ++expected;
+  }
+  QCOMPARE( loaded->intersects( rect ).size(), expected );
+  delete loaded;
+
+  QgsSpatialIndex::removeDiskIndex( baseName );
+  QVERIFY( !QgsSpatialIndex::loadDiskIndex( baseName ) );
+}
+
+void TestQgsSpatialIndex::addBackendColumn()
+{
+  QTest::addColumn<int>( "backend" );
+  QTest::newRow( "storage manager" ) << ( int ) QgsSpatialIndex::StorageManagerBackend;
+  QTest::newRow( "pointer tree" ) << ( int ) QgsSpatialIndex::PointerTreeBackend;
+}
+
+int TestQgsSpatialIndex::benchmarkSize()
+{
+  return qgetenv( "QGIS_LARGE_BENCHMARKS" ).isEmpty() ? 20000 : 1000000;
+}
+
+void TestQgsSpatialIndex::benchmarkBuild_data()
+{
+  addBackendColumn();
+}
+
+void TestQgsSpatialIndex::benchmarkBuild()
+{
+  QFETCH( int, backend );
+  int count = benchmarkSize();
+
+  QBENCHMARK
+  {
+    QgsSpatialIndex index(( QgsSpatialIndex::Backend ) backend );
+    fillIndex( index, count );
+  }
+}
+
+void TestQgsSpatialIndex::benchmarkQueries_data()
+{
+  addBackendColumn();
+}
+
+void TestQgsSpatialIndex::benchmarkQueries()
+{
+  QFETCH( int, backend );
+  int count = benchmarkSize();
+  QgsSpatialIndex index(( QgsSpatialIndex::Backend ) backend );
+  fillIndex( index, count );
+
+  //small interactive queries (approx. 10 points each with 1M points) and nearest neighbors
+  QBENCHMARK
+  {
+    for ( int q = 0; q < 1000; ++q )
+    {
+      QgsPoint center = testPoint( count + q );
+      index.intersects( QgsRectangle( center.x() - 5, center.y() - 5, center.x() + 5, center.y() + 5 ) );
+      index.nearestNeighbor( center, 1 );
+    }
+  }
+}
+
+QTEST_MAIN( TestQgsSpatialIndex )
+#include "moc_testqgsspatialindex.cxx"
@@ -0,0 +1,365 @@
+/***************************************************************************
+     testqgsspatialiteprovider.cpp
+     --------------------------------------
+    Date                 : October 2010
+    Copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QList>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgsfeature.h>
+#include <qgsfield.h>
+#include <qgsgeometry.h>
+#include <qgsproviderregistry.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectorfilewriter.h>
+#include <qgsvectorlayer.h>
+
+/** \ingroup UnitTests
+ * This is a unit test for reading layers with the spatialite provider.
+ * The test layers are copies of polys.shp and of generated multipolygons,
+ * written with the OGR SQLite driver. The tests are skipped if that driver
+ * was built without SpatiaLite support.
+ */
+class TestQgsSpatiaLiteProvider: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init();// will be called before each testfunction is executed.
+    void cleanup() {};// will be called after every testfunction.
+    void fullScan();
+    void featureAtId();
+    void attributeRestriction();
+    void rectangleSelect();
+    void multiPolygons();
+    void benchmarkFeatureAtId();
+    void benchmarkFullScan();
+
+  private:
+    /** writes layer to a SpatiaLite database and opens the copy, 0 on failure */
+    static QgsVectorLayer* copyToSpatiaLite( QgsVectorLayer* layer, const QString& table );
+    /** memory layer with count two part multipolygons */
+    static QgsVectorLayer* createMultiPolygonLayer( int count );
+    /** the large layer of the benchmarks, created on first use */
+    QgsVectorDataProvider* benchmarkProvider();
+
+    QgsVectorLayer* mShapeLayer;
+    QgsVectorLayer* mSpatiaLiteLayer;
+    QgsVectorLayer* mBenchmarkLayer;
+};
+
+void TestQgsSpatiaLiteProvider::initTestCase()
+{
+  QgsApplication::setPrefixPath( INSTALL_PREFIX, true );
+  QgsApplication::showSettings();
+  // Instantiate the plugin directory so that providers are loaded
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+
+  QString myDataDir( TEST_DATA_DIR ); //defined in CmakeLists.txt
+  mShapeLayer = new QgsVectorLayer( myDataDir + QDir::separator() + "polys.shp", "polys", "ogr" );
+  mSpatiaLiteLayer = copyToSpatiaLite( mShapeLayer, "polys" );
+  mBenchmarkLayer = 0;
+}
+
+void TestQgsSpatiaLiteProvider::cleanupTestCase()
+{
+  delete mSpatiaLiteLayer;
+  delete mShapeLayer;
+  delete mBenchmarkLayer;
+}
+
+void TestQgsSpatiaLiteProvider::init()
+{
+  if ( !mSpatiaLiteLayer )
+  {
+    QSKIP( "OGR SQLite driver without SpatiaLite support", SkipAll );
+  }
+}
+
+QgsVectorLayer* TestQgsSpatiaLiteProvider::copyToSpatiaLite( QgsVectorLayer* layer, const QString& table )
+{
+  //the OGR SQLite driver names the table after the file
+  QString dbFile = QDir::tempPath() + QDir::separator() + table + ".sqlite";
+  QFile::remove( dbFile );
+
+  QgsVectorFileWriter::WriterError error =
+    QgsVectorFileWriter::writeAsVectorFormat( layer, dbFile, "UTF-8", &layer->srs(), "SQLite", false, 0,
+        QStringList() << "SPATIALITE=YES" );
+  if ( error != QgsVectorFileWriter::NoError )
+  {
+    return 0;
+  }
+
+  QgsVectorLayer* copy = new QgsVectorLayer( QString( "dbname='%1' table='%2'(GEOMETRY) sql=" ).arg( dbFile ).arg( table ), table, "spatialite" );
+  if ( !copy->isValid() )
+  {
+    delete copy;
+    return 0;
+  }
+  return copy;
+}
+
+QgsVectorLayer* TestQgsSpatiaLiteProvider::createMultiPolygonLayer( int count )
+{
+  QgsVectorLayer* layer = new QgsVectorLayer( "MultiPolygon", "multipolys", "memory" );
+  if ( !layer->isValid() )
+  {
+    delete layer;
+    return 0;
+  }
+  layer->dataProvider()->addAttributes( QList<QgsField>() << QgsField( "value", QVariant::Int ) );
+
+  QgsFeatureList features;
+  for ( int i = 0; i < count; ++i )
+  {
+    //two squares, the second with a hole
+    double x = i % 200;
+    double y = i / 200;
+    QgsPolygon outer;
+    outer << ( QgsPolyline() << QgsPoint( x, y ) << QgsPoint( x + 0.4, y ) << QgsPoint( x + 0.4, y + 0.4 ) << QgsPoint( x, y + 0.4 ) << QgsPoint( x, y ) );
+    QgsPolygon holed;
+    holed << ( QgsPolyline() << QgsPoint( x + 0.5, y + 0.5 ) << QgsPoint( x + 0.9, y + 0.5 ) << QgsPoint( x + 0.9, y + 0.9 ) << QgsPoint( x + 0.5, y + 0.9 ) << QgsPoint( x + 0.5, y + 0.5 ) );
+    holed << ( QgsPolyline() << QgsPoint( x + 0.6, y + 0.6 ) << QgsPoint( x + 0.6, y + 0.8 ) << QgsPoint( x + 0.8, y + 0.8 ) << QgsPoint( x + 0.8, y + 0.6 ) << QgsPoint( x + 0.6, y + 0.6 ) );
+
+    QgsFeature f;
+    f.setGeometry( QgsGeometry::fromMultiPolygon( QgsMultiPolygon() << outer << holed ) );
+    f.addAttribute( 0, i );
+    features << f;
+  }
+  layer->dataProvider()->addFeatures( features );
+  return layer;
+}
+
+QgsVectorDataProvider* TestQgsSpatiaLiteProvider::benchmarkProvider()
+{
+  if ( !mBenchmarkLayer )
+  {
+    QgsVectorLayer* memoryLayer = createMultiPolygonLayer( 20000 );
+    if ( !memoryLayer )
+    {
+      return 0;
+    }
+    mBenchmarkLayer = copyToSpatiaLite( memoryLayer, "benchmarkpolys" );
+    delete memoryLayer;
+  }
+  return mBenchmarkLayer ? mBenchmarkLayer->dataProvider() : 0;
+}
+
+void TestQgsSpatiaLiteProvider::fullScan()
+{
+  QgsVectorDataProvider* shapeProvider = mShapeLayer->dataProvider();
+  QgsVectorDataProvider* provider = mSpatiaLiteLayer->dataProvider();
+  QCOMPARE( provider->featureCount(), shapeProvider->featureCount() );
+
+  //the OGR SQLite driver launders the field names to lower case
+  int nameIndex = provider->fieldNameIndex( "name" );
+  int valueIndex = provider->fieldNameIndex( "value" );
+  QVERIFY( nameIndex >= 0 );
+  QVERIFY( valueIndex >= 0 );
+
+  shapeProvider->select( shapeProvider->attributeIndexes() );
+  provider->select( provider->attributeIndexes() );
+
+  QgsFeature shapeFeature, feature;
+  int count = 0;
+  while ( shapeProvider->nextFeature( shapeFeature ) )
+  {
+    QVERIFY( provider->nextFeature( feature ) );
+    QVERIFY( feature.geometry() );
+    QCOMPARE( feature.geometry()->exportToWkt(), shapeFeature.geometry()->exportToWkt() );
+    QCOMPARE( feature.attributeMap()[ nameIndex ].toString(), shapeFeature.attributeMap()[ 0 ].toString() );
+    QCOMPARE( feature.attributeMap()[ valueIndex ].toDouble(), shapeFeature.attributeMap()[ 1 ].toDouble() );
+    ++count;
+  }
+  QVERIFY( !provider->nextFeature( feature ) );
+  QCOMPARE( count, ( int ) shapeProvider->featureCount() );
+
+  //a second scan of the same shape reuses the statement
+  provider->select( provider->attributeIndexes() );
+  count = 0;
+  while ( provider->nextFeature( feature ) )
+  {
+    ++count;
+  }
+  QCOMPARE( count, ( int ) shapeProvider->featureCount() );
+}
+
+void TestQgsSpatiaLiteProvider::featureAtId()
+{
+  QgsVectorDataProvider* provider = mSpatiaLiteLayer->dataProvider();
+
+  QList<QgsFeature> features;
+  QgsFeature f;
+  provider->select( provider->attributeIndexes() );
+  while ( provider->nextFeature( f ) )
+  {
+    features << f;
+  }
+  QVERIFY( !features.isEmpty() );
+
+  //twice, the second round runs on the cached statement
+  for ( int round = 0; round < 2; ++round )
+  {
+    for ( int i = 0; i < features.size(); ++i )
+    {
+      QgsFeature feature;
+      QVERIFY( provider->featureAtId( features[i].id(), feature, true, provider->attributeIndexes() ) );
+      QCOMPARE( feature.id(), features[i].id() );
+      QCOMPARE( feature.geometry()->exportToWkt(), features[i].geometry()->exportToWkt() );
+      QCOMPARE( feature.attributeMap().size(), features[i].attributeMap().size() );
+    }
+  }
+
+  //the geometry flag of featureAtId is independent of the last select
+  provider->select( QgsAttributeList(), QgsRectangle(), false );
+  QgsFeature feature;
+  QVERIFY( provider->featureAtId( features[0].id(), feature, true ) );
+  QVERIFY( feature.geometry() );
+  QVERIFY( provider->featureAtId( features[0].id(), feature, false ) );
+  QVERIFY( !feature.geometry() );
+
+  QVERIFY( !provider->featureAtId( -1, feature ) );
+}
+
+void TestQgsSpatiaLiteProvider::attributeRestriction()
+{
+  QgsVectorDataProvider* provider = mSpatiaLiteLayer->dataProvider();
+  int valueIndex = provider->fieldNameIndex( "value" );
+
+  provider->select( QgsAttributeList() << valueIndex, QgsRectangle(), false );
+  QgsFeature f;
+  QVERIFY( provider->nextFeature( f ) );
+  QCOMPARE( f.attributeMap().size(), 1 );
+  QVERIFY( f.attributeMap().contains( valueIndex ) );
+  QVERIFY( !f.geometry() );
+
+  provider->select( QgsAttributeList(), QgsRectangle(), true );
+  QVERIFY( provider->nextFeature( f ) );
+  QVERIFY( f.attributeMap().isEmpty() );
+  QVERIFY( f.geometry() );
+}
+
+void TestQgsSpatiaLiteProvider::rectangleSelect()
+{
+  QgsVectorDataProvider* shapeProvider = mShapeLayer->dataProvider();
+  QgsVectorDataProvider* provider = mSpatiaLiteLayer->dataProvider();
+  QgsRectangle extent = shapeProvider->extent();
+
+  //the quarters of the extent, panning reuses the statement with other bindings
+  for ( int i = 0; i < 4; ++i )
+  {
+    double width = extent.width() / 2;
+    double height = extent.height() / 2;
+    double xMin = extent.xMinimum() + ( i % 2 ) * width;
+    double yMin = extent.yMinimum() + ( i / 2 ) * height;
+    QgsRectangle rect( xMin, yMin, xMin + width, yMin + height );
+
+    QStringList shapeGeometries;
+    QgsFeature f;
+    shapeProvider->select( QgsAttributeList(), rect, true, true );
+    while ( shapeProvider->nextFeature( f ) )
+    {
+      shapeGeometries << f.geometry()->exportToWkt();
+    }
+
+    QStringList geometries;
+    provider->select( QgsAttributeList(), rect, true, true );
+    while ( provider->nextFeature( f ) )
+    {
+      QVERIFY( f.geometry()->intersects( rect ) );
+      geometries << f.geometry()->exportToWkt();
+    }
+
+    shapeGeometries.sort();
+    geometries.sort();
+    QCOMPARE( geometries, shapeGeometries );
+  }
+}
+
+void TestQgsSpatiaLiteProvider::multiPolygons()
+{
+  QgsVectorLayer* memoryLayer = createMultiPolygonLayer( 20 );
+  QVERIFY( memoryLayer );
+  QgsVectorLayer* layer = copyToSpatiaLite( memoryLayer, "multipolys" );
+  QVERIFY( layer );
+
+  QgsVectorDataProvider* memoryProvider = memoryLayer->dataProvider();
+  QgsVectorDataProvider* provider = layer->dataProvider();
+  QCOMPARE( provider->featureCount(), memoryProvider->featureCount() );
+
+  memoryProvider->select( QgsAttributeList() );
+  provider->select( QgsAttributeList() );
+  QgsFeature memoryFeature, feature;
+  while ( memoryProvider->nextFeature( memoryFeature ) )
+  {
+    QVERIFY( provider->nextFeature( feature ) );
+    QVERIFY( feature.geometry() );
+    QCOMPARE( feature.geometry()->wkbType(), QGis::WKBMultiPolygon );
+    QCOMPARE( feature.geometry()->exportToWkt(), memoryFeature.geometry()->exportToWkt() );
+  }
+
+  delete layer;
+  delete memoryLayer;
+}
+
+void TestQgsSpatiaLiteProvider::benchmarkFeatureAtId()
+{
+  if ( qgetenv( "QGIS_LARGE_BENCHMARKS" ).isEmpty() )
+  {
+    QSKIP( "writing the benchmark layer takes long, set QGIS_LARGE_BENCHMARKS to run it", SkipSingle );
+  }
+
+  QgsVectorDataProvider* provider = benchmarkProvider();
+  QVERIFY( provider );
+  QList<int> ids;
+  QgsFeature f;
+  provider->select( QgsAttributeList(), QgsRectangle(), false );
+  while ( provider->nextFeature( f ) )
+  {
+    ids << f.id();
+  }
+
+  QBENCHMARK
+  {
+    for ( int i = 0; i < ids.size(); ++i )
+    {
+      provider->featureAtId( ids[i], f, true, provider->attributeIndexes() );
+    }
+  }
+}
+
+void TestQgsSpatiaLiteProvider::benchmarkFullScan()
+{
+  if ( qgetenv( "QGIS_LARGE_BENCHMARKS" ).isEmpty() )
+  {
+    QSKIP( "writing the benchmark layer takes long, set QGIS_LARGE_BENCHMARKS to run it", SkipSingle );
+  }
+
+  QgsVectorDataProvider* provider = benchmarkProvider();
+  QVERIFY( provider );
+
+  QBENCHMARK
+  {
+    provider->select( provider->attributeIndexes() );
+    QgsFeature f;
+    while ( provider->nextFeature( f ) )
+      ;
+  }
+}
+
+QTEST_MAIN( TestQgsSpatiaLiteProvider )
+#include "moc_testqgsspatialiteprovider.cxx"
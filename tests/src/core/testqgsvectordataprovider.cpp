@@ -0,0 +1,157 @@
+/***************************************************************************
+     testqgsvectordataprovider.cpp
+     --------------------------------------
+    Date                 : October 2010
+    Copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QList>
+#include <QVariant>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgsfeature.h>
+#include <qgsfield.h>
+#include <qgsgeometry.h>
+#include <qgsproviderregistry.h>
+#include <qgsvectorlayer.h>
+//header for class being tested
+#include <qgsvectordataprovider.h>
+
+/** Tests the default attribute statistics of QgsVectorDataProvider
+ * with a memory layer */
+class TestQgsVectorDataProvider: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init();// will be called before each testfunction is executed.
+    void cleanup();// will be called after every testfunction.
+    void aggregates();
+    void quantiles();
+    void uniqueValues();
+    void cacheInvalidation();
+
+  private:
+    QgsVectorLayer* mLayer;
+    QgsVectorDataProvider* mProvider;
+};
+
+void TestQgsVectorDataProvider::initTestCase()
+{
+  QgsApplication::setPrefixPath( INSTALL_PREFIX, true );
+  QgsApplication::showSettings();
+  // Instantiate the plugin directory so that providers are loaded
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+}
+
+void TestQgsVectorDataProvider::cleanupTestCase()
+{
+}
+
+void TestQgsVectorDataProvider::init()
+{
+  //attribute 0: the values 1...100 and every 11th feature null, attribute 1: ten different strings
+  mLayer = new QgsVectorLayer( "Point", "points", "memory" );
+  QVERIFY( mLayer->isValid() );
+  mProvider = mLayer->dataProvider();
+  mProvider->addAttributes( QList<QgsField>() << QgsField( "value", QVariant::Double ) << QgsField( "name", QVariant::String ) );
+
+  QgsFeatureList features;
+  for ( int i = 1; i <= 110; ++i )
+  {
+    QgsFeature f;
+    f.setGeometry( QgsGeometry::fromPoint( QgsPoint( i, i ) ) );
+    f.addAttribute( 0, i % 11 == 0 ? QVariant( QVariant::Double ) : QVariant( i - i / 11 ) );
+    f.addAttribute( 1, QString( "name%1" ).arg( i % 10 ) );
+    features << f;
+  }
+  mProvider->addFeatures( features );
+}
+
+void TestQgsVectorDataProvider::cleanup()
+{
+  delete mLayer;
+}
+
+void TestQgsVectorDataProvider::aggregates()
+{
+  QCOMPARE( mProvider->aggregateValue( 0, QgsVectorDataProvider::Count ).toInt(), 100 );
+  QCOMPARE( mProvider->aggregateValue( 0, QgsVectorDataProvider::Sum ).toDouble(), 5050.0 );
+  QCOMPARE( mProvider->aggregateValue( 0, QgsVectorDataProvider::Minimum ).toDouble(), 1.0 );
+  QCOMPARE( mProvider->aggregateValue( 0, QgsVectorDataProvider::Maximum ).toDouble(), 100.0 );
+  QCOMPARE( mProvider->minimumValue( 0 ).toDouble(), 1.0 );
+  QCOMPARE( mProvider->maximumValue( 0 ).toDouble(), 100.0 );
+
+  QCOMPARE( mProvider->aggregateValue( 1, QgsVectorDataProvider::Count ).toInt(), 110 );
+  QVERIFY( mProvider->aggregateValue( 1, QgsVectorDataProvider::Sum ).isNull() );
+  QCOMPARE( mProvider->minimumValue( 1 ).toString(), QString( "name0" ) );
+  QCOMPARE( mProvider->maximumValue( 1 ).toString(), QString( "name9" ) );
+
+  QVERIFY( mProvider->minimumValue( 5 ).isNull() );
+}
+
+void TestQgsVectorDataProvider::quantiles()
+{
+  QList<double> breaks = mProvider->quantiles( 0, 4 );
+  QCOMPARE( breaks.size(), 4 );
+  QCOMPARE( breaks[0], 25.75 );
+  QCOMPARE( breaks[1], 50.5 );
+  QCOMPARE( breaks[2], 75.25 );
+  QCOMPARE( breaks[3], 100.0 );
+
+  //the sorted values are cached, other class numbers do not fetch the features again
+  breaks = mProvider->quantiles( 0, 2 );
+  QCOMPARE( breaks.size(), 2 );
+  QCOMPARE( breaks[0], 50.5 );
+}
+
+void TestQgsVectorDataProvider::uniqueValues()
+{
+  QList<QVariant> values;
+  mProvider->uniqueValues( 1, values, 3 );
+  QCOMPARE( values.size(), 3 );
+
+  mProvider->uniqueValues( 1, values );
+  QCOMPARE( values.size(), 10 );
+
+  //answered from the cached complete list
+  mProvider->uniqueValues( 1, values, 5 );
+  QCOMPARE( values.size(), 5 );
+  mProvider->uniqueValues( 1, values, 20 );
+  QCOMPARE( values.size(), 10 );
+}
+
+void TestQgsVectorDataProvider::cacheInvalidation()
+{
+  QCOMPARE( mProvider->maximumValue( 0 ).toDouble(), 100.0 );
+  QCOMPARE( mProvider->quantiles( 0, 1 ).last(), 100.0 );
+  QList<QVariant> values;
+  mProvider->uniqueValues( 1, values );
+  QCOMPARE( values.size(), 10 );
+
+  //the memory provider numbers the features from 1
+  QgsAttributeMap attributes;
+  attributes[0] = 1000.0;
+  attributes[1] = QString( "other" );
+  QgsChangedAttributesMap changes;
+  changes[1] = attributes;
+  QVERIFY( mProvider->changeAttributeValues( changes ) );
+
+  QCOMPARE( mProvider->maximumValue( 0 ).toDouble(), 1000.0 );
+  QCOMPARE( mProvider->quantiles( 0, 1 ).last(), 1000.0 );
+  mProvider->uniqueValues( 1, values );
+  QCOMPARE( values.size(), 11 );
+}
+
+QTEST_MAIN( TestQgsVectorDataProvider )
+#include "moc_testqgsvectordataprovider.cxx"
@@ -29,6 +29,7 @@
 #include <qgscoordinatereferencesystem.h> //needed for creating a srs
 #include <qgsapplication.h> //search path for srs.db
 #include <qgsfield.h>
+#include <qgsproviderregistry.h> //needed to read the written file back
 #include <qgis.h> //defines GEOWkt
 
 /** \ingroup UnitTests
@@ -70,6 +71,10 @@ class TestQgsVectorFileWriter: public QObject
     void polygonGridTest();
     /** As above but using a projected CRS*/
     void projectedPlygonGridTest();
+    /** This method tests that queued features are written in order */
+    void backgroundWriting();
+    /** This method tests that failures of queued features are counted */
+    void backgroundWriteErrors();
 
   private:
     // a little util fn used by all tests
@@ -389,6 +394,77 @@ void TestQgsVectorFileWriter::projectedPlygonGridTest()
   }
 }
 
+void TestQgsVectorFileWriter::backgroundWriting()
+{
+  QString myFileName = QDir::tempPath() + "/testbackground.shp";
+  QVERIFY( QgsVectorFileWriter::deleteShapeFile( myFileName ) );
+  const int myCount = 5000;
+  {
+    QgsVectorFileWriter myWriter( myFileName,
+                                  mEncoding,
+                                  mFields,
+                                  QGis::WKBPoint,
+                                  &mCRS );
+    QVERIFY( myWriter.hasError() == QgsVectorFileWriter::NoError );
+    myWriter.setBackgroundWriting( true, 100 );
+    for ( int i = 0; i < myCount; ++i )
+    {
+      QgsFeature myFeature;
+      myFeature.setGeometry( QgsGeometry::fromPoint( QgsPoint( i, i ) ) );
+      myFeature.addAttribute( 0, QString::number( i ) );
+      QVERIFY( myWriter.addFeature( myFeature ) );
+    }
+    QVERIFY( myWriter.flush() );
+    QVERIFY( myWriter.hasError() == QgsVectorFileWriter::NoError );
+    QCOMPARE( myWriter.failedFeatures(), 0 );
+  }
+
+  QgsProviderRegistry::instance( QgsApplication::pluginPath() );
+  QgsVectorLayer myLayer( myFileName, "background", "ogr" );
+  QVERIFY( myLayer.isValid() );
+  QCOMPARE(( int ) myLayer.featureCount(), myCount );
+  myLayer.select( myLayer.pendingAllAttributesList(), QgsRectangle(), true );
+  QgsFeature myFeature;
+  int i = 0;
+  while ( myLayer.nextFeature( myFeature ) )
+  {
+    QCOMPARE( myFeature.attributeMap()[0].toString(), QString::number( i ) );
+    QCOMPARE( myFeature.geometry()->asPoint().x(), ( double ) i );
+    ++i;
+  }
+  QCOMPARE( i, myCount );
+}
+
+void TestQgsVectorFileWriter::backgroundWriteErrors()
+{
+  QString myFileName = QDir::tempPath() + "/testbackgrounderrors.shp";
+  QVERIFY( QgsVectorFileWriter::deleteShapeFile( myFileName ) );
+  QgsVectorFileWriter myWriter( myFileName,
+                                mEncoding,
+                                mFields,
+                                QGis::WKBPoint,
+                                &mCRS );
+  QVERIFY( myWriter.hasError() == QgsVectorFileWriter::NoError );
+  myWriter.setBackgroundWriting( true, 10 );
+
+  //a point shapefile does not accept lines
+  const int myCount = 100;
+  for ( int i = 0; i < myCount; ++i )
+  {
+    QgsPolyline myPolyline;
+    myPolyline << QgsPoint( i, i ) << QgsPoint( i + 1, i );
+    QgsFeature myFeature;
+    myFeature.setGeometry( QgsGeometry::fromPolyline( myPolyline ) );
+    myFeature.addAttribute( 0, QString::number( i ) );
+    //queued features are accepted, failures of the features added before are only counted
+    QVERIFY( myWriter.addFeature( myFeature ) );
+    QVERIFY( myWriter.failedFeatures() <= i );
+  }
+  QVERIFY( !myWriter.flush() );
+  QVERIFY( myWriter.hasError() == QgsVectorFileWriter::ErrFeatureWriteFailed );
+  QCOMPARE( myWriter.failedFeatures(), myCount );
+}
+
 QTEST_MAIN( TestQgsVectorFileWriter )
 #include "moc_testqgsvectorfilewriter.cxx"
 
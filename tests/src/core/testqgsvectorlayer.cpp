@@ -31,6 +31,9 @@
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
 #include <qgsmaplayerregistry.h>
+#include <qgsfeature.h>
+#include <qgsfield.h>
+#include <qgsgeometry.h>
 //qgis test includes
 #include "qgsrenderchecker.h"
 
@@ -217,6 +220,83 @@ class TestQgsVectorLayer: public QObject
     void QgsVectorLayerselect()
     {
 
+    };
+    void QgsVectorLayerselectRectangleEditBuffer()
+    {
+      QgsVectorLayer* myLayer = new QgsVectorLayer( "Point", "editbuffer", "memory" );
+      QVERIFY( myLayer->isValid() );
+      QgsVectorDataProvider* myProvider = myLayer->dataProvider();
+      myProvider->addAttributes( QList<QgsField>() << QgsField( "name", QVariant::String ) );
+
+      //provider features 1 to 4 on the diagonal, the rectangle contains 1 and 2
+      QgsFeatureList myFeatures;
+      for ( int i = 0; i < 4; ++i )
+      {
+        QgsFeature f;
+        f.setGeometry( QgsGeometry::fromPoint( QgsPoint( i * 10 + 5, i * 10 + 5 ) ) );
+        f.addAttribute( 0, QString( "provider %1" ).arg( i + 1 ) );
+        myFeatures << f;
+      }
+      myProvider->addFeatures( myFeatures );
+      QgsRectangle myRect( 0, 0, 20, 20 );
+
+      QVERIFY( myLayer->startEditing() );
+      //added features inside and outside of the rectangle and without geometry
+      QgsFeature myInside;
+      myInside.setGeometry( QgsGeometry::fromPoint( QgsPoint( 12, 12 ) ) );
+      myInside.addAttribute( 0, QString( "added inside" ) );
+      QVERIFY( myLayer->addFeature( myInside ) );
+      QgsFeature myOutside;
+      myOutside.setGeometry( QgsGeometry::fromPoint( QgsPoint( 50, 50 ) ) );
+      myOutside.addAttribute( 0, QString( "added outside" ) );
+      QVERIFY( myLayer->addFeature( myOutside ) );
+      QgsFeature myNoGeometry;
+      myNoGeometry.addAttribute( 0, QString( "added without geometry" ) );
+      QVERIFY( myLayer->addFeature( myNoGeometry ) );
+      QgsFeature myDeleted;
+      myDeleted.setGeometry( QgsGeometry::fromPoint( QgsPoint( 8, 8 ) ) );
+      QVERIFY( myLayer->addFeature( myDeleted ) );
+      QVERIFY( myLayer->deleteFeature( myDeleted.id() ) );
+
+      //move 2 out of and 3 into the rectangle, move the added feature outside of the rectangle into it
+      QMap<int, QgsPoint> myMoves;
+      myMoves.insert( 2, QgsPoint( 60, 60 ) );
+      myMoves.insert( 3, QgsPoint( 18, 2 ) );
+      myMoves.insert( myOutside.id(), QgsPoint( 1, 19 ) );
+      for ( QMap<int, QgsPoint>::const_iterator it = myMoves.constBegin(); it != myMoves.constEnd(); ++it )
+      {
+        QgsGeometry* myGeometry = QgsGeometry::fromPoint( it.value() );
+        QVERIFY( myLayer->changeGeometry( it.key(), myGeometry ) );
+        delete myGeometry;
+      }
+      //delete 1
+      QVERIFY( myLayer->deleteFeature( 1 ) );
+
+      QSet<int> myIds;
+      QgsFeature f;
+      myLayer->select( QgsAttributeList() << 0, myRect, true, false );
+      while ( myLayer->nextFeature( f ) )
+      {
+        QVERIFY( !myIds.contains( f.id() ) );
+        myIds << f.id();
+        QCOMPARE( f.attributeMap().size(), 1 );
+      }
+      QSet<int> myExpected;
+      myExpected << 3 << myInside.id() << myOutside.id() << myNoGeometry.id();
+      QCOMPARE( myIds, myExpected );
+
+      //without rectangle every feature that was not deleted is returned
+      myIds.clear();
+      myLayer->select( QgsAttributeList(), QgsRectangle(), false, false );
+      while ( myLayer->nextFeature( f ) )
+      {
+        myIds << f.id();
+      }
+      myExpected << 2 << 4;
+      QCOMPARE( myIds, myExpected );
+
+      myLayer->rollBack();
+      delete myLayer;
     };
     void QgsVectorLayerinvertSelection()
     {
@@ -0,0 +1,117 @@
+/***************************************************************************
+     testqgsmstilecache.cpp
+     --------------------------------------
+    Date                 : October 2010
+    Copyright            : (C) 2010 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+
+//header for class being tested
+#include "qgsmstilecache.h"
+
+/** \ingroup UnitTests
+ * Tests the keys of the server tile cache for tiling clients
+ */
+class TestQgsMSTileCache: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void gridPosition();
+    void roundedNeighbourHitsCache();
+    void unalignedBBox();
+  private:
+    /**Parameters of a GetMap request for a 256x256 tile*/
+    std::map<QString, QString> tileParameters( const QString& bbox ) const;
+    /**Width of a web mercator tile at zoom level 10*/
+    double mTileWidth;
+};
+
+void TestQgsMSTileCache::initTestCase()
+{
+  //the singleton reads its configuration when it is created
+  qputenv( "QGIS_SERVER_TILE_CACHE_SIZE", "10" );
+  qputenv( "QGIS_SERVER_METATILE_SIZE", "4" );
+  mTileWidth = 40075016.685578488 / 1024;
+}
+
+std::map<QString, QString> TestQgsMSTileCache::tileParameters( const QString& bbox ) const
+{
+  std::map<QString, QString> parameters;
+  parameters["REQUEST"] = "GetMap";
+  parameters["LAYERS"] = "roads";
+  parameters["STYLES"] = "";
+  parameters["SRS"] = "EPSG:900913";
+  parameters["FORMAT"] = "image/png";
+  parameters["WIDTH"] = "256";
+  parameters["HEIGHT"] = "256";
+  parameters["BBOX"] = bbox;
+  return parameters;
+}
+
+void TestQgsMSTileCache::gridPosition()
+{
+  QgsMSTileCache* tileCache = QgsMSTileCache::instance();
+  int column, row;
+  double tileWidth, tileHeight;
+
+  //a tile below and left of the origin with coordinates rounded to 6 decimals like OpenLayers does
+  QString bbox = QString( "%1,%2,%3,%4" ).arg( -7 * mTileWidth, 0, 'f', 6 ).arg( -3 * mTileWidth, 0, 'f', 6 )
+                 .arg( -6 * mTileWidth, 0, 'f', 6 ).arg( -2 * mTileWidth, 0, 'f', 6 );
+  QVERIFY( tileCache->gridPosition( bbox, column, row, tileWidth, tileHeight ) );
+  QCOMPARE( column, -7 );
+  QCOMPARE( row, -3 );
+  QVERIFY( qAbs( tileWidth - mTileWidth ) < 1E-6 );
+  QVERIFY( qAbs( tileHeight - mTileWidth ) < 1E-6 );
+}
+
+void TestQgsMSTileCache::roundedNeighbourHitsCache()
+{
+  QgsMSTileCache* tileCache = QgsMSTileCache::instance();
+  QVERIFY( tileCache->enabled() );
+
+  //the metatile renderer stores the neighbour (13/5) of a requested tile under its grid position
+  QString requestBBox = QString( "%1,%2,%3,%4" ).arg( 12 * mTileWidth, 0, 'f', 6 ).arg( 5 * mTileWidth, 0, 'f', 6 )
+                        .arg( 13 * mTileWidth, 0, 'f', 6 ).arg( 6 * mTileWidth, 0, 'f', 6 );
+  int column, row;
+  double tileWidth, tileHeight;
+  QVERIFY( tileCache->gridPosition( requestBBox, column, row, tileWidth, tileHeight ) );
+  QString neighbourKey = tileCache->tileKey( tileParameters( requestBBox ), "project.qgs", column + 1, row, tileWidth, tileHeight );
+  tileCache->insertTile( neighbourKey, QByteArray( 2048, 'x' ) );
+
+  //a later request for the neighbour with the client's rounding finds it
+  QString neighbourBBox = QString( "%1,%2,%3,%4" ).arg( 13 * mTileWidth, 0, 'f', 6 ).arg( 5 * mTileWidth, 0, 'f', 6 )
+                          .arg( 14 * mTileWidth, 0, 'f', 6 ).arg( 6 * mTileWidth, 0, 'f', 6 );
+  QString requestKey = tileCache->cacheKey( tileParameters( neighbourBBox ), "project.qgs" );
+  QCOMPARE( requestKey, neighbourKey );
+  QVERIFY( tileCache->searchTile( requestKey ) );
+
+  //other layers or sizes don't share the tile
+  std::map<QString, QString> otherParameters = tileParameters( neighbourBBox );
+  otherParameters["WIDTH"] = "512";
+  QVERIFY( !tileCache->searchTile( tileCache->cacheKey( otherParameters, "project.qgs" ) ) );
+}
+
+void TestQgsMSTileCache::unalignedBBox()
+{
+  QgsMSTileCache* tileCache = QgsMSTileCache::instance();
+  int column, row;
+  double tileWidth, tileHeight;
+  QString bbox = QString( "%1,%2,%3,%4" ).arg( 12.3 * mTileWidth, 0, 'f', 6 ).arg( 5 * mTileWidth, 0, 'f', 6 )
+                 .arg( 13.3 * mTileWidth, 0, 'f', 6 ).arg( 6 * mTileWidth, 0, 'f', 6 );
+  QVERIFY( !tileCache->gridPosition( bbox, column, row, tileWidth, tileHeight ) );
+  QVERIFY( tileCache->cacheKey( tileParameters( bbox ), "project.qgs" ).contains( "BBOX=" ) );
+}
+
+QTEST_MAIN( TestQgsMSTileCache )
+#include "moc_testqgsmstilecache.cxx"
+